@@ -0,0 +1,57 @@
+#ifndef _FMATH_BENCH_BENCH_H_
+#define _FMATH_BENCH_BENCH_H_
+
+#include <chrono>
+#include <cstdio>
+
+#include <fmath/fmath.h>
+
+namespace fmath
+{
+namespace bench
+{
+
+// Best wall time of func over repetitions runs, in milliseconds. The best run is the one least disturbed by the rest
+// of the system.
+template<typename FunctionT>
+double measure(size_t repetitions, FunctionT &&func)
+{
+    double best = constants::Inf<double>::value;
+    for (index_t i = 0; i < repetitions; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        const auto end = std::chrono::steady_clock::now();
+        best = min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+// Fewer runs of the larger inputs, so that every size takes about as long
+inline size_t repetitionsFor(size_t count)
+{
+    return clamp(static_cast<size_t>(3000000) / max(count, static_cast<size_t>(1)), static_cast<size_t>(1),
+        static_cast<size_t>(20));
+}
+
+// Times func on a single worker and on one worker per hardware thread, and prints both
+template<typename FunctionT>
+void compareWorkers(const char *name, size_t count, FunctionT &&func)
+{
+    const size_t repetitions = repetitionsFor(count);
+    internal::setWorkerLimit(1);
+    const double serial = measure(repetitions, func);
+    internal::setWorkerLimit(0);
+    const double parallel = measure(repetitions, func);
+    std::printf("%-28s %10zu   1 worker %10.2f ms   %2zu workers %10.2f ms   speedup %5.2f\n", name, count, serial,
+        internal::workerCount(), parallel, serial / parallel);
+}
+
+void benchBvh(size_t max_count);
+
+void benchSweepAndPrune(size_t max_count);
+
+}
+}
+
+#endif
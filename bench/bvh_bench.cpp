@@ -0,0 +1,49 @@
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+namespace fmath
+{
+namespace bench
+{
+
+namespace
+{
+
+// Small boxes spread uniformly over a cube, as the triangles of a finely tessellated scene
+std::vector<Box3<float>> makeBoxes(size_t count)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(0.0F, 100.0F);
+    std::uniform_real_distribution<float> size(0.01F, 0.5F);
+    std::vector<Box3<float>> boxes;
+    boxes.reserve(count);
+    for (index_t i = 0; i < count; ++i)
+    {
+        const Point3f lower(position(rng), position(rng), position(rng));
+        boxes.emplace_back(lower, lower + Vector3f(size(rng), size(rng), size(rng)));
+    }
+    return boxes;
+}
+
+}
+
+void benchBvh(size_t max_count)
+{
+    BvhBuildOptions options;
+    options.method = BvhBuildMethod::Linear;
+    for (size_t count = 100000; count <= max_count; count *= 10)
+    {
+        const std::vector<Box3<float>> boxes = makeBoxes(count);
+        compareWorkers("lbvh build", count, [&]()
+        {
+            const Bvh<float> bvh(boxes.data(), boxes.size(), options);
+            if (bvh.nodeCount() == 0)
+                std::printf("empty tree\n");
+        });
+    }
+}
+
+}
+}
@@ -0,0 +1,13 @@
+#include <cstdlib>
+
+#include "bench.h"
+
+// fmath_bench [max_count] runs every benchmark on the inputs up to max_count elements, ten million by default
+int main(int argc, char **argv)
+{
+    const size_t max_count = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 10000000;
+
+    fmath::bench::benchBvh(max_count);
+    fmath::bench::benchSweepAndPrune(max_count);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+namespace fmath
+{
+namespace bench
+{
+
+namespace
+{
+
+constexpr size_t SWEEP_AND_PRUNE_COUNT = 100000;
+constexpr size_t SWEEP_AND_PRUNE_FRAMES = 16;
+
+// Boxes swinging around their rest positions in a cube. Every box goes through a whole period over the frames, so
+// replaying them from the first frame again is one more small step.
+std::vector<std::vector<Box3<float>>> makeMovingBoxes(size_t count, size_t frame_count)
+{
+    constexpr float SIZE = 100.0F;
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> position(0.0F, SIZE);
+    std::uniform_real_distribution<float> amplitude(-1.0F, 1.0F);
+    std::uniform_real_distribution<float> phase(0.0F, 2.0F * constants::Pi<float>::value);
+    std::uniform_real_distribution<float> extent(0.1F, 0.5F);
+
+    std::vector<std::vector<Box3<float>>> frames(frame_count, std::vector<Box3<float>>(count));
+    for (index_t i = 0; i < count; ++i)
+    {
+        const Point3f rest(position(rng), position(rng), position(rng));
+        const Vector3f swing(amplitude(rng), amplitude(rng), amplitude(rng));
+        const Vector3f half_size(extent(rng), extent(rng), extent(rng));
+        const float start = phase(rng);
+        for (index_t f = 0; f < frame_count; ++f)
+        {
+            const float angle = start + 2.0F * constants::Pi<float>::value * static_cast<float>(f) /
+                static_cast<float>(frame_count);
+            const Point3f center = rest + swing * std::sin(angle);
+            frames[f][i] = Box3<float>(center - half_size, center + half_size);
+        }
+    }
+    return frames;
+}
+
+}
+
+void benchSweepAndPrune(size_t max_count)
+{
+    const size_t count = min(SWEEP_AND_PRUNE_COUNT, max_count);
+    const std::vector<std::vector<Box3<float>>> frames = makeMovingBoxes(count, SWEEP_AND_PRUNE_FRAMES);
+    SweepAndPrunef sweep_and_prune;
+    sweep_and_prune.build(frames.back().data(), count);
+    std::vector<SweepAndPrunef::PairType> pairs;
+
+    size_t pair_count = 0;
+    compareWorkers("sap 16 frames", count, [&]()
+    {
+        for (const auto &frame : frames)
+        {
+            sweep_and_prune.update(frame.data(), count);
+            sweep_and_prune.findPairs(pairs);
+            pair_count += pairs.size();
+        }
+    });
+    std::printf("%-28s %10zu pairs per frame\n", "", pair_count / (2 * repetitionsFor(count) * frames.size()));
+}
+
+}
+}
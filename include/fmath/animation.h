@@ -0,0 +1,725 @@
+#ifndef _FMATH_ANIMATION_H_
+#define _FMATH_ANIMATION_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "common.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "transform.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+namespace internal
+{
+
+// Number of scalars in a key value
+template<typename KeyT>
+struct KeyComponents;
+
+template<typename T, size_t N>
+struct KeyComponents<Vector<T, N>>
+{
+    static constexpr size_t COUNT = N;
+};
+
+template<typename T>
+struct KeyComponents<Quat<T>>
+{
+    static constexpr size_t COUNT = 4;
+};
+
+// Index of the last of count sorted times not greater than time, starting the search at hint
+template<typename T>
+FMATH_INLINE index_t findKey(const T *times, size_t count, const T &time, index_t hint)
+{
+    FMATH_ASSERT(count != 0);
+    hint = min(hint, count - 1);
+
+    // Sequential playback lands on the same or the next couple of keys
+    if (times[hint] <= time)
+    {
+        for (index_t i = 0; i < 2 && hint + 1 < count && times[hint + 1] <= time; ++i)
+            ++hint;
+        if (hint + 1 == count || time < times[hint + 1])
+            return hint;
+    }
+
+    const T *it = std::upper_bound(times, times + count, time);
+    return it == times ? 0 : static_cast<index_t>(it - times) - 1;
+}
+
+}
+
+// Keyframes of a single channel of one bone, key times and values are kept in two separate arrays. Tracks are how
+// keys are authored, clips store them as KeyframeChannel.
+template<typename T, typename KeyT>
+class KeyframeTrack
+{
+public:
+    using ValueType = T;
+    using KeyType = KeyT;
+
+public:
+    KeyframeTrack() = default;
+
+    explicit KeyframeTrack(std::vector<ValueType> times, std::vector<KeyType> values);
+
+    FMATH_INLINE size_t size() const;
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE const T *times() const;
+
+    FMATH_INLINE const KeyT *values() const;
+
+    FMATH_INLINE T duration() const;
+
+    // Keys must be added in increasing time order
+    FMATH_INLINE void add(const ValueType &time, const KeyType &value);
+
+    FMATH_INLINE void reserve(size_t count);
+
+    FMATH_INLINE void clear();
+
+    // Index of the last key whose time is not greater than time, starting the search at hint
+    FMATH_INLINE index_t find(const ValueType &time, index_t hint = 0) const;
+
+private:
+    std::vector<ValueType> times_;
+    std::vector<KeyType> values_;
+};
+
+template<typename T>
+using Vector3Track = KeyframeTrack<T, Vector3<T>>;
+
+template<typename T>
+using QuatTrack = KeyframeTrack<T, Quat<T>>;
+
+// One channel of every bone of a clip in structure of arrays order: the key times of all bones in one array and every
+// component of the key values in an array of its own, with the keys of a bone running from offset(bone) to
+// offset(bone + 1). Sampling the channel for a whole skeleton walks a few contiguous arrays instead of one allocation
+// per bone.
+template<typename T, typename KeyT>
+class KeyframeChannel
+{
+public:
+    using ValueType = T;
+    using KeyType = KeyT;
+    static constexpr size_t COMPONENTS = internal::KeyComponents<KeyT>::COUNT;
+
+public:
+    KeyframeChannel();
+
+    explicit KeyframeChannel(size_t bone_count);
+
+    FMATH_INLINE size_t boneCount() const;
+
+    // Keys of every bone
+    FMATH_INLINE size_t size() const;
+
+    FMATH_INLINE size_t size(index_t bone) const;
+
+    FMATH_INLINE bool empty(index_t bone) const;
+
+    // Index of the first key of bone in times() and components()
+    FMATH_INLINE index_t offset(index_t bone) const;
+
+    FMATH_INLINE const T *times() const;
+
+    FMATH_INLINE const T *components(index_t component) const;
+
+    // Gathers the value of the key at index from the component arrays
+    FMATH_INLINE KeyT key(index_t index) const;
+
+    // Latest key time of every bone
+    FMATH_INLINE T duration() const;
+
+    // Replaces the keys of bone. Setting the bones in increasing order only appends.
+    void set(index_t bone, const KeyframeTrack<T, KeyT> &track);
+
+    KeyframeTrack<T, KeyT> track(index_t bone) const;
+
+    void resize(size_t bone_count);
+
+private:
+    std::vector<index_t> offsets_;
+    std::vector<ValueType> times_;
+    std::vector<ValueType> components_[COMPONENTS];
+};
+
+template<typename T>
+using Vector3Channel = KeyframeChannel<T, Vector3<T>>;
+
+template<typename T>
+using QuatChannel = KeyframeChannel<T, Quat<T>>;
+
+// Rotation track sampled with squad. The control quaternions of every key are computed once on construction, after
+// flipping each key into the hemisphere of the previous one, so sampling costs a key lookup and three slerps.
+template<typename T>
+class QuatSpline
+{
+public:
+    using ValueType = T;
+
+public:
+    QuatSpline() = default;
+
+    explicit QuatSpline(const QuatTrack<ValueType> &track);
+
+    FMATH_INLINE size_t size() const;
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE const QuatTrack<ValueType> &track() const;
+
+    FMATH_INLINE const Quat<ValueType> *controls() const;
+
+    // Time is clamped to the keys. cursor is the search hint of KeyframeTrack::find and receives the key used.
+    FMATH_INLINE Quat<ValueType> sample(const ValueType &time, index_t &cursor) const;
+
+    FMATH_INLINE Quat<ValueType> sample(const ValueType &time) const;
+
+    // Samples count times, fastest when they are sorted as along a camera path
+    void sample(const ValueType *times, Quat<ValueType> *result, size_t count) const;
+
+private:
+    QuatTrack<ValueType> track_;
+    std::vector<Quat<ValueType>> controls_;
+};
+
+// Translation, rotation and scale keys of every bone, each channel stored as one KeyframeChannel. A bone without keys
+// in a channel keeps the identity for it.
+template<typename T>
+class AnimationClip
+{
+public:
+    using ValueType = T;
+
+public:
+    AnimationClip() = default;
+
+    explicit AnimationClip(size_t bone_count);
+
+    FMATH_INLINE size_t boneCount() const;
+
+    FMATH_INLINE T duration() const;
+
+    FMATH_INLINE const Vector3Channel<T> &translations() const;
+
+    FMATH_INLINE Vector3Channel<T> &translations();
+
+    FMATH_INLINE const QuatChannel<T> &rotations() const;
+
+    FMATH_INLINE QuatChannel<T> &rotations();
+
+    FMATH_INLINE const Vector3Channel<T> &scales() const;
+
+    FMATH_INLINE Vector3Channel<T> &scales();
+
+    FMATH_INLINE void resize(size_t bone_count);
+
+private:
+    Vector3Channel<T> translations_;
+    QuatChannel<T> rotations_;
+    Vector3Channel<T> scales_;
+};
+
+// Samples clips into poses. The sampler remembers the key used last for every track, so playing a clip forwards
+// only ever steps a key or two instead of searching. A sampler must not be shared between threads.
+template<typename T>
+class AnimationSampler
+{
+public:
+    using ValueType = T;
+
+public:
+    AnimationSampler() = default;
+
+    // Time is clamped to the keys of every track, wrap it before calling for looping playback.
+    // pose must hold clip.boneCount() entries.
+    void sample(const AnimationClip<ValueType> &clip, const ValueType &time, TRS<ValueType> *pose);
+
+    void sample(const AnimationClip<ValueType> &clip, const ValueType &time, Matrix4<ValueType> *pose);
+
+    // Forgets the cached keys, needed only to release memory since the cache is validated on every use
+    FMATH_INLINE void reset();
+
+private:
+    // Global index of the key of bone before time in cursor, which holds the index within the bone in between calls
+    template<typename KeyT>
+    FMATH_INLINE bool findKeys(const KeyframeChannel<ValueType, KeyT> &channel, index_t bone, const ValueType &time,
+        index_t &cursor, index_t &key, ValueType &t) const;
+
+private:
+    std::vector<index_t> cursors_;
+    std::vector<Quat<ValueType>> rotation_from_;
+    std::vector<Quat<ValueType>> rotation_to_;
+    std::vector<ValueType> rotation_t_;
+    std::vector<index_t> rotation_bones_;
+    std::vector<TRS<ValueType>> scratch_;
+};
+
+// One character to evaluate in sampleAnimations
+template<typename T>
+struct AnimationJob
+{
+    AnimationSampler<T> *sampler = nullptr;
+    const AnimationClip<T> *clip = nullptr;
+    T time = 0;
+    TRS<T> *pose = nullptr;
+};
+
+// Evaluates independent characters in parallel, every job needs its own sampler
+template<typename T>
+void sampleAnimations(const AnimationJob<T> *jobs, size_t count)
+{
+    internal::parallelFor(0, count, 1, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            jobs[i].sampler->sample(*jobs[i].clip, jobs[i].time, jobs[i].pose);
+    });
+}
+
+template<typename T, typename KeyT>
+KeyframeTrack<T, KeyT>::KeyframeTrack(std::vector<ValueType> times, std::vector<KeyType> values)
+    :   times_(std::move(times)),
+        values_(std::move(values))
+{
+    FMATH_ASSERT(times_.size() == values_.size());
+    FMATH_ASSERT(std::is_sorted(times_.begin(), times_.end()));
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE size_t KeyframeTrack<T, KeyT>::size() const
+{
+    return times_.size();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE bool KeyframeTrack<T, KeyT>::empty() const
+{
+    return times_.empty();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE const T *KeyframeTrack<T, KeyT>::times() const
+{
+    return times_.data();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE const KeyT *KeyframeTrack<T, KeyT>::values() const
+{
+    return values_.data();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE T KeyframeTrack<T, KeyT>::duration() const
+{
+    return times_.empty() ? static_cast<T>(0) : times_.back();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE void KeyframeTrack<T, KeyT>::add(const ValueType &time, const KeyType &value)
+{
+    FMATH_ASSERT(times_.empty() || times_.back() <= time);
+    times_.push_back(time);
+    values_.push_back(value);
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE void KeyframeTrack<T, KeyT>::reserve(size_t count)
+{
+    times_.reserve(count);
+    values_.reserve(count);
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE void KeyframeTrack<T, KeyT>::clear()
+{
+    times_.clear();
+    values_.clear();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE index_t KeyframeTrack<T, KeyT>::find(const ValueType &time, index_t hint) const
+{
+    return internal::findKey(times_.data(), times_.size(), time, hint);
+}
+
+template<typename T, typename KeyT>
+KeyframeChannel<T, KeyT>::KeyframeChannel()
+    :   offsets_(1, 0)
+{}
+
+template<typename T, typename KeyT>
+KeyframeChannel<T, KeyT>::KeyframeChannel(size_t bone_count)
+    :   offsets_(bone_count + 1, 0)
+{}
+
+template<typename T, typename KeyT>
+FMATH_INLINE size_t KeyframeChannel<T, KeyT>::boneCount() const
+{
+    return offsets_.size() - 1;
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE size_t KeyframeChannel<T, KeyT>::size() const
+{
+    return times_.size();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE size_t KeyframeChannel<T, KeyT>::size(index_t bone) const
+{
+    FMATH_ASSERT(bone < boneCount());
+    return offsets_[bone + 1] - offsets_[bone];
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE bool KeyframeChannel<T, KeyT>::empty(index_t bone) const
+{
+    return size(bone) == 0;
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE index_t KeyframeChannel<T, KeyT>::offset(index_t bone) const
+{
+    FMATH_ASSERT(bone <= boneCount());
+    return offsets_[bone];
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE const T *KeyframeChannel<T, KeyT>::times() const
+{
+    return times_.data();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE const T *KeyframeChannel<T, KeyT>::components(index_t component) const
+{
+    FMATH_ASSERT(component < COMPONENTS);
+    return components_[component].data();
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE KeyT KeyframeChannel<T, KeyT>::key(index_t index) const
+{
+    KeyT result;
+    for (index_t c = 0; c < COMPONENTS; ++c)
+        result[c] = components_[c][index];
+    return result;
+}
+
+template<typename T, typename KeyT>
+FMATH_INLINE T KeyframeChannel<T, KeyT>::duration() const
+{
+    return times_.empty() ? static_cast<T>(0) : *std::max_element(times_.begin(), times_.end());
+}
+
+template<typename T, typename KeyT>
+void KeyframeChannel<T, KeyT>::set(index_t bone, const KeyframeTrack<T, KeyT> &track)
+{
+    FMATH_ASSERT(bone < boneCount());
+    const index_t begin = offsets_[bone];
+    const index_t end = offsets_[bone + 1];
+    const size_t count = track.size();
+
+    times_.erase(times_.begin() + begin, times_.begin() + end);
+    times_.insert(times_.begin() + begin, track.times(), track.times() + count);
+    for (index_t c = 0; c < COMPONENTS; ++c)
+    {
+        std::vector<ValueType> &component = components_[c];
+        component.erase(component.begin() + begin, component.begin() + end);
+        component.insert(component.begin() + begin, count, static_cast<ValueType>(0));
+        for (index_t i = 0; i < count; ++i)
+            component[begin + i] = track.values()[i][c];
+    }
+
+    for (index_t i = bone + 1; i < offsets_.size(); ++i)
+        offsets_[i] = offsets_[i] - (end - begin) + count;
+}
+
+template<typename T, typename KeyT>
+KeyframeTrack<T, KeyT> KeyframeChannel<T, KeyT>::track(index_t bone) const
+{
+    FMATH_ASSERT(bone < boneCount());
+    const index_t begin = offsets_[bone];
+    const index_t end = offsets_[bone + 1];
+    std::vector<KeyType> values(end - begin);
+    for (index_t i = begin; i < end; ++i)
+        values[i - begin] = key(i);
+    return KeyframeTrack<T, KeyT>(std::vector<ValueType>(times_.begin() + begin, times_.begin() + end),
+        std::move(values));
+}
+
+template<typename T, typename KeyT>
+void KeyframeChannel<T, KeyT>::resize(size_t bone_count)
+{
+    if (bone_count < boneCount())
+    {
+        const index_t end = offsets_[bone_count];
+        times_.resize(end);
+        for (index_t c = 0; c < COMPONENTS; ++c)
+            components_[c].resize(end);
+    }
+    offsets_.resize(bone_count + 1, offsets_.back());
+}
+
+template<typename T>
+QuatSpline<T>::QuatSpline(const QuatTrack<ValueType> &track)
+{
+    const size_t count = track.size();
+    std::vector<ValueType> times(track.times(), track.times() + count);
+    std::vector<Quat<ValueType>> keys(track.values(), track.values() + count);
+    for (index_t i = 1; i < count; ++i)
+    {
+        if (dot(keys[i - 1], keys[i]) < static_cast<ValueType>(0))
+            keys[i] = -keys[i];
+    }
+
+    controls_.resize(count);
+    squadControls(keys.data(), controls_.data(), count);
+    track_ = QuatTrack<ValueType>(std::move(times), std::move(keys));
+}
+
+template<typename T>
+FMATH_INLINE size_t QuatSpline<T>::size() const
+{
+    return track_.size();
+}
+
+template<typename T>
+FMATH_INLINE bool QuatSpline<T>::empty() const
+{
+    return track_.empty();
+}
+
+template<typename T>
+FMATH_INLINE const QuatTrack<T> &QuatSpline<T>::track() const
+{
+    return track_;
+}
+
+template<typename T>
+FMATH_INLINE const Quat<T> *QuatSpline<T>::controls() const
+{
+    return controls_.data();
+}
+
+template<typename T>
+FMATH_INLINE Quat<T> QuatSpline<T>::sample(const ValueType &time, index_t &cursor) const
+{
+    cursor = track_.find(time, cursor);
+    const ValueType *times = track_.times();
+    const Quat<ValueType> *keys = track_.values();
+    if (cursor + 1 >= track_.size() || time <= times[cursor])
+        return keys[cursor];
+
+    const ValueType t = (time - times[cursor]) / (times[cursor + 1] - times[cursor]);
+    return squad(keys[cursor], keys[cursor + 1], controls_[cursor], controls_[cursor + 1], t);
+}
+
+template<typename T>
+FMATH_INLINE Quat<T> QuatSpline<T>::sample(const ValueType &time) const
+{
+    index_t cursor = 0;
+    return sample(time, cursor);
+}
+
+template<typename T>
+void QuatSpline<T>::sample(const ValueType *times, Quat<ValueType> *result, size_t count) const
+{
+    index_t cursor = 0;
+    for (index_t i = 0; i < count; ++i)
+        result[i] = sample(times[i], cursor);
+}
+
+template<typename T>
+AnimationClip<T>::AnimationClip(size_t bone_count)
+    :   translations_(bone_count),
+        rotations_(bone_count),
+        scales_(bone_count)
+{}
+
+template<typename T>
+FMATH_INLINE size_t AnimationClip<T>::boneCount() const
+{
+    return rotations_.boneCount();
+}
+
+template<typename T>
+FMATH_INLINE T AnimationClip<T>::duration() const
+{
+    return max(translations_.duration(), rotations_.duration(), scales_.duration());
+}
+
+template<typename T>
+FMATH_INLINE const Vector3Channel<T> &AnimationClip<T>::translations() const
+{
+    return translations_;
+}
+
+template<typename T>
+FMATH_INLINE Vector3Channel<T> &AnimationClip<T>::translations()
+{
+    return translations_;
+}
+
+template<typename T>
+FMATH_INLINE const QuatChannel<T> &AnimationClip<T>::rotations() const
+{
+    return rotations_;
+}
+
+template<typename T>
+FMATH_INLINE QuatChannel<T> &AnimationClip<T>::rotations()
+{
+    return rotations_;
+}
+
+template<typename T>
+FMATH_INLINE const Vector3Channel<T> &AnimationClip<T>::scales() const
+{
+    return scales_;
+}
+
+template<typename T>
+FMATH_INLINE Vector3Channel<T> &AnimationClip<T>::scales()
+{
+    return scales_;
+}
+
+template<typename T>
+FMATH_INLINE void AnimationClip<T>::resize(size_t bone_count)
+{
+    translations_.resize(bone_count);
+    rotations_.resize(bone_count);
+    scales_.resize(bone_count);
+}
+
+template<typename T>
+    template<typename KeyT>
+FMATH_INLINE bool AnimationSampler<T>::findKeys(const KeyframeChannel<ValueType, KeyT> &channel, index_t bone,
+    const ValueType &time, index_t &cursor, index_t &key, ValueType &t) const
+{
+    const size_t count = channel.size(bone);
+    const ValueType *times = channel.times() + channel.offset(bone);
+    cursor = internal::findKey(times, count, time, cursor);
+    key = channel.offset(bone) + cursor;
+    if (cursor + 1 >= count || time <= times[cursor])
+    {
+        // Clamped to the first or the last key
+        t = static_cast<ValueType>(0);
+        return false;
+    }
+    t = (time - times[cursor]) / (times[cursor + 1] - times[cursor]);
+    return true;
+}
+
+template<typename T>
+void AnimationSampler<T>::sample(const AnimationClip<ValueType> &clip, const ValueType &time, TRS<ValueType> *pose)
+{
+    const size_t bone_count = clip.boneCount();
+    cursors_.resize(bone_count * 3, 0);
+    rotation_from_.resize(bone_count);
+    rotation_to_.resize(bone_count);
+    rotation_t_.resize(bone_count);
+    rotation_bones_.resize(bone_count);
+
+    const Vector3Channel<ValueType> &translations = clip.translations();
+    const QuatChannel<ValueType> &rotations = clip.rotations();
+    const Vector3Channel<ValueType> &scales = clip.scales();
+    size_t rotation_count = 0;
+    index_t key;
+    ValueType t;
+
+    for (index_t bone = 0; bone < bone_count; ++bone)
+    {
+        TRS<ValueType> &result = pose[bone];
+        index_t *cursor = &cursors_[bone * 3];
+
+        if (translations.empty(bone))
+            result.translation = Vector3<ValueType>(0, 0, 0);
+        else if (findKeys(translations, bone, time, cursor[0], key, t))
+            result.translation = lerp(translations.key(key), translations.key(key + 1), t);
+        else
+            result.translation = translations.key(key);
+
+        if (rotations.empty(bone))
+        {
+            result.rotation = Quat<ValueType>::identity();
+        }
+        else if (findKeys(rotations, bone, time, cursor[1], key, t))
+        {
+            // Interpolated below in a single batch
+            rotation_from_[rotation_count] = rotations.key(key);
+            rotation_to_[rotation_count] = rotations.key(key + 1);
+            rotation_t_[rotation_count] = t;
+            rotation_bones_[rotation_count] = bone;
+            ++rotation_count;
+        }
+        else
+        {
+            result.rotation = rotations.key(key);
+        }
+
+        if (scales.empty(bone))
+            result.scale = Vector3<ValueType>(1, 1, 1);
+        else if (findKeys(scales, bone, time, cursor[2], key, t))
+            result.scale = lerp(scales.key(key), scales.key(key + 1), t);
+        else
+            result.scale = scales.key(key);
+    }
+
+    slerpFast(rotation_from_.data(), rotation_to_.data(), rotation_t_.data(), rotation_from_.data(), rotation_count);
+    for (index_t i = 0; i < rotation_count; ++i)
+        pose[rotation_bones_[i]].rotation = rotation_from_[i];
+}
+
+template<typename T>
+void AnimationSampler<T>::sample(const AnimationClip<ValueType> &clip, const ValueType &time, Matrix4<ValueType> *pose)
+{
+    scratch_.resize(clip.boneCount());
+    sample(clip, time, scratch_.data());
+    for (index_t bone = 0; bone < scratch_.size(); ++bone)
+        pose[bone] = scratch_[bone].toMatrix();
+}
+
+template<typename T>
+FMATH_INLINE void AnimationSampler<T>::reset()
+{
+    cursors_ = std::vector<index_t>();
+    rotation_from_ = std::vector<Quat<ValueType>>();
+    rotation_to_ = std::vector<Quat<ValueType>>();
+    rotation_t_ = std::vector<ValueType>();
+    rotation_bones_ = std::vector<index_t>();
+    scratch_ = std::vector<TRS<ValueType>>();
+}
+
+using Vector3Trackf = Vector3Track<float>;
+using Vector3Tracklf = Vector3Track<double>;
+
+using QuatTrackf = QuatTrack<float>;
+using QuatTracklf = QuatTrack<double>;
+
+using Vector3Channelf = Vector3Channel<float>;
+using Vector3Channellf = Vector3Channel<double>;
+
+using QuatChannelf = QuatChannel<float>;
+using QuatChannellf = QuatChannel<double>;
+
+using AnimationClipf = AnimationClip<float>;
+using AnimationCliplf = AnimationClip<double>;
+
+using AnimationSamplerf = AnimationSampler<float>;
+using AnimationSamplerlf = AnimationSampler<double>;
+
+}
+
+#endif
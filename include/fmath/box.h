@@ -39,11 +39,11 @@ public:
 
     FMATH_INLINE FMATH_CONSTEXPR Vector<T, N> diagonal() const;
 
-    FMATH_INLINE FMATH_CONSTEXPR bool contains(const Point<ValueType, N> &point);
+    FMATH_INLINE FMATH_CONSTEXPR bool contains(const Point<ValueType, N> &point) const;
 
-    FMATH_INLINE FMATH_CONSTEXPR bool contains(const Box<ValueType, N> &box);
+    FMATH_INLINE FMATH_CONSTEXPR bool contains(const Box<ValueType, N> &box) const;
 
-    FMATH_INLINE FMATH_CONSTEXPR bool overlaps(const Box<ValueType, N> &box);
+    FMATH_INLINE FMATH_CONSTEXPR bool overlaps(const Box<ValueType, N> &box) const;
 
     FMATH_INLINE FMATH_CONSTEXPR bool isEmpty() const;
 
@@ -195,19 +195,19 @@ FMATH_INLINE FMATH_CONSTEXPR Vector<T, N> Box<T, N>::diagonal() const
 }
 
 template<typename T, size_t N>
-FMATH_INLINE FMATH_CONSTEXPR bool Box<T, N>::contains(const Point<ValueType, N> &point)
+FMATH_INLINE FMATH_CONSTEXPR bool Box<T, N>::contains(const Point<ValueType, N> &point) const
 {
     return point >= min_ && point <= max_;
 }
 
 template<typename T, size_t N>
-FMATH_INLINE FMATH_CONSTEXPR bool Box<T, N>::contains(const Box<ValueType, N> &box)
+FMATH_INLINE FMATH_CONSTEXPR bool Box<T, N>::contains(const Box<ValueType, N> &box) const
 {
     return box.min_ >= min_ && box.max_ <= max_;
 }
 
 template<typename T, size_t N>
-FMATH_INLINE FMATH_CONSTEXPR bool Box<T, N>::overlaps(const Box<ValueType, N> &box)
+FMATH_INLINE FMATH_CONSTEXPR bool Box<T, N>::overlaps(const Box<ValueType, N> &box) const
 {
     return min_ <= box.max_ && max_ >= box.min_;
 }
@@ -222,7 +222,7 @@ template<typename T, size_t N>
 FMATH_INLINE Box<T, N> &Box<T, N>::add(const Box &other)
 {
     min_ = componentWiseMin(min_, other.min_);
-    max_ = componentWiseMax(max_, other,max_);
+    max_ = componentWiseMax(max_, other.max_);
     return *this;
 }
 
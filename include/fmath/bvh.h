@@ -0,0 +1,1666 @@
+#ifndef _FMATH_BVH_H_
+#define _FMATH_BVH_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "morton.h"
+#include "point.h"
+#include "ray.h"
+#include "sphere.h"
+#include "triangle.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// 32 bytes for float. Inner nodes have a count of 0 and their two children stored next to each other at first and
+// first + 1, leaves reference count entries of the primitive index array starting at first.
+template<typename T>
+struct BvhNode
+{
+    T lower[3];
+    uint32 first;
+    T upper[3];
+    uint32 count;
+
+    FMATH_INLINE bool isLeaf() const;
+
+    FMATH_INLINE Box3<T> bounds() const;
+};
+
+static_assert(sizeof(BvhNode<float>) == 32, "BvhNode<float> must fill half a cache line");
+
+enum class BvhBuildMethod : uint8
+{
+    // Binned SAH, the better trees for static geometry
+    BinnedSah,
+    // Morton-ordered LBVH, several times faster to build and meant for geometry rebuilt every frame
+    Linear
+};
+
+struct BvhBuildOptions
+{
+    BvhBuildMethod method = BvhBuildMethod::BinnedSah;
+
+    // Nodes with more primitives are always split, smaller ones become leaves when splitting does not pay off
+    uint32 max_leaf_size = 4;
+};
+
+// Closest intersection of a ray with the triangles of a Bvh
+template<typename T>
+struct RayHit
+{
+    T t = constants::Inf<T>::value;
+    T u = 0;
+    T v = 0;
+    uint32 primitive = ~0U;
+};
+
+// SAH cost and sibling overlap of a Bvh, both relative to the surface area of its root. Rising values after refits
+// tell that the tree no longer fits the geometry and should be rebuilt.
+template<typename T>
+struct BvhQuality
+{
+    // Expected node and primitive tests of a ray through the root, with both tests costing the same as in the builder
+    T sah_cost;
+    // Surface area shared by the bounds of sibling nodes
+    T overlap;
+};
+
+namespace internal
+{
+
+template<typename T>
+struct BvhBounds;
+
+}
+
+// Bounding volume hierarchy over boxes or triangles, built top-down with binned SAH or as an LBVH. Only the tree and
+// a permutation of the primitives are stored, together with the bounds of every primitive for the overlap queries,
+// so traversals receive the primitive indices of the input array. All queries are const and safe to run from
+// several threads.
+template<typename T>
+class Bvh
+{
+public:
+    using ValueType = T;
+    using NodeType = BvhNode<T>;
+
+    // Deep enough for every tree built here. SAH builds switch to median splits past MAX_DEPTH, linear builds are
+    // bounded by the 63 bits of their keys plus the 31 bits that break ties.
+    static constexpr size_t MAX_DEPTH = 64;
+    static constexpr size_t STACK_SIZE = 128;
+
+public:
+    Bvh() = default;
+
+    explicit Bvh(const Box3<ValueType> *boxes, size_t count, const BvhBuildOptions &options = BvhBuildOptions());
+
+    explicit Bvh(const Triangle3<ValueType> *triangles, size_t count,
+        const BvhBuildOptions &options = BvhBuildOptions());
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE size_t nodeCount() const;
+
+    FMATH_INLINE const NodeType *nodes() const;
+
+    FMATH_INLINE size_t primitiveCount() const;
+
+    // Input index of every primitive in leaf order
+    FMATH_INLINE const uint32 *primitiveIndices() const;
+
+    FMATH_INLINE Box3<ValueType> bounds() const;
+
+    // Closest hit. intersector(primitive, ray, t) returns whether the primitive is hit within [ray.t_min, ray.t_max]
+    // and writes the distance to t. The ray passed to it shrinks to every hit accepted, so the last accepted hit is
+    // the closest one.
+    template<typename IntersectorT>
+    bool intersect(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector, ValueType &t) const;
+
+    // Closest hit against the triangles the hierarchy was built from
+    bool intersect(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles,
+        RayHit<ValueType> &hit) const;
+
+    // Any hit, stops at the first primitive the intersector reports
+    template<typename IntersectorT,
+        typename = std::enable_if_t<!std::is_pointer_v<std::remove_reference_t<IntersectorT>>>>
+    bool occluded(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector) const;
+
+    bool occluded(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles) const;
+
+    // Calls func(primitive) for every primitive whose bounds overlap the box or the sphere
+    template<typename FunctionT>
+    void query(const Box3<ValueType> &box, FunctionT &&func) const;
+
+    template<typename FunctionT>
+    void query(const Sphere3<ValueType> &sphere, FunctionT &&func) const;
+
+    // Refits the tree to new bounds of the primitives it was built from, given in input order. The forms with a list
+    // of primitives only touch those and the nodes above them. The topology is kept, so the quality drops as the
+    // geometry deforms.
+    void refit(const Box3<ValueType> *boxes);
+
+    void refit(const Box3<ValueType> *boxes, const uint32 *primitives, size_t count);
+
+    void refit(const Triangle3<ValueType> *triangles);
+
+    void refit(const Triangle3<ValueType> *triangles, const uint32 *primitives, size_t count);
+
+    BvhQuality<ValueType> quality() const;
+
+    // Rebuilds with binned SAH every treelet, the largest subtrees of at most treeletSize() primitives, whose SAH
+    // cost relative to its own root area grew by more than the threshold factor since it was built. Returns the
+    // number of treelets rebuilt.
+    size_t rebuildDegraded(ValueType threshold = static_cast<ValueType>(1.5));
+
+    FMATH_INLINE size_t treeletSize() const;
+
+private:
+    void build(const BvhBuildOptions &options);
+
+    void storeBounds(const std::vector<internal::BvhBounds<ValueType>> &ordered);
+
+    // Parent and leaf links used by refits
+    void link();
+
+    template<typename BoundsFunctionT>
+    void refitPrimitives(const uint32 *primitives, size_t count, BoundsFunctionT &&bounds);
+
+    // Primitive count and absolute SAH cost of every subtree
+    void computeCosts(std::vector<uint32> &counts, std::vector<ValueType> &costs) const;
+
+    // Treelet roots and their depths in depth-first order, which is also the order of the primitive ranges
+    void collectTreelets(const std::vector<uint32> &counts, std::vector<uint32> &roots,
+        std::vector<uint32> &depths) const;
+
+    FMATH_INLINE ValueType relativeCost(const std::vector<ValueType> &costs, uint32 node) const;
+
+private:
+    std::vector<NodeType> nodes_;
+    std::vector<uint32> indices_;
+    std::vector<Box3<ValueType>> primitive_bounds_;
+    std::vector<uint32> parents_;
+    // Leaf order position of every primitive and the leaf node holding every position
+    std::vector<uint32> positions_;
+    std::vector<uint32> leaf_nodes_;
+    // Relative SAH cost of every treelet right after it was built
+    std::vector<ValueType> treelet_costs_;
+    uint32 max_leaf_size_ = 0;
+};
+
+using Bvhf = Bvh<float>;
+using Bvhlf = Bvh<double>;
+
+namespace internal
+{
+
+template<typename T>
+struct BvhBounds
+{
+    using SimdType = simd::Simd<T, 4>;
+
+    // x, y and z in the first three lanes, the last one is padding
+    SimdType lower;
+    SimdType upper;
+
+    static FMATH_INLINE BvhBounds make(const Box3<T> &box)
+    {
+        const T lower[4] = { box.min()[0], box.min()[1], box.min()[2], static_cast<T>(0) };
+        const T upper[4] = { box.max()[0], box.max()[1], box.max()[2], static_cast<T>(0) };
+        return BvhBounds { SimdType::load(lower), SimdType::load(upper) };
+    }
+
+    static FMATH_INLINE BvhBounds makeEmpty()
+    {
+        return BvhBounds { SimdType::broadcast(constants::Inf<T>::value),
+            SimdType::broadcast(-constants::Inf<T>::value) };
+    }
+
+    FMATH_INLINE void grow(const BvhBounds &other)
+    {
+        lower = simd::min(other.lower, lower);
+        upper = simd::max(other.upper, upper);
+    }
+
+    FMATH_INLINE void grow(const SimdType &point)
+    {
+        lower = simd::min(point, lower);
+        upper = simd::max(point, upper);
+    }
+
+    FMATH_INLINE SimdType centroid() const
+    {
+        return (lower + upper) * SimdType::broadcast(static_cast<T>(0.5));
+    }
+
+    FMATH_INLINE Box3<T> box() const
+    {
+        return Box3<T>(Point3<T>(lower.get(0), lower.get(1), lower.get(2)),
+            Point3<T>(upper.get(0), upper.get(1), upper.get(2)));
+    }
+
+    FMATH_INLINE T halfArea() const
+    {
+        const SimdType extent = upper - lower;
+        const T dx = extent.get(0);
+        const T dy = extent.get(1);
+        const T dz = extent.get(2);
+        return dx * dy + dy * dz + dz * dx;
+    }
+};
+
+template<typename T>
+FMATH_INLINE T halfArea(const T *lower, const T *upper)
+{
+    const T dx = upper[0] - lower[0];
+    const T dy = upper[1] - lower[1];
+    const T dz = upper[2] - lower[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> triangleBounds(const Triangle3<T> &triangle)
+{
+    return Box3<T>(componentWiseMin(triangle[0], componentWiseMin(triangle[1], triangle[2])),
+        componentWiseMax(triangle[0], componentWiseMax(triangle[1], triangle[2])));
+}
+
+template<typename T>
+FMATH_INLINE void setBounds(BvhNode<T> &node, const Box3<T> &box)
+{
+    for (index_t k = 0; k < 3; ++k)
+    {
+        node.lower[k] = box.min()[k];
+        node.upper[k] = box.max()[k];
+    }
+}
+
+template<typename T>
+FMATH_INLINE bool intersectNode(const RayPrecomputed<T> &ray, const BvhNode<T> &node, T &t_near)
+{
+    const T *bounds[2] = { node.lower, node.upper };
+    T t0 = ray.t_min;
+    T t1 = ray.t_max;
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const T near_i = (bounds[ray.sign[i]][i] - ray.origin[i]) * ray.inv_direction[i];
+        const T far_i = (bounds[1 - ray.sign[i]][i] - ray.origin[i]) * ray.inv_direction[i];
+        t0 = near_i > t0 ? near_i : t0;
+        t1 = far_i < t1 ? far_i : t1;
+    }
+    t_near = t0;
+    return t0 <= t1;
+}
+
+template<typename T>
+FMATH_INLINE bool overlaps(const T *lower, const T *upper, const Box3<T> &box)
+{
+    return lower[0] <= box.max()[0] && upper[0] >= box.min()[0] &&
+        lower[1] <= box.max()[1] && upper[1] >= box.min()[1] &&
+        lower[2] <= box.max()[2] && upper[2] >= box.min()[2];
+}
+
+template<typename T>
+FMATH_INLINE bool overlaps(const T *lower, const T *upper, const Sphere3<T> &sphere)
+{
+    T distance2 = static_cast<T>(0);
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const T c = sphere.center()[i];
+        const T d = c < lower[i] ? lower[i] - c : (c > upper[i] ? c - upper[i] : static_cast<T>(0));
+        distance2 += d * d;
+    }
+    return distance2 <= sphere.radius() * sphere.radius();
+}
+
+constexpr size_t BVH_GRAIN_SIZE = 16384;
+
+template<typename T>
+void computeBounds(const std::vector<BvhBounds<T>> &boxes, BvhBounds<T> &bounds, BvhBounds<T> &centroid_bounds)
+{
+    const size_t chunk_count = workerCount() * 4;
+    std::vector<BvhBounds<T>> chunk_bounds(chunk_count, BvhBounds<T>::makeEmpty());
+    std::vector<BvhBounds<T>> chunk_centroid_bounds(chunk_count, BvhBounds<T>::makeEmpty());
+    parallelForChunks(boxes.size(), chunk_count, [&](size_t chunk, size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            chunk_bounds[chunk].grow(boxes[i]);
+            chunk_centroid_bounds[chunk].grow(boxes[i].centroid());
+        }
+    });
+
+    bounds = BvhBounds<T>::makeEmpty();
+    centroid_bounds = BvhBounds<T>::makeEmpty();
+    for (index_t i = 0; i < chunk_count; ++i)
+    {
+        bounds.grow(chunk_bounds[i]);
+        centroid_bounds.grow(chunk_centroid_bounds[i]);
+    }
+}
+
+// Depth-first copy of the nodes reachable from the root that keeps siblings together
+template<typename T>
+void compactNodes(const std::vector<BvhNode<T>> &source, std::vector<BvhNode<T>> &nodes)
+{
+    nodes.clear();
+    nodes.reserve(source.size());
+    nodes.push_back(source[0]);
+    std::vector<std::pair<uint32, uint32>> stack { { 0U, 0U } };
+    while (!stack.empty())
+    {
+        const auto [from, to] = stack.back();
+        stack.pop_back();
+        const BvhNode<T> &node = source[from];
+        if (node.count != 0)
+            continue;
+
+        const uint32 first = static_cast<uint32>(nodes.size());
+        nodes[to].first = first;
+        nodes.push_back(source[node.first]);
+        nodes.push_back(source[node.first + 1]);
+        stack.emplace_back(node.first + 1, first + 1);
+        stack.emplace_back(node.first, first);
+    }
+}
+
+// Top-down binned SAH builder. A subtree over n primitives owns 2n - 1 node slots, its root and the 2n - 2 slots
+// starting at first_free for its descendants, so subtrees are built in parallel without sharing an allocator and
+// the result does not depend on the thread count. Slots left unused by multi-primitive leaves are compacted away.
+template<typename T>
+class BvhBuilder
+{
+public:
+    using SimdType = simd::Simd<T, 4>;
+
+    static constexpr size_t BIN_COUNT = 16;
+    static constexpr size_t PARALLEL_BINNING_THRESHOLD = 1 << 15;
+
+    struct Task
+    {
+        uint32 slot;
+        uint32 first_free;
+        uint32 begin;
+        uint32 end;
+        uint32 depth;
+        BvhBounds<T> bounds;
+        BvhBounds<T> centroid_bounds;
+    };
+
+    struct Bin
+    {
+        BvhBounds<T> bounds;
+        uint32 count;
+    };
+
+    using Bins = std::array<std::array<Bin, BIN_COUNT>, 3>;
+
+public:
+    BvhBuilder(std::vector<BvhBounds<T>> boxes, uint32 max_leaf_size, size_t max_depth)
+        :   boxes_(std::move(boxes)),
+            indices_(boxes_.size()),
+            nodes_(boxes_.empty() ? 0 : boxes_.size() * 2 - 1),
+            max_leaf_size_(max(max_leaf_size, 1U)),
+            max_depth_(max_depth)
+    {}
+
+    void run(std::vector<BvhNode<T>> &nodes, std::vector<uint32> &indices)
+    {
+        const size_t count = boxes_.size();
+        if (count == 0)
+            return;
+
+        Task root { 0, 1, 0, static_cast<uint32>(count), 0, BvhBounds<T>::makeEmpty(), BvhBounds<T>::makeEmpty() };
+        computeBounds(boxes_, root.bounds, root.centroid_bounds);
+        parallelFor(0, count, BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                indices_[i] = static_cast<uint32>(i);
+        });
+
+        // Large nodes are split one at a time with parallel binning, until there are enough subtrees to give every
+        // worker its own
+        const size_t worker_count = workerCount();
+        const size_t subtree_size = worker_count > 1 ? max(count / (worker_count * 8), static_cast<size_t>(4096))
+            : count + 1;
+        std::vector<Task> pending { root };
+        std::vector<Task> subtrees;
+        while (!pending.empty())
+        {
+            Task task = pending.back();
+            pending.pop_back();
+            if (task.end - task.begin < subtree_size)
+            {
+                subtrees.push_back(task);
+                continue;
+            }
+            Task children[2];
+            if (split(task, children, true))
+            {
+                pending.push_back(children[0]);
+                pending.push_back(children[1]);
+            }
+        }
+
+        std::sort(subtrees.begin(), subtrees.end(), [](const Task &t1, const Task &t2)
+        {
+            return t1.end - t1.begin > t2.end - t2.begin;
+        });
+        parallelFor(0, subtrees.size(), 1, [&](size_t first, size_t last)
+        {
+            std::vector<Task> stack;
+            for (index_t i = first; i < last; ++i)
+            {
+                stack.push_back(subtrees[i]);
+                while (!stack.empty())
+                {
+                    Task task = stack.back();
+                    stack.pop_back();
+                    Task children[2];
+                    if (split(task, children, false))
+                    {
+                        stack.push_back(children[0]);
+                        stack.push_back(children[1]);
+                    }
+                }
+            }
+        });
+
+        compactNodes(nodes_, nodes);
+        indices = std::move(indices_);
+    }
+
+    // Primitive bounds in leaf order once run returns
+    FMATH_INLINE const std::vector<BvhBounds<T>> &boxes() const
+    {
+        return boxes_;
+    }
+
+private:
+    // Bins of the primitive along the three axes, a zero scale puts everything into the first bin
+    FMATH_INLINE void binIndices(const SimdType &centroid, const SimdType &lower, const SimdType &scale,
+        uint32 bin_count, uint32 *bins) const
+    {
+        T offsets[4];
+        ((centroid - lower) * scale).store(offsets);
+        for (index_t k = 0; k < 3; ++k)
+            bins[k] = min(static_cast<uint32>(offsets[k]), bin_count - 1);
+    }
+
+    void binRange(const Task &task, const SimdType &scale, uint32 bin_count, uint32 begin, uint32 end,
+        Bins &bins) const
+    {
+        for (index_t k = 0; k < 3; ++k)
+        {
+            for (index_t b = 0; b < bin_count; ++b)
+                bins[k][b] = Bin { BvhBounds<T>::makeEmpty(), 0 };
+        }
+
+        for (index_t i = begin; i < end; ++i)
+        {
+            const BvhBounds<T> &box = boxes_[i];
+            uint32 indices[3];
+            binIndices(box.centroid(), task.centroid_bounds.lower, scale, bin_count, indices);
+            for (index_t k = 0; k < 3; ++k)
+            {
+                Bin &bin = bins[k][indices[k]];
+                bin.bounds.grow(box);
+                ++bin.count;
+            }
+        }
+    }
+
+    void binParallel(const Task &task, const SimdType &scale, uint32 bin_count, Bins &bins) const
+    {
+        const size_t chunk_count = workerCount() * 2;
+        std::vector<Bins> chunk_bins(chunk_count);
+        parallelForChunks(task.end - task.begin, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+        {
+            binRange(task, scale, bin_count, task.begin + static_cast<uint32>(begin),
+                task.begin + static_cast<uint32>(end), chunk_bins[chunk]);
+        });
+
+        bins = chunk_bins[0];
+        for (index_t c = 1; c < chunk_count; ++c)
+        {
+            for (index_t k = 0; k < 3; ++k)
+            {
+                for (index_t b = 0; b < bin_count; ++b)
+                {
+                    bins[k][b].bounds.grow(chunk_bins[c][k][b].bounds);
+                    bins[k][b].count += chunk_bins[c][k][b].count;
+                }
+            }
+        }
+    }
+
+    // Moves the primitives left of the split plane to the front and gathers the centroid bounds of both sides. The
+    // boxes move along with the indices so that binning reads them sequentially.
+    uint32 partition(const Task &task, const SimdType &scale, uint32 bin_count, index_t axis, index_t split_bin,
+        BvhBounds<T> *centroid_bounds)
+    {
+        const auto goes_left = [&](uint32 position, SimdType &centroid)
+        {
+            centroid = boxes_[position].centroid();
+            uint32 bins[3];
+            binIndices(centroid, task.centroid_bounds.lower, scale, bin_count, bins);
+            return bins[axis] < split_bin;
+        };
+
+        centroid_bounds[0] = BvhBounds<T>::makeEmpty();
+        centroid_bounds[1] = BvhBounds<T>::makeEmpty();
+        uint32 left = task.begin;
+        uint32 right = task.end;
+        while (true)
+        {
+            SimdType centroid;
+            while (left < right && goes_left(left, centroid))
+            {
+                centroid_bounds[0].grow(centroid);
+                ++left;
+            }
+            while (left < right && !goes_left(right - 1, centroid))
+            {
+                centroid_bounds[1].grow(centroid);
+                --right;
+            }
+            if (left == right)
+                break;
+            std::swap(indices_[left], indices_[right - 1]);
+            std::swap(boxes_[left], boxes_[right - 1]);
+        }
+        return left;
+    }
+
+    // Writes the node of the task, returns false for a leaf and the two child tasks otherwise
+    bool split(const Task &task, Task *children, bool parallel)
+    {
+        BvhNode<T> &node = nodes_[task.slot];
+        for (index_t k = 0; k < 3; ++k)
+        {
+            node.lower[k] = task.bounds.lower.get(k);
+            node.upper[k] = task.bounds.upper.get(k);
+        }
+
+        const uint32 count = task.end - task.begin;
+        if (count == 1)
+            return makeLeaf(task, node);
+
+        // Small nodes are binned coarser, most of the nodes are small and the split quality barely changes
+        const uint32 bin_count = min(static_cast<uint32>(BIN_COUNT), 4 + count / 20);
+        T scales[4] = { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) };
+        bool can_bin = false;
+        for (index_t k = 0; k < 3; ++k)
+        {
+            const T extent = task.centroid_bounds.upper.get(k) - task.centroid_bounds.lower.get(k);
+            scales[k] = extent > static_cast<T>(0) ? static_cast<T>(bin_count) / extent : static_cast<T>(0);
+            can_bin = can_bin || extent > static_cast<T>(0);
+        }
+        const SimdType scale = SimdType::load(scales);
+
+        uint32 mid = task.begin + count / 2;
+        BvhBounds<T> child_bounds[2], child_centroid_bounds[2];
+        if (can_bin && task.depth < max_depth_)
+        {
+            Bins bins;
+            if (parallel && count >= PARALLEL_BINNING_THRESHOLD)
+                binParallel(task, scale, bin_count, bins);
+            else
+                binRange(task, scale, bin_count, task.begin, task.end, bins);
+
+            index_t best_axis = 0;
+            index_t best_split = 0;
+            T best_cost = constants::Inf<T>::value;
+            for (index_t k = 0; k < 3; ++k)
+            {
+                if (scales[k] == static_cast<T>(0))
+                    continue;
+                // Cost of the right side of every split plane, then a left to right sweep
+                T right_costs[BIN_COUNT];
+                BvhBounds<T> right = BvhBounds<T>::makeEmpty();
+                uint32 right_count = 0;
+                for (index_t b = bin_count - 1; b > 0; --b)
+                {
+                    right.grow(bins[k][b].bounds);
+                    right_count += bins[k][b].count;
+                    right_costs[b] = right_count == 0 ? static_cast<T>(0) : right.halfArea() * right_count;
+                }
+                BvhBounds<T> left = BvhBounds<T>::makeEmpty();
+                uint32 left_count = 0;
+                for (index_t b = 1; b < bin_count; ++b)
+                {
+                    left.grow(bins[k][b - 1].bounds);
+                    left_count += bins[k][b - 1].count;
+                    if (left_count == 0 || left_count == count)
+                        continue;
+                    const T cost = left.halfArea() * left_count + right_costs[b];
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = k;
+                        best_split = b;
+                    }
+                }
+            }
+
+            // Traversal and intersection costs are taken as equal
+            const T parent_area = task.bounds.halfArea();
+            const T split_cost = static_cast<T>(1) + best_cost / parent_area;
+            if (count <= max_leaf_size_ && !(split_cost < static_cast<T>(count)))
+                return makeLeaf(task, node);
+
+            if (best_cost < constants::Inf<T>::value)
+            {
+                mid = partition(task, scale, bin_count, best_axis, best_split, child_centroid_bounds);
+                child_bounds[0] = BvhBounds<T>::makeEmpty();
+                child_bounds[1] = BvhBounds<T>::makeEmpty();
+                for (index_t b = 0; b < bin_count; ++b)
+                    child_bounds[b < best_split ? 0 : 1].grow(bins[best_axis][b].bounds);
+                return makeInner(task, node, mid, child_bounds, child_centroid_bounds, children);
+            }
+        }
+
+        if (count <= max_leaf_size_)
+            return makeLeaf(task, node);
+
+        // Coincident centroids or a very deep tree, split at the median along the widest centroid extent
+        index_t axis = 0;
+        const SimdType extent = task.centroid_bounds.upper - task.centroid_bounds.lower;
+        for (index_t k = 1; k < 3; ++k)
+        {
+            if (extent.get(k) > extent.get(axis))
+                axis = k;
+        }
+        std::vector<uint32> order(count);
+        for (index_t i = 0; i < count; ++i)
+            order[i] = task.begin + static_cast<uint32>(i);
+        std::nth_element(order.begin(), order.begin() + (mid - task.begin), order.end(), [&](uint32 p1, uint32 p2)
+        {
+            return boxes_[p1].centroid().get(axis) < boxes_[p2].centroid().get(axis);
+        });
+        std::vector<uint32> indices(count);
+        std::vector<BvhBounds<T>> boxes(count);
+        for (index_t i = 0; i < count; ++i)
+        {
+            indices[i] = indices_[order[i]];
+            boxes[i] = boxes_[order[i]];
+        }
+        std::copy(indices.begin(), indices.end(), indices_.begin() + task.begin);
+        std::copy(boxes.begin(), boxes.end(), boxes_.begin() + task.begin);
+        for (index_t s = 0; s < 2; ++s)
+        {
+            child_bounds[s] = BvhBounds<T>::makeEmpty();
+            child_centroid_bounds[s] = BvhBounds<T>::makeEmpty();
+            const uint32 begin = s == 0 ? task.begin : mid;
+            const uint32 end = s == 0 ? mid : task.end;
+            for (index_t i = begin; i < end; ++i)
+            {
+                child_bounds[s].grow(boxes_[i]);
+                child_centroid_bounds[s].grow(boxes_[i].centroid());
+            }
+        }
+        return makeInner(task, node, mid, child_bounds, child_centroid_bounds, children);
+    }
+
+    FMATH_INLINE bool makeLeaf(const Task &task, BvhNode<T> &node) const
+    {
+        node.first = task.begin;
+        node.count = task.end - task.begin;
+        return false;
+    }
+
+    FMATH_INLINE bool makeInner(const Task &task, BvhNode<T> &node, uint32 mid, const BvhBounds<T> *child_bounds,
+        const BvhBounds<T> *child_centroid_bounds, Task *children) const
+    {
+        node.first = task.first_free;
+        node.count = 0;
+        const uint32 left_count = mid - task.begin;
+        children[0] = Task { task.first_free, task.first_free + 2, task.begin, mid, task.depth + 1,
+            child_bounds[0], child_centroid_bounds[0] };
+        children[1] = Task { task.first_free + 1, task.first_free + 2 * left_count, mid, task.end, task.depth + 1,
+            child_bounds[1], child_centroid_bounds[1] };
+        return true;
+    }
+
+private:
+    std::vector<BvhBounds<T>> boxes_;
+    std::vector<uint32> indices_;
+    std::vector<BvhNode<T>> nodes_;
+    uint32 max_leaf_size_;
+    size_t max_depth_;
+};
+
+FMATH_INLINE uint32 countLeadingZeros(uint64 value)
+{
+#if defined(FMATH_COMPILER_GCC) || defined(FMATH_COMPILER_CLANG)
+    return value == 0 ? 64 : static_cast<uint32>(__builtin_clzll(value));
+#else
+    uint32 count = 0;
+    for (uint64 bit = 1ULL << 63; bit != 0 && (value & bit) == 0; bit >>= 1)
+        ++count;
+    return count;
+#endif
+}
+
+// Linear builder after Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees". The
+// primitives are sorted along a 63-bit Morton curve over their centroids and every internal node is emitted
+// independently from the sorted keys. Internal node k keeps its children in slots 1 + 2k and 2 + 2k, so the nodes
+// come out in the layout Bvh traverses, and the bounds are fitted bottom-up by the second thread to reach a node.
+template<typename T>
+class LbvhBuilder
+{
+public:
+    using SimdType = simd::Simd<T, 4>;
+
+    static constexpr uint32 MORTON_BITS = 21;
+
+public:
+    LbvhBuilder(std::vector<BvhBounds<T>> boxes, uint32 max_leaf_size)
+        :   boxes_(std::move(boxes)),
+            max_leaf_size_(max(max_leaf_size, 1U))
+    {}
+
+    void run(std::vector<BvhNode<T>> &nodes, std::vector<uint32> &indices)
+    {
+        const size_t count = boxes_.size();
+        nodes.clear();
+        indices.clear();
+        if (count == 0)
+            return;
+
+        sortPrimitives();
+        if (count == 1)
+        {
+            nodes.push_back(makeLeaf(0, 1));
+            indices = std::move(indices_);
+            return;
+        }
+
+        nodes_.resize(count * 2 - 1);
+        internal_slots_.resize(count - 1);
+        ranges_.resize(count - 1);
+        leaf_masks_.resize(count - 1);
+        internal_slots_[0] = 0;
+        parallelFor(0, count - 1, BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                emit(static_cast<int64>(i));
+        });
+
+        fit();
+        compactNodes(nodes_, nodes);
+        indices = std::move(indices_);
+    }
+
+    // Primitive bounds in leaf order once run returns
+    FMATH_INLINE const std::vector<BvhBounds<T>> &boxes() const
+    {
+        return boxes_;
+    }
+
+private:
+    void sortPrimitives()
+    {
+        const size_t count = boxes_.size();
+        BvhBounds<T> bounds, centroid_bounds;
+        computeBounds(boxes_, bounds, centroid_bounds);
+
+        T scales[4] = { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) };
+        for (index_t k = 0; k < 3; ++k)
+        {
+            const T extent = centroid_bounds.upper.get(k) - centroid_bounds.lower.get(k);
+            scales[k] = extent > static_cast<T>(0) ? static_cast<T>(1ULL << MORTON_BITS) / extent : static_cast<T>(0);
+        }
+        const SimdType scale = SimdType::load(scales);
+
+        codes_.resize(count);
+        indices_.resize(count);
+        parallelFor(0, count, BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            constexpr uint64 MAX_CELL = (1ULL << MORTON_BITS) - 1;
+            for (index_t i = begin; i < end; ++i)
+            {
+                T cells[4];
+                ((boxes_[i].centroid() - centroid_bounds.lower) * scale).store(cells);
+                uint32 axes[3];
+                for (index_t k = 0; k < 3; ++k)
+                    axes[k] = static_cast<uint32>(min(static_cast<uint64>(cells[k]), MAX_CELL));
+                // x in the highest bit of every triple
+                codes_[i] = encodeMorton64(axes[2], axes[1], axes[0]);
+                indices_[i] = static_cast<uint32>(i);
+            }
+        });
+        parallelRadixSort(codes_.data(), indices_.data(), count, MORTON_BITS * 3);
+
+        std::vector<BvhBounds<T>> sorted(count);
+        parallelFor(0, count, BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                sorted[i] = boxes_[indices_[i]];
+        });
+        boxes_ = std::move(sorted);
+    }
+
+    // Length of the common prefix of two keys, the positions break ties between equal codes
+    FMATH_INLINE int32 delta(int64 i, int64 j) const
+    {
+        if (j < 0 || j >= static_cast<int64>(codes_.size()))
+            return -1;
+        const uint64 a = codes_[i];
+        const uint64 b = codes_[j];
+        if (a == b)
+            return 64 + static_cast<int32>(countLeadingZeros(static_cast<uint64>(i ^ j)));
+        return static_cast<int32>(countLeadingZeros(a ^ b));
+    }
+
+    void emit(int64 i)
+    {
+        // Direction of the range and its far end, found by exponential and then binary search
+        const int64 d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+        const int32 delta_min = delta(i, i - d);
+        int64 length_max = 2;
+        while (delta(i, i + length_max * d) > delta_min)
+            length_max *= 2;
+        int64 length = 0;
+        for (int64 step = length_max / 2; step >= 1; step /= 2)
+        {
+            if (delta(i, i + (length + step) * d) > delta_min)
+                length += step;
+        }
+        const int64 j = i + length * d;
+
+        // Highest differing bit inside the range
+        const int32 delta_node = delta(i, j);
+        int64 split = 0;
+        int64 step = length;
+        do
+        {
+            step = (step + 1) / 2;
+            if (split + step < length && delta(i, i + (split + step) * d) > delta_node)
+                split += step;
+        } while (step > 1);
+        const int64 gamma = i + split * d + min(d, static_cast<int64>(0));
+
+        const int64 first = min(i, j);
+        const int64 last = max(i, j);
+        ranges_[i] = { static_cast<uint32>(first), static_cast<uint32>(last - first + 1) };
+        const int64 children[2] = { gamma, gamma + 1 };
+        const bool leaves[2] = { first == gamma, last == gamma + 1 };
+        leaf_masks_[i] = static_cast<uint8>((leaves[0] ? 1 : 0) | (leaves[1] ? 2 : 0));
+        for (index_t side = 0; side < 2; ++side)
+        {
+            const uint32 slot = static_cast<uint32>(1 + 2 * i + side);
+            if (leaves[side])
+                nodes_[slot] = makeLeaf(static_cast<uint32>(children[side]), 1);
+            else
+                internal_slots_[children[side]] = slot;
+        }
+    }
+
+    // Every leaf walks towards the root, the first thread to reach a node stops there and the second one, which
+    // finds both children done, merges them and carries on
+    void fit()
+    {
+        const size_t internal_count = internal_slots_.size();
+        std::unique_ptr<std::atomic<uint32>[]> arrivals(new std::atomic<uint32>[internal_count]);
+        parallelFor(0, internal_count, BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                arrivals[i].store(0, std::memory_order_relaxed);
+        });
+
+        parallelFor(0, internal_count, BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+            {
+                for (index_t side = 0; side < 2; ++side)
+                {
+                    if ((leaf_masks_[i] & (1U << side)) == 0)
+                        continue;
+
+                    index_t parent = i;
+                    while (arrivals[parent].fetch_add(1, std::memory_order_acq_rel) != 0)
+                    {
+                        const uint32 slot = internal_slots_[parent];
+                        nodes_[slot] = makeInner(static_cast<uint32>(parent));
+                        if (slot == 0)
+                            break;
+                        parent = (slot - 1) / 2;
+                    }
+                }
+            }
+        });
+    }
+
+    FMATH_INLINE BvhNode<T> makeLeaf(uint32 first, uint32 count) const
+    {
+        BvhBounds<T> bounds = BvhBounds<T>::makeEmpty();
+        for (index_t i = first; i < first + count; ++i)
+            bounds.grow(boxes_[i]);
+
+        BvhNode<T> node;
+        for (index_t k = 0; k < 3; ++k)
+        {
+            node.lower[k] = bounds.lower.get(k);
+            node.upper[k] = bounds.upper.get(k);
+        }
+        node.first = first;
+        node.count = count;
+        return node;
+    }
+
+    // Small subtrees collapse into a leaf over their range, compaction drops the nodes below it
+    FMATH_INLINE BvhNode<T> makeInner(uint32 index) const
+    {
+        const std::pair<uint32, uint32> &range = ranges_[index];
+        if (range.second <= max_leaf_size_)
+            return makeLeaf(range.first, range.second);
+
+        const BvhNode<T> &left = nodes_[1 + 2 * index];
+        const BvhNode<T> &right = nodes_[2 + 2 * index];
+        BvhNode<T> node;
+        for (index_t k = 0; k < 3; ++k)
+        {
+            node.lower[k] = min(left.lower[k], right.lower[k]);
+            node.upper[k] = max(left.upper[k], right.upper[k]);
+        }
+        node.first = 1 + 2 * index;
+        node.count = 0;
+        return node;
+    }
+
+private:
+    std::vector<BvhBounds<T>> boxes_;
+    std::vector<uint64> codes_;
+    std::vector<uint32> indices_;
+    std::vector<BvhNode<T>> nodes_;
+    std::vector<uint32> internal_slots_;
+    std::vector<std::pair<uint32, uint32>> ranges_;
+    // Bit s set when child s of an internal node is a leaf of the Karras tree
+    std::vector<uint8> leaf_masks_;
+    uint32 max_leaf_size_;
+};
+
+}
+
+template<typename T>
+FMATH_INLINE bool BvhNode<T>::isLeaf() const
+{
+    return count != 0;
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> BvhNode<T>::bounds() const
+{
+    return Box3<T>(Point3<T>(lower[0], lower[1], lower[2]), Point3<T>(upper[0], upper[1], upper[2]));
+}
+
+template<typename T>
+Bvh<T>::Bvh(const Box3<ValueType> *boxes, size_t count, const BvhBuildOptions &options)
+{
+    primitive_bounds_.assign(boxes, boxes + count);
+    build(options);
+}
+
+template<typename T>
+Bvh<T>::Bvh(const Triangle3<ValueType> *triangles, size_t count, const BvhBuildOptions &options)
+{
+    primitive_bounds_.resize(count);
+    internal::parallelFor(0, count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            primitive_bounds_[i] = internal::triangleBounds(triangles[i]);
+        }
+    });
+    build(options);
+}
+
+template<typename T>
+void Bvh<T>::build(const BvhBuildOptions &options)
+{
+    const size_t count = primitive_bounds_.size();
+    FMATH_ASSERT(count < (1ULL << 31));
+    std::vector<internal::BvhBounds<ValueType>> boxes(count);
+    internal::parallelFor(0, count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            boxes[i] = internal::BvhBounds<ValueType>::make(primitive_bounds_[i]);
+    });
+
+    max_leaf_size_ = max(options.max_leaf_size, 1U);
+    if (options.method == BvhBuildMethod::Linear)
+    {
+        internal::LbvhBuilder<ValueType> builder(std::move(boxes), options.max_leaf_size);
+        builder.run(nodes_, indices_);
+        storeBounds(builder.boxes());
+    }
+    else
+    {
+        internal::BvhBuilder<ValueType> builder(std::move(boxes), options.max_leaf_size, MAX_DEPTH);
+        builder.run(nodes_, indices_);
+        storeBounds(builder.boxes());
+    }
+
+    link();
+    std::vector<uint32> counts, roots, depths;
+    std::vector<ValueType> costs;
+    computeCosts(counts, costs);
+    collectTreelets(counts, roots, depths);
+    treelet_costs_.resize(roots.size());
+    for (index_t i = 0; i < roots.size(); ++i)
+        treelet_costs_[i] = relativeCost(costs, roots[i]);
+}
+
+template<typename T>
+void Bvh<T>::link()
+{
+    const size_t node_count = nodes_.size();
+    const size_t count = indices_.size();
+    parents_.resize(node_count);
+    positions_.resize(count);
+    leaf_nodes_.resize(count);
+    if (node_count != 0)
+        parents_[0] = ~0U;
+
+    internal::parallelFor(0, node_count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            const NodeType &node = nodes_[i];
+            if (node.count == 0)
+            {
+                parents_[node.first] = static_cast<uint32>(i);
+                parents_[node.first + 1] = static_cast<uint32>(i);
+                continue;
+            }
+            for (index_t j = node.first; j < node.first + node.count; ++j)
+            {
+                positions_[indices_[j]] = static_cast<uint32>(j);
+                leaf_nodes_[j] = static_cast<uint32>(i);
+            }
+        }
+    });
+}
+
+// Leaf order, so that a leaf reads its primitive bounds from consecutive memory
+template<typename T>
+void Bvh<T>::storeBounds(const std::vector<internal::BvhBounds<ValueType>> &ordered)
+{
+    const size_t count = ordered.size();
+    internal::parallelFor(0, count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            primitive_bounds_[i] = ordered[i].box();
+    });
+}
+
+template<typename T>
+FMATH_INLINE bool Bvh<T>::empty() const
+{
+    return nodes_.empty();
+}
+
+template<typename T>
+FMATH_INLINE size_t Bvh<T>::nodeCount() const
+{
+    return nodes_.size();
+}
+
+template<typename T>
+FMATH_INLINE const BvhNode<T> *Bvh<T>::nodes() const
+{
+    return nodes_.data();
+}
+
+template<typename T>
+FMATH_INLINE size_t Bvh<T>::primitiveCount() const
+{
+    return indices_.size();
+}
+
+template<typename T>
+FMATH_INLINE const uint32 *Bvh<T>::primitiveIndices() const
+{
+    return indices_.data();
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> Bvh<T>::bounds() const
+{
+    return empty() ? Box3<ValueType>::makeEmpty() : nodes_[0].bounds();
+}
+
+template<typename T>
+    template<typename IntersectorT>
+bool Bvh<T>::intersect(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector, ValueType &t) const
+{
+    struct Entry
+    {
+        uint32 node;
+        ValueType t_near;
+    };
+
+    ValueType t_near;
+    if (empty() || !internal::intersectNode(ray, nodes_[0], t_near))
+        return false;
+
+    RayPrecomputed<ValueType> current = ray;
+    bool hit = false;
+    Entry stack[STACK_SIZE];
+    size_t top = 0;
+    uint32 index = 0;
+    while (true)
+    {
+        const NodeType &node = nodes_[index];
+        if (node.count == 0)
+        {
+            // Visit the nearer child first, the farther one waits on the stack with its entry distance
+            ValueType t0, t1;
+            const bool hit0 = internal::intersectNode(current, nodes_[node.first], t0);
+            const bool hit1 = internal::intersectNode(current, nodes_[node.first + 1], t1);
+            if (hit0 && hit1)
+            {
+                const bool swap = t1 < t0;
+                stack[top++] = Entry { node.first + (swap ? 0U : 1U), swap ? t0 : t1 };
+                index = node.first + (swap ? 1U : 0U);
+                continue;
+            }
+            if (hit0 || hit1)
+            {
+                index = node.first + (hit0 ? 0U : 1U);
+                continue;
+            }
+        }
+        else
+        {
+            for (index_t i = 0; i < node.count; ++i)
+            {
+                ValueType t_hit;
+                if (intersector(indices_[node.first + i], static_cast<const RayPrecomputed<ValueType> &>(current),
+                    t_hit))
+                {
+                    current.t_max = t_hit;
+                    hit = true;
+                }
+            }
+        }
+
+        // Entries farther than the closest hit so far are skipped
+        do
+        {
+            if (top == 0)
+            {
+                if (hit)
+                    t = current.t_max;
+                return hit;
+            }
+            --top;
+        } while (stack[top].t_near > current.t_max);
+        index = stack[top].node;
+    }
+}
+
+template<typename T>
+bool Bvh<T>::intersect(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles,
+    RayHit<ValueType> &hit) const
+{
+    ValueType u = 0, v = 0;
+    uint32 primitive = 0;
+    ValueType t;
+    const bool found = intersect(ray, [&](uint32 index, const RayPrecomputed<ValueType> &r, ValueType &t_hit)
+    {
+        ValueType u_hit, v_hit;
+        if (!fmath::intersect(r, triangles[index], t_hit, u_hit, v_hit))
+            return false;
+        u = u_hit;
+        v = v_hit;
+        primitive = index;
+        return true;
+    }, t);
+
+    if (found)
+        hit = RayHit<ValueType> { t, u, v, primitive };
+    return found;
+}
+
+template<typename T>
+    template<typename IntersectorT, typename>
+bool Bvh<T>::occluded(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector) const
+{
+    ValueType t_near;
+    if (empty() || !internal::intersectNode(ray, nodes_[0], t_near))
+        return false;
+
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    uint32 index = 0;
+    while (true)
+    {
+        const NodeType &node = nodes_[index];
+        if (node.count == 0)
+        {
+            const bool hit0 = internal::intersectNode(ray, nodes_[node.first], t_near);
+            const bool hit1 = internal::intersectNode(ray, nodes_[node.first + 1], t_near);
+            if (hit0 || hit1)
+            {
+                if (hit0 && hit1)
+                    stack[top++] = node.first + 1;
+                index = node.first + (hit0 ? 0U : 1U);
+                continue;
+            }
+        }
+        else
+        {
+            for (index_t i = 0; i < node.count; ++i)
+            {
+                ValueType t_hit;
+                if (intersector(indices_[node.first + i], ray, t_hit))
+                    return true;
+            }
+        }
+
+        if (top == 0)
+            return false;
+        index = stack[--top];
+    }
+}
+
+template<typename T>
+bool Bvh<T>::occluded(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles) const
+{
+    return occluded(ray, [triangles](uint32 index, const RayPrecomputed<ValueType> &r, ValueType &t_hit)
+    {
+        ValueType u, v;
+        return fmath::intersect(r, triangles[index], t_hit, u, v);
+    });
+}
+
+template<typename T>
+    template<typename FunctionT>
+void Bvh<T>::query(const Box3<ValueType> &box, FunctionT &&func) const
+{
+    if (empty())
+        return;
+
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        const NodeType &node = nodes_[stack[--top]];
+        if (!internal::overlaps(node.lower, node.upper, box))
+            continue;
+
+        if (node.count == 0)
+        {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+            continue;
+        }
+        for (index_t i = node.first; i < node.first + node.count; ++i)
+        {
+            const Box3<ValueType> &bounds = primitive_bounds_[i];
+            if (internal::overlaps(bounds.min().data(), bounds.max().data(), box))
+                func(indices_[i]);
+        }
+    }
+}
+
+template<typename T>
+    template<typename FunctionT>
+void Bvh<T>::query(const Sphere3<ValueType> &sphere, FunctionT &&func) const
+{
+    if (empty())
+        return;
+
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        const NodeType &node = nodes_[stack[--top]];
+        if (!internal::overlaps(node.lower, node.upper, sphere))
+            continue;
+
+        if (node.count == 0)
+        {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+            continue;
+        }
+        for (index_t i = node.first; i < node.first + node.count; ++i)
+        {
+            const Box3<ValueType> &bounds = primitive_bounds_[i];
+            if (internal::overlaps(bounds.min().data(), bounds.max().data(), sphere))
+                func(indices_[i]);
+        }
+    }
+}
+
+template<typename T>
+void Bvh<T>::refit(const Box3<ValueType> *boxes)
+{
+    refitPrimitives(nullptr, primitiveCount(), [boxes](uint32 primitive)
+    {
+        return boxes[primitive];
+    });
+}
+
+template<typename T>
+void Bvh<T>::refit(const Box3<ValueType> *boxes, const uint32 *primitives, size_t count)
+{
+    refitPrimitives(primitives, count, [boxes](uint32 primitive)
+    {
+        return boxes[primitive];
+    });
+}
+
+template<typename T>
+void Bvh<T>::refit(const Triangle3<ValueType> *triangles)
+{
+    refitPrimitives(nullptr, primitiveCount(), [triangles](uint32 primitive)
+    {
+        return internal::triangleBounds(triangles[primitive]);
+    });
+}
+
+template<typename T>
+void Bvh<T>::refit(const Triangle3<ValueType> *triangles, const uint32 *primitives, size_t count)
+{
+    refitPrimitives(primitives, count, [triangles](uint32 primitive)
+    {
+        return internal::triangleBounds(triangles[primitive]);
+    });
+}
+
+// Marks the leaves holding the primitives and every node above them, then walks up from the dirty leaves in
+// parallel. A node is merged by the thread that brings the last of its dirty children, so the clean side keeps its
+// bounds and every node is written once.
+template<typename T>
+    template<typename BoundsFunctionT>
+void Bvh<T>::refitPrimitives(const uint32 *primitives, size_t count, BoundsFunctionT &&bounds)
+{
+    if (empty())
+        return;
+
+    const size_t node_count = nodes_.size();
+    std::unique_ptr<std::atomic<uint8>[]> dirty(new std::atomic<uint8>[node_count]);
+    std::unique_ptr<std::atomic<uint8>[]> arrivals(new std::atomic<uint8>[node_count]);
+    internal::parallelFor(0, node_count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            dirty[i].store(primitives == nullptr ? 1 : 0, std::memory_order_relaxed);
+            arrivals[i].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    std::vector<uint32> leaves(primitives == nullptr ? node_count : count);
+    std::atomic<size_t> leaf_count(0);
+    if (primitives == nullptr)
+    {
+        internal::parallelFor(0, count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                primitive_bounds_[positions_[i]] = bounds(static_cast<uint32>(i));
+        });
+        internal::parallelFor(0, node_count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+            {
+                if (nodes_[i].count != 0)
+                    leaves[leaf_count.fetch_add(1, std::memory_order_relaxed)] = static_cast<uint32>(i);
+            }
+        });
+    }
+    else
+    {
+        internal::parallelFor(0, count, internal::BVH_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+            {
+                const uint32 position = positions_[primitives[i]];
+                primitive_bounds_[position] = bounds(primitives[i]);
+
+                uint32 node = leaf_nodes_[position];
+                if (dirty[node].exchange(1, std::memory_order_relaxed) != 0)
+                    continue;
+                leaves[leaf_count.fetch_add(1, std::memory_order_relaxed)] = node;
+                for (node = parents_[node]; node != ~0U; node = parents_[node])
+                {
+                    if (dirty[node].exchange(1, std::memory_order_relaxed) != 0)
+                        break;
+                }
+            }
+        });
+    }
+
+    // Only the bounds are written, first and count stay readable for the other threads
+    internal::parallelFor(0, leaf_count.load(), 256, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            NodeType &leaf = nodes_[leaves[i]];
+            Box3<ValueType> box = primitive_bounds_[leaf.first];
+            for (index_t j = leaf.first + 1; j < leaf.first + leaf.count; ++j)
+            {
+                box = Box3<ValueType>(componentWiseMin(box.min(), primitive_bounds_[j].min()),
+                    componentWiseMax(box.max(), primitive_bounds_[j].max()));
+            }
+            internal::setBounds(leaf, box);
+
+            for (uint32 parent = parents_[leaves[i]]; parent != ~0U; parent = parents_[parent])
+            {
+                NodeType &node = nodes_[parent];
+                const uint32 expected = dirty[node.first].load(std::memory_order_relaxed) +
+                    dirty[node.first + 1].load(std::memory_order_relaxed);
+                if (arrivals[parent].fetch_add(1, std::memory_order_acq_rel) + 1U < expected)
+                    break;
+
+                const NodeType &left = nodes_[node.first];
+                const NodeType &right = nodes_[node.first + 1];
+                for (index_t k = 0; k < 3; ++k)
+                {
+                    node.lower[k] = min(left.lower[k], right.lower[k]);
+                    node.upper[k] = max(left.upper[k], right.upper[k]);
+                }
+            }
+        }
+    });
+}
+
+template<typename T>
+BvhQuality<T> Bvh<T>::quality() const
+{
+    if (empty())
+        return BvhQuality<ValueType> { static_cast<ValueType>(0), static_cast<ValueType>(0) };
+
+    // A fixed chunk count keeps the sums independent of the thread count
+    constexpr size_t CHUNK_COUNT = 64;
+    std::array<ValueType, CHUNK_COUNT> sah_costs {}, overlaps {};
+    internal::parallelForChunks(nodes_.size(), CHUNK_COUNT, [&](size_t chunk, size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            const NodeType &node = nodes_[i];
+            const ValueType area = internal::halfArea(node.lower, node.upper);
+            if (node.count != 0)
+            {
+                sah_costs[chunk] += area * static_cast<ValueType>(node.count);
+                continue;
+            }
+
+            sah_costs[chunk] += area;
+            const NodeType &left = nodes_[node.first];
+            const NodeType &right = nodes_[node.first + 1];
+            ValueType lower[3], upper[3];
+            for (index_t k = 0; k < 3; ++k)
+            {
+                lower[k] = max(left.lower[k], right.lower[k]);
+                upper[k] = max(min(left.upper[k], right.upper[k]), lower[k]);
+            }
+            overlaps[chunk] += internal::halfArea(lower, upper);
+        }
+    });
+
+    BvhQuality<ValueType> result { static_cast<ValueType>(0), static_cast<ValueType>(0) };
+    for (index_t i = 0; i < CHUNK_COUNT; ++i)
+    {
+        result.sah_cost += sah_costs[i];
+        result.overlap += overlaps[i];
+    }
+    const ValueType root_area = internal::halfArea(nodes_[0].lower, nodes_[0].upper);
+    const ValueType scale = root_area > static_cast<ValueType>(0) ? static_cast<ValueType>(1) / root_area
+        : static_cast<ValueType>(0);
+    result.sah_cost *= scale;
+    result.overlap *= scale;
+    return result;
+}
+
+template<typename T>
+size_t Bvh<T>::rebuildDegraded(ValueType threshold)
+{
+    if (empty())
+        return 0;
+
+    std::vector<uint32> counts, roots, depths;
+    std::vector<ValueType> costs;
+    computeCosts(counts, costs);
+    collectTreelets(counts, roots, depths);
+    FMATH_ASSERT(roots.size() == treelet_costs_.size());
+
+    std::vector<index_t> rebuilt;
+    for (index_t i = 0; i < roots.size(); ++i)
+    {
+        if (counts[roots[i]] > max_leaf_size_ && relativeCost(costs, roots[i]) > treelet_costs_[i] * threshold)
+            rebuilt.push_back(i);
+    }
+    if (rebuilt.empty())
+        return 0;
+
+    // The new subtrees go to the end of the node array and replace the old roots, compaction drops the old nodes
+    for (index_t i : rebuilt)
+    {
+        const uint32 root = roots[i];
+        const uint32 count = counts[root];
+        uint32 begin = root;
+        while (nodes_[begin].count == 0)
+            begin = nodes_[begin].first;
+        begin = nodes_[begin].first;
+
+        std::vector<internal::BvhBounds<ValueType>> boxes(count);
+        for (index_t j = 0; j < count; ++j)
+            boxes[j] = internal::BvhBounds<ValueType>::make(primitive_bounds_[begin + j]);
+        const size_t max_depth = MAX_DEPTH > depths[i] ? MAX_DEPTH - depths[i] : 0;
+        internal::BvhBuilder<ValueType> builder(std::move(boxes), max_leaf_size_, max_depth);
+        std::vector<NodeType> nodes;
+        std::vector<uint32> order;
+        builder.run(nodes, order);
+
+        std::vector<uint32> indices(count);
+        for (index_t j = 0; j < count; ++j)
+        {
+            indices[j] = indices_[begin + order[j]];
+            primitive_bounds_[begin + j] = builder.boxes()[j].box();
+        }
+        std::copy(indices.begin(), indices.end(), indices_.begin() + begin);
+
+        const uint32 offset = static_cast<uint32>(nodes_.size());
+        for (NodeType node : nodes)
+        {
+            node.first += node.count != 0 ? begin : offset;
+            nodes_.push_back(node);
+        }
+        nodes_[root] = nodes_[offset];
+    }
+
+    std::vector<NodeType> compacted;
+    internal::compactNodes(nodes_, compacted);
+    nodes_ = std::move(compacted);
+    link();
+
+    computeCosts(counts, costs);
+    collectTreelets(counts, roots, depths);
+    FMATH_ASSERT(roots.size() == treelet_costs_.size());
+    for (index_t i : rebuilt)
+        treelet_costs_[i] = relativeCost(costs, roots[i]);
+    return rebuilt.size();
+}
+
+template<typename T>
+FMATH_INLINE size_t Bvh<T>::treeletSize() const
+{
+    return max(primitiveCount() / 64, static_cast<size_t>(256));
+}
+
+// Children are stored after their parents, so a reverse sweep sees them first
+template<typename T>
+void Bvh<T>::computeCosts(std::vector<uint32> &counts, std::vector<ValueType> &costs) const
+{
+    counts.resize(nodes_.size());
+    costs.resize(nodes_.size());
+    for (index_t i = nodes_.size(); i-- > 0;)
+    {
+        const NodeType &node = nodes_[i];
+        const ValueType area = internal::halfArea(node.lower, node.upper);
+        if (node.count != 0)
+        {
+            counts[i] = node.count;
+            costs[i] = area * static_cast<ValueType>(node.count);
+        }
+        else
+        {
+            counts[i] = counts[node.first] + counts[node.first + 1];
+            costs[i] = area + costs[node.first] + costs[node.first + 1];
+        }
+    }
+}
+
+template<typename T>
+void Bvh<T>::collectTreelets(const std::vector<uint32> &counts, std::vector<uint32> &roots,
+    std::vector<uint32> &depths) const
+{
+    roots.clear();
+    depths.clear();
+    if (empty())
+        return;
+
+    const size_t size = treeletSize();
+    std::vector<std::pair<uint32, uint32>> stack { { 0U, 0U } };
+    while (!stack.empty())
+    {
+        const auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (nodes_[node].count != 0 || counts[node] <= size)
+        {
+            roots.push_back(node);
+            depths.push_back(depth);
+            continue;
+        }
+        stack.emplace_back(nodes_[node].first + 1, depth + 1);
+        stack.emplace_back(nodes_[node].first, depth + 1);
+    }
+}
+
+template<typename T>
+FMATH_INLINE T Bvh<T>::relativeCost(const std::vector<ValueType> &costs, uint32 node) const
+{
+    const ValueType area = internal::halfArea(nodes_[node].lower, nodes_[node].upper);
+    return area > static_cast<ValueType>(0) ? costs[node] / area : static_cast<ValueType>(0);
+}
+
+}
+
+#endif
@@ -59,4 +59,26 @@
 #   define FMATH_ARCHITECTURE_X86
 #endif
 
+#if !defined(FMATH_NO_SIMD)
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define FMATH_SIMD_SSE2
+#   endif
+#   if defined(__SSE4_1__) || defined(__AVX__)
+#       define FMATH_SIMD_SSE41
+#   endif
+#   if defined(__AVX__)
+#       define FMATH_SIMD_AVX
+#   endif
+#   if defined(__FMA__)
+#       define FMATH_SIMD_FMA
+#   endif
+#   if defined(__BMI2__) && (defined(__x86_64__) || defined(_M_X64))
+#       define FMATH_SIMD_BMI2
+#   endif
+#endif
+
+#if !defined(FMATH_NO_THREADS)
+#   define FMATH_USE_THREADS
+#endif
+
 #endif
\ No newline at end of file
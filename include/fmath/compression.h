@@ -0,0 +1,446 @@
+#ifndef _FMATH_COMPRESSION_H_
+#define _FMATH_COMPRESSION_H_
+
+#include "internal/simd.h"
+#include "box.h"
+#include "common.h"
+#include "quaternion.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// Smallest three: the index of the largest component in 2 bits and the three others in 10 bits each.
+// The largest component is made positive and rebuilt from the unit length, the error is below 2e-3 per component.
+struct PackedQuat32
+{
+    uint32 bits = 0;
+
+    template<typename T>
+    static FMATH_INLINE PackedQuat32 encode(const Quat<T> &q);
+
+    template<typename T>
+    FMATH_INLINE Quat<T> decode() const;
+};
+
+// Smallest three with 15 bits per component, the error is below 6e-5 per component
+struct PackedQuat48
+{
+    uint16 bits[3] = { 0, 0, 0 };
+
+    template<typename T>
+    static FMATH_INLINE PackedQuat48 encode(const Quat<T> &q);
+
+    template<typename T>
+    FMATH_INLINE Quat<T> decode() const;
+};
+
+// Every component as a signed normalized 16 bit integer in (w, x, y, z) order, the quaternion may have any sign
+struct PackedQuat64
+{
+    int16 values[4] = { 0, 0, 0, 0 };
+
+    template<typename T>
+    static FMATH_INLINE PackedQuat64 encode(const Quat<T> &q);
+
+    template<typename T>
+    FMATH_INLINE Quat<T> decode() const;
+};
+
+// 16 bits per component quantized inside a range, typically the bounds of all keys of a track
+struct PackedVector3
+{
+    uint16 values[3] = { 0, 0, 0 };
+
+    template<typename T>
+    static FMATH_INLINE PackedVector3 encode(const Vector3<T> &v, const Box3<T> &range);
+
+    template<typename T>
+    FMATH_INLINE Vector3<T> decode(const Box3<T> &range) const;
+};
+
+namespace internal
+{
+
+template<typename PackedT>
+struct SmallestThreeTraits;
+
+template<>
+struct SmallestThreeTraits<PackedQuat32>
+{
+    static constexpr uint32 BITS = 10;
+
+    static FMATH_INLINE void pack(uint32 index, const uint32 *c, PackedQuat32 &packed)
+    {
+        packed.bits = (index << 30) | (c[0] << 20) | (c[1] << 10) | c[2];
+    }
+
+    static FMATH_INLINE uint32 unpack(const PackedQuat32 &packed, uint32 *c)
+    {
+        c[0] = (packed.bits >> 20) & 0x3FF;
+        c[1] = (packed.bits >> 10) & 0x3FF;
+        c[2] = packed.bits & 0x3FF;
+        return packed.bits >> 30;
+    }
+};
+
+template<>
+struct SmallestThreeTraits<PackedQuat48>
+{
+    static constexpr uint32 BITS = 15;
+
+    static FMATH_INLINE void pack(uint32 index, const uint32 *c, PackedQuat48 &packed)
+    {
+        uint64 bits = (static_cast<uint64>(index) << 45) | (static_cast<uint64>(c[0]) << 30) |
+            (static_cast<uint64>(c[1]) << 15) | c[2];
+        packed.bits[0] = static_cast<uint16>(bits >> 32);
+        packed.bits[1] = static_cast<uint16>(bits >> 16);
+        packed.bits[2] = static_cast<uint16>(bits);
+    }
+
+    static FMATH_INLINE uint32 unpack(const PackedQuat48 &packed, uint32 *c)
+    {
+        uint64 bits = (static_cast<uint64>(packed.bits[0]) << 32) | (static_cast<uint64>(packed.bits[1]) << 16) |
+            packed.bits[2];
+        c[0] = static_cast<uint32>(bits >> 30) & 0x7FFF;
+        c[1] = static_cast<uint32>(bits >> 15) & 0x7FFF;
+        c[2] = static_cast<uint32>(bits) & 0x7FFF;
+        return static_cast<uint32>(bits >> 45);
+    }
+};
+
+// The three smallest components of a unit quaternion lie in [-1 / sqrt(2), 1 / sqrt(2)]
+template<typename T>
+constexpr T SMALLEST_THREE_RANGE = static_cast<T>(0.707106781186547524);
+
+template<typename SimdT, typename PackedT>
+FMATH_INLINE void encodeSmallestThreeBlock(const typename SimdT::ValueType *q, PackedT *packed)
+{
+    using T = typename SimdT::ValueType;
+    using Traits = SmallestThreeTraits<PackedT>;
+    constexpr size_t W = SimdT::WIDTH;
+    const T max_value = static_cast<T>((1u << Traits::BITS) - 1);
+
+    SimdT c[4];
+    for (index_t i = 0; i < 4; ++i)
+        c[i] = SimdT::loadStrided(q + i, 4);
+
+    // Index of the largest absolute component
+    SimdT index = SimdT::broadcast(0);
+    SimdT largest = c[0];
+    SimdT largest_abs = abs(c[0]);
+    for (index_t i = 1; i < 4; ++i)
+    {
+        const SimdT a = abs(c[i]);
+        const typename SimdT::MaskType greater = a > largest_abs;
+        index = select(greater, SimdT::broadcast(static_cast<T>(i)), index);
+        largest = select(greater, c[i], largest);
+        largest_abs = max(a, largest_abs);
+    }
+
+    // q and -q are the same rotation, keep the largest component positive so it can be rebuilt from the length
+    const SimdT zero = SimdT::broadcast(0);
+    const typename SimdT::MaskType negative = largest < zero;
+    const SimdT scale = SimdT::broadcast(max_value / (static_cast<T>(2) * SMALLEST_THREE_RANGE<T>));
+    const SimdT offset = SimdT::broadcast(SMALLEST_THREE_RANGE<T>);
+    const SimdT half = SimdT::broadcast(static_cast<T>(0.5));
+    const SimdT upper = SimdT::broadcast(max_value);
+
+    T quantized[3][W];
+    for (index_t j = 0; j < 3; ++j)
+    {
+        SimdT s = select(index > SimdT::broadcast(static_cast<T>(j)), c[j], c[j + 1]);
+        s = select(negative, -s, s);
+        s = min(max(fmadd(s + offset, scale, half), zero), upper);
+        s.store(quantized[j]);
+    }
+
+    T indices[W];
+    index.store(indices);
+    for (index_t l = 0; l < W; ++l)
+    {
+        const uint32 values[3] = {
+            static_cast<uint32>(quantized[0][l]),
+            static_cast<uint32>(quantized[1][l]),
+            static_cast<uint32>(quantized[2][l])
+        };
+        Traits::pack(static_cast<uint32>(indices[l]), values, packed[l]);
+    }
+}
+
+template<typename SimdT, typename PackedT>
+FMATH_INLINE void decodeSmallestThreeBlock(const PackedT *packed, typename SimdT::ValueType *q)
+{
+    using T = typename SimdT::ValueType;
+    using Traits = SmallestThreeTraits<PackedT>;
+    constexpr size_t W = SimdT::WIDTH;
+    const T max_value = static_cast<T>((1u << Traits::BITS) - 1);
+
+    T indices[W];
+    T quantized[3][W];
+    for (index_t l = 0; l < W; ++l)
+    {
+        uint32 values[3];
+        indices[l] = static_cast<T>(Traits::unpack(packed[l], values));
+        quantized[0][l] = static_cast<T>(values[0]);
+        quantized[1][l] = static_cast<T>(values[1]);
+        quantized[2][l] = static_cast<T>(values[2]);
+    }
+
+    const SimdT scale = SimdT::broadcast(static_cast<T>(2) * SMALLEST_THREE_RANGE<T> / max_value);
+    const SimdT offset = SimdT::broadcast(SMALLEST_THREE_RANGE<T>);
+    const SimdT index = SimdT::load(indices);
+
+    SimdT s[3];
+    for (index_t j = 0; j < 3; ++j)
+        s[j] = fmadd(SimdT::load(quantized[j]), scale, -offset);
+
+    const SimdT one = SimdT::broadcast(1);
+    const SimdT zero = SimdT::broadcast(0);
+    const SimdT length2 = fmadd(s[0], s[0], fmadd(s[1], s[1], s[2] * s[2]));
+    const SimdT largest = sqrt(max(one - length2, zero));
+
+    for (index_t i = 0; i < 4; ++i)
+    {
+        const SimdT lane = SimdT::broadcast(static_cast<T>(i));
+        const SimdT other = i == 0 ? s[0] : (i == 3 ? s[2] : select(index > lane, s[i], s[i - 1]));
+        select(index == lane, largest, other).storeStrided(q + i, 4);
+    }
+}
+
+template<typename SimdT>
+FMATH_INLINE void encodeSnormBlock(const typename SimdT::ValueType *q, PackedQuat64 *packed)
+{
+    using T = typename SimdT::ValueType;
+    constexpr size_t W = SimdT::WIDTH;
+    const SimdT scale = SimdT::broadcast(static_cast<T>(32767));
+    const SimdT half = SimdT::broadcast(static_cast<T>(0.5));
+    const SimdT zero = SimdT::broadcast(0);
+
+    for (index_t i = 0; i < 4; ++i)
+    {
+        SimdT v = min(max(SimdT::loadStrided(q + i, 4) * scale, -scale), scale);
+        v = v + select(v < zero, -half, half);
+
+        T values[W];
+        v.store(values);
+        for (index_t l = 0; l < W; ++l)
+            packed[l].values[i] = static_cast<int16>(values[l]);
+    }
+}
+
+template<typename SimdT>
+FMATH_INLINE void decodeSnormBlock(const PackedQuat64 *packed, typename SimdT::ValueType *q)
+{
+    using T = typename SimdT::ValueType;
+    constexpr size_t W = SimdT::WIDTH;
+    const SimdT scale = SimdT::broadcast(static_cast<T>(1) / static_cast<T>(32767));
+
+    for (index_t i = 0; i < 4; ++i)
+    {
+        T values[W];
+        for (index_t l = 0; l < W; ++l)
+            values[l] = static_cast<T>(packed[l].values[i]);
+        (SimdT::load(values) * scale).storeStrided(q + i, 4);
+    }
+}
+
+template<typename SimdT>
+FMATH_INLINE void encodeVector3Block(const typename SimdT::ValueType *v, const Box3<typename SimdT::ValueType> &range,
+    PackedVector3 *packed)
+{
+    using T = typename SimdT::ValueType;
+    constexpr size_t W = SimdT::WIDTH;
+    const T max_value = static_cast<T>(65535);
+    const SimdT half = SimdT::broadcast(static_cast<T>(0.5));
+    const SimdT zero = SimdT::broadcast(0);
+    const SimdT upper = SimdT::broadcast(max_value);
+
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const T extent = range.max()[i] - range.min()[i];
+        const T inv_extent = extent > static_cast<T>(0) ? max_value / extent : static_cast<T>(0);
+        SimdT q = (SimdT::loadStrided(v + i, 3) - SimdT::broadcast(range.min()[i])) * SimdT::broadcast(inv_extent);
+        q = min(max(q + half, zero), upper);
+
+        T values[W];
+        q.store(values);
+        for (index_t l = 0; l < W; ++l)
+            packed[l].values[i] = static_cast<uint16>(values[l]);
+    }
+}
+
+template<typename SimdT>
+FMATH_INLINE void decodeVector3Block(const PackedVector3 *packed, const Box3<typename SimdT::ValueType> &range,
+    typename SimdT::ValueType *v)
+{
+    using T = typename SimdT::ValueType;
+    constexpr size_t W = SimdT::WIDTH;
+
+    for (index_t i = 0; i < 3; ++i)
+    {
+        T values[W];
+        for (index_t l = 0; l < W; ++l)
+            values[l] = static_cast<T>(packed[l].values[i]);
+        const SimdT scale = SimdT::broadcast((range.max()[i] - range.min()[i]) / static_cast<T>(65535));
+        fmadd(SimdT::load(values), scale, SimdT::broadcast(range.min()[i])).storeStrided(v + i, 3);
+    }
+}
+
+// Runs block<SimdT> over full blocks and block<Simd<T, 1>> over the tail
+template<typename T, typename BlockFunction>
+FMATH_INLINE void forEachCodecBlock(size_t count, BlockFunction &&block)
+{
+    using SimdT = simd::NativeSimd<T>;
+    constexpr size_t W = SimdT::WIDTH;
+
+    index_t i = 0;
+    for (; i + W <= count; i += W)
+        block(SimdT(), i);
+    for (; i < count; ++i)
+        block(simd::Simd<T, 1>(), i);
+}
+
+}
+
+template<typename T>
+FMATH_INLINE PackedQuat32 PackedQuat32::encode(const Quat<T> &q)
+{
+    PackedQuat32 result;
+    internal::encodeSmallestThreeBlock<internal::simd::Simd<T, 1>>(q.data(), &result);
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE Quat<T> PackedQuat32::decode() const
+{
+    Quat<T> result;
+    internal::decodeSmallestThreeBlock<internal::simd::Simd<T, 1>>(this, result.data());
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE PackedQuat48 PackedQuat48::encode(const Quat<T> &q)
+{
+    PackedQuat48 result;
+    internal::encodeSmallestThreeBlock<internal::simd::Simd<T, 1>>(q.data(), &result);
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE Quat<T> PackedQuat48::decode() const
+{
+    Quat<T> result;
+    internal::decodeSmallestThreeBlock<internal::simd::Simd<T, 1>>(this, result.data());
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE PackedQuat64 PackedQuat64::encode(const Quat<T> &q)
+{
+    PackedQuat64 result;
+    internal::encodeSnormBlock<internal::simd::Simd<T, 1>>(q.data(), &result);
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE Quat<T> PackedQuat64::decode() const
+{
+    Quat<T> result;
+    internal::decodeSnormBlock<internal::simd::Simd<T, 1>>(this, result.data());
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE PackedVector3 PackedVector3::encode(const Vector3<T> &v, const Box3<T> &range)
+{
+    PackedVector3 result;
+    internal::encodeVector3Block<internal::simd::Simd<T, 1>>(v.data(), range, &result);
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE Vector3<T> PackedVector3::decode(const Box3<T> &range) const
+{
+    Vector3<T> result;
+    internal::decodeVector3Block<internal::simd::Simd<T, 1>>(this, range, result.data());
+    return result;
+}
+
+template<typename T>
+void encode(const Quat<T> *q, PackedQuat32 *packed, size_t count)
+{
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::encodeSmallestThreeBlock<decltype(tag)>(q[i].data(), packed + i);
+    });
+}
+
+template<typename T>
+void decode(const PackedQuat32 *packed, Quat<T> *q, size_t count)
+{
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::decodeSmallestThreeBlock<decltype(tag)>(packed + i, q[i].data());
+    });
+}
+
+template<typename T>
+void encode(const Quat<T> *q, PackedQuat48 *packed, size_t count)
+{
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::encodeSmallestThreeBlock<decltype(tag)>(q[i].data(), packed + i);
+    });
+}
+
+template<typename T>
+void decode(const PackedQuat48 *packed, Quat<T> *q, size_t count)
+{
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::decodeSmallestThreeBlock<decltype(tag)>(packed + i, q[i].data());
+    });
+}
+
+template<typename T>
+void encode(const Quat<T> *q, PackedQuat64 *packed, size_t count)
+{
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::encodeSnormBlock<decltype(tag)>(q[i].data(), packed + i);
+    });
+}
+
+template<typename T>
+void decode(const PackedQuat64 *packed, Quat<T> *q, size_t count)
+{
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::decodeSnormBlock<decltype(tag)>(packed + i, q[i].data());
+    });
+}
+
+template<typename T>
+void encode(const Vector3<T> *v, const Box3<T> &range, PackedVector3 *packed, size_t count)
+{
+    static_assert(sizeof(Vector3<T>) == sizeof(T) * 3, "Vector3 must be tightly packed");
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::encodeVector3Block<decltype(tag)>(v[i].data(), range, packed + i);
+    });
+}
+
+template<typename T>
+void decode(const PackedVector3 *packed, const Box3<T> &range, Vector3<T> *v, size_t count)
+{
+    static_assert(sizeof(Vector3<T>) == sizeof(T) * 3, "Vector3 must be tightly packed");
+    internal::forEachCodecBlock<T>(count, [&](auto tag, index_t i)
+    {
+        internal::decodeVector3Block<decltype(tag)>(packed + i, range, v[i].data());
+    });
+}
+
+}
+
+#endif
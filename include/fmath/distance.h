@@ -0,0 +1,512 @@
+#ifndef _FMATH_DISTANCE_H_
+#define _FMATH_DISTANCE_H_
+
+#include "internal/simd.h"
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "line.h"
+#include "point.h"
+#include "ray.h"
+#include "triangle.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// Part of a triangle its closest point lies on
+enum class TriangleFeature : uint8
+{
+    Vertex0,
+    Vertex1,
+    Vertex2,
+    Edge01,
+    Edge12,
+    Edge20,
+    Face
+};
+
+template<typename T>
+struct TriangleClosestPoint
+{
+    Point3<T> point;
+    // point = (1 - u - v) * v0 + u * v1 + v * v2
+    T u;
+    T v;
+    T distance2;
+    TriangleFeature feature;
+};
+
+// Lines are taken as the segments between their start and end points
+template<typename T, size_t N>
+struct SegmentClosestPoints
+{
+    // point1 = start1 + s * (end1 - start1) and point2 = start2 + t * (end2 - start2)
+    Point<T, N> point1;
+    Point<T, N> point2;
+    T s;
+    T t;
+    T distance2;
+};
+
+template<typename T>
+struct TriangleClosestPoints
+{
+    Point3<T> point1;
+    Point3<T> point2;
+    T distance2;
+};
+
+namespace internal
+{
+
+// Share of the products summed into |ab x ac|^2 under which the sum is rounding and the triangle is taken as flat
+template<typename T>
+struct FlatTriangleTolerance
+{
+    static constexpr T value = static_cast<T>(64) * constants::Epsilon<T>::value;
+};
+
+// Closest point on the three edges, for triangles too flat for their barycentric regions to be trusted
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR TriangleClosestPoint<T> closestPointOnEdges(const Point3<T> &point,
+    const Triangle3<T> &triangle)
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    TriangleClosestPoint<T> best { triangle[0], zero, zero, constants::Inf<T>::value, TriangleFeature::Vertex0 };
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const index_t j = i == 2 ? 0 : i + 1;
+        const Vector3<T> edge = triangle[j] - triangle[i];
+        const T length2 = dot(edge, edge);
+        const T t = length2 > zero ? clamp(dot(point - triangle[i], edge) / length2, zero, one) : zero;
+        const Point3<T> closest = triangle[i] + edge * t;
+        const T closest_distance2 = distance2(point, closest);
+        if (closest_distance2 >= best.distance2)
+            continue;
+
+        // Edges 01, 12 and 20 in the order of TriangleFeature
+        const T u = i == 0 ? t : (i == 1 ? one - t : zero);
+        const T v = i == 0 ? zero : (i == 1 ? t : one - t);
+        const TriangleFeature feature = t == zero ? static_cast<TriangleFeature>(i) :
+            (t == one ? static_cast<TriangleFeature>(j) : static_cast<TriangleFeature>(3 + i));
+        best = TriangleClosestPoint<T> { closest, u, v, closest_distance2, feature };
+    }
+    return best;
+}
+
+}
+
+// Ericson, "Real-Time Collision Detection", 5.1.5, the Voronoi region of the point found from dot products only.
+// Collinear and collapsed triangles get the closest point of their edges.
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR TriangleClosestPoint<T> closestPoint(const Point3<T> &point,
+    const Triangle3<T> &triangle)
+{
+    const auto make = [&point, &triangle](T u, T v, TriangleFeature feature)
+    {
+        const Point3<T> closest = triangle[0] + (triangle[1] - triangle[0]) * u + (triangle[2] - triangle[0]) * v;
+        return TriangleClosestPoint<T> { closest, u, v, distance2(point, closest), feature };
+    };
+
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    const Vector3<T> ab = triangle[1] - triangle[0];
+    const Vector3<T> ac = triangle[2] - triangle[0];
+    const Vector3<T> ap = point - triangle[0];
+    const T d1 = dot(ab, ap);
+    const T d2 = dot(ac, ap);
+    if (d1 <= zero && d2 <= zero)
+        return make(zero, zero, TriangleFeature::Vertex0);
+
+    const Vector3<T> bp = point - triangle[1];
+    const T d3 = dot(ab, bp);
+    const T d4 = dot(ac, bp);
+    if (d3 >= zero && d4 <= d3)
+        return make(one, zero, TriangleFeature::Vertex1);
+
+    // The denominators of the edge regions are the squared edge lengths, an edge shrunk to a point has no region
+    const T vc = d1 * d4 - d3 * d2;
+    if (vc <= zero && d1 >= zero && d3 <= zero && d1 - d3 > zero)
+        return make(d1 / (d1 - d3), zero, TriangleFeature::Edge01);
+
+    const Vector3<T> cp = point - triangle[2];
+    const T d5 = dot(ab, cp);
+    const T d6 = dot(ac, cp);
+    if (d6 >= zero && d5 <= d6)
+        return make(zero, one, TriangleFeature::Vertex2);
+
+    const T vb = d5 * d2 - d1 * d6;
+    if (vb <= zero && d2 >= zero && d6 <= zero && d2 - d6 > zero)
+        return make(zero, d2 / (d2 - d6), TriangleFeature::Edge20);
+
+    const T va = d3 * d6 - d5 * d4;
+    if (va <= zero && d4 - d3 >= zero && d5 - d6 >= zero && (d4 - d3) + (d5 - d6) > zero)
+    {
+        const T w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return make(one - w, w, TriangleFeature::Edge12);
+    }
+
+    // The sum is |ab x ac|^2, near zero for flat triangles whose barycentrics then come out of range or meaningless
+    const T sum = va + vb + vc;
+    const T magnitude = abs(d3 * d6) + abs(d5 * d4) + abs(d5 * d2) + abs(d1 * d6) + abs(d1 * d4) + abs(d3 * d2);
+    const T u = vb / sum;
+    const T v = vc / sum;
+    if (!(sum > internal::FlatTriangleTolerance<T>::value * magnitude) || !(u >= zero) || !(v >= zero) ||
+        !(u + v <= one))
+        return internal::closestPointOnEdges(point, triangle);
+    return make(u, v, TriangleFeature::Face);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T distance2(const Point3<T> &point, const Triangle3<T> &triangle)
+{
+    return closestPoint(point, triangle).distance2;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T distance2(const Triangle3<T> &triangle, const Point3<T> &point)
+{
+    return distance2(point, triangle);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T distance(const Point3<T> &point, const Triangle3<T> &triangle)
+{
+    return sqrt(distance2(point, triangle));
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T distance(const Triangle3<T> &triangle, const Point3<T> &point)
+{
+    return distance(point, triangle);
+}
+
+// The point itself when it lies inside of the box
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR Point<T, N> closestPoint(const Point<T, N> &point, const Box<T, N> &box)
+{
+    return componentWiseMin(componentWiseMax(point, box.min()), box.max());
+}
+
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR T distance2(const Point<T, N> &point, const Box<T, N> &box)
+{
+    return distance2(point, closestPoint(point, box));
+}
+
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR T distance2(const Box<T, N> &box, const Point<T, N> &point)
+{
+    return distance2(point, box);
+}
+
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR T distance(const Point<T, N> &point, const Box<T, N> &box)
+{
+    return sqrt(distance2(point, box));
+}
+
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR T distance(const Box<T, N> &box, const Point<T, N> &point)
+{
+    return distance(point, box);
+}
+
+// Ericson, "Real-Time Collision Detection", 5.1.9. Segments shrunk to a point and parallel segments are handled, the
+// latter get one of their closest pairs.
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR SegmentClosestPoints<T, N> closestPoints(const Line<T, N> &segment1,
+    const Line<T, N> &segment2)
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    const Vector<T, N> d1 = segment1.end() - segment1.start();
+    const Vector<T, N> d2 = segment2.end() - segment2.start();
+    const Vector<T, N> r = segment1.start() - segment2.start();
+    const T a = dot(d1, d1);
+    const T e = dot(d2, d2);
+    const T f = dot(d2, r);
+
+    T s = zero;
+    T t = zero;
+    if (a == zero)
+    {
+        t = e == zero ? zero : clamp(f / e, zero, one);
+    }
+    else
+    {
+        const T c = dot(d1, r);
+        if (e == zero)
+        {
+            s = clamp(-c / a, zero, one);
+        }
+        else
+        {
+            // Closest points of the infinite lines, clamped to the first segment, then to the second one
+            const T b = dot(d1, d2);
+            const T denominator = a * e - b * b;
+            s = denominator != zero ? clamp((b * f - c * e) / denominator, zero, one) : zero;
+            t = (b * s + f) / e;
+            if (t < zero)
+            {
+                t = zero;
+                s = clamp(-c / a, zero, one);
+            }
+            else if (t > one)
+            {
+                t = one;
+                s = clamp((b - c) / a, zero, one);
+            }
+        }
+    }
+
+    const Point<T, N> point1 = segment1.start() + d1 * s;
+    const Point<T, N> point2 = segment2.start() + d2 * t;
+    return SegmentClosestPoints<T, N> { point1, point2, s, t, distance2(point1, point2) };
+}
+
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR T distance2(const Line<T, N> &segment1, const Line<T, N> &segment2)
+{
+    return closestPoints(segment1, segment2).distance2;
+}
+
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR T distance(const Line<T, N> &segment1, const Line<T, N> &segment2)
+{
+    return sqrt(distance2(segment1, segment2));
+}
+
+namespace internal
+{
+
+// Where the segment crosses the plane of the triangle inside of it, segments lying in the plane never cross
+template<typename T>
+FMATH_INLINE bool crossTriangle(const Point3<T> &start, const Point3<T> &end, const Triangle3<T> &triangle,
+    Point3<T> &crossing)
+{
+    const T zero = static_cast<T>(0);
+    const Vector3<T> normal = cross(triangle[1] - triangle[0], triangle[2] - triangle[0]);
+    const T d0 = dot(normal, start - triangle[0]);
+    const T d1 = dot(normal, end - triangle[0]);
+    if ((d0 > zero && d1 > zero) || (d0 < zero && d1 < zero) || d0 == d1)
+        return false;
+
+    crossing = start + (end - start) * (d0 / (d0 - d1));
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const Point3<T> &a = triangle[i];
+        const Point3<T> &b = triangle[i == 2 ? 0 : i + 1];
+        if (dot(normal, cross(b - a, crossing - a)) < zero)
+            return false;
+    }
+    return true;
+}
+
+}
+
+// Intersecting triangles are found through an edge of one crossing the other and get a distance of 0. Otherwise the
+// closest pair lies on two edges or on a vertex and a face, and all 15 of these pairs are compared.
+template<typename T>
+FMATH_INLINE TriangleClosestPoints<T> closestPoints(const Triangle3<T> &triangle1, const Triangle3<T> &triangle2)
+{
+    const Triangle3<T> *triangles[2] = { &triangle1, &triangle2 };
+    for (index_t k = 0; k < 2; ++k)
+    {
+        const Triangle3<T> &edges = *triangles[k];
+        for (index_t i = 0; i < 3; ++i)
+        {
+            Point3<T> crossing;
+            if (internal::crossTriangle(edges[i], edges[i == 2 ? 0 : i + 1], *triangles[1 - k], crossing))
+                return TriangleClosestPoints<T> { crossing, crossing, static_cast<T>(0) };
+        }
+    }
+
+    TriangleClosestPoints<T> best { triangle1[0], triangle2[0], constants::Inf<T>::value };
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const Line<T, 3> edge1(triangle1[i], triangle1[i == 2 ? 0 : i + 1]);
+        for (index_t j = 0; j < 3; ++j)
+        {
+            const SegmentClosestPoints<T, 3> points = closestPoints(edge1,
+                Line<T, 3>(triangle2[j], triangle2[j == 2 ? 0 : j + 1]));
+            if (points.distance2 < best.distance2)
+                best = TriangleClosestPoints<T> { points.point1, points.point2, points.distance2 };
+        }
+    }
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const TriangleClosestPoint<T> on2 = closestPoint(triangle1[i], triangle2);
+        if (on2.distance2 < best.distance2)
+            best = TriangleClosestPoints<T> { triangle1[i], on2.point, on2.distance2 };
+        const TriangleClosestPoint<T> on1 = closestPoint(triangle2[i], triangle1);
+        if (on1.distance2 < best.distance2)
+            best = TriangleClosestPoints<T> { on1.point, triangle2[i], on1.distance2 };
+    }
+    return best;
+}
+
+template<typename T>
+FMATH_INLINE T distance2(const Triangle3<T> &triangle1, const Triangle3<T> &triangle2)
+{
+    return closestPoints(triangle1, triangle2).distance2;
+}
+
+template<typename T>
+FMATH_INLINE T distance(const Triangle3<T> &triangle1, const Triangle3<T> &triangle2)
+{
+    return sqrt(distance2(triangle1, triangle2));
+}
+
+// Closest points of one point on W triangles at once, the regions of the scalar version are blended with selects.
+// Writes the squared distance and the barycentric coordinates of every lane. Empty lanes report infinity, as the
+// empty lanes of a Box3Block do.
+template<typename T, size_t W>
+FMATH_INLINE void closestPoint(const Point3<T> &point, const Triangle3Block<T, W> &triangles, T *distance2, T *u,
+    T *v)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    using internal::simd::SimdVector3;
+
+    const auto dot = [](const SimdVector3<SimdT> &a, const SimdVector3<SimdT> &b)
+    {
+        return fmadd(a.x, b.x, fmadd(a.y, b.y, a.z * b.z));
+    };
+
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdVector3<SimdT> ab { SimdT::load(triangles.e1_x), SimdT::load(triangles.e1_y),
+        SimdT::load(triangles.e1_z) };
+    const SimdVector3<SimdT> ac { SimdT::load(triangles.e2_x), SimdT::load(triangles.e2_y),
+        SimdT::load(triangles.e2_z) };
+    const SimdVector3<SimdT> ap {
+        SimdT::broadcast(point[0]) - SimdT::load(triangles.v0_x),
+        SimdT::broadcast(point[1]) - SimdT::load(triangles.v0_y),
+        SimdT::broadcast(point[2]) - SimdT::load(triangles.v0_z)
+    };
+    const SimdVector3<SimdT> bp { ap.x - ab.x, ap.y - ab.y, ap.z - ab.z };
+    const SimdVector3<SimdT> cp { ap.x - ac.x, ap.y - ac.y, ap.z - ac.z };
+
+    const SimdT d1 = dot(ab, ap);
+    const SimdT d2 = dot(ac, ap);
+    const SimdT d3 = dot(ab, bp);
+    const SimdT d4 = dot(ac, bp);
+    const SimdT d5 = dot(ab, cp);
+    const SimdT d6 = dot(ac, cp);
+    const SimdT va = fnmadd(d5, d4, d3 * d6);
+    const SimdT vb = fnmadd(d1, d6, d5 * d2);
+    const SimdT vc = fnmadd(d3, d2, d1 * d4);
+
+    // From the face up to the first vertex, so that the region tested first by the scalar version wins. Divisions
+    // of lanes outside of a region may give infinities or NaN, which the selects drop.
+    const SimdT sum = va + vb + vc;
+    SimdT hit_u = vb / sum;
+    SimdT hit_v = vc / sum;
+    // Flat triangles, like in the scalar version, and barycentrics out of range fall back to the edges
+    const SimdT magnitude = abs(d3 * d6) + abs(d5 * d4) + abs(d5 * d2) + abs(d1 * d6) + abs(d1 * d4) + abs(d3 * d2);
+    const SimdT flat_tolerance = SimdT::broadcast(internal::FlatTriangleTolerance<T>::value) * magnitude;
+    auto face_edges = ~((sum > flat_tolerance) & (hit_u >= zero) & (hit_v >= zero) & (hit_u + hit_v <= one));
+
+    const SimdT d43 = d4 - d3;
+    const SimdT d56 = d5 - d6;
+    const auto edge12 = (va <= zero) & (d43 >= zero) & (d56 >= zero) & (d43 + d56 > zero);
+    face_edges = face_edges & ~edge12;
+    const SimdT w12 = d43 / (d43 + d56);
+    hit_u = select(edge12, one - w12, hit_u);
+    hit_v = select(edge12, w12, hit_v);
+
+    const auto edge20 = (vb <= zero) & (d2 >= zero) & (d6 <= zero) & (d2 - d6 > zero);
+    face_edges = face_edges & ~edge20;
+    hit_u = select(edge20, zero, hit_u);
+    hit_v = select(edge20, d2 / (d2 - d6), hit_v);
+
+    const auto vertex2 = (d6 >= zero) & (d5 <= d6);
+    face_edges = face_edges & ~vertex2;
+    hit_u = select(vertex2, zero, hit_u);
+    hit_v = select(vertex2, one, hit_v);
+
+    const auto edge01 = (vc <= zero) & (d1 >= zero) & (d3 <= zero) & (d1 - d3 > zero);
+    face_edges = face_edges & ~edge01;
+    hit_u = select(edge01, d1 / (d1 - d3), hit_u);
+    hit_v = select(edge01, zero, hit_v);
+
+    const auto vertex1 = (d3 >= zero) & (d4 <= d3);
+    face_edges = face_edges & ~vertex1;
+    hit_u = select(vertex1, one, hit_u);
+    hit_v = select(vertex1, zero, hit_v);
+
+    const auto vertex0 = (d1 <= zero) & (d2 <= zero);
+    face_edges = face_edges & ~vertex0;
+    hit_u = select(vertex0, zero, hit_u);
+    hit_v = select(vertex0, zero, hit_v);
+
+    // Rare, so the three edges are projected on only when a lane needs them
+    if (internal::simd::bitmask(face_edges) != 0)
+    {
+        const SimdVector3<SimdT> bc { ac.x - ab.x, ac.y - ab.y, ac.z - ab.z };
+        const auto project = [&](const SimdVector3<SimdT> &from, const SimdVector3<SimdT> &edge)
+        {
+            const SimdT length2 = dot(edge, edge);
+            return select(length2 > zero, min(max(dot(from, edge) / length2, zero), one), zero);
+        };
+        const auto offset2 = [&](const SimdT &edge_u, const SimdT &edge_v)
+        {
+            const SimdVector3<SimdT> offset {
+                fnmadd(edge_v, ac.x, fnmadd(edge_u, ab.x, ap.x)),
+                fnmadd(edge_v, ac.y, fnmadd(edge_u, ab.y, ap.y)),
+                fnmadd(edge_v, ac.z, fnmadd(edge_u, ab.z, ap.z))
+            };
+            return dot(offset, offset);
+        };
+
+        const SimdT t01 = project(ap, ab);
+        const SimdT t12 = project(bp, bc);
+        const SimdT t20 = project(cp, SimdVector3<SimdT> { -ac.x, -ac.y, -ac.z });
+        SimdT edge_u = t01;
+        SimdT edge_v = zero;
+        SimdT best = offset2(t01, zero);
+        const SimdT distance12 = offset2(one - t12, t12);
+        const auto closer12 = distance12 < best;
+        edge_u = select(closer12, one - t12, edge_u);
+        edge_v = select(closer12, t12, edge_v);
+        best = min(best, distance12);
+        const auto closer20 = offset2(zero, one - t20) < best;
+        edge_u = select(closer20, zero, edge_u);
+        edge_v = select(closer20, one - t20, edge_v);
+        hit_u = select(face_edges, edge_u, hit_u);
+        hit_v = select(face_edges, edge_v, hit_v);
+    }
+
+    // Offset from the closest point to the point
+    const SimdVector3<SimdT> offset {
+        fnmadd(hit_v, ac.x, fnmadd(hit_u, ab.x, ap.x)),
+        fnmadd(hit_v, ac.y, fnmadd(hit_u, ab.y, ap.y)),
+        fnmadd(hit_v, ac.z, fnmadd(hit_u, ab.z, ap.z))
+    };
+    const auto empty = SimdT::load(triangles.v0_x) == SimdT::broadcast(constants::Inf<T>::value);
+    select(empty, SimdT::broadcast(constants::Inf<T>::value), dot(offset, offset)).store(distance2);
+    hit_u.store(u);
+    hit_v.store(v);
+}
+
+// Squared distances of one point to W boxes at once, points inside of a box get 0 and empty lanes infinity
+template<typename T, size_t W>
+FMATH_INLINE void distance2(const Point3<T> &point, const Box3Block<T, W> &boxes, T *distance2)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    const SimdT x = SimdT::broadcast(point[0]);
+    const SimdT y = SimdT::broadcast(point[1]);
+    const SimdT z = SimdT::broadcast(point[2]);
+    const SimdT dx = max(max(SimdT::load(boxes.min_x) - x, x - SimdT::load(boxes.max_x)), zero);
+    const SimdT dy = max(max(SimdT::load(boxes.min_y) - y, y - SimdT::load(boxes.max_y)), zero);
+    const SimdT dz = max(max(SimdT::load(boxes.min_z) - z, z - SimdT::load(boxes.max_z)), zero);
+    fmadd(dx, dx, fmadd(dy, dy, dz * dz)).store(distance2);
+}
+
+}
+
+#endif
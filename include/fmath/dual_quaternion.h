@@ -0,0 +1,407 @@
+#ifndef _FMATH_DUAL_QUATERNION_H_
+#define _FMATH_DUAL_QUATERNION_H_
+
+#include <istream>
+#include <ostream>
+
+#include "common.h"
+#include "matrix.h"
+#include "normal.h"
+#include "point.h"
+#include "quaternion.h"
+#include "transform.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// A rigid transform q_r + eps * q_d, where q_r is the rotation and q_d = 0.5 * t * q_r
+template<typename T>
+class DualQuat
+{
+public:
+    using ValueType = T;
+    static constexpr size_t DIMENSION = 8;
+
+public:
+    FMATH_CONSTEXPR DualQuat(const DualQuat &other);
+
+    FMATH_CONSTEXPR DualQuat();
+
+    explicit FMATH_CONSTEXPR DualQuat(const Quat<ValueType> &real, const Quat<ValueType> &dual);
+
+    explicit FMATH_CONSTEXPR DualQuat(const Quat<ValueType> &rotation, const Vector3<ValueType> &translation);
+
+    FMATH_CONSTEXPR DualQuat &operator=(const DualQuat &other);
+
+    FMATH_INLINE FMATH_CONSTEXPR const ValueType *data() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR ValueType *data();
+
+    FMATH_INLINE FMATH_CONSTEXPR Quat<T> rotation() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Vector3<T> translation() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR DualQuat operator+() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR DualQuat operator-() const;
+
+    FMATH_INLINE DualQuat &operator+=(const DualQuat &other);
+
+    FMATH_INLINE DualQuat &operator-=(const DualQuat &other);
+
+    FMATH_INLINE DualQuat &operator*=(const DualQuat &other);
+
+    FMATH_INLINE DualQuat &operator*=(const ValueType &value);
+
+    FMATH_INLINE FMATH_CONSTEXPR Point3<T> apply(const Point3<ValueType> &p) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Vector3<T> apply(const Vector3<ValueType> &v) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Normal3<T> apply(const Normal3<ValueType> &n) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Point3<T> operator()(const Point3<ValueType> &p) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Vector3<T> operator()(const Vector3<ValueType> &v) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Normal3<T> operator()(const Normal3<ValueType> &n) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> toMatrix() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Transform<T> toTransform() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR TRS<T> toTRS() const;
+
+    static FMATH_CONSTEXPR DualQuat identity();
+
+    // The scale of the transform is dropped
+    static FMATH_CONSTEXPR DualQuat makeFromMatrix(const Matrix4<ValueType> &mat);
+
+    static FMATH_CONSTEXPR DualQuat makeFromTransform(const Transform<ValueType> &t);
+
+    static FMATH_CONSTEXPR DualQuat makeFromTRS(const TRS<ValueType> &trs);
+
+public:
+    Quat<ValueType> real;
+    Quat<ValueType> dual;
+};
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool operator==(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return q1.real == q2.real && q1.dual == q2.dual;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool operator!=(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return !(q1 == q2);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool equal(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return q1 == q2;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool notEqual(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return q1 != q2;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool equalEpsilon(const DualQuat<T> &q1, const DualQuat<T> &q2, const T &epsilon = constants::Epsilon<T>::value)
+{
+    return equalEpsilon(q1.real, q2.real, epsilon) && equalEpsilon(q1.dual, q2.dual, epsilon);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool notEqualEpsilon(const DualQuat<T> &q1, const DualQuat<T> &q2, const T &epsilon = constants::Epsilon<T>::value)
+{
+    return !equalEpsilon(q1, q2, epsilon);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> operator+(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return DualQuat<T>(q1.real + q2.real, q1.dual + q2.dual);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> operator-(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return DualQuat<T>(q1.real - q2.real, q1.dual - q2.dual);
+}
+
+// Applies q2 first, then q1
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> operator*(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return DualQuat<T>(q1.real * q2.real, q1.real * q2.dual + q1.dual * q2.real);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> operator*(const DualQuat<T> &q, const T &value)
+{
+    return DualQuat<T>(q.real * value, q.dual * value);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> operator*(const T &value, const DualQuat<T> &q)
+{
+    return q * value;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T dot(const DualQuat<T> &q1, const DualQuat<T> &q2)
+{
+    return dot(q1.real, q2.real);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> conjugate(const DualQuat<T> &q)
+{
+    return DualQuat<T>(conjugate(q.real), conjugate(q.dual));
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T length(const DualQuat<T> &q)
+{
+    return length(q.real);
+}
+
+// Scales the real part to unit length and removes the component of the dual part along it
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> normalize(const DualQuat<T> &q)
+{
+    const T inv_length = static_cast<T>(1) / length(q.real);
+    Quat<T> real = q.real * inv_length;
+    Quat<T> dual = q.dual * inv_length;
+    return DualQuat<T>(real, dual - real * dot(real, dual));
+}
+
+// Only valid for unit dual quaternions
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> inverse(const DualQuat<T> &q)
+{
+    return conjugate(q);
+}
+
+template<typename T>
+FMATH_INLINE std::string toString(const DualQuat<T> &q, uint32 precision = 6)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(precision);
+    ss << '(' << q.real << ',' << q.dual << ')';
+    return ss.str();
+}
+
+template<typename T>
+FMATH_INLINE std::ostream &operator<<(std::ostream &output, const DualQuat<T> &q)
+{
+    output << '(' << q.real << ',' << q.dual << ')';
+    return output;
+}
+
+template<typename T>
+FMATH_INLINE std::istream &operator>>(std::istream &input, DualQuat<T> &q)
+{
+    input >> q.real >> q.dual;
+    return input;
+}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T>::DualQuat(const DualQuat &other)
+    :   real(other.real),
+        dual(other.dual)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T>::DualQuat()
+    :   real(Quat<ValueType>::identity()),
+        dual(static_cast<ValueType>(0), static_cast<ValueType>(0), static_cast<ValueType>(0), static_cast<ValueType>(0))
+{}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T>::DualQuat(const Quat<ValueType> &real, const Quat<ValueType> &dual)
+    :   real(real),
+        dual(dual)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T>::DualQuat(const Quat<ValueType> &rotation, const Vector3<ValueType> &translation)
+    :   real(rotation),
+        dual(Quat<ValueType>(static_cast<ValueType>(0), translation * static_cast<ValueType>(0.5)) * rotation)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T> &DualQuat<T>::operator=(const DualQuat &other)
+{
+    real = other.real;
+    dual = other.dual;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR const typename DualQuat<T>::ValueType *DualQuat<T>::data() const
+{
+    return real.data();
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR typename DualQuat<T>::ValueType *DualQuat<T>::data()
+{
+    return real.data();
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Quat<T> DualQuat<T>::rotation() const
+{
+    return real;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Vector3<T> DualQuat<T>::translation() const
+{
+    // 2 * vec(dual * conjugate(real)), expanded
+    const Vector3<ValueType> &rv = real.v;
+    const Vector3<ValueType> &dv = dual.v;
+    return (dv * real.w - rv * dual.w + cross(rv, dv)) * static_cast<ValueType>(2);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> DualQuat<T>::operator+() const
+{
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR DualQuat<T> DualQuat<T>::operator-() const
+{
+    return DualQuat(-real, -dual);
+}
+
+template<typename T>
+FMATH_INLINE DualQuat<T> &DualQuat<T>::operator+=(const DualQuat &other)
+{
+    real += other.real;
+    dual += other.dual;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE DualQuat<T> &DualQuat<T>::operator-=(const DualQuat &other)
+{
+    real -= other.real;
+    dual -= other.dual;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE DualQuat<T> &DualQuat<T>::operator*=(const DualQuat &other)
+{
+    *this = (*this) * other;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE DualQuat<T> &DualQuat<T>::operator*=(const ValueType &value)
+{
+    real *= value;
+    dual *= value;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Point3<T> DualQuat<T>::apply(const Point3<ValueType> &p) const
+{
+    Vector3<ValueType> v = apply(Vector3<ValueType>(p[0], p[1], p[2])) + translation();
+    return Point3<ValueType>(v[0], v[1], v[2]);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Vector3<T> DualQuat<T>::apply(const Vector3<ValueType> &v) const
+{
+    const Vector3<ValueType> &u = real.v;
+    Vector3<ValueType> t = cross(u, v) * static_cast<ValueType>(2);
+    return v + t * real.w + cross(u, t);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Normal3<T> DualQuat<T>::apply(const Normal3<ValueType> &n) const
+{
+    Vector3<ValueType> v = apply(Vector3<ValueType>(n[0], n[1], n[2]));
+    return Normal3<ValueType>(v[0], v[1], v[2]);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Point3<T> DualQuat<T>::operator()(const Point3<ValueType> &p) const
+{
+    return apply(p);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Vector3<T> DualQuat<T>::operator()(const Vector3<ValueType> &v) const
+{
+    return apply(v);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Normal3<T> DualQuat<T>::operator()(const Normal3<ValueType> &n) const
+{
+    return apply(n);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> DualQuat<T>::toMatrix() const
+{
+    Matrix4<ValueType> m = real.toMatrix();
+    Vector3<ValueType> t = translation();
+    m[3] = Vector4<ValueType>(t[0], t[1], t[2], static_cast<ValueType>(1));
+    return m;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Transform<T> DualQuat<T>::toTransform() const
+{
+    return Transform<ValueType>(toMatrix(), TransformKind::Rigid);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR TRS<T> DualQuat<T>::toTRS() const
+{
+    return TRS<ValueType>(translation(), real);
+}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T> DualQuat<T>::identity()
+{
+    return DualQuat<T>();
+}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T> DualQuat<T>::makeFromMatrix(const Matrix4<ValueType> &mat)
+{
+    TRS<ValueType> trs = TRS<ValueType>::makeFromMatrix(mat);
+    return DualQuat<T>(trs.rotation, trs.translation);
+}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T> DualQuat<T>::makeFromTransform(const Transform<ValueType> &t)
+{
+    return makeFromMatrix(t.toMatrix());
+}
+
+template<typename T>
+FMATH_CONSTEXPR DualQuat<T> DualQuat<T>::makeFromTRS(const TRS<ValueType> &trs)
+{
+    return DualQuat<T>(trs.rotation, trs.translation);
+}
+
+using DualQuatf = DualQuat<float>;
+using DualQuatlf = DualQuat<double>;
+
+}
+
+#endif
@@ -3,24 +3,40 @@
 
 // Just include all headers
 
+#include "animation.h"
 #include "box.h"
+#include "bvh.h"
 #include "color.h"
 #include "common.h"
+#include "compression.h"
 #include "constants.h"
+#include "distance.h"
+#include "dual_quaternion.h"
+#include "frustum.h"
+#include "gjk.h"
+#include "kd_tree.h"
 #include "line.h"
+#include "loose_octree.h"
 #include "math_common_functions.h"
 #include "matrix.h"
+#include "morton.h"
 #include "normal.h"
 #include "plane.h"
 #include "point.h"
 #include "quaternion.h"
 #include "random.h"
 #include "ray.h"
+#include "ray_packet.h"
+#include "skinning.h"
+#include "spatial_hash.h"
 #include "sphere.h"
+#include "sweep_and_prune.h"
 #include "swizzle.h"
 #include "traits.h"
 #include "transform.h"
 #include "triangle.h"
 #include "vector.h"
+#include "voxelizer.h"
+#include "wide_bvh.h"
 
 #endif
\ No newline at end of file
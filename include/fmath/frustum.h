@@ -0,0 +1,407 @@
+#ifndef _FMATH_FRUSTUM_H_
+#define _FMATH_FRUSTUM_H_
+
+#include <array>
+
+#include "internal/parallel.h"
+#include "internal/simd.h"
+#include "box.h"
+#include "common.h"
+#include "matrix.h"
+#include "plane.h"
+#include "point.h"
+#include "sphere.h"
+#include "transform.h"
+
+namespace fmath
+{
+
+enum class Visibility : uint8
+{
+    Outside = 0,
+    Intersecting = 1,
+    Inside = 2
+};
+
+// Boxes stored as six separate component arrays
+template<typename T>
+struct Box3Soa
+{
+    const T *min_x = nullptr;
+    const T *min_y = nullptr;
+    const T *min_z = nullptr;
+    const T *max_x = nullptr;
+    const T *max_y = nullptr;
+    const T *max_z = nullptr;
+    size_t count = 0;
+};
+
+template<typename T>
+struct Sphere3Soa
+{
+    const T *center_x = nullptr;
+    const T *center_y = nullptr;
+    const T *center_z = nullptr;
+    const T *radius = nullptr;
+    size_t count = 0;
+};
+
+// Six planes with normals pointing inwards, a point is inside when its distance to every plane is positive
+template<typename T>
+class Frustum
+{
+public:
+    using ValueType = T;
+    static constexpr size_t PLANE_COUNT = 6;
+
+    static constexpr index_t LEFT = 0;
+    static constexpr index_t RIGHT = 1;
+    static constexpr index_t BOTTOM = 2;
+    static constexpr index_t TOP = 3;
+    static constexpr index_t NEAR_PLANE = 4;
+    static constexpr index_t FAR_PLANE = 5;
+
+public:
+    FMATH_CONSTEXPR Frustum(const Frustum &other);
+
+    explicit FMATH_CONSTEXPR Frustum(const std::array<Plane<ValueType>, PLANE_COUNT> &planes);
+
+    // Extracts the planes of the clip volume -w <= x, y, z <= w (Gribb and Hartmann)
+    explicit FMATH_CONSTEXPR Frustum(const Transform<ValueType> &view_projection);
+
+    FMATH_CONSTEXPR Frustum &operator=(const Frustum &other);
+
+    FMATH_INLINE FMATH_CONSTEXPR const Plane<T> &operator[](index_t index) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Plane<T> &operator[](index_t index);
+
+    FMATH_INLINE FMATH_CONSTEXPR const std::array<Plane<T>, PLANE_COUNT> &planes() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR bool contains(const Point3<ValueType> &point) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Visibility classify(const Box3<ValueType> &box) const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Visibility classify(const Sphere3<ValueType> &sphere) const;
+
+    static FMATH_CONSTEXPR Frustum makeFromMatrix(const Matrix4<ValueType> &view_projection);
+
+private:
+    std::array<Plane<ValueType>, PLANE_COUNT> planes_;
+};
+
+template<typename T>
+FMATH_INLINE std::string toString(const Frustum<T> &f, uint32 precision = 6)
+{
+    std::stringstream ss;
+    ss << '(';
+    for (index_t i = 0; i < Frustum<T>::PLANE_COUNT; ++i)
+        ss << (i == 0 ? "" : ",") << toString(f[i], precision);
+    ss << ')';
+    return ss.str();
+}
+
+template<typename T>
+FMATH_INLINE std::ostream &operator<<(std::ostream &output, const Frustum<T> &f)
+{
+    output << toString(f);
+    return output;
+}
+
+namespace internal
+{
+
+constexpr size_t CULLING_GRAIN_SIZE = 16384;
+
+template<typename T>
+FMATH_INLINE Plane<T> makeClipPlane(const Matrix4<T> &m, index_t row, T sign)
+{
+    // Row 3 +/- row i gives (a, b, c, d) with a * x + b * y + c * z + d >= 0 inside
+    Vector3<T> n(m[0][3] + sign * m[0][row], m[1][3] + sign * m[1][row], m[2][3] + sign * m[2][row]);
+    T d = m[3][3] + sign * m[3][row];
+    T inv_length = static_cast<T>(1) / length(n);
+    return Plane<T>(n * inv_length, -d * inv_length);
+}
+
+template<typename SimdT>
+struct SimdPlanes
+{
+    SimdT nx[6], ny[6], nz[6], d[6];
+    SimdT abs_nx[6], abs_ny[6], abs_nz[6];
+
+    template<typename T>
+    explicit SimdPlanes(const Frustum<T> &frustum)
+    {
+        for (index_t i = 0; i < 6; ++i)
+        {
+            const Plane<T> &plane = frustum[i];
+            nx[i] = SimdT::broadcast(plane.normal()[0]);
+            ny[i] = SimdT::broadcast(plane.normal()[1]);
+            nz[i] = SimdT::broadcast(plane.normal()[2]);
+            d[i] = SimdT::broadcast(-plane.constant());
+            abs_nx[i] = abs(nx[i]);
+            abs_ny[i] = abs(ny[i]);
+            abs_nz[i] = abs(nz[i]);
+        }
+    }
+};
+
+// Returns the lanes that are completely outside in the low bits and the lanes completely inside in the high 16 bits
+template<typename SimdT>
+FMATH_INLINE uint32 classifySpheres(const SimdPlanes<SimdT> &planes, const SimdT &x, const SimdT &y, const SimdT &z,
+    const SimdT &radius)
+{
+    using MaskT = typename SimdT::MaskType;
+    MaskT outside, inside;
+    for (index_t i = 0; i < 6; ++i)
+    {
+        SimdT distance = fmadd(planes.nx[i], x, fmadd(planes.ny[i], y, fmadd(planes.nz[i], z, planes.d[i])));
+        MaskT out = distance < -radius;
+        MaskT in = distance >= radius;
+        outside = i == 0 ? out : outside | out;
+        inside = i == 0 ? in : inside & in;
+    }
+    return simd::bitmask(outside) | (simd::bitmask(inside) << 16);
+}
+
+template<typename SimdT>
+FMATH_INLINE uint32 classifyBoxes(const SimdPlanes<SimdT> &planes, const Box3Soa<typename SimdT::ValueType> &boxes,
+    index_t first)
+{
+    using MaskT = typename SimdT::MaskType;
+    const SimdT half = SimdT::broadcast(static_cast<typename SimdT::ValueType>(0.5));
+    const SimdT min_x = SimdT::load(boxes.min_x + first), max_x = SimdT::load(boxes.max_x + first);
+    const SimdT min_y = SimdT::load(boxes.min_y + first), max_y = SimdT::load(boxes.max_y + first);
+    const SimdT min_z = SimdT::load(boxes.min_z + first), max_z = SimdT::load(boxes.max_z + first);
+    const SimdT cx = (min_x + max_x) * half, ex = (max_x - min_x) * half;
+    const SimdT cy = (min_y + max_y) * half, ey = (max_y - min_y) * half;
+    const SimdT cz = (min_z + max_z) * half, ez = (max_z - min_z) * half;
+
+    MaskT outside, inside;
+    for (index_t i = 0; i < 6; ++i)
+    {
+        SimdT distance = fmadd(planes.nx[i], cx, fmadd(planes.ny[i], cy, fmadd(planes.nz[i], cz, planes.d[i])));
+        SimdT radius = fmadd(planes.abs_nx[i], ex, fmadd(planes.abs_ny[i], ey, planes.abs_nz[i] * ez));
+        MaskT out = distance < -radius;
+        MaskT in = distance >= radius;
+        outside = i == 0 ? out : outside | out;
+        inside = i == 0 ? in : inside & in;
+    }
+    return simd::bitmask(outside) | (simd::bitmask(inside) << 16);
+}
+
+template<typename SimdT>
+FMATH_INLINE uint32 classifySpheres(const SimdPlanes<SimdT> &planes, const Sphere3Soa<typename SimdT::ValueType> &spheres,
+    index_t first)
+{
+    return classifySpheres(planes, SimdT::load(spheres.center_x + first), SimdT::load(spheres.center_y + first),
+        SimdT::load(spheres.center_z + first), SimdT::load(spheres.radius + first));
+}
+
+template<size_t W>
+FMATH_INLINE void writeVisibility(uint32 bits, Visibility *results)
+{
+    for (index_t l = 0; l < W; ++l)
+    {
+        if (bits & (1u << l))
+            results[l] = Visibility::Outside;
+        else if (bits & (1u << (l + 16)))
+            results[l] = Visibility::Inside;
+        else
+            results[l] = Visibility::Intersecting;
+    }
+}
+
+template<typename T, typename Objects, typename Classifier>
+FMATH_INLINE void classifyBatch(const Frustum<T> &frustum, const Objects &objects, Visibility *results, Classifier &&classifier)
+{
+    using SimdT = simd::NativeSimd<T>;
+    const SimdPlanes<SimdT> planes(frustum);
+    const SimdPlanes<simd::Simd<T, 1>> scalar_planes(frustum);
+
+    parallelForSimd<SimdT>(objects.count, CULLING_GRAIN_SIZE, [&](auto tag, index_t i)
+    {
+        using BlockT = decltype(tag);
+        if constexpr (BlockT::WIDTH == SimdT::WIDTH)
+            writeVisibility<BlockT::WIDTH>(classifier(planes, tag, i), results + i);
+        else
+            writeVisibility<BlockT::WIDTH>(classifier(scalar_planes, tag, i), results + i);
+    });
+}
+
+template<typename T, typename Objects, typename Classifier>
+FMATH_INLINE size_t cullBatch(const Frustum<T> &frustum, const Objects &objects, uint32 *visible_indices,
+    Classifier &&classifier)
+{
+    using SimdT = simd::NativeSimd<T>;
+    constexpr size_t W = SimdT::WIDTH;
+    const SimdPlanes<SimdT> planes(frustum);
+    const SimdPlanes<simd::Simd<T, 1>> scalar_planes(frustum);
+
+    size_t visible_count = 0;
+    index_t i = 0;
+    for (; i + W <= objects.count; i += W)
+    {
+        // Branchless compaction, every lane is written and the cursor only advances past visible ones
+        uint32 outside = classifier(planes, SimdT(), i);
+        for (index_t l = 0; l < W; ++l)
+        {
+            visible_indices[visible_count] = static_cast<uint32>(i + l);
+            visible_count += ((outside >> l) & 1u) ^ 1u;
+        }
+    }
+    for (; i < objects.count; ++i)
+    {
+        if ((classifier(scalar_planes, simd::Simd<T, 1>(), i) & 1u) == 0)
+            visible_indices[visible_count++] = static_cast<uint32>(i);
+    }
+    return visible_count;
+}
+
+}
+
+// Writes the visibility of every box, boxes.count entries
+template<typename T>
+void classify(const Frustum<T> &frustum, const Box3Soa<T> &boxes, Visibility *results)
+{
+    internal::classifyBatch(frustum, boxes, results, [&](const auto &planes, auto tag, index_t i)
+    {
+        return internal::classifyBoxes<decltype(tag)>(planes, boxes, i);
+    });
+}
+
+template<typename T>
+void classify(const Frustum<T> &frustum, const Sphere3Soa<T> &spheres, Visibility *results)
+{
+    internal::classifyBatch(frustum, spheres, results, [&](const auto &planes, auto tag, index_t i)
+    {
+        return internal::classifySpheres<decltype(tag)>(planes, spheres, i);
+    });
+}
+
+// Writes the indices of the boxes that are not outside, in increasing order, and returns their count.
+// visible_indices must have room for boxes.count entries.
+template<typename T>
+size_t cull(const Frustum<T> &frustum, const Box3Soa<T> &boxes, uint32 *visible_indices)
+{
+    return internal::cullBatch(frustum, boxes, visible_indices, [&](const auto &planes, auto tag, index_t i)
+    {
+        return internal::classifyBoxes<decltype(tag)>(planes, boxes, i);
+    });
+}
+
+template<typename T>
+size_t cull(const Frustum<T> &frustum, const Sphere3Soa<T> &spheres, uint32 *visible_indices)
+{
+    return internal::cullBatch(frustum, spheres, visible_indices, [&](const auto &planes, auto tag, index_t i)
+    {
+        return internal::classifySpheres<decltype(tag)>(planes, spheres, i);
+    });
+}
+
+template<typename T>
+FMATH_CONSTEXPR Frustum<T>::Frustum(const Frustum &other)
+    :   planes_(other.planes_)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR Frustum<T>::Frustum(const std::array<Plane<ValueType>, PLANE_COUNT> &planes)
+    :   planes_(planes)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR Frustum<T>::Frustum(const Transform<ValueType> &view_projection)
+    :   Frustum(makeFromMatrix(view_projection.toMatrix()))
+{}
+
+template<typename T>
+FMATH_CONSTEXPR Frustum<T> &Frustum<T>::operator=(const Frustum &other)
+{
+    planes_ = other.planes_;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR const Plane<T> &Frustum<T>::operator[](index_t index) const
+{
+    FMATH_ASSERT(index < PLANE_COUNT);
+    return planes_[index];
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Plane<T> &Frustum<T>::operator[](index_t index)
+{
+    FMATH_ASSERT(index < PLANE_COUNT);
+    return planes_[index];
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR const std::array<Plane<T>, Frustum<T>::PLANE_COUNT> &Frustum<T>::planes() const
+{
+    return planes_;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool Frustum<T>::contains(const Point3<ValueType> &point) const
+{
+    for (const Plane<ValueType> &plane : planes_)
+    {
+        if (distance(plane, point) < static_cast<ValueType>(0))
+            return false;
+    }
+    return true;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Visibility Frustum<T>::classify(const Box3<ValueType> &box) const
+{
+    const ValueType half = static_cast<ValueType>(0.5);
+    const Vector3<ValueType> extent = (box.max() - box.min()) * half;
+    const Point3<ValueType> center = box.min() + extent;
+
+    bool inside = true;
+    for (const Plane<ValueType> &plane : planes_)
+    {
+        const Vector3<ValueType> &n = plane.normal();
+        const ValueType d = distance(plane, center);
+        const ValueType r = abs(n[0]) * extent[0] + abs(n[1]) * extent[1] + abs(n[2]) * extent[2];
+        if (d < -r)
+            return Visibility::Outside;
+        inside = inside && d >= r;
+    }
+    return inside ? Visibility::Inside : Visibility::Intersecting;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Visibility Frustum<T>::classify(const Sphere3<ValueType> &sphere) const
+{
+    bool inside = true;
+    for (const Plane<ValueType> &plane : planes_)
+    {
+        const ValueType d = distance(plane, sphere.center());
+        if (d < -sphere.radius())
+            return Visibility::Outside;
+        inside = inside && d >= sphere.radius();
+    }
+    return inside ? Visibility::Inside : Visibility::Intersecting;
+}
+
+template<typename T>
+FMATH_CONSTEXPR Frustum<T> Frustum<T>::makeFromMatrix(const Matrix4<ValueType> &m)
+{
+    const ValueType one = static_cast<ValueType>(1);
+    return Frustum<T>(std::array<Plane<ValueType>, PLANE_COUNT> {
+        internal::makeClipPlane(m, 0, one),
+        internal::makeClipPlane(m, 0, -one),
+        internal::makeClipPlane(m, 1, one),
+        internal::makeClipPlane(m, 1, -one),
+        internal::makeClipPlane(m, 2, one),
+        internal::makeClipPlane(m, 2, -one)
+    });
+}
+
+using Frustumf = Frustum<float>;
+using Frustumlf = Frustum<double>;
+
+}
+
+#endif
@@ -0,0 +1,971 @@
+#ifndef _FMATH_GJK_H_
+#define _FMATH_GJK_H_
+
+#include <type_traits>
+#include <utility>
+
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "distance.h"
+#include "point.h"
+#include "sphere.h"
+#include "triangle.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// Convex shapes are passed to the queries as any type with a ValueType and two overloads found by argument dependent
+// lookup: support(shape, direction), the point of the shape farthest along direction, and supportRadius(shape). The
+// shape is the points within that radius of the support point set, which keeps the points of spheres and the
+// segments of capsules exact instead of approximating their round surfaces.
+
+// Points within radius of the segment from start to end
+template<typename T>
+class Capsule
+{
+public:
+    using ValueType = T;
+
+public:
+    FMATH_CONSTEXPR Capsule() = default;
+
+    explicit FMATH_CONSTEXPR Capsule(const Point3<T> &start, const Point3<T> &end, T radius);
+
+    FMATH_INLINE FMATH_CONSTEXPR const Point3<T> &start() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR const Point3<T> &end() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR T radius() const;
+
+private:
+    Point3<T> start_;
+    Point3<T> end_;
+    T radius_ = static_cast<T>(0);
+};
+
+// Convex hull of a point set, the points are referenced, not copied
+template<typename T>
+class ConvexHull
+{
+public:
+    using ValueType = T;
+
+public:
+    explicit FMATH_CONSTEXPR ConvexHull(const Point3<T> *points, size_t count);
+
+    FMATH_INLINE FMATH_CONSTEXPR const Point3<T> *points() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR size_t size() const;
+
+private:
+    const Point3<T> *points_;
+    size_t count_;
+};
+
+// Shape given by a callable returning its support point for a direction, grown by radius
+template<typename T, typename FunctionT>
+class SupportShape
+{
+public:
+    using ValueType = T;
+
+public:
+    explicit SupportShape(FunctionT function, T radius = static_cast<T>(0));
+
+    FMATH_INLINE Point3<T> support(const Vector3<T> &direction) const;
+
+    FMATH_INLINE T radius() const;
+
+private:
+    FunctionT function_;
+    T radius_;
+};
+
+template<typename T, typename FunctionT>
+FMATH_INLINE SupportShape<T, std::decay_t<FunctionT>> makeSupportShape(FunctionT &&function,
+    T radius = static_cast<T>(0))
+{
+    return SupportShape<T, std::decay_t<FunctionT>>(std::forward<FunctionT>(function), radius);
+}
+
+// Search directions of the last simplex of a pair of shapes. Passed again on the next frame they rebuild that simplex
+// on the moved shapes, which usually starts the search next to the answer.
+template<typename T>
+struct GjkCache
+{
+    Vector3<T> directions[4];
+    uint32 size = 0;
+};
+
+template<typename T>
+struct GjkResult
+{
+    // Closest points of the shapes, when they intersect two points inside both
+    Point3<T> point1;
+    Point3<T> point2;
+    T distance;
+    bool intersecting;
+    uint32 iterations;
+};
+
+template<typename T>
+struct Penetration
+{
+    // Moving the second shape by normal * depth separates the shapes, point1 and point2 are the deepest points of each
+    // shape inside the other
+    Vector3<T> normal;
+    T depth;
+    Point3<T> point1;
+    Point3<T> point2;
+};
+
+// Gilbert-Johnson-Keerthi distance between two convex shapes, after van den Bergen, "A Fast and Robust GJK
+// Implementation for Collision Detection of Convex Objects"
+template<typename Shape1, typename Shape2>
+GjkResult<typename Shape1::ValueType> gjkDistance(const Shape1 &shape1, const Shape2 &shape2,
+    GjkCache<typename Shape1::ValueType> *cache = nullptr);
+
+// Only whether the shapes intersect, touching included. Stops as soon as a separating direction turns up.
+template<typename Shape1, typename Shape2>
+bool gjkIntersect(const Shape1 &shape1, const Shape2 &shape2, GjkCache<typename Shape1::ValueType> *cache = nullptr);
+
+// Penetration depth of intersecting shapes by the expanding polytope algorithm on the simplex GJK ends with. Returns
+// false and leaves penetration alone if the shapes do not intersect.
+template<typename Shape1, typename Shape2>
+bool epaPenetration(const Shape1 &shape1, const Shape2 &shape2, Penetration<typename Shape1::ValueType> &penetration,
+    GjkCache<typename Shape1::ValueType> *cache = nullptr);
+
+template<typename T>
+FMATH_INLINE Point3<T> support(const Sphere3<T> &sphere, const Vector3<T> &)
+{
+    return sphere.center();
+}
+
+template<typename T>
+FMATH_INLINE T supportRadius(const Sphere3<T> &sphere)
+{
+    return sphere.radius();
+}
+
+template<typename T>
+FMATH_INLINE Point3<T> support(const Box3<T> &box, const Vector3<T> &direction)
+{
+    return Point3<T>(direction[0] >= static_cast<T>(0) ? box.max()[0] : box.min()[0],
+        direction[1] >= static_cast<T>(0) ? box.max()[1] : box.min()[1],
+        direction[2] >= static_cast<T>(0) ? box.max()[2] : box.min()[2]);
+}
+
+template<typename T>
+FMATH_INLINE T supportRadius(const Box3<T> &)
+{
+    return static_cast<T>(0);
+}
+
+template<typename T>
+FMATH_INLINE Point3<T> support(const Triangle3<T> &triangle, const Vector3<T> &direction)
+{
+    const T d0 = dot(triangle[0] - Point3<T>(), direction);
+    const T d1 = dot(triangle[1] - Point3<T>(), direction);
+    const T d2 = dot(triangle[2] - Point3<T>(), direction);
+    return d0 >= d1 ? (d0 >= d2 ? triangle[0] : triangle[2]) : (d1 >= d2 ? triangle[1] : triangle[2]);
+}
+
+template<typename T>
+FMATH_INLINE T supportRadius(const Triangle3<T> &)
+{
+    return static_cast<T>(0);
+}
+
+template<typename T>
+FMATH_INLINE Point3<T> support(const Capsule<T> &capsule, const Vector3<T> &direction)
+{
+    return dot(capsule.end() - capsule.start(), direction) >= static_cast<T>(0) ? capsule.end() : capsule.start();
+}
+
+template<typename T>
+FMATH_INLINE T supportRadius(const Capsule<T> &capsule)
+{
+    return capsule.radius();
+}
+
+template<typename T>
+FMATH_INLINE Point3<T> support(const ConvexHull<T> &hull, const Vector3<T> &direction)
+{
+    FMATH_ASSERT(hull.size() > 0);
+    const Point3<T> *points = hull.points();
+    index_t best = 0;
+    T best_distance = dot(points[0] - Point3<T>(), direction);
+    for (index_t i = 1; i < hull.size(); ++i)
+    {
+        const T d = dot(points[i] - Point3<T>(), direction);
+        if (d > best_distance)
+        {
+            best_distance = d;
+            best = i;
+        }
+    }
+    return points[best];
+}
+
+template<typename T>
+FMATH_INLINE T supportRadius(const ConvexHull<T> &)
+{
+    return static_cast<T>(0);
+}
+
+template<typename T, typename FunctionT>
+FMATH_INLINE Point3<T> support(const SupportShape<T, FunctionT> &shape, const Vector3<T> &direction)
+{
+    return shape.support(direction);
+}
+
+template<typename T, typename FunctionT>
+FMATH_INLINE T supportRadius(const SupportShape<T, FunctionT> &shape)
+{
+    return shape.radius();
+}
+
+using Capsulef = Capsule<float>;
+using Capsulelf = Capsule<double>;
+
+using ConvexHullf = ConvexHull<float>;
+using ConvexHulllf = ConvexHull<double>;
+
+namespace internal
+{
+
+constexpr uint32 GJK_MAX_ITERATIONS = 64;
+constexpr uint32 EPA_MAX_ITERATIONS = 64;
+constexpr size_t EPA_MAX_VERTICES = EPA_MAX_ITERATIONS + 4;
+constexpr size_t EPA_MAX_FACES = 2 * EPA_MAX_VERTICES;
+
+// Relative tolerance of the convergence tests on squared lengths, about half of it is left in the distances
+template<typename T>
+struct GjkTolerance
+{
+    static constexpr T value = static_cast<T>(1e-10);
+};
+
+template<>
+struct GjkTolerance<float>
+{
+    static constexpr float value = 1e-5f;
+};
+
+// Relative squared distance from the origin under which it counts as reached. The rounding of a projection onto the
+// simplex grows with epsilon times the length of its points, so the squared tolerance goes with epsilon squared.
+template<typename T>
+struct GjkContactTolerance
+{
+    static constexpr T value = static_cast<T>(65536) * constants::Epsilon<T>::value * constants::Epsilon<T>::value;
+};
+
+template<typename T>
+struct SimplexVertex
+{
+    // point1 - point2, a point of the Minkowski difference of the cores
+    Vector3<T> w;
+    Point3<T> point1;
+    Point3<T> point2;
+    Vector3<T> direction;
+};
+
+template<typename T, typename Shape1, typename Shape2>
+FMATH_INLINE SimplexVertex<T> supportVertex(const Shape1 &shape1, const Shape2 &shape2, const Vector3<T> &direction)
+{
+    SimplexVertex<T> vertex;
+    vertex.point1 = support(shape1, direction);
+    vertex.point2 = support(shape2, -direction);
+    vertex.w = vertex.point1 - vertex.point2;
+    vertex.direction = direction;
+    return vertex;
+}
+
+template<typename T>
+FMATH_INLINE T determinant(const Vector3<T> &a, const Vector3<T> &b, const Vector3<T> &c)
+{
+    return dot(a, cross(b, c));
+}
+
+// Up to four points of the Minkowski difference and the barycentric weights of its point closest to the origin
+template<typename T>
+class Simplex
+{
+public:
+    FMATH_INLINE uint32 size() const;
+
+    FMATH_INLINE const SimplexVertex<T> &operator[](index_t index) const;
+
+    FMATH_INLINE bool contains(const Vector3<T> &w) const;
+
+    FMATH_INLINE void add(const SimplexVertex<T> &vertex);
+
+    // Keeps the smallest subset whose hull holds the point closest to the origin and returns that point, the zero
+    // vector when the origin is inside a full tetrahedron
+    Vector3<T> solve();
+
+    // Points of the shapes the closest point interpolates
+    FMATH_INLINE void closestPoints(Point3<T> &point1, Point3<T> &point2) const;
+
+    // Largest squared length of the points, the scale of the tolerances
+    FMATH_INLINE T maxLength2() const;
+
+private:
+    FMATH_INLINE void keep(uint32 i, T wi);
+
+    FMATH_INLINE void keep(uint32 i, T wi, uint32 j, T wj);
+
+    FMATH_INLINE void keep(uint32 i, T wi, uint32 j, T wj, uint32 k, T wk);
+
+    // Closest point of the triangle of vertices i, j and k, written to the weights without reducing
+    FMATH_INLINE T solveTriangle(uint32 i, uint32 j, uint32 k, uint32 *kept, T *weights, uint32 &kept_count) const;
+
+private:
+    SimplexVertex<T> vertices_[4];
+    T weights_[4] = {};
+    uint32 size_ = 0;
+};
+
+template<typename T>
+FMATH_INLINE uint32 Simplex<T>::size() const
+{
+    return size_;
+}
+
+template<typename T>
+FMATH_INLINE const SimplexVertex<T> &Simplex<T>::operator[](index_t index) const
+{
+    return vertices_[index];
+}
+
+template<typename T>
+FMATH_INLINE bool Simplex<T>::contains(const Vector3<T> &w) const
+{
+    for (index_t i = 0; i < size_; ++i)
+    {
+        if (vertices_[i].w == w)
+            return true;
+    }
+    return false;
+}
+
+template<typename T>
+FMATH_INLINE void Simplex<T>::add(const SimplexVertex<T> &vertex)
+{
+    FMATH_ASSERT(size_ < 4);
+    vertices_[size_++] = vertex;
+}
+
+template<typename T>
+FMATH_INLINE void Simplex<T>::keep(uint32 i, T wi)
+{
+    vertices_[0] = vertices_[i];
+    weights_[0] = wi;
+    size_ = 1;
+}
+
+template<typename T>
+FMATH_INLINE void Simplex<T>::keep(uint32 i, T wi, uint32 j, T wj)
+{
+    const SimplexVertex<T> vj = vertices_[j];
+    vertices_[0] = vertices_[i];
+    vertices_[1] = vj;
+    weights_[0] = wi;
+    weights_[1] = wj;
+    size_ = 2;
+}
+
+template<typename T>
+FMATH_INLINE void Simplex<T>::keep(uint32 i, T wi, uint32 j, T wj, uint32 k, T wk)
+{
+    const SimplexVertex<T> vi = vertices_[i];
+    const SimplexVertex<T> vj = vertices_[j];
+    const SimplexVertex<T> vk = vertices_[k];
+    vertices_[0] = vi;
+    vertices_[1] = vj;
+    vertices_[2] = vk;
+    weights_[0] = wi;
+    weights_[1] = wj;
+    weights_[2] = wk;
+    size_ = 3;
+}
+
+template<typename T>
+FMATH_INLINE T Simplex<T>::solveTriangle(uint32 i, uint32 j, uint32 k, uint32 *kept, T *weights,
+    uint32 &kept_count) const
+{
+    const T one = static_cast<T>(1);
+    const Triangle3<T> triangle(vertices_[i].w, vertices_[j].w, vertices_[k].w);
+    const TriangleClosestPoint<T> closest = closestPoint(Point3<T>(), triangle);
+    const T u = closest.u;
+    const T v = closest.v;
+    switch (closest.feature)
+    {
+    case TriangleFeature::Vertex0:
+        kept[0] = i, weights[0] = one, kept_count = 1;
+        break;
+    case TriangleFeature::Vertex1:
+        kept[0] = j, weights[0] = one, kept_count = 1;
+        break;
+    case TriangleFeature::Vertex2:
+        kept[0] = k, weights[0] = one, kept_count = 1;
+        break;
+    case TriangleFeature::Edge01:
+        kept[0] = i, weights[0] = one - u, kept[1] = j, weights[1] = u, kept_count = 2;
+        break;
+    case TriangleFeature::Edge12:
+        kept[0] = j, weights[0] = u, kept[1] = k, weights[1] = v, kept_count = 2;
+        break;
+    case TriangleFeature::Edge20:
+        kept[0] = k, weights[0] = v, kept[1] = i, weights[1] = one - v, kept_count = 2;
+        break;
+    default:
+        kept[0] = i, weights[0] = one - u - v, kept[1] = j, weights[1] = u, kept[2] = k, weights[2] = v;
+        kept_count = 3;
+        break;
+    }
+    return closest.distance2;
+}
+
+template<typename T>
+Vector3<T> Simplex<T>::solve()
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    uint32 kept[3] = {};
+    T weights[3] = {};
+    uint32 kept_count = 0;
+
+    if (size_ == 2)
+    {
+        const Vector3<T> &a = vertices_[0].w;
+        const Vector3<T> ab = vertices_[1].w - a;
+        const T length2_ab = dot(ab, ab);
+        const T t = length2_ab > zero ? -dot(a, ab) / length2_ab : zero;
+        if (t <= zero)
+            keep(0, one);
+        else if (t >= one)
+            keep(1, one);
+        else
+            keep(0, one - t, 1, t);
+    }
+    else if (size_ == 3)
+    {
+        solveTriangle(0, 1, 2, kept, weights, kept_count);
+        if (kept_count == 1)
+            keep(kept[0], weights[0]);
+        else if (kept_count == 2)
+            keep(kept[0], weights[0], kept[1], weights[1]);
+        else
+            weights_[0] = weights[0], weights_[1] = weights[1], weights_[2] = weights[2];
+    }
+    else if (size_ == 4)
+    {
+        // Ericson, "Real-Time Collision Detection", 5.1.6: the closest point lies on a face the origin is outside of.
+        // Faces with the opposite vertex within rounding of their plane count as outside, so that a flat tetrahedron
+        // never passes for holding the origin.
+        static constexpr uint32 FACES[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+        const T flat_tolerance = GjkContactTolerance<T>::value * maxLength2();
+        T best = constants::Inf<T>::value;
+        uint32 best_kept[3] = {};
+        T best_weights[3] = {};
+        uint32 best_count = 0;
+        bool inside = true;
+        for (const auto &face : FACES)
+        {
+            const Vector3<T> &a = vertices_[face[0]].w;
+            const Vector3<T> normal = cross(vertices_[face[1]].w - a, vertices_[face[2]].w - a);
+            const T origin_side = -dot(normal, a);
+            const T opposite_side = dot(normal, vertices_[face[3]].w - a);
+            if (origin_side * opposite_side > zero &&
+                opposite_side * opposite_side > flat_tolerance * dot(normal, normal))
+                continue;
+
+            inside = false;
+            const T distance2 = solveTriangle(face[0], face[1], face[2], kept, weights, kept_count);
+            if (distance2 < best)
+            {
+                best = distance2;
+                best_count = kept_count;
+                for (index_t i = 0; i < kept_count; ++i)
+                {
+                    best_kept[i] = kept[i];
+                    best_weights[i] = weights[i];
+                }
+            }
+        }
+
+        if (inside)
+        {
+            const Vector3<T> &a = vertices_[0].w;
+            const Vector3<T> &b = vertices_[1].w;
+            const Vector3<T> &c = vertices_[2].w;
+            const Vector3<T> &d = vertices_[3].w;
+            const T volume = determinant(b - a, c - a, d - a);
+            weights_[0] = determinant(b, c, d) / volume;
+            weights_[1] = determinant(-a, c - a, d - a) / volume;
+            weights_[2] = determinant(b - a, -a, d - a) / volume;
+            weights_[3] = determinant(b - a, c - a, -a) / volume;
+            return Vector3<T>();
+        }
+
+        if (best_count == 1)
+            keep(best_kept[0], best_weights[0]);
+        else if (best_count == 2)
+            keep(best_kept[0], best_weights[0], best_kept[1], best_weights[1]);
+        else
+            keep(best_kept[0], best_weights[0], best_kept[1], best_weights[1], best_kept[2], best_weights[2]);
+    }
+    else
+    {
+        weights_[0] = one;
+    }
+
+    Vector3<T> result = vertices_[0].w * weights_[0];
+    for (index_t i = 1; i < size_; ++i)
+        result += vertices_[i].w * weights_[i];
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE void Simplex<T>::closestPoints(Point3<T> &point1, Point3<T> &point2) const
+{
+    Vector3<T> sum1 = (vertices_[0].point1 - Point3<T>()) * weights_[0];
+    Vector3<T> sum2 = (vertices_[0].point2 - Point3<T>()) * weights_[0];
+    for (index_t i = 1; i < size_; ++i)
+    {
+        sum1 += (vertices_[i].point1 - Point3<T>()) * weights_[i];
+        sum2 += (vertices_[i].point2 - Point3<T>()) * weights_[i];
+    }
+    point1 = sum1;
+    point2 = sum2;
+}
+
+template<typename T>
+FMATH_INLINE T Simplex<T>::maxLength2() const
+{
+    T result = static_cast<T>(0);
+    for (index_t i = 0; i < size_; ++i)
+        result = max(result, dot(vertices_[i].w, vertices_[i].w));
+    return result;
+}
+
+// GJK on the support point sets of the shapes, leaving the closest point of their Minkowski difference in closest and
+// the simplex around it. Gives up early, returning false, once the distance is known to exceed separation.
+template<typename T, typename Shape1, typename Shape2>
+bool gjk(const Shape1 &shape1, const Shape2 &shape2, GjkCache<T> *cache, T separation, Simplex<T> &simplex,
+    Vector3<T> &closest, uint32 &iterations)
+{
+    const T tolerance = GjkTolerance<T>::value;
+    const T contact_tolerance = GjkContactTolerance<T>::value;
+    if (cache != nullptr)
+    {
+        for (index_t i = 0; i < cache->size; ++i)
+        {
+            const SimplexVertex<T> vertex = supportVertex<T>(shape1, shape2, cache->directions[i]);
+            if (!simplex.contains(vertex.w))
+                simplex.add(vertex);
+        }
+    }
+    if (simplex.size() == 0)
+    {
+        const Vector3<T> direction = support(shape2, Vector3<T>(1, 0, 0)) - support(shape1, Vector3<T>(1, 0, 0));
+        simplex.add(supportVertex<T>(shape1, shape2, dot(direction, direction) > static_cast<T>(0) ?
+            direction : Vector3<T>(1, 0, 0)));
+    }
+
+    closest = simplex.solve();
+    bool intersecting = false;
+    for (iterations = 0; iterations < GJK_MAX_ITERATIONS; ++iterations)
+    {
+        const T length2 = dot(closest, closest);
+        if (simplex.size() == 4 || length2 <= contact_tolerance * simplex.maxLength2())
+        {
+            intersecting = true;
+            break;
+        }
+
+        const SimplexVertex<T> vertex = supportVertex<T>(shape1, shape2, -closest);
+        // The support plane bounds the distance from below by vw / |v|
+        const T vw = dot(closest, vertex.w);
+        if (vw > static_cast<T>(0) && vw * vw > separation * separation * length2)
+            break;
+
+        if (length2 - vw <= tolerance * length2 || simplex.contains(vertex.w))
+            break;
+
+        // Rounding can stall the descent near the answer, the last simplex is then as close as it gets
+        const Simplex<T> previous = simplex;
+        simplex.add(vertex);
+        const Vector3<T> next = simplex.solve();
+        if (dot(next, next) >= length2)
+        {
+            simplex = previous;
+            break;
+        }
+        closest = next;
+    }
+
+    if (cache != nullptr)
+    {
+        cache->size = simplex.size();
+        for (index_t i = 0; i < simplex.size(); ++i)
+            cache->directions[i] = simplex[i].direction;
+    }
+    return intersecting;
+}
+
+// Grows a simplex holding the origin into a tetrahedron holding it, false when the Minkowski difference is flat
+template<typename T, typename Shape1, typename Shape2>
+bool expandSimplex(const Shape1 &shape1, const Shape2 &shape2, Simplex<T> &simplex)
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    while (simplex.size() < 4)
+    {
+        const T tolerance = GjkContactTolerance<T>::value * max(simplex.maxLength2(), one);
+        const Vector3<T> &a = simplex[0].w;
+        Vector3<T> directions[6];
+        size_t direction_count = 0;
+        if (simplex.size() == 1)
+        {
+            for (index_t i = 0; i < 3; ++i)
+            {
+                Vector3<T> axis;
+                axis[i] = one;
+                directions[direction_count++] = axis;
+                directions[direction_count++] = -axis;
+            }
+        }
+        else if (simplex.size() == 2)
+        {
+            const Vector3<T> ab = simplex[1].w - a;
+            index_t smallest = 0;
+            for (index_t i = 1; i < 3; ++i)
+            {
+                if (abs(ab[i]) < abs(ab[smallest]))
+                    smallest = i;
+            }
+            Vector3<T> axis;
+            axis[smallest] = one;
+            const Vector3<T> side = cross(ab, axis);
+            const Vector3<T> up = cross(ab, side);
+            directions[direction_count++] = side;
+            directions[direction_count++] = -side;
+            directions[direction_count++] = up;
+            directions[direction_count++] = -up;
+        }
+        else
+        {
+            const Vector3<T> normal = cross(simplex[1].w - a, simplex[2].w - a);
+            directions[direction_count++] = normal;
+            directions[direction_count++] = -normal;
+        }
+
+        bool added = false;
+        for (index_t i = 0; i < direction_count && !added; ++i)
+        {
+            const SimplexVertex<T> vertex = supportVertex<T>(shape1, shape2, directions[i]);
+            // Squared distance of the new point from the line or plane of the simplex
+            const Vector3<T> aw = vertex.w - a;
+            T spread = zero;
+            if (simplex.size() == 1)
+            {
+                spread = dot(aw, aw);
+            }
+            else if (simplex.size() == 2)
+            {
+                const Vector3<T> ab = simplex[1].w - a;
+                spread = length2(cross(ab, aw)) / dot(ab, ab);
+            }
+            else
+            {
+                const T height = dot(directions[i], aw);
+                spread = height * height / dot(directions[i], directions[i]);
+            }
+
+            if (spread > tolerance)
+            {
+                simplex.add(vertex);
+                added = true;
+            }
+        }
+        if (!added)
+            return false;
+    }
+    return true;
+}
+
+template<typename T>
+struct EpaFace
+{
+    uint32 vertices[3];
+    Vector3<T> normal;
+    T distance;
+};
+
+// Expanding polytope from a tetrahedron holding the origin. Writes the face of the Minkowski difference closest to the
+// origin as normal and depth and the points of the shapes behind it.
+template<typename T, typename Shape1, typename Shape2>
+void epa(const Shape1 &shape1, const Shape2 &shape2, const Simplex<T> &simplex, Penetration<T> &penetration)
+{
+    const T zero = static_cast<T>(0);
+    const T tolerance = GjkTolerance<T>::value;
+    SimplexVertex<T> vertices[EPA_MAX_VERTICES];
+    EpaFace<T> faces[EPA_MAX_FACES];
+    std::pair<uint32, uint32> edges[3 * EPA_MAX_FACES];
+    size_t vertex_count = 4;
+    size_t face_count = 0;
+    for (index_t i = 0; i < 4; ++i)
+        vertices[i] = simplex[i];
+
+    const auto makeFace = [&](uint32 a, uint32 b, uint32 c)
+    {
+        EpaFace<T> &face = faces[face_count++];
+        face.vertices[0] = a;
+        face.vertices[1] = b;
+        face.vertices[2] = c;
+        face.normal = cross(vertices[b].w - vertices[a].w, vertices[c].w - vertices[a].w);
+        const T length = fmath::length(face.normal);
+        if (length > zero)
+        {
+            face.normal = face.normal * (static_cast<T>(1) / length);
+            face.distance = dot(face.normal, vertices[a].w);
+        }
+        else
+        {
+            face.distance = constants::Inf<T>::value;
+        }
+    };
+
+    // Wind the tetrahedron so that every face normal points away from the opposite vertex
+    const bool positive = determinant(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w,
+        vertices[3].w - vertices[0].w) > zero;
+    const uint32 b = positive ? 2 : 1;
+    const uint32 c = positive ? 1 : 2;
+    makeFace(0, b, c);
+    makeFace(0, 3, b);
+    makeFace(0, c, 3);
+    makeFace(b, 3, c);
+
+    // A copy, the faces move as the polytope grows
+    EpaFace<T> closest = faces[0];
+    for (uint32 iteration = 0; iteration < EPA_MAX_ITERATIONS; ++iteration)
+    {
+        index_t best = 0;
+        for (index_t i = 1; i < face_count; ++i)
+        {
+            if (faces[i].distance < faces[best].distance)
+                best = i;
+        }
+
+        closest = faces[best];
+        const SimplexVertex<T> vertex = supportVertex<T>(shape1, shape2, closest.normal);
+        if (dot(vertex.w, closest.normal) - closest.distance <= tolerance * max(closest.distance, static_cast<T>(1)) ||
+            vertex_count == EPA_MAX_VERTICES)
+            break;
+
+        // Remove the faces the new vertex sees, the edges they share with the rest form the horizon
+        const uint32 index = static_cast<uint32>(vertex_count);
+        vertices[vertex_count++] = vertex;
+        size_t edge_count = 0;
+        for (index_t i = 0; i < face_count;)
+        {
+            const EpaFace<T> &face = faces[i];
+            if (dot(face.normal, vertex.w - vertices[face.vertices[0]].w) <= zero)
+            {
+                ++i;
+                continue;
+            }
+
+            for (index_t k = 0; k < 3; ++k)
+            {
+                const std::pair<uint32, uint32> edge(face.vertices[k], face.vertices[(k + 1) % 3]);
+                index_t j = 0;
+                while (j < edge_count && !(edges[j].first == edge.second && edges[j].second == edge.first))
+                    ++j;
+                if (j < edge_count)
+                    edges[j] = edges[--edge_count];
+                else
+                    edges[edge_count++] = edge;
+            }
+            faces[i] = faces[--face_count];
+        }
+
+        if (face_count + edge_count > EPA_MAX_FACES)
+            break;
+        for (index_t i = 0; i < edge_count; ++i)
+            makeFace(edges[i].first, edges[i].second, index);
+    }
+
+    // The origin projected on the closest face locates the points on the shapes
+    const EpaFace<T> &face = closest;
+    const SimplexVertex<T> &va = vertices[face.vertices[0]];
+    const SimplexVertex<T> &vb = vertices[face.vertices[1]];
+    const SimplexVertex<T> &vc = vertices[face.vertices[2]];
+    const TriangleClosestPoint<T> projection = closestPoint(Point3<T>(face.normal * face.distance),
+        Triangle3<T>(va.w, vb.w, vc.w));
+    const T u = projection.u;
+    const T v = projection.v;
+    penetration.normal = face.normal;
+    penetration.depth = face.distance;
+    penetration.point1 = va.point1 + (vb.point1 - va.point1) * u + (vc.point1 - va.point1) * v;
+    penetration.point2 = va.point2 + (vb.point2 - va.point2) * u + (vc.point2 - va.point2) * v;
+}
+
+}
+
+template<typename T>
+FMATH_CONSTEXPR Capsule<T>::Capsule(const Point3<T> &start, const Point3<T> &end, T radius)
+    : start_(start), end_(end), radius_(radius)
+{
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR const Point3<T> &Capsule<T>::start() const
+{
+    return start_;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR const Point3<T> &Capsule<T>::end() const
+{
+    return end_;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T Capsule<T>::radius() const
+{
+    return radius_;
+}
+
+template<typename T>
+FMATH_CONSTEXPR ConvexHull<T>::ConvexHull(const Point3<T> *points, size_t count)
+    : points_(points), count_(count)
+{
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR const Point3<T> *ConvexHull<T>::points() const
+{
+    return points_;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR size_t ConvexHull<T>::size() const
+{
+    return count_;
+}
+
+template<typename T, typename FunctionT>
+SupportShape<T, FunctionT>::SupportShape(FunctionT function, T radius)
+    : function_(std::move(function)), radius_(radius)
+{
+}
+
+template<typename T, typename FunctionT>
+FMATH_INLINE Point3<T> SupportShape<T, FunctionT>::support(const Vector3<T> &direction) const
+{
+    return function_(direction);
+}
+
+template<typename T, typename FunctionT>
+FMATH_INLINE T SupportShape<T, FunctionT>::radius() const
+{
+    return radius_;
+}
+
+template<typename Shape1, typename Shape2>
+GjkResult<typename Shape1::ValueType> gjkDistance(const Shape1 &shape1, const Shape2 &shape2,
+    GjkCache<typename Shape1::ValueType> *cache)
+{
+    using T = typename Shape1::ValueType;
+    internal::Simplex<T> simplex;
+    Vector3<T> closest;
+    GjkResult<T> result;
+    result.intersecting = internal::gjk(shape1, shape2, cache, constants::Inf<T>::value, simplex, closest,
+        result.iterations);
+    simplex.closestPoints(result.point1, result.point2);
+    result.distance = static_cast<T>(0);
+    if (result.intersecting)
+        return result;
+
+    // Grow the closest points of the cores out to the surfaces
+    const T radius1 = supportRadius(shape1);
+    const T radius2 = supportRadius(shape2);
+    const T core_distance = length(closest);
+    const Vector3<T> normal = closest * (static_cast<T>(-1) / core_distance);
+    result.intersecting = core_distance <= radius1 + radius2;
+    result.distance = max(core_distance - radius1 - radius2, static_cast<T>(0));
+    result.point1 += normal * radius1;
+    result.point2 -= normal * radius2;
+    return result;
+}
+
+template<typename Shape1, typename Shape2>
+bool gjkIntersect(const Shape1 &shape1, const Shape2 &shape2, GjkCache<typename Shape1::ValueType> *cache)
+{
+    using T = typename Shape1::ValueType;
+    internal::Simplex<T> simplex;
+    Vector3<T> closest;
+    uint32 iterations = 0;
+    const T radius = supportRadius(shape1) + supportRadius(shape2);
+    return internal::gjk(shape1, shape2, cache, radius, simplex, closest, iterations) ||
+        dot(closest, closest) <= radius * radius;
+}
+
+template<typename Shape1, typename Shape2>
+bool epaPenetration(const Shape1 &shape1, const Shape2 &shape2, Penetration<typename Shape1::ValueType> &penetration,
+    GjkCache<typename Shape1::ValueType> *cache)
+{
+    using T = typename Shape1::ValueType;
+    internal::Simplex<T> simplex;
+    Vector3<T> closest;
+    uint32 iterations = 0;
+    const T radius1 = supportRadius(shape1);
+    const T radius2 = supportRadius(shape2);
+    const bool cores_intersect = internal::gjk(shape1, shape2, cache, radius1 + radius2, simplex, closest,
+        iterations);
+    const T core_distance2 = dot(closest, closest);
+    if (!cores_intersect && core_distance2 > (radius1 + radius2) * (radius1 + radius2))
+        return false;
+
+    // Only the margins overlap, the cores give the normal directly
+    if (!cores_intersect)
+    {
+        const T core_distance = sqrt(core_distance2);
+        simplex.closestPoints(penetration.point1, penetration.point2);
+        penetration.normal = closest * (static_cast<T>(-1) / core_distance);
+        penetration.depth = radius1 + radius2 - core_distance;
+        penetration.point1 += penetration.normal * radius1;
+        penetration.point2 -= penetration.normal * radius2;
+        return true;
+    }
+
+    if (!internal::expandSimplex(shape1, shape2, simplex))
+    {
+        // Flat Minkowski difference, the shapes only touch across its plane unless margins add depth
+        simplex.closestPoints(penetration.point1, penetration.point2);
+        penetration.normal = Vector3<T>(0, 0, 1);
+        if (simplex.size() == 3)
+        {
+            const Vector3<T> normal = cross(simplex[1].w - simplex[0].w, simplex[2].w - simplex[0].w);
+            if (dot(normal, normal) > static_cast<T>(0))
+                penetration.normal = normalize(normal);
+        }
+        penetration.depth = radius1 + radius2;
+        return true;
+    }
+
+    internal::epa(shape1, shape2, simplex, penetration);
+    penetration.depth += radius1 + radius2;
+    penetration.point1 += penetration.normal * radius1;
+    penetration.point2 -= penetration.normal * radius2;
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,368 @@
+#ifndef _FMATH_INTERNAL_PARALLEL_H_
+#define _FMATH_INTERNAL_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common.h"
+#include "../compile_config.h"
+#include "../functions.h"
+#include "simd.h"
+
+namespace fmath
+{
+namespace internal
+{
+
+FMATH_INLINE size_t hardwareWorkerCount()
+{
+#if defined(FMATH_USE_THREADS)
+    size_t count = static_cast<size_t>(std::thread::hardware_concurrency());
+    return count == 0 ? 1 : count;
+#else
+    return 1;
+#endif
+}
+
+// Upper bound on the threads of the parallel kernels, the calling thread included, 0 for one per hardware thread
+FMATH_INLINE std::atomic<size_t> &workerLimit()
+{
+    static std::atomic<size_t> limit { 0 };
+    return limit;
+}
+
+// Lets benchmarks compare thread counts and applications keep cores for other work. Takes effect on the next kernel.
+FMATH_INLINE void setWorkerLimit(size_t limit)
+{
+    workerLimit().store(limit, std::memory_order_relaxed);
+}
+
+FMATH_INLINE size_t workerCount()
+{
+    const size_t count = hardwareWorkerCount();
+    const size_t limit = workerLimit().load(std::memory_order_relaxed);
+    return limit == 0 ? count : min(limit, count);
+}
+
+#if defined(FMATH_USE_THREADS)
+
+// hardwareWorkerCount() - 1 threads started on first use and kept until exit, shared by every parallel kernel so that
+// per frame calls do not pay for creating threads. The pool runs one job at a time: the calling thread and the first
+// workerCount() - 1 workers claim its chunks, and the caller returns once every worker has seen the job.
+class WorkerPool
+{
+public:
+    using TaskFunction = void (*)(void *context, size_t chunk);
+
+public:
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto &thread : threads_)
+            thread.join();
+    }
+
+    static WorkerPool &instance()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    // Calls task(context, chunk) for every chunk in [0, chunk_count). Returns false without calling it when the pool
+    // is running the job of another thread or when called from inside a job, the caller then runs the chunks itself.
+    bool run(size_t chunk_count, TaskFunction task, void *context)
+    {
+        if (insideJob() || threads_.empty())
+            return false;
+
+        std::unique_lock<std::mutex> submit(submit_, std::try_to_lock);
+        if (!submit.owns_lock())
+            return false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = task;
+            context_ = context;
+            chunk_count_ = chunk_count;
+            helper_count_ = min(workerCount() - 1, chunk_count - 1);
+            next_chunk_.store(0, std::memory_order_relaxed);
+            busy_ = threads_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        insideJob() = true;
+        execute(task, context, chunk_count);
+        insideJob() = false;
+
+        // Every worker has to be done before the next job may reuse the shared state
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return busy_ == 0; });
+        return true;
+    }
+
+private:
+    WorkerPool()
+    {
+        const size_t count = hardwareWorkerCount();
+        threads_.reserve(count - 1);
+        for (index_t i = 0; i + 1 < count; ++i)
+            threads_.emplace_back([this, i]() { work(i); });
+    }
+
+    static bool &insideJob()
+    {
+        thread_local bool inside = false;
+        return inside;
+    }
+
+    void work(index_t index)
+    {
+        insideJob() = true;
+        uint64 seen = 0;
+        for (;;)
+        {
+            TaskFunction task;
+            void *context;
+            size_t chunk_count;
+            bool helps;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+                task = task_;
+                context = context_;
+                chunk_count = chunk_count_;
+                helps = index < helper_count_;
+            }
+
+            if (helps)
+                execute(task, context, chunk_count);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0)
+                done_.notify_one();
+        }
+    }
+
+    void execute(TaskFunction task, void *context, size_t chunk_count)
+    {
+        for (size_t chunk = next_chunk_++; chunk < chunk_count; chunk = next_chunk_++)
+            task(context, chunk);
+    }
+
+private:
+    std::vector<std::thread> threads_;
+    std::mutex submit_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    TaskFunction task_ = nullptr;
+    void *context_ = nullptr;
+    size_t chunk_count_ = 0;
+    size_t helper_count_ = 0;
+    std::atomic<size_t> next_chunk_ { 0 };
+    size_t busy_ = 0;
+    uint64 generation_ = 0;
+    bool stop_ = false;
+};
+
+#endif
+
+// Splits [begin, end) into chunks of grain_size elements and calls func(chunk_begin, chunk_end)
+// for each of them. Chunks are claimed dynamically so uneven work still balances. The chunks run on the shared
+// WorkerPool, calls nested in another parallelFor or made while another thread uses the pool run serially.
+template<typename Function>
+void parallelFor(size_t begin, size_t end, size_t grain_size, Function &&func)
+{
+    if (begin >= end)
+        return;
+
+    grain_size = grain_size == 0 ? 1 : grain_size;
+    const size_t chunk_count = (end - begin + grain_size - 1) / grain_size;
+    if (min(workerCount(), chunk_count) <= 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+#if defined(FMATH_USE_THREADS)
+    auto body = [&](size_t chunk)
+    {
+        const size_t chunk_begin = begin + chunk * grain_size;
+        const size_t chunk_end = min(chunk_begin + grain_size, end);
+        func(chunk_begin, chunk_end);
+    };
+    using BodyT = decltype(body);
+    const auto task = [](void *context, size_t chunk) { (*static_cast<BodyT *>(context))(chunk); };
+    if (!WorkerPool::instance().run(chunk_count, task, &body))
+        func(begin, end);
+#else
+    func(begin, end);
+#endif
+}
+
+// Runs func(chunk_index, chunk_begin, chunk_end) over exactly chunk_count contiguous chunks, useful when
+// every chunk owns a slot in a per-chunk scratch buffer.
+template<typename Function>
+void parallelForChunks(size_t count, size_t chunk_count, Function &&func)
+{
+    if (count == 0 || chunk_count == 0)
+        return;
+
+    const size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+    parallelFor(0, chunk_count, 1, [&](size_t first, size_t last)
+    {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            size_t chunk_begin = min(chunk * chunk_size, count);
+            size_t chunk_end = min(chunk_begin + chunk_size, count);
+            func(chunk, chunk_begin, chunk_end);
+        }
+    });
+}
+
+// Runs block(tag, index) over [0, count) in parallel chunks, where tag is a default constructed SimdT for full
+// blocks of SimdT::WIDTH elements starting at index and a Simd<T, 1> for the remaining tail elements
+template<typename SimdT, typename BlockFunction>
+FMATH_INLINE void parallelForSimd(size_t count, size_t grain_size, BlockFunction &&block)
+{
+    using ScalarT = simd::Simd<typename SimdT::ValueType, 1>;
+    constexpr size_t W = SimdT::WIDTH;
+
+    // Keep chunk boundaries on block boundaries so only the last chunk has a tail
+    grain_size = (grain_size + W - 1) / W * W;
+    parallelFor(0, count, grain_size, [&](size_t begin, size_t end)
+    {
+        index_t i = begin;
+        for (; i + W <= end; i += W)
+            block(SimdT(), i);
+        for (; i < end; ++i)
+            block(ScalarT(), i);
+    });
+}
+
+// Stable LSD radix sort of key/value pairs by the low key_bits bits of the keys, eight bits per pass. Every pass
+// counts digits per chunk in parallel and scatters each chunk to its own offsets, passes where all keys share the
+// same digit are skipped.
+template<typename KeyT, typename ValueT>
+void parallelRadixSort(KeyT *keys, ValueT *values, size_t count, size_t key_bits = sizeof(KeyT) * 8)
+{
+    constexpr size_t RADIX = 256;
+    constexpr size_t MIN_CHUNK_SIZE = 4096;
+    if (count < 2)
+        return;
+
+    std::vector<KeyT> key_buffer(count);
+    std::vector<ValueT> value_buffer(count);
+    KeyT *source_keys = keys;
+    ValueT *source_values = values;
+    KeyT *target_keys = key_buffer.data();
+    ValueT *target_values = value_buffer.data();
+
+    const size_t chunk_count = max(min(workerCount() * 4, count / MIN_CHUNK_SIZE), static_cast<size_t>(1));
+    std::vector<size_t> offsets(chunk_count * RADIX);
+    for (size_t shift = 0; shift < key_bits; shift += 8)
+    {
+        std::fill(offsets.begin(), offsets.end(), static_cast<size_t>(0));
+        parallelForChunks(count, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+        {
+            size_t *histogram = &offsets[chunk * RADIX];
+            for (index_t i = begin; i < end; ++i)
+                ++histogram[static_cast<size_t>(source_keys[i] >> shift) & (RADIX - 1)];
+        });
+
+        // Digit major, chunk minor, which keeps equal digits in their input order
+        size_t offset = 0;
+        bool skip = false;
+        for (index_t digit = 0; digit < RADIX; ++digit)
+        {
+            size_t digit_count = 0;
+            for (index_t chunk = 0; chunk < chunk_count; ++chunk)
+            {
+                const size_t n = offsets[chunk * RADIX + digit];
+                offsets[chunk * RADIX + digit] = offset;
+                offset += n;
+                digit_count += n;
+            }
+            skip = skip || digit_count == count;
+        }
+        if (skip)
+            continue;
+
+        parallelForChunks(count, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+        {
+            size_t *chunk_offsets = &offsets[chunk * RADIX];
+            for (index_t i = begin; i < end; ++i)
+            {
+                const size_t position = chunk_offsets[static_cast<size_t>(source_keys[i] >> shift) & (RADIX - 1)]++;
+                target_keys[position] = source_keys[i];
+                target_values[position] = source_values[i];
+            }
+        });
+        std::swap(source_keys, target_keys);
+        std::swap(source_values, target_values);
+    }
+
+    if (source_keys != keys)
+    {
+        parallelFor(0, count, MIN_CHUNK_SIZE * 4, [&](size_t begin, size_t end)
+        {
+            std::copy(source_keys + begin, source_keys + end, keys + begin);
+            std::copy(source_values + begin, source_values + end, values + begin);
+        });
+    }
+}
+
+// Output shared by the threads of a parallel search. Every thread gathers results in a small local block and reserves
+// room for the whole block with one atomic add, so nothing is locked and the buffer stays dense. Results past the
+// capacity are dropped but still counted, the caller grows the buffer to size() and runs again.
+template<typename ElementT>
+class AppendBuffer
+{
+public:
+    AppendBuffer(ElementT *data, size_t capacity) : data_(data), capacity_(capacity), cursor_(0) {}
+
+    void append(const ElementT *elements, size_t count)
+    {
+        const size_t offset = cursor_.fetch_add(count, std::memory_order_relaxed);
+        if (offset < capacity_)
+            std::copy(elements, elements + min(count, capacity_ - offset), data_ + offset);
+    }
+
+    // Number of results appended, including the ones that did not fit
+    size_t size() const
+    {
+        return cursor_.load(std::memory_order_relaxed);
+    }
+
+    bool overflowed() const
+    {
+        return size() > capacity_;
+    }
+
+private:
+    ElementT *data_;
+    size_t capacity_;
+    std::atomic<size_t> cursor_;
+};
+
+}
+}
+
+#endif
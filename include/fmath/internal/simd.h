@@ -0,0 +1,1065 @@
+#ifndef _FMATH_INTERNAL_SIMD_H_
+#define _FMATH_INTERNAL_SIMD_H_
+
+#include <array>
+#include <cmath>
+
+#include "../common.h"
+#include "../compile_config.h"
+
+#if defined(FMATH_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+
+#if defined(FMATH_SIMD_SSE41)
+#   include <smmintrin.h>
+#endif
+
+#if defined(FMATH_SIMD_AVX)
+#   include <immintrin.h>
+#endif
+
+namespace fmath
+{
+namespace internal
+{
+namespace simd
+{
+
+// Portable fallback, the fixed-size loops are unrolled and vectorized by the compiler
+template<typename T, size_t W>
+struct SimdMask
+{
+    std::array<bool, W> values;
+};
+
+template<typename T, size_t W>
+struct Simd
+{
+    using ValueType = T;
+    using MaskType = SimdMask<T, W>;
+    static constexpr size_t WIDTH = W;
+
+    alignas(sizeof(T) * W) std::array<T, W> values;
+
+    static FMATH_INLINE Simd broadcast(const T &value)
+    {
+        Simd result;
+        result.values.fill(value);
+        return result;
+    }
+
+    static FMATH_INLINE Simd load(const T *data)
+    {
+        Simd result;
+        for (index_t i = 0; i < W; ++i)
+            result.values[i] = data[i];
+        return result;
+    }
+
+    static FMATH_INLINE Simd loadStrided(const T *data, size_t stride)
+    {
+        Simd result;
+        for (index_t i = 0; i < W; ++i)
+            result.values[i] = data[i * stride];
+        return result;
+    }
+
+    template<typename IndexT>
+    static FMATH_INLINE Simd gather(const T *base, const IndexT *indices, size_t stride = 1)
+    {
+        Simd result;
+        for (index_t i = 0; i < W; ++i)
+            result.values[i] = base[static_cast<size_t>(indices[i]) * stride];
+        return result;
+    }
+
+    FMATH_INLINE void store(T *data) const
+    {
+        for (index_t i = 0; i < W; ++i)
+            data[i] = values[i];
+    }
+
+    FMATH_INLINE void storeStrided(T *data, size_t stride) const
+    {
+        for (index_t i = 0; i < W; ++i)
+            data[i * stride] = values[i];
+    }
+
+    FMATH_INLINE T get(index_t lane) const
+    {
+        return values[lane];
+    }
+};
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> operator+(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] + b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> operator-(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] - b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> operator*(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] * b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> operator/(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] / b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> operator-(const Simd<T, W> &a)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = -a.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> fmadd(const Simd<T, W> &a, const Simd<T, W> &b, const Simd<T, W> &c)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] * b.values[i] + c.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> fnmadd(const Simd<T, W> &a, const Simd<T, W> &b, const Simd<T, W> &c)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = c.values[i] - a.values[i] * b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> min(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] < b.values[i] ? a.values[i] : b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> max(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] > b.values[i] ? a.values[i] : b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> abs(const Simd<T, W> &a)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = std::abs(a.values[i]);
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> sqrt(const Simd<T, W> &a)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = std::sqrt(a.values[i]);
+    return result;
+}
+
+// Rounds to the nearest integer, halfway cases to even
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> round(const Simd<T, W> &a)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = std::nearbyint(a.values[i]);
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator<(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    SimdMask<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] < b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator<=(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    SimdMask<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] <= b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator>(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    return b < a;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator>=(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    return b <= a;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator==(const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    SimdMask<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] == b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator&(const SimdMask<T, W> &a, const SimdMask<T, W> &b)
+{
+    SimdMask<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] && b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator|(const SimdMask<T, W> &a, const SimdMask<T, W> &b)
+{
+    SimdMask<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = a.values[i] || b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE SimdMask<T, W> operator~(const SimdMask<T, W> &a)
+{
+    SimdMask<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = !a.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Simd<T, W> select(const SimdMask<T, W> &mask, const Simd<T, W> &a, const Simd<T, W> &b)
+{
+    Simd<T, W> result;
+    for (index_t i = 0; i < W; ++i)
+        result.values[i] = mask.values[i] ? a.values[i] : b.values[i];
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE uint32 bitmask(const SimdMask<T, W> &mask)
+{
+    static_assert(W <= 32);
+    uint32 result = 0;
+    for (index_t i = 0; i < W; ++i)
+        result |= static_cast<uint32>(mask.values[i]) << i;
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE T hmin(const Simd<T, W> &a)
+{
+    T result = a.values[0];
+    for (index_t i = 1; i < W; ++i)
+        result = a.values[i] < result ? a.values[i] : result;
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE T hmax(const Simd<T, W> &a)
+{
+    T result = a.values[0];
+    for (index_t i = 1; i < W; ++i)
+        result = a.values[i] > result ? a.values[i] : result;
+    return result;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE T hsum(const Simd<T, W> &a)
+{
+    T result = a.values[0];
+    for (index_t i = 1; i < W; ++i)
+        result += a.values[i];
+    return result;
+}
+
+#if defined(FMATH_SIMD_SSE2)
+#pragma region Simd<float, 4>
+template<>
+struct SimdMask<float, 4>
+{
+    __m128 value;
+};
+
+template<>
+struct Simd<float, 4>
+{
+    using ValueType = float;
+    using MaskType = SimdMask<float, 4>;
+    static constexpr size_t WIDTH = 4;
+
+    __m128 value;
+
+    static FMATH_INLINE Simd broadcast(const float &v)
+    {
+        return Simd { _mm_set1_ps(v) };
+    }
+
+    static FMATH_INLINE Simd load(const float *data)
+    {
+        return Simd { _mm_loadu_ps(data) };
+    }
+
+    static FMATH_INLINE Simd loadStrided(const float *data, size_t stride)
+    {
+        return Simd { _mm_setr_ps(data[0], data[stride], data[2 * stride], data[3 * stride]) };
+    }
+
+    template<typename IndexT>
+    static FMATH_INLINE Simd gather(const float *base, const IndexT *indices, size_t stride = 1)
+    {
+        return Simd { _mm_setr_ps(
+            base[static_cast<size_t>(indices[0]) * stride], base[static_cast<size_t>(indices[1]) * stride],
+            base[static_cast<size_t>(indices[2]) * stride], base[static_cast<size_t>(indices[3]) * stride]) };
+    }
+
+    FMATH_INLINE void store(float *data) const
+    {
+        _mm_storeu_ps(data, value);
+    }
+
+    FMATH_INLINE void storeStrided(float *data, size_t stride) const
+    {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, value);
+        for (index_t i = 0; i < 4; ++i)
+            data[i * stride] = lanes[i];
+    }
+
+    FMATH_INLINE float get(index_t lane) const
+    {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, value);
+        return lanes[lane];
+    }
+};
+
+using Simd4f = Simd<float, 4>;
+using SimdMask4f = SimdMask<float, 4>;
+
+FMATH_INLINE Simd4f operator+(const Simd4f &a, const Simd4f &b)
+{
+    return Simd4f { _mm_add_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4f operator-(const Simd4f &a, const Simd4f &b)
+{
+    return Simd4f { _mm_sub_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4f operator*(const Simd4f &a, const Simd4f &b)
+{
+    return Simd4f { _mm_mul_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4f operator/(const Simd4f &a, const Simd4f &b)
+{
+    return Simd4f { _mm_div_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4f operator-(const Simd4f &a)
+{
+    return Simd4f { _mm_xor_ps(a.value, _mm_set1_ps(-0.0F)) };
+}
+
+FMATH_INLINE Simd4f min(const Simd4f &a, const Simd4f &b)
+{
+    return Simd4f { _mm_min_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4f max(const Simd4f &a, const Simd4f &b)
+{
+    return Simd4f { _mm_max_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4f abs(const Simd4f &a)
+{
+    return Simd4f { _mm_andnot_ps(_mm_set1_ps(-0.0F), a.value) };
+}
+
+FMATH_INLINE Simd4f sqrt(const Simd4f &a)
+{
+    return Simd4f { _mm_sqrt_ps(a.value) };
+}
+
+FMATH_INLINE Simd4f round(const Simd4f &a)
+{
+#if defined(FMATH_SIMD_SSE41)
+    return Simd4f { _mm_round_ps(a.value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+#else
+    // Adding 1.5 * 2^23 pushes the fraction out of the mantissa, exact for |a| < 2^22
+    const __m128 magic = _mm_set1_ps(12582912.0F);
+    return Simd4f { _mm_sub_ps(_mm_add_ps(a.value, magic), magic) };
+#endif
+}
+
+FMATH_INLINE Simd4f fmadd(const Simd4f &a, const Simd4f &b, const Simd4f &c)
+{
+#if defined(FMATH_SIMD_FMA)
+    return Simd4f { _mm_fmadd_ps(a.value, b.value, c.value) };
+#else
+    return Simd4f { _mm_add_ps(_mm_mul_ps(a.value, b.value), c.value) };
+#endif
+}
+
+FMATH_INLINE Simd4f fnmadd(const Simd4f &a, const Simd4f &b, const Simd4f &c)
+{
+#if defined(FMATH_SIMD_FMA)
+    return Simd4f { _mm_fnmadd_ps(a.value, b.value, c.value) };
+#else
+    return Simd4f { _mm_sub_ps(c.value, _mm_mul_ps(a.value, b.value)) };
+#endif
+}
+
+FMATH_INLINE SimdMask4f operator<(const Simd4f &a, const Simd4f &b)
+{
+    return SimdMask4f { _mm_cmplt_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator<=(const Simd4f &a, const Simd4f &b)
+{
+    return SimdMask4f { _mm_cmple_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator>(const Simd4f &a, const Simd4f &b)
+{
+    return SimdMask4f { _mm_cmpgt_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator>=(const Simd4f &a, const Simd4f &b)
+{
+    return SimdMask4f { _mm_cmpge_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator==(const Simd4f &a, const Simd4f &b)
+{
+    return SimdMask4f { _mm_cmpeq_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator&(const SimdMask4f &a, const SimdMask4f &b)
+{
+    return SimdMask4f { _mm_and_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator|(const SimdMask4f &a, const SimdMask4f &b)
+{
+    return SimdMask4f { _mm_or_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4f operator~(const SimdMask4f &a)
+{
+    return SimdMask4f { _mm_xor_ps(a.value, _mm_castsi128_ps(_mm_set1_epi32(-1))) };
+}
+
+FMATH_INLINE Simd4f select(const SimdMask4f &mask, const Simd4f &a, const Simd4f &b)
+{
+#if defined(FMATH_SIMD_SSE41)
+    return Simd4f { _mm_blendv_ps(b.value, a.value, mask.value) };
+#else
+    return Simd4f { _mm_or_ps(_mm_and_ps(mask.value, a.value), _mm_andnot_ps(mask.value, b.value)) };
+#endif
+}
+
+FMATH_INLINE uint32 bitmask(const SimdMask4f &mask)
+{
+    return static_cast<uint32>(_mm_movemask_ps(mask.value));
+}
+
+FMATH_INLINE float hmin(const Simd4f &a)
+{
+    __m128 v = _mm_min_ps(a.value, _mm_shuffle_ps(a.value, a.value, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+FMATH_INLINE float hmax(const Simd4f &a)
+{
+    __m128 v = _mm_max_ps(a.value, _mm_shuffle_ps(a.value, a.value, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+FMATH_INLINE float hsum(const Simd4f &a)
+{
+    __m128 v = _mm_add_ps(a.value, _mm_shuffle_ps(a.value, a.value, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+#pragma endregion
+#endif
+
+#if defined(FMATH_SIMD_AVX)
+#pragma region Simd<float, 8>
+template<>
+struct SimdMask<float, 8>
+{
+    __m256 value;
+};
+
+template<>
+struct Simd<float, 8>
+{
+    using ValueType = float;
+    using MaskType = SimdMask<float, 8>;
+    static constexpr size_t WIDTH = 8;
+
+    __m256 value;
+
+    static FMATH_INLINE Simd broadcast(const float &v)
+    {
+        return Simd { _mm256_set1_ps(v) };
+    }
+
+    static FMATH_INLINE Simd load(const float *data)
+    {
+        return Simd { _mm256_loadu_ps(data) };
+    }
+
+    static FMATH_INLINE Simd loadStrided(const float *data, size_t stride)
+    {
+        return Simd { _mm256_setr_ps(data[0], data[stride], data[2 * stride], data[3 * stride],
+            data[4 * stride], data[5 * stride], data[6 * stride], data[7 * stride]) };
+    }
+
+    template<typename IndexT>
+    static FMATH_INLINE Simd gather(const float *base, const IndexT *indices, size_t stride = 1)
+    {
+        return Simd { _mm256_setr_ps(
+            base[static_cast<size_t>(indices[0]) * stride], base[static_cast<size_t>(indices[1]) * stride],
+            base[static_cast<size_t>(indices[2]) * stride], base[static_cast<size_t>(indices[3]) * stride],
+            base[static_cast<size_t>(indices[4]) * stride], base[static_cast<size_t>(indices[5]) * stride],
+            base[static_cast<size_t>(indices[6]) * stride], base[static_cast<size_t>(indices[7]) * stride]) };
+    }
+
+    FMATH_INLINE void store(float *data) const
+    {
+        _mm256_storeu_ps(data, value);
+    }
+
+    FMATH_INLINE void storeStrided(float *data, size_t stride) const
+    {
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, value);
+        for (index_t i = 0; i < 8; ++i)
+            data[i * stride] = lanes[i];
+    }
+
+    FMATH_INLINE float get(index_t lane) const
+    {
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, value);
+        return lanes[lane];
+    }
+};
+
+using Simd8f = Simd<float, 8>;
+using SimdMask8f = SimdMask<float, 8>;
+
+FMATH_INLINE Simd8f operator+(const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_add_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd8f operator-(const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_sub_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd8f operator*(const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_mul_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd8f operator/(const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_div_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd8f operator-(const Simd8f &a)
+{
+    return Simd8f { _mm256_xor_ps(a.value, _mm256_set1_ps(-0.0F)) };
+}
+
+FMATH_INLINE Simd8f min(const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_min_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd8f max(const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_max_ps(a.value, b.value) };
+}
+
+FMATH_INLINE Simd8f abs(const Simd8f &a)
+{
+    return Simd8f { _mm256_andnot_ps(_mm256_set1_ps(-0.0F), a.value) };
+}
+
+FMATH_INLINE Simd8f sqrt(const Simd8f &a)
+{
+    return Simd8f { _mm256_sqrt_ps(a.value) };
+}
+
+FMATH_INLINE Simd8f round(const Simd8f &a)
+{
+    return Simd8f { _mm256_round_ps(a.value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+}
+
+FMATH_INLINE Simd8f fmadd(const Simd8f &a, const Simd8f &b, const Simd8f &c)
+{
+#if defined(FMATH_SIMD_FMA)
+    return Simd8f { _mm256_fmadd_ps(a.value, b.value, c.value) };
+#else
+    return Simd8f { _mm256_add_ps(_mm256_mul_ps(a.value, b.value), c.value) };
+#endif
+}
+
+FMATH_INLINE Simd8f fnmadd(const Simd8f &a, const Simd8f &b, const Simd8f &c)
+{
+#if defined(FMATH_SIMD_FMA)
+    return Simd8f { _mm256_fnmadd_ps(a.value, b.value, c.value) };
+#else
+    return Simd8f { _mm256_sub_ps(c.value, _mm256_mul_ps(a.value, b.value)) };
+#endif
+}
+
+FMATH_INLINE SimdMask8f operator<(const Simd8f &a, const Simd8f &b)
+{
+    return SimdMask8f { _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ) };
+}
+
+FMATH_INLINE SimdMask8f operator<=(const Simd8f &a, const Simd8f &b)
+{
+    return SimdMask8f { _mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ) };
+}
+
+FMATH_INLINE SimdMask8f operator>(const Simd8f &a, const Simd8f &b)
+{
+    return SimdMask8f { _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ) };
+}
+
+FMATH_INLINE SimdMask8f operator>=(const Simd8f &a, const Simd8f &b)
+{
+    return SimdMask8f { _mm256_cmp_ps(a.value, b.value, _CMP_GE_OQ) };
+}
+
+FMATH_INLINE SimdMask8f operator==(const Simd8f &a, const Simd8f &b)
+{
+    return SimdMask8f { _mm256_cmp_ps(a.value, b.value, _CMP_EQ_OQ) };
+}
+
+FMATH_INLINE SimdMask8f operator&(const SimdMask8f &a, const SimdMask8f &b)
+{
+    return SimdMask8f { _mm256_and_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask8f operator|(const SimdMask8f &a, const SimdMask8f &b)
+{
+    return SimdMask8f { _mm256_or_ps(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask8f operator~(const SimdMask8f &a)
+{
+    return SimdMask8f { _mm256_xor_ps(a.value, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) };
+}
+
+FMATH_INLINE Simd8f select(const SimdMask8f &mask, const Simd8f &a, const Simd8f &b)
+{
+    return Simd8f { _mm256_blendv_ps(b.value, a.value, mask.value) };
+}
+
+FMATH_INLINE uint32 bitmask(const SimdMask8f &mask)
+{
+    return static_cast<uint32>(_mm256_movemask_ps(mask.value));
+}
+
+FMATH_INLINE float hmin(const Simd8f &a)
+{
+    __m128 v = _mm_min_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1));
+    return hmin(Simd4f { v });
+}
+
+FMATH_INLINE float hmax(const Simd8f &a)
+{
+    __m128 v = _mm_max_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1));
+    return hmax(Simd4f { v });
+}
+
+FMATH_INLINE float hsum(const Simd8f &a)
+{
+    __m128 v = _mm_add_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1));
+    return hsum(Simd4f { v });
+}
+#pragma endregion
+
+#pragma region Simd<double, 4>
+template<>
+struct SimdMask<double, 4>
+{
+    __m256d value;
+};
+
+template<>
+struct Simd<double, 4>
+{
+    using ValueType = double;
+    using MaskType = SimdMask<double, 4>;
+    static constexpr size_t WIDTH = 4;
+
+    __m256d value;
+
+    static FMATH_INLINE Simd broadcast(const double &v)
+    {
+        return Simd { _mm256_set1_pd(v) };
+    }
+
+    static FMATH_INLINE Simd load(const double *data)
+    {
+        return Simd { _mm256_loadu_pd(data) };
+    }
+
+    static FMATH_INLINE Simd loadStrided(const double *data, size_t stride)
+    {
+        return Simd { _mm256_setr_pd(data[0], data[stride], data[2 * stride], data[3 * stride]) };
+    }
+
+    template<typename IndexT>
+    static FMATH_INLINE Simd gather(const double *base, const IndexT *indices, size_t stride = 1)
+    {
+        return Simd { _mm256_setr_pd(
+            base[static_cast<size_t>(indices[0]) * stride], base[static_cast<size_t>(indices[1]) * stride],
+            base[static_cast<size_t>(indices[2]) * stride], base[static_cast<size_t>(indices[3]) * stride]) };
+    }
+
+    FMATH_INLINE void store(double *data) const
+    {
+        _mm256_storeu_pd(data, value);
+    }
+
+    FMATH_INLINE void storeStrided(double *data, size_t stride) const
+    {
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, value);
+        for (index_t i = 0; i < 4; ++i)
+            data[i * stride] = lanes[i];
+    }
+
+    FMATH_INLINE double get(index_t lane) const
+    {
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, value);
+        return lanes[lane];
+    }
+};
+
+using Simd4d = Simd<double, 4>;
+using SimdMask4d = SimdMask<double, 4>;
+
+FMATH_INLINE Simd4d operator+(const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_add_pd(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4d operator-(const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_sub_pd(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4d operator*(const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_mul_pd(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4d operator/(const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_div_pd(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4d operator-(const Simd4d &a)
+{
+    return Simd4d { _mm256_xor_pd(a.value, _mm256_set1_pd(-0.0)) };
+}
+
+FMATH_INLINE Simd4d min(const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_min_pd(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4d max(const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_max_pd(a.value, b.value) };
+}
+
+FMATH_INLINE Simd4d abs(const Simd4d &a)
+{
+    return Simd4d { _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.value) };
+}
+
+FMATH_INLINE Simd4d sqrt(const Simd4d &a)
+{
+    return Simd4d { _mm256_sqrt_pd(a.value) };
+}
+
+FMATH_INLINE Simd4d round(const Simd4d &a)
+{
+    return Simd4d { _mm256_round_pd(a.value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+}
+
+FMATH_INLINE Simd4d fmadd(const Simd4d &a, const Simd4d &b, const Simd4d &c)
+{
+#if defined(FMATH_SIMD_FMA)
+    return Simd4d { _mm256_fmadd_pd(a.value, b.value, c.value) };
+#else
+    return Simd4d { _mm256_add_pd(_mm256_mul_pd(a.value, b.value), c.value) };
+#endif
+}
+
+FMATH_INLINE Simd4d fnmadd(const Simd4d &a, const Simd4d &b, const Simd4d &c)
+{
+#if defined(FMATH_SIMD_FMA)
+    return Simd4d { _mm256_fnmadd_pd(a.value, b.value, c.value) };
+#else
+    return Simd4d { _mm256_sub_pd(c.value, _mm256_mul_pd(a.value, b.value)) };
+#endif
+}
+
+FMATH_INLINE SimdMask4d operator<(const Simd4d &a, const Simd4d &b)
+{
+    return SimdMask4d { _mm256_cmp_pd(a.value, b.value, _CMP_LT_OQ) };
+}
+
+FMATH_INLINE SimdMask4d operator<=(const Simd4d &a, const Simd4d &b)
+{
+    return SimdMask4d { _mm256_cmp_pd(a.value, b.value, _CMP_LE_OQ) };
+}
+
+FMATH_INLINE SimdMask4d operator>(const Simd4d &a, const Simd4d &b)
+{
+    return SimdMask4d { _mm256_cmp_pd(a.value, b.value, _CMP_GT_OQ) };
+}
+
+FMATH_INLINE SimdMask4d operator>=(const Simd4d &a, const Simd4d &b)
+{
+    return SimdMask4d { _mm256_cmp_pd(a.value, b.value, _CMP_GE_OQ) };
+}
+
+FMATH_INLINE SimdMask4d operator==(const Simd4d &a, const Simd4d &b)
+{
+    return SimdMask4d { _mm256_cmp_pd(a.value, b.value, _CMP_EQ_OQ) };
+}
+
+FMATH_INLINE SimdMask4d operator&(const SimdMask4d &a, const SimdMask4d &b)
+{
+    return SimdMask4d { _mm256_and_pd(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4d operator|(const SimdMask4d &a, const SimdMask4d &b)
+{
+    return SimdMask4d { _mm256_or_pd(a.value, b.value) };
+}
+
+FMATH_INLINE SimdMask4d operator~(const SimdMask4d &a)
+{
+    return SimdMask4d { _mm256_xor_pd(a.value, _mm256_castsi256_pd(_mm256_set1_epi32(-1))) };
+}
+
+FMATH_INLINE Simd4d select(const SimdMask4d &mask, const Simd4d &a, const Simd4d &b)
+{
+    return Simd4d { _mm256_blendv_pd(b.value, a.value, mask.value) };
+}
+
+FMATH_INLINE uint32 bitmask(const SimdMask4d &mask)
+{
+    return static_cast<uint32>(_mm256_movemask_pd(mask.value));
+}
+
+FMATH_INLINE double hmin(const Simd4d &a)
+{
+    const __m128d v = _mm_min_pd(_mm256_castpd256_pd128(a.value), _mm256_extractf128_pd(a.value, 1));
+    return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+FMATH_INLINE double hmax(const Simd4d &a)
+{
+    const __m128d v = _mm_max_pd(_mm256_castpd256_pd128(a.value), _mm256_extractf128_pd(a.value, 1));
+    return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+FMATH_INLINE double hsum(const Simd4d &a)
+{
+    const __m128d v = _mm_add_pd(_mm256_castpd256_pd128(a.value), _mm256_extractf128_pd(a.value, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+#pragma endregion
+#endif
+
+template<typename T, size_t W>
+FMATH_INLINE bool any(const SimdMask<T, W> &mask)
+{
+    return bitmask(mask) != 0;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE bool all(const SimdMask<T, W> &mask)
+{
+    return bitmask(mask) == (W == 32 ? ~0U : (1U << W) - 1U);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE bool none(const SimdMask<T, W> &mask)
+{
+    return bitmask(mask) == 0;
+}
+
+template<typename T>
+struct SimdNativeWidth
+{
+#if defined(FMATH_SIMD_AVX)
+    static constexpr size_t value = 32 / sizeof(T);
+#else
+    static constexpr size_t value = 16 / sizeof(T);
+#endif
+};
+
+template<typename T>
+using NativeSimd = Simd<T, SimdNativeWidth<T>::value>;
+
+// Cephes single precision polynomials, accurate to a few ulp of float for every T. Arguments are reduced by
+// multiples of pi / 2 in three steps, which stays exact for |x| up to about 8192.
+template<typename SimdT>
+FMATH_INLINE void sincos(const SimdT &x, SimdT &sin_x, SimdT &cos_x)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT quadrant = round(x * SimdT::broadcast(static_cast<T>(0.636619772367581343)));
+    SimdT r = fnmadd(quadrant, SimdT::broadcast(static_cast<T>(1.5703125)), x);
+    r = fnmadd(quadrant, SimdT::broadcast(static_cast<T>(4.837512969970703125e-4)), r);
+    r = fnmadd(quadrant, SimdT::broadcast(static_cast<T>(7.54978995489188216e-8)), r);
+
+    const SimdT z = r * r;
+    SimdT s = fmadd(z, SimdT::broadcast(static_cast<T>(-1.9515295891e-4)),
+        SimdT::broadcast(static_cast<T>(8.3321608736e-3)));
+    s = fmadd(s, z, SimdT::broadcast(static_cast<T>(-1.6666654611e-1)));
+    s = fmadd(s * z, r, r);
+    SimdT c = fmadd(z, SimdT::broadcast(static_cast<T>(2.443315711809948e-5)),
+        SimdT::broadcast(static_cast<T>(-1.388731625493765e-3)));
+    c = fmadd(c, z, SimdT::broadcast(static_cast<T>(4.166664568298827e-2)));
+    c = fmadd(c * z, z, fnmadd(SimdT::broadcast(static_cast<T>(0.5)), z, SimdT::broadcast(static_cast<T>(1))));
+
+    // quadrant mod 4, floor(q / 4) is round((q - 1.5) / 4) for integral q
+    const SimdT quarter = SimdT::broadcast(static_cast<T>(0.25));
+    const SimdT m = fnmadd(SimdT::broadcast(static_cast<T>(4)),
+        round((quadrant - SimdT::broadcast(static_cast<T>(1.5))) * quarter), quadrant);
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdT two = SimdT::broadcast(static_cast<T>(2));
+    const typename SimdT::MaskType odd = (m == one) | (m == SimdT::broadcast(static_cast<T>(3)));
+    const SimdT sin_r = select(odd, c, s);
+    const SimdT cos_r = select(odd, s, c);
+    sin_x = select(m >= two, -sin_r, sin_r);
+    cos_x = select((m == one) | (m == two), -cos_r, cos_r);
+}
+
+// Cephes single precision arctangent after folding into [0, tan(pi / 8)], result in [-pi, pi]
+template<typename SimdT>
+FMATH_INLINE SimdT atan2(const SimdT &y, const SimdT &x)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdT ay = abs(y);
+    const SimdT ax = abs(x);
+    const typename SimdT::MaskType swap = ay > ax;
+    const SimdT num = select(swap, ax, ay);
+    const SimdT den = select(swap, ay, ax);
+    SimdT a = select(den > zero, num / den, zero);
+
+    const typename SimdT::MaskType fold = a > SimdT::broadcast(static_cast<T>(0.4142135623730950));
+    a = select(fold, (a - one) / (a + one), a);
+    const SimdT z = a * a;
+    SimdT p = fmadd(z, SimdT::broadcast(static_cast<T>(8.05374449538e-2)),
+        SimdT::broadcast(static_cast<T>(-1.38776856032e-1)));
+    p = fmadd(p, z, SimdT::broadcast(static_cast<T>(1.99777106478e-1)));
+    p = fmadd(p, z, SimdT::broadcast(static_cast<T>(-3.33329491539e-1)));
+    SimdT angle = fmadd(p * z, a, a);
+    angle = select(fold, angle + SimdT::broadcast(static_cast<T>(0.785398163397448310)), angle);
+
+    angle = select(swap, SimdT::broadcast(static_cast<T>(1.57079632679489662)) - angle, angle);
+    angle = select(x < zero, SimdT::broadcast(static_cast<T>(3.14159265358979324)) - angle, angle);
+    return select(y < zero, -angle, angle);
+}
+
+template<typename SimdT>
+struct SimdVector3
+{
+    SimdT x, y, z;
+};
+
+template<typename SimdT>
+FMATH_INLINE SimdVector3<SimdT> cross(const SimdVector3<SimdT> &a, const SimdVector3<SimdT> &b)
+{
+    return SimdVector3<SimdT> {
+        fnmadd(a.z, b.y, a.y * b.z),
+        fnmadd(a.x, b.z, a.z * b.x),
+        fnmadd(a.y, b.x, a.x * b.y)
+    };
+}
+
+// v + 2 * w * (u x v) + 2 * u x (u x v), for a unit quaternion (w, u)
+template<typename SimdT>
+FMATH_INLINE SimdVector3<SimdT> rotate(const SimdT &w, const SimdVector3<SimdT> &u, const SimdVector3<SimdT> &v)
+{
+    const SimdT two = SimdT::broadcast(2);
+    SimdVector3<SimdT> t = cross(u, v);
+    t = SimdVector3<SimdT> { t.x * two, t.y * two, t.z * two };
+    SimdVector3<SimdT> ut = cross(u, t);
+    return SimdVector3<SimdT> {
+        fmadd(w, t.x, v.x + ut.x),
+        fmadd(w, t.y, v.y + ut.y),
+        fmadd(w, t.z, v.z + ut.z)
+    };
+}
+
+}
+}
+}
+
+#endif
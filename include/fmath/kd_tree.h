@@ -0,0 +1,414 @@
+#ifndef _FMATH_KD_TREE_H_
+#define _FMATH_KD_TREE_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "morton.h"
+#include "point.h"
+#include "sphere.h"
+
+namespace fmath
+{
+
+template<typename T>
+struct KdTreeNeighbor
+{
+    uint32 index = ~0U;
+    T distance2 = constants::Inf<T>::value;
+};
+
+// k-d tree over points stored as a complete binary tree in breadth-first order, the children of node i are 2i + 1
+// and 2i + 2, so neither child links nor leaves are stored. Every node holds a point, the median of its subtree along
+// the widest axis of the subtree cell, and that axis. Built with nth_element, subtrees in parallel. All queries are
+// const and report indices of the input array.
+template<typename T, size_t N>
+class KdTree
+{
+public:
+    using ValueType = T;
+    using PointType = Point<T, N>;
+    using NeighborType = KdTreeNeighbor<T>;
+    static constexpr size_t DIMENSION = N;
+
+    // A complete tree over less than 2^32 points has at most 32 levels, and the stack holds one entry per level
+    static constexpr size_t STACK_SIZE = 32;
+
+public:
+    KdTree() = default;
+
+    explicit KdTree(const PointType *points, size_t count);
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE size_t size() const;
+
+    // Points in tree order
+    FMATH_INLINE const PointType *points() const;
+
+    // Input index of every point in tree order
+    FMATH_INLINE const uint32 *pointIndices() const;
+
+    // Closest point no further than sqrt(max_distance2), false if there is none
+    bool nearest(const PointType &point, NeighborType &neighbor,
+        ValueType max_distance2 = constants::Inf<ValueType>::value) const;
+
+    // Up to k closest points sorted by distance, returns how many were found
+    size_t nearest(const PointType &point, size_t k, NeighborType *neighbors,
+        ValueType max_distance2 = constants::Inf<ValueType>::value) const;
+
+    // k closest points of every query point, in parallel. neighbors holds k entries per query, the ones not found keep
+    // the default index and distance of KdTreeNeighbor.
+    void nearest(const PointType *points, size_t count, size_t k, NeighborType *neighbors,
+        ValueType max_distance2 = constants::Inf<ValueType>::value) const;
+
+    // Calls func(index) for every point inside the sphere
+    template<typename FunctionT>
+    void query(const Sphere<ValueType, N> &sphere, FunctionT &&func) const;
+
+    // Appends the indices found to indices
+    void query(const Sphere<ValueType, N> &sphere, std::vector<uint32> &indices) const;
+
+private:
+    // Calls visit(node, distance2) for every node that may lie within sqrt(radius2), visit may shrink radius2
+    template<typename VisitT>
+    void search(const PointType &point, ValueType &radius2, VisitT &&visit) const;
+
+private:
+    std::vector<PointType> points_;
+    std::vector<uint32> indices_;
+    std::vector<uint8> axes_;
+};
+
+template<typename T>
+using KdTree2 = KdTree<T, 2>;
+
+template<typename T>
+using KdTree3 = KdTree<T, 3>;
+
+using KdTree2f = KdTree2<float>;
+using KdTree2lf = KdTree2<double>;
+using KdTree3f = KdTree3<float>;
+using KdTree3lf = KdTree3<double>;
+
+namespace internal
+{
+
+constexpr size_t KD_TREE_GRAIN_SIZE = 16384;
+constexpr size_t KD_TREE_QUERY_GRAIN_SIZE = 256;
+
+// Nodes in the left subtree of a complete binary tree with count nodes
+FMATH_INLINE uint32 leftSubtreeSize(uint32 count)
+{
+    if (count <= 1)
+        return 0;
+
+    uint32 last_level = 1;
+    while (last_level <= count / 2)
+        last_level *= 2;
+    const uint32 half = last_level / 2;
+    return half - 1 + min(count - (last_level - 1), half);
+}
+
+template<typename T, size_t N>
+class KdTreeBuilder
+{
+public:
+    struct Item
+    {
+        Point<T, N> point;
+        uint32 index;
+    };
+
+    struct Task
+    {
+        uint32 node;
+        uint32 begin;
+        uint32 end;
+        Box<T, N> cell;
+    };
+
+public:
+    KdTreeBuilder(const Point<T, N> *points, size_t count)
+        :   items_(count)
+    {
+        parallelFor(0, count, KD_TREE_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                items_[i] = Item { points[i], static_cast<uint32>(i) };
+        });
+    }
+
+    void run(const Box<T, N> &bounds, std::vector<Point<T, N>> &points, std::vector<uint32> &indices,
+        std::vector<uint8> &axes)
+    {
+        const size_t count = items_.size();
+        points.resize(count);
+        indices.resize(count);
+        axes.resize(count);
+        points_ = points.data();
+        indices_ = indices.data();
+        axes_ = axes.data();
+        if (count == 0)
+            return;
+
+        // Levels are split together, one task per worker, until there are enough subtrees to give every worker its
+        // own. Only the first few splits run alone.
+        const size_t worker_count = workerCount();
+        const size_t subtree_size = worker_count > 1 ? max(count / (worker_count * 8), static_cast<size_t>(4096))
+            : count + 1;
+        std::vector<Task> level { Task { 0, 0, static_cast<uint32>(count), bounds } };
+        std::vector<Task> subtrees;
+        while (!level.empty())
+        {
+            std::vector<Task> large;
+            for (const Task &task : level)
+                (task.end - task.begin < subtree_size ? subtrees : large).push_back(task);
+
+            std::vector<Task> children(large.size() * 2);
+            parallelFor(0, large.size(), 1, [&](size_t first, size_t last)
+            {
+                for (index_t i = first; i < last; ++i)
+                    split(large[i], &children[i * 2]);
+            });
+            level.clear();
+            for (const Task &child : children)
+            {
+                if (child.begin != child.end)
+                    level.push_back(child);
+            }
+        }
+
+        std::sort(subtrees.begin(), subtrees.end(), [](const Task &t1, const Task &t2)
+        {
+            return t1.end - t1.begin > t2.end - t2.begin;
+        });
+        parallelFor(0, subtrees.size(), 1, [&](size_t first, size_t last)
+        {
+            std::vector<Task> stack;
+            for (index_t i = first; i < last; ++i)
+            {
+                stack.push_back(subtrees[i]);
+                while (!stack.empty())
+                {
+                    const Task task = stack.back();
+                    stack.pop_back();
+                    Task children[2];
+                    split(task, children);
+                    for (const Task &child : children)
+                    {
+                        if (child.begin != child.end)
+                            stack.push_back(child);
+                    }
+                }
+            }
+        });
+    }
+
+private:
+    // Writes the node of the task and its two child tasks, an empty range marks a missing child
+    void split(const Task &task, Task *children)
+    {
+        index_t axis = 0;
+        for (index_t k = 1; k < N; ++k)
+        {
+            if (task.cell.max()[k] - task.cell.min()[k] > task.cell.max()[axis] - task.cell.min()[axis])
+                axis = k;
+        }
+
+        const uint32 mid = task.begin + leftSubtreeSize(task.end - task.begin);
+        std::nth_element(items_.begin() + task.begin, items_.begin() + mid, items_.begin() + task.end,
+            [axis](const Item &i1, const Item &i2) { return i1.point[axis] < i2.point[axis]; });
+        points_[task.node] = items_[mid].point;
+        indices_[task.node] = items_[mid].index;
+        axes_[task.node] = static_cast<uint8>(axis);
+
+        const T split_value = items_[mid].point[axis];
+        children[0] = Task { task.node * 2 + 1, task.begin, mid, task.cell };
+        children[0].cell.max()[axis] = split_value;
+        children[1] = Task { task.node * 2 + 2, mid + 1, task.end, task.cell };
+        children[1].cell.min()[axis] = split_value;
+    }
+
+private:
+    std::vector<Item> items_;
+    Point<T, N> *points_ = nullptr;
+    uint32 *indices_ = nullptr;
+    uint8 *axes_ = nullptr;
+};
+
+}
+
+template<typename T, size_t N>
+KdTree<T, N>::KdTree(const PointType *points, size_t count)
+{
+    FMATH_ASSERT(count < static_cast<size_t>(~0U));
+
+    internal::KdTreeBuilder<T, N> builder(points, count);
+    builder.run(internal::computePointBounds(points, count), points_, indices_, axes_);
+}
+
+template<typename T, size_t N>
+FMATH_INLINE bool KdTree<T, N>::empty() const
+{
+    return points_.empty();
+}
+
+template<typename T, size_t N>
+FMATH_INLINE size_t KdTree<T, N>::size() const
+{
+    return points_.size();
+}
+
+template<typename T, size_t N>
+FMATH_INLINE const Point<T, N> *KdTree<T, N>::points() const
+{
+    return points_.data();
+}
+
+template<typename T, size_t N>
+FMATH_INLINE const uint32 *KdTree<T, N>::pointIndices() const
+{
+    return indices_.data();
+}
+
+template<typename T, size_t N>
+bool KdTree<T, N>::nearest(const PointType &point, NeighborType &neighbor, ValueType max_distance2) const
+{
+    NeighborType best;
+    ValueType radius2 = max_distance2;
+    search(point, radius2, [&](uint32 node, ValueType distance2)
+    {
+        if (distance2 <= radius2 && distance2 < best.distance2)
+        {
+            best = NeighborType { indices_[node], distance2 };
+            radius2 = distance2;
+        }
+    });
+
+    if (best.index == NeighborType().index)
+        return false;
+    neighbor = best;
+    return true;
+}
+
+// neighbors is a max-heap by distance while searching, so that the furthest of the k candidates is replaced first
+template<typename T, size_t N>
+size_t KdTree<T, N>::nearest(const PointType &point, size_t k, NeighborType *neighbors, ValueType max_distance2) const
+{
+    const auto closer = [](const NeighborType &n1, const NeighborType &n2)
+    {
+        return n1.distance2 < n2.distance2;
+    };
+
+    size_t found = 0;
+    ValueType radius2 = max_distance2;
+    if (k == 0)
+        return 0;
+
+    search(point, radius2, [&](uint32 node, ValueType distance2)
+    {
+        if (distance2 > radius2)
+            return;
+
+        if (found < k)
+        {
+            neighbors[found++] = NeighborType { indices_[node], distance2 };
+            std::push_heap(neighbors, neighbors + found, closer);
+            if (found == k)
+                radius2 = neighbors[0].distance2;
+        }
+        else if (distance2 < neighbors[0].distance2)
+        {
+            std::pop_heap(neighbors, neighbors + k, closer);
+            neighbors[k - 1] = NeighborType { indices_[node], distance2 };
+            std::push_heap(neighbors, neighbors + k, closer);
+            radius2 = neighbors[0].distance2;
+        }
+    });
+    std::sort_heap(neighbors, neighbors + found, closer);
+    return found;
+}
+
+template<typename T, size_t N>
+void KdTree<T, N>::nearest(const PointType *points, size_t count, size_t k, NeighborType *neighbors,
+    ValueType max_distance2) const
+{
+    internal::parallelFor(0, count, internal::KD_TREE_QUERY_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            NeighborType *row = neighbors + i * k;
+            const size_t found = nearest(points[i], k, row, max_distance2);
+            std::fill(row + found, row + k, NeighborType());
+        }
+    });
+}
+
+template<typename T, size_t N>
+    template<typename FunctionT>
+void KdTree<T, N>::query(const Sphere<ValueType, N> &sphere, FunctionT &&func) const
+{
+    ValueType radius2 = sphere.radius() * sphere.radius();
+    search(sphere.center(), radius2, [&](uint32 node, ValueType distance2)
+    {
+        if (distance2 <= radius2)
+            func(indices_[node]);
+    });
+}
+
+template<typename T, size_t N>
+void KdTree<T, N>::query(const Sphere<ValueType, N> &sphere, std::vector<uint32> &indices) const
+{
+    query(sphere, [&indices](uint32 index) { indices.push_back(index); });
+}
+
+// Descends to the side of the query point first and defers the other child with the distance to the splitting
+// plane, which is skipped once it exceeds the shrinking radius
+template<typename T, size_t N>
+    template<typename VisitT>
+void KdTree<T, N>::search(const PointType &point, ValueType &radius2, VisitT &&visit) const
+{
+    struct Entry
+    {
+        uint32 node;
+        ValueType distance2;
+    };
+
+    const size_t count = size();
+    Entry stack[STACK_SIZE];
+    size_t top = 0;
+    index_t node = 0;
+    while (true)
+    {
+        while (node < count)
+        {
+            const PointType &p = points_[node];
+            visit(static_cast<uint32>(node), distance2(p, point));
+
+            const index_t axis = axes_[node];
+            const ValueType d = point[axis] - p[axis];
+            const index_t side = d >= static_cast<ValueType>(0) ? 1 : 0;
+            const index_t far = node * 2 + 2 - side;
+            if (far < count && d * d <= radius2)
+                stack[top++] = Entry { static_cast<uint32>(far), d * d };
+            node = node * 2 + 1 + side;
+        }
+
+        do
+        {
+            if (top == 0)
+                return;
+            --top;
+        } while (stack[top].distance2 > radius2);
+        node = stack[top].node;
+    }
+}
+
+}
+
+#endif
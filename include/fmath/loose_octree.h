@@ -0,0 +1,552 @@
+#ifndef _FMATH_LOOSE_OCTREE_H_
+#define _FMATH_LOOSE_OCTREE_H_
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "box.h"
+#include "common.h"
+#include "frustum.h"
+#include "point.h"
+#include "ray.h"
+#include "sphere.h"
+
+namespace fmath
+{
+
+// Cell of a LooseOctree. The bounds are the cell grown by half its size on every side, so they hold every object
+// whose center lies in the cell and whose extent is at most the cell size. Objects of the node form a linked list
+// starting at first_object.
+template<typename T>
+struct LooseOctreeNode
+{
+    static constexpr uint32 NONE = ~0U;
+
+    Box3<T> bounds;
+    uint32 children[8];
+    uint32 parent;
+    uint32 first_object;
+    uint32 object_count;
+    uint32 child_count;
+    uint32 depth;
+    Point3u cell;
+
+    FMATH_INLINE bool empty() const;
+};
+
+// Loose octree over boxes that move, appear and disappear. An object goes to the deepest cell at least as large as
+// its extent that contains its center, found directly from its bounds, so insert, remove and update cost at most
+// max_depth steps and an update within the same cell only stores the new bounds. Nodes come from a pool and go back
+// to it once they hold neither objects nor children. Objects outside of the world stay in the root, which queries
+// always visit. Queries are const and receive the ids returned by insert.
+template<typename T>
+class LooseOctree
+{
+public:
+    using ValueType = T;
+    using NodeType = LooseOctreeNode<T>;
+
+    static constexpr uint32 MAX_DEPTH = 20;
+    // Every node pushes at most 8 children and pops itself
+    static constexpr size_t STACK_SIZE = 7 * MAX_DEPTH + 1;
+
+public:
+    // The world is grown to the smallest cube around it
+    explicit LooseOctree(const Box3<ValueType> &world, uint32 max_depth = 8);
+
+    // Returns the id of the new object, ids of removed objects are reused
+    uint32 insert(const Box3<ValueType> &box);
+
+    void remove(uint32 id);
+
+    void update(uint32 id, const Box3<ValueType> &box);
+
+    void clear();
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE size_t size() const;
+
+    FMATH_INLINE size_t nodeCount() const;
+
+    FMATH_INLINE const Box3<ValueType> &bounds(uint32 id) const;
+
+    FMATH_INLINE Box3<ValueType> worldBounds() const;
+
+    // Call func(id) for every object whose bounds overlap the query
+    template<typename FunctionT>
+    void query(const Box3<ValueType> &box, FunctionT &&func) const;
+
+    template<typename FunctionT>
+    void query(const Sphere3<ValueType> &sphere, FunctionT &&func) const;
+
+    // Objects whose bounds are not outside of the frustum, cells inside of it are reported without further tests
+    template<typename FunctionT>
+    void query(const Frustum<ValueType> &frustum, FunctionT &&func) const;
+
+    // Objects whose bounds the ray hits within [t_min, t_max]
+    template<typename FunctionT>
+    void query(const RayPrecomputed<ValueType> &ray, FunctionT &&func) const;
+
+    // Closest hit with the contract of Bvh::intersect, intersector(id, ray, t) is only called for objects whose
+    // bounds the ray hits and cells are visited front to back
+    template<typename IntersectorT>
+    bool intersect(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector, ValueType &t) const;
+
+private:
+    void findCell(const Box3<ValueType> &box, uint32 &depth, Point3u &cell) const;
+
+    FMATH_INLINE Box3<ValueType> cellBounds(uint32 depth, const Point3u &cell) const;
+
+    uint32 findOrCreateNode(uint32 depth, const Point3u &cell);
+
+    uint32 allocateNode(uint32 parent, uint32 depth, const Point3u &cell);
+
+    void link(uint32 id, uint32 node);
+
+    void unlink(uint32 id);
+
+    void releaseEmptyNodes(uint32 node);
+
+    template<typename OverlapT, typename FunctionT>
+    void visit(OverlapT &&overlaps, FunctionT &&func) const;
+
+    template<typename FunctionT>
+    void visitAll(uint32 node, FunctionT &&func) const;
+
+private:
+    Point3<ValueType> world_min_;
+    std::array<ValueType, MAX_DEPTH + 1> cell_sizes_;
+    uint32 max_depth_;
+    size_t size_ = 0;
+    // Node 0 is the root and never released
+    std::vector<NodeType> nodes_;
+    std::vector<uint32> free_nodes_;
+    // Per object id, a node of NONE marks a free id
+    std::vector<Box3<ValueType>> boxes_;
+    std::vector<uint32> object_nodes_;
+    std::vector<uint32> next_;
+    std::vector<uint32> previous_;
+    std::vector<uint32> free_ids_;
+};
+
+using LooseOctreef = LooseOctree<float>;
+using LooseOctreelf = LooseOctree<double>;
+
+template<typename T>
+FMATH_INLINE bool LooseOctreeNode<T>::empty() const
+{
+    return object_count == 0 && child_count == 0;
+}
+
+template<typename T>
+LooseOctree<T>::LooseOctree(const Box3<ValueType> &world, uint32 max_depth)
+    :   max_depth_(max_depth)
+{
+    FMATH_ASSERT(max_depth <= MAX_DEPTH);
+
+    const Vector3<ValueType> diagonal = world.max() - world.min();
+    ValueType size = max(diagonal[0], max(diagonal[1], diagonal[2]));
+    size = size > static_cast<ValueType>(0) ? size : static_cast<ValueType>(1);
+    const ValueType half = static_cast<ValueType>(0.5);
+    world_min_ = world.min() + diagonal * half - size * half;
+    for (index_t d = 0; d <= MAX_DEPTH; ++d)
+    {
+        cell_sizes_[d] = size;
+        size *= half;
+    }
+    clear();
+}
+
+template<typename T>
+uint32 LooseOctree<T>::insert(const Box3<ValueType> &box)
+{
+    uint32 id;
+    if (!free_ids_.empty())
+    {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+        boxes_[id] = box;
+    }
+    else
+    {
+        id = static_cast<uint32>(boxes_.size());
+        boxes_.push_back(box);
+        object_nodes_.push_back(NodeType::NONE);
+        next_.push_back(NodeType::NONE);
+        previous_.push_back(NodeType::NONE);
+    }
+
+    uint32 depth;
+    Point3u cell;
+    findCell(box, depth, cell);
+    link(id, findOrCreateNode(depth, cell));
+    ++size_;
+    return id;
+}
+
+template<typename T>
+void LooseOctree<T>::remove(uint32 id)
+{
+    FMATH_ASSERT(id < object_nodes_.size() && object_nodes_[id] != NodeType::NONE);
+
+    const uint32 node = object_nodes_[id];
+    unlink(id);
+    object_nodes_[id] = NodeType::NONE;
+    free_ids_.push_back(id);
+    --size_;
+    releaseEmptyNodes(node);
+}
+
+template<typename T>
+void LooseOctree<T>::update(uint32 id, const Box3<ValueType> &box)
+{
+    FMATH_ASSERT(id < object_nodes_.size() && object_nodes_[id] != NodeType::NONE);
+
+    boxes_[id] = box;
+    uint32 depth;
+    Point3u cell;
+    findCell(box, depth, cell);
+    const uint32 node = object_nodes_[id];
+    if (nodes_[node].depth == depth && nodes_[node].cell == cell)
+        return;
+
+    unlink(id);
+    link(id, findOrCreateNode(depth, cell));
+    releaseEmptyNodes(node);
+}
+
+template<typename T>
+void LooseOctree<T>::clear()
+{
+    nodes_.clear();
+    free_nodes_.clear();
+    boxes_.clear();
+    object_nodes_.clear();
+    next_.clear();
+    previous_.clear();
+    free_ids_.clear();
+    size_ = 0;
+    allocateNode(NodeType::NONE, 0, Point3u(0U, 0U, 0U));
+}
+
+template<typename T>
+FMATH_INLINE bool LooseOctree<T>::empty() const
+{
+    return size_ == 0;
+}
+
+template<typename T>
+FMATH_INLINE size_t LooseOctree<T>::size() const
+{
+    return size_;
+}
+
+template<typename T>
+FMATH_INLINE size_t LooseOctree<T>::nodeCount() const
+{
+    return nodes_.size() - free_nodes_.size();
+}
+
+template<typename T>
+FMATH_INLINE const Box3<T> &LooseOctree<T>::bounds(uint32 id) const
+{
+    return boxes_[id];
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> LooseOctree<T>::worldBounds() const
+{
+    return Box3<ValueType>(world_min_, world_min_ + cell_sizes_[0]);
+}
+
+template<typename T>
+    template<typename FunctionT>
+void LooseOctree<T>::query(const Box3<ValueType> &box, FunctionT &&func) const
+{
+    visit([&box](const Box3<ValueType> &bounds) { return bounds.overlaps(box); }, func);
+}
+
+template<typename T>
+    template<typename FunctionT>
+void LooseOctree<T>::query(const Sphere3<ValueType> &sphere, FunctionT &&func) const
+{
+    visit([&sphere](const Box3<ValueType> &bounds) { return sphere.overlaps(bounds); }, func);
+}
+
+template<typename T>
+    template<typename FunctionT>
+void LooseOctree<T>::query(const Frustum<ValueType> &frustum, FunctionT &&func) const
+{
+    // Objects of the root may lie outside of its bounds, so the root is never reported as a whole
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        const NodeType &node = nodes_[stack[--top]];
+        for (uint32 id = node.first_object; id != NodeType::NONE; id = next_[id])
+        {
+            if (frustum.classify(boxes_[id]) != Visibility::Outside)
+                func(id);
+        }
+        for (index_t i = 0; i < 8; ++i)
+        {
+            const uint32 child = node.children[i];
+            if (child == NodeType::NONE)
+                continue;
+
+            const Visibility visibility = frustum.classify(nodes_[child].bounds);
+            if (visibility == Visibility::Inside)
+                visitAll(child, func);
+            else if (visibility == Visibility::Intersecting)
+                stack[top++] = child;
+        }
+    }
+}
+
+template<typename T>
+    template<typename FunctionT>
+void LooseOctree<T>::query(const RayPrecomputed<ValueType> &ray, FunctionT &&func) const
+{
+    visit([&ray](const Box3<ValueType> &bounds)
+    {
+        ValueType t_near, t_far;
+        return fmath::intersect(ray, bounds, t_near, t_far);
+    }, func);
+}
+
+template<typename T>
+    template<typename IntersectorT>
+bool LooseOctree<T>::intersect(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector, ValueType &t) const
+{
+    struct Entry
+    {
+        uint32 node;
+        ValueType t_near;
+    };
+
+    RayPrecomputed<ValueType> current = ray;
+    bool hit = false;
+    Entry stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = Entry { 0U, ray.t_min };
+    while (top != 0)
+    {
+        const Entry entry = stack[--top];
+        // Entries pushed before t_max shrank may lie behind the closest hit by now
+        if (entry.t_near > current.t_max)
+            continue;
+
+        const NodeType &node = nodes_[entry.node];
+        ValueType t_near, t_far;
+        for (uint32 id = node.first_object; id != NodeType::NONE; id = next_[id])
+        {
+            ValueType t_hit;
+            if (fmath::intersect(current, boxes_[id], t_near, t_far) &&
+                intersector(id, static_cast<const RayPrecomputed<ValueType> &>(current), t_hit))
+            {
+                current.t_max = t_hit;
+                hit = true;
+            }
+        }
+
+        // Children hit are pushed far to near so that the nearest one is popped first
+        Entry hits[8];
+        size_t hit_count = 0;
+        for (index_t i = 0; i < 8; ++i)
+        {
+            const uint32 child = node.children[i];
+            if (child == NodeType::NONE || !fmath::intersect(current, nodes_[child].bounds, t_near, t_far))
+                continue;
+
+            size_t j = hit_count++;
+            for (; j > 0 && hits[j - 1].t_near < t_near; --j)
+                hits[j] = hits[j - 1];
+            hits[j] = Entry { child, t_near };
+        }
+        for (index_t i = 0; i < hit_count; ++i)
+            stack[top++] = hits[i];
+    }
+
+    if (hit)
+        t = current.t_max;
+    return hit;
+}
+
+// Starts with the deepest cell as large as the extent of the box, which holds it whenever its center lies in the
+// world. Centers outside are clamped to the border cells, and the depth is lowered until the loose bounds hold the
+// box or the root is reached.
+template<typename T>
+void LooseOctree<T>::findCell(const Box3<ValueType> &box, uint32 &depth, Point3u &cell) const
+{
+    const Vector3<ValueType> diagonal = box.max() - box.min();
+    const ValueType extent = max(diagonal[0], max(diagonal[1], diagonal[2]));
+    depth = 0;
+    while (depth < max_depth_ && cell_sizes_[depth + 1] >= extent)
+        ++depth;
+
+    const Point3<ValueType> center = box.min() + diagonal * static_cast<ValueType>(0.5);
+    while (true)
+    {
+        const ValueType first = static_cast<ValueType>(0);
+        const ValueType last = static_cast<ValueType>((1U << depth) - 1);
+        for (index_t k = 0; k < 3; ++k)
+        {
+            // NaN ends up in the first cell
+            const ValueType c = std::floor((center[k] - world_min_[k]) / cell_sizes_[depth]);
+            cell[k] = static_cast<uint32>(c > first ? (c < last ? c : last) : first);
+        }
+        if (depth == 0 || cellBounds(depth, cell).contains(box))
+            return;
+        --depth;
+    }
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> LooseOctree<T>::cellBounds(uint32 depth, const Point3u &cell) const
+{
+    const ValueType size = cell_sizes_[depth];
+    const Point3<ValueType> lower(world_min_[0] + static_cast<ValueType>(cell[0]) * size,
+        world_min_[1] + static_cast<ValueType>(cell[1]) * size, world_min_[2] + static_cast<ValueType>(cell[2]) * size);
+    return Box3<ValueType>(lower - size * static_cast<ValueType>(0.5), lower + size * static_cast<ValueType>(1.5));
+}
+
+template<typename T>
+uint32 LooseOctree<T>::findOrCreateNode(uint32 depth, const Point3u &cell)
+{
+    uint32 node = 0;
+    for (uint32 level = 1; level <= depth; ++level)
+    {
+        const uint32 shift = depth - level;
+        const Point3u child_cell(cell[0] >> shift, cell[1] >> shift, cell[2] >> shift);
+        const index_t slot = (child_cell[0] & 1U) | ((child_cell[1] & 1U) << 1) | ((child_cell[2] & 1U) << 2);
+        uint32 child = nodes_[node].children[slot];
+        if (child == NodeType::NONE)
+        {
+            // Allocation may move the pool, so the parent is indexed again afterwards
+            child = allocateNode(node, level, child_cell);
+            nodes_[node].children[slot] = child;
+            ++nodes_[node].child_count;
+        }
+        node = child;
+    }
+    return node;
+}
+
+template<typename T>
+uint32 LooseOctree<T>::allocateNode(uint32 parent, uint32 depth, const Point3u &cell)
+{
+    NodeType node;
+    node.bounds = depth == 0 ? worldBounds() : cellBounds(depth, cell);
+    for (uint32 &child : node.children)
+        child = NodeType::NONE;
+    node.parent = parent;
+    node.first_object = NodeType::NONE;
+    node.object_count = 0;
+    node.child_count = 0;
+    node.depth = depth;
+    node.cell = cell;
+
+    if (free_nodes_.empty())
+    {
+        nodes_.push_back(node);
+        return static_cast<uint32>(nodes_.size() - 1);
+    }
+    const uint32 index = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[index] = node;
+    return index;
+}
+
+template<typename T>
+void LooseOctree<T>::link(uint32 id, uint32 node)
+{
+    NodeType &target = nodes_[node];
+    object_nodes_[id] = node;
+    previous_[id] = NodeType::NONE;
+    next_[id] = target.first_object;
+    if (target.first_object != NodeType::NONE)
+        previous_[target.first_object] = id;
+    target.first_object = id;
+    ++target.object_count;
+}
+
+template<typename T>
+void LooseOctree<T>::unlink(uint32 id)
+{
+    NodeType &source = nodes_[object_nodes_[id]];
+    if (previous_[id] != NodeType::NONE)
+        next_[previous_[id]] = next_[id];
+    else
+        source.first_object = next_[id];
+    if (next_[id] != NodeType::NONE)
+        previous_[next_[id]] = previous_[id];
+    --source.object_count;
+}
+
+template<typename T>
+void LooseOctree<T>::releaseEmptyNodes(uint32 node)
+{
+    while (node != 0 && nodes_[node].empty())
+    {
+        const NodeType &released = nodes_[node];
+        const index_t slot = (released.cell[0] & 1U) | ((released.cell[1] & 1U) << 1) |
+            ((released.cell[2] & 1U) << 2);
+        const uint32 parent = released.parent;
+        nodes_[parent].children[slot] = NodeType::NONE;
+        --nodes_[parent].child_count;
+        free_nodes_.push_back(node);
+        node = parent;
+    }
+}
+
+template<typename T>
+    template<typename OverlapT, typename FunctionT>
+void LooseOctree<T>::visit(OverlapT &&overlaps, FunctionT &&func) const
+{
+    // The root is always visited, its objects may lie outside of its bounds
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        const NodeType &node = nodes_[stack[--top]];
+        for (uint32 id = node.first_object; id != NodeType::NONE; id = next_[id])
+        {
+            if (overlaps(boxes_[id]))
+                func(id);
+        }
+        for (index_t i = 0; i < 8; ++i)
+        {
+            const uint32 child = node.children[i];
+            if (child != NodeType::NONE && overlaps(nodes_[child].bounds))
+                stack[top++] = child;
+        }
+    }
+}
+
+template<typename T>
+    template<typename FunctionT>
+void LooseOctree<T>::visitAll(uint32 node, FunctionT &&func) const
+{
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = node;
+    while (top != 0)
+    {
+        const NodeType &current = nodes_[stack[--top]];
+        for (uint32 id = current.first_object; id != NodeType::NONE; id = next_[id])
+            func(id);
+        for (index_t i = 0; i < 8; ++i)
+        {
+            if (current.children[i] != NodeType::NONE)
+                stack[top++] = current.children[i];
+        }
+    }
+}
+
+}
+
+#endif
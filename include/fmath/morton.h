@@ -0,0 +1,555 @@
+#ifndef _FMATH_MORTON_H_
+#define _FMATH_MORTON_H_
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "box.h"
+#include "common.h"
+#include "compile_config.h"
+#include "point.h"
+
+#if defined(FMATH_SIMD_BMI2)
+#   include <immintrin.h>
+#endif
+
+namespace fmath
+{
+
+enum class SpaceFillingCurve : uint8
+{
+    Morton,
+    Hilbert
+};
+
+// Morton codes interleave the bits of the cell coordinates, x in the lowest bit. 32-bit codes take 16 bits per axis
+// in 2D and 10 in 3D, 64-bit codes take 32 and 21, higher coordinate bits are ignored.
+FMATH_INLINE uint32 encodeMorton32(uint32 x, uint32 y);
+
+FMATH_INLINE uint32 encodeMorton32(uint32 x, uint32 y, uint32 z);
+
+FMATH_INLINE uint64 encodeMorton64(uint32 x, uint32 y);
+
+FMATH_INLINE uint64 encodeMorton64(uint32 x, uint32 y, uint32 z);
+
+FMATH_INLINE void decodeMorton32(uint32 code, uint32 &x, uint32 &y);
+
+FMATH_INLINE void decodeMorton32(uint32 code, uint32 &x, uint32 &y, uint32 &z);
+
+FMATH_INLINE void decodeMorton64(uint64 code, uint32 &x, uint32 &y);
+
+FMATH_INLINE void decodeMorton64(uint64 code, uint32 &x, uint32 &y, uint32 &z);
+
+// Hilbert indices with the bit budgets of the Morton codes. Cells next to each other along the curve are always
+// neighbors in space, unlike the jumps of the Morton order.
+FMATH_INLINE uint32 encodeHilbert32(uint32 x, uint32 y);
+
+FMATH_INLINE uint32 encodeHilbert32(uint32 x, uint32 y, uint32 z);
+
+FMATH_INLINE uint64 encodeHilbert64(uint32 x, uint32 y);
+
+FMATH_INLINE uint64 encodeHilbert64(uint32 x, uint32 y, uint32 z);
+
+FMATH_INLINE void decodeHilbert32(uint32 code, uint32 &x, uint32 &y);
+
+FMATH_INLINE void decodeHilbert32(uint32 code, uint32 &x, uint32 &y, uint32 &z);
+
+FMATH_INLINE void decodeHilbert64(uint64 code, uint32 &x, uint32 &y);
+
+FMATH_INLINE void decodeHilbert64(uint64 code, uint32 &x, uint32 &y, uint32 &z);
+
+// Cell of point in a grid of 2^bits cells per axis spanning bounds, points outside land in the border cells
+template<typename T, size_t N>
+FMATH_INLINE Point<uint32, N> quantizeToGrid(const Point<T, N> &point, const Box<T, N> &bounds, uint32 bits);
+
+// Codes of a 2D or 3D point quantized to the full resolution of the code inside bounds
+template<typename T, size_t N>
+FMATH_INLINE uint32 encodeMorton32(const Point<T, N> &point, const Box<T, N> &bounds);
+
+template<typename T, size_t N>
+FMATH_INLINE uint64 encodeMorton64(const Point<T, N> &point, const Box<T, N> &bounds);
+
+template<typename T, size_t N>
+FMATH_INLINE uint32 encodeHilbert32(const Point<T, N> &point, const Box<T, N> &bounds);
+
+template<typename T, size_t N>
+FMATH_INLINE uint64 encodeHilbert64(const Point<T, N> &point, const Box<T, N> &bounds);
+
+// Order of the points along curve over their bounds, order[i] is the input index of the i-th point. The grid only
+// gets a few cells per point and axis, so the radix sort runs as few passes as the point count allows. Points
+// sharing a cell keep their input order.
+template<typename T, size_t N>
+std::vector<uint32> spatialOrder(const Point<T, N> *points, size_t count,
+    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+
+// Moves data[order[i]] to data[i], order must be a permutation of [0, count)
+template<typename ElementT>
+void permute(ElementT *data, const uint32 *order, size_t count);
+
+// Sorts the points along curve and every attribute array with them, returns the order applied
+template<typename T, size_t N, typename... AttributeTs>
+std::vector<uint32> spatialSort(Point<T, N> *points, size_t count, SpaceFillingCurve curve,
+    AttributeTs *...attributes);
+
+template<typename T, size_t N, typename... AttributeTs>
+std::vector<uint32> spatialSort(Point<T, N> *points, size_t count, AttributeTs *...attributes);
+
+namespace internal
+{
+
+constexpr size_t SPATIAL_SORT_GRAIN_SIZE = 16384;
+
+// Spreads the low 32 bits of value so that a zero bit follows each of them
+FMATH_INLINE uint64 spreadBits2(uint64 value)
+{
+    value &= 0xFFFFFFFFULL;
+    value = (value | (value << 16)) & 0x0000FFFF0000FFFFULL;
+    value = (value | (value << 8)) & 0x00FF00FF00FF00FFULL;
+    value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    value = (value | (value << 2)) & 0x3333333333333333ULL;
+    value = (value | (value << 1)) & 0x5555555555555555ULL;
+    return value;
+}
+
+// Spreads the low 21 bits of value so that two zero bits follow each of them
+FMATH_INLINE uint64 spreadBits3(uint64 value)
+{
+    value &= 0x1FFFFFULL;
+    value = (value | (value << 32)) & 0x1F00000000FFFFULL;
+    value = (value | (value << 16)) & 0x1F0000FF0000FFULL;
+    value = (value | (value << 8)) & 0x100F00F00F00F00FULL;
+    value = (value | (value << 4)) & 0x10C30C30C30C30C3ULL;
+    value = (value | (value << 2)) & 0x1249249249249249ULL;
+    return value;
+}
+
+// Inverse of spreadBits2, gathers every second bit starting at bit 0
+FMATH_INLINE uint64 compactBits2(uint64 value)
+{
+    value &= 0x5555555555555555ULL;
+    value = (value | (value >> 1)) & 0x3333333333333333ULL;
+    value = (value | (value >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    value = (value | (value >> 4)) & 0x00FF00FF00FF00FFULL;
+    value = (value | (value >> 8)) & 0x0000FFFF0000FFFFULL;
+    value = (value | (value >> 16)) & 0xFFFFFFFFULL;
+    return value;
+}
+
+// Inverse of spreadBits3, gathers every third bit starting at bit 0
+FMATH_INLINE uint64 compactBits3(uint64 value)
+{
+    value &= 0x1249249249249249ULL;
+    value = (value | (value >> 2)) & 0x10C30C30C30C30C3ULL;
+    value = (value | (value >> 4)) & 0x100F00F00F00F00FULL;
+    value = (value | (value >> 8)) & 0x1F0000FF0000FFULL;
+    value = (value | (value >> 16)) & 0x1F00000000FFFFULL;
+    value = (value | (value >> 32)) & 0x1FFFFFULL;
+    return value;
+}
+
+// One step of Skilling's transforms: if the bit of axis is set invert the lower bits of first, otherwise exchange
+// them with axis. Branchless, the bits are random for scattered points.
+FMATH_INLINE void hilbertStep(uint32 &first, uint32 &axis, uint32 bit)
+{
+    const uint32 low = (1U << bit) - 1;
+    const uint32 invert = 0U - ((axis >> bit) & 1U);
+    const uint32 t = (first ^ axis) & low & ~invert;
+    first ^= t | (low & invert);
+    axis ^= t;
+}
+
+// Axes unrolled in increasing order, or decreasing when Reverse is set
+template<bool Reverse, size_t N, size_t... I>
+FMATH_INLINE void hilbertSteps(uint32 (&x)[N], uint32 bit, std::index_sequence<I...>)
+{
+    (hilbertStep(x[0], x[Reverse ? N - 1 - I : I], bit), ...);
+}
+
+// Skilling, "Programming the Hilbert curve", 2004. Turns the low bits bits of N coordinates in place into the Hilbert
+// index in transposed form: the index read from its highest bit down is bit bits - 1 of x[0], x[1], ..., x[N - 1],
+// then bit bits - 2 of x[0] and so on.
+template<size_t N>
+FMATH_INLINE void axesToTranspose(uint32 (&x)[N], uint32 bits)
+{
+    for (uint32 bit = bits - 1; bit > 0; --bit)
+        hilbertSteps<false>(x, bit, std::make_index_sequence<N>());
+
+    for (index_t i = 1; i < N; ++i)
+        x[i] ^= x[i - 1];
+    uint32 t = 0;
+    for (uint32 bit = bits - 1; bit > 0; --bit)
+        t ^= ((1U << bit) - 1) & (0U - ((x[N - 1] >> bit) & 1U));
+    for (index_t i = 0; i < N; ++i)
+        x[i] ^= t;
+}
+
+template<size_t N>
+FMATH_INLINE void transposeToAxes(uint32 (&x)[N], uint32 bits)
+{
+    const uint32 t = x[N - 1] >> 1;
+    for (index_t i = N - 1; i > 0; --i)
+        x[i] ^= x[i - 1];
+    x[0] ^= t;
+
+    for (uint32 bit = 1; bit < bits; ++bit)
+        hilbertSteps<true>(x, bit, std::make_index_sequence<N>());
+}
+
+// Maps points to grid cells with the scales computed once
+template<typename T, size_t N>
+struct GridQuantizer
+{
+    T lower[N];
+    T scale[N];
+    T max_cell;
+
+    static FMATH_INLINE GridQuantizer make(const Box<T, N> &bounds, uint32 bits)
+    {
+        GridQuantizer result;
+        const T cells = static_cast<T>(1ULL << bits);
+        for (index_t k = 0; k < N; ++k)
+        {
+            const T extent = bounds.max()[k] - bounds.min()[k];
+            result.lower[k] = bounds.min()[k];
+            result.scale[k] = extent > static_cast<T>(0) ? cells / extent : static_cast<T>(0);
+        }
+        // Largest value below the cell count, cells - 1 is not representable in float for 32 bits
+        result.max_cell = std::nextafter(cells, static_cast<T>(0));
+        return result;
+    }
+
+    FMATH_INLINE uint32 cell(const Point<T, N> &point, index_t axis) const
+    {
+        const T value = (point[axis] - lower[axis]) * scale[axis];
+        // NaN coordinates go to cell 0 with the points below the bounds
+        if (!(value > static_cast<T>(0)))
+            return 0;
+        return static_cast<uint32>(value < max_cell ? value : max_cell);
+    }
+};
+
+// Code of a point on a grid of 2^bits cells per axis, at most 32 bits per axis in 2D and 21 in 3D
+template<typename T, size_t N>
+FMATH_INLINE uint64 encodeCurve(const GridQuantizer<T, N> &quantizer, const Point<T, N> &point, uint32 bits,
+    SpaceFillingCurve curve)
+{
+    static_assert(N == 2 || N == 3, "Space filling curves are defined for 2D and 3D points");
+
+    uint32 x[N];
+    for (index_t k = 0; k < N; ++k)
+        x[k] = quantizer.cell(point, k);
+    if (curve == SpaceFillingCurve::Morton)
+    {
+        if constexpr (N == 2)
+            return encodeMorton64(x[0], x[1]);
+        else
+            return encodeMorton64(x[0], x[1], x[2]);
+    }
+
+    axesToTranspose(x, bits);
+    if constexpr (N == 2)
+        return encodeMorton64(x[1], x[0]);
+    else
+        return encodeMorton64(x[2], x[1], x[0]);
+}
+
+template<typename T, size_t N>
+Box<T, N> computePointBounds(const Point<T, N> *points, size_t count)
+{
+    const size_t chunk_count = min(workerCount(), (count + SPATIAL_SORT_GRAIN_SIZE - 1) / SPATIAL_SORT_GRAIN_SIZE);
+    std::vector<Box<T, N>> chunk_bounds(chunk_count, Box<T, N>::makeEmpty());
+    parallelForChunks(count, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+    {
+        Point<T, N> &lower = chunk_bounds[chunk].min();
+        Point<T, N> &upper = chunk_bounds[chunk].max();
+        for (index_t i = begin; i < end; ++i)
+        {
+            for (index_t k = 0; k < N; ++k)
+            {
+                lower[k] = min(lower[k], points[i][k]);
+                upper[k] = max(upper[k], points[i][k]);
+            }
+        }
+    });
+
+    Box<T, N> bounds = Box<T, N>::makeEmpty();
+    for (const Box<T, N> &box : chunk_bounds)
+        bounds.add(box);
+    return bounds;
+}
+
+// Sorts order along the curve with keys just wide enough for bits bits per axis
+template<typename KeyT, typename T, size_t N>
+void sortAlongCurve(const Point<T, N> *points, size_t count, const GridQuantizer<T, N> &quantizer, uint32 bits,
+    SpaceFillingCurve curve, uint32 *order)
+{
+    std::vector<KeyT> codes(count);
+    parallelFor(0, count, SPATIAL_SORT_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            codes[i] = static_cast<KeyT>(encodeCurve(quantizer, points[i], bits, curve));
+            order[i] = static_cast<uint32>(i);
+        }
+    });
+    parallelRadixSort(codes.data(), order, count, bits * N);
+}
+
+}
+
+FMATH_INLINE uint32 encodeMorton32(uint32 x, uint32 y)
+{
+#if defined(FMATH_SIMD_BMI2)
+    return _pdep_u32(x, 0x55555555U) | _pdep_u32(y, 0xAAAAAAAAU);
+#else
+    return static_cast<uint32>(internal::spreadBits2(x & 0xFFFFU) | (internal::spreadBits2(y & 0xFFFFU) << 1));
+#endif
+}
+
+FMATH_INLINE uint32 encodeMorton32(uint32 x, uint32 y, uint32 z)
+{
+#if defined(FMATH_SIMD_BMI2)
+    return _pdep_u32(x, 0x09249249U) | _pdep_u32(y, 0x12492492U) | _pdep_u32(z, 0x24924924U);
+#else
+    return static_cast<uint32>(internal::spreadBits3(x & 0x3FFU) | (internal::spreadBits3(y & 0x3FFU) << 1) |
+        (internal::spreadBits3(z & 0x3FFU) << 2));
+#endif
+}
+
+FMATH_INLINE uint64 encodeMorton64(uint32 x, uint32 y)
+{
+#if defined(FMATH_SIMD_BMI2)
+    return _pdep_u64(x, 0x5555555555555555ULL) | _pdep_u64(y, 0xAAAAAAAAAAAAAAAAULL);
+#else
+    return internal::spreadBits2(x) | (internal::spreadBits2(y) << 1);
+#endif
+}
+
+FMATH_INLINE uint64 encodeMorton64(uint32 x, uint32 y, uint32 z)
+{
+#if defined(FMATH_SIMD_BMI2)
+    return _pdep_u64(x, 0x1249249249249249ULL) | _pdep_u64(y, 0x2492492492492492ULL) |
+        _pdep_u64(z, 0x4924924924924924ULL);
+#else
+    return internal::spreadBits3(x) | (internal::spreadBits3(y) << 1) | (internal::spreadBits3(z) << 2);
+#endif
+}
+
+FMATH_INLINE void decodeMorton32(uint32 code, uint32 &x, uint32 &y)
+{
+#if defined(FMATH_SIMD_BMI2)
+    x = _pext_u32(code, 0x55555555U);
+    y = _pext_u32(code, 0xAAAAAAAAU);
+#else
+    x = static_cast<uint32>(internal::compactBits2(code));
+    y = static_cast<uint32>(internal::compactBits2(code >> 1));
+#endif
+}
+
+FMATH_INLINE void decodeMorton32(uint32 code, uint32 &x, uint32 &y, uint32 &z)
+{
+#if defined(FMATH_SIMD_BMI2)
+    x = _pext_u32(code, 0x09249249U);
+    y = _pext_u32(code, 0x12492492U);
+    z = _pext_u32(code, 0x24924924U);
+#else
+    x = static_cast<uint32>(internal::compactBits3(code & 0x3FFFFFFFU));
+    y = static_cast<uint32>(internal::compactBits3((code & 0x3FFFFFFFU) >> 1));
+    z = static_cast<uint32>(internal::compactBits3((code & 0x3FFFFFFFU) >> 2));
+#endif
+}
+
+FMATH_INLINE void decodeMorton64(uint64 code, uint32 &x, uint32 &y)
+{
+#if defined(FMATH_SIMD_BMI2)
+    x = static_cast<uint32>(_pext_u64(code, 0x5555555555555555ULL));
+    y = static_cast<uint32>(_pext_u64(code, 0xAAAAAAAAAAAAAAAAULL));
+#else
+    x = static_cast<uint32>(internal::compactBits2(code));
+    y = static_cast<uint32>(internal::compactBits2(code >> 1));
+#endif
+}
+
+FMATH_INLINE void decodeMorton64(uint64 code, uint32 &x, uint32 &y, uint32 &z)
+{
+#if defined(FMATH_SIMD_BMI2)
+    x = static_cast<uint32>(_pext_u64(code, 0x1249249249249249ULL));
+    y = static_cast<uint32>(_pext_u64(code, 0x2492492492492492ULL));
+    z = static_cast<uint32>(_pext_u64(code, 0x4924924924924924ULL));
+#else
+    x = static_cast<uint32>(internal::compactBits3(code));
+    y = static_cast<uint32>(internal::compactBits3(code >> 1));
+    z = static_cast<uint32>(internal::compactBits3(code >> 2));
+#endif
+}
+
+FMATH_INLINE uint32 encodeHilbert32(uint32 x, uint32 y)
+{
+    uint32 axes[2] = { x & 0xFFFFU, y & 0xFFFFU };
+    internal::axesToTranspose(axes, 16);
+    return encodeMorton32(axes[1], axes[0]);
+}
+
+FMATH_INLINE uint32 encodeHilbert32(uint32 x, uint32 y, uint32 z)
+{
+    uint32 axes[3] = { x & 0x3FFU, y & 0x3FFU, z & 0x3FFU };
+    internal::axesToTranspose(axes, 10);
+    return encodeMorton32(axes[2], axes[1], axes[0]);
+}
+
+FMATH_INLINE uint64 encodeHilbert64(uint32 x, uint32 y)
+{
+    uint32 axes[2] = { x, y };
+    internal::axesToTranspose(axes, 32);
+    return encodeMorton64(axes[1], axes[0]);
+}
+
+FMATH_INLINE uint64 encodeHilbert64(uint32 x, uint32 y, uint32 z)
+{
+    uint32 axes[3] = { x & 0x1FFFFFU, y & 0x1FFFFFU, z & 0x1FFFFFU };
+    internal::axesToTranspose(axes, 21);
+    return encodeMorton64(axes[2], axes[1], axes[0]);
+}
+
+FMATH_INLINE void decodeHilbert32(uint32 code, uint32 &x, uint32 &y)
+{
+    uint32 axes[2];
+    decodeMorton32(code, axes[1], axes[0]);
+    internal::transposeToAxes(axes, 16);
+    x = axes[0];
+    y = axes[1];
+}
+
+FMATH_INLINE void decodeHilbert32(uint32 code, uint32 &x, uint32 &y, uint32 &z)
+{
+    uint32 axes[3];
+    decodeMorton32(code, axes[2], axes[1], axes[0]);
+    internal::transposeToAxes(axes, 10);
+    x = axes[0];
+    y = axes[1];
+    z = axes[2];
+}
+
+FMATH_INLINE void decodeHilbert64(uint64 code, uint32 &x, uint32 &y)
+{
+    uint32 axes[2];
+    decodeMorton64(code, axes[1], axes[0]);
+    internal::transposeToAxes(axes, 32);
+    x = axes[0];
+    y = axes[1];
+}
+
+FMATH_INLINE void decodeHilbert64(uint64 code, uint32 &x, uint32 &y, uint32 &z)
+{
+    uint32 axes[3];
+    decodeMorton64(code, axes[2], axes[1], axes[0]);
+    internal::transposeToAxes(axes, 21);
+    x = axes[0];
+    y = axes[1];
+    z = axes[2];
+}
+
+template<typename T, size_t N>
+FMATH_INLINE Point<uint32, N> quantizeToGrid(const Point<T, N> &point, const Box<T, N> &bounds, uint32 bits)
+{
+    FMATH_ASSERT(bits <= 32);
+    const internal::GridQuantizer<T, N> quantizer = internal::GridQuantizer<T, N>::make(bounds, bits);
+    Point<uint32, N> result;
+    for (index_t k = 0; k < N; ++k)
+        result[k] = quantizer.cell(point, k);
+    return result;
+}
+
+template<typename T, size_t N>
+FMATH_INLINE uint32 encodeMorton32(const Point<T, N> &point, const Box<T, N> &bounds)
+{
+    constexpr uint32 BITS = N == 2 ? 16 : 10;
+    return static_cast<uint32>(internal::encodeCurve(internal::GridQuantizer<T, N>::make(bounds, BITS), point, BITS,
+        SpaceFillingCurve::Morton));
+}
+
+template<typename T, size_t N>
+FMATH_INLINE uint64 encodeMorton64(const Point<T, N> &point, const Box<T, N> &bounds)
+{
+    constexpr uint32 BITS = N == 2 ? 32 : 21;
+    return internal::encodeCurve(internal::GridQuantizer<T, N>::make(bounds, BITS), point, BITS,
+        SpaceFillingCurve::Morton);
+}
+
+template<typename T, size_t N>
+FMATH_INLINE uint32 encodeHilbert32(const Point<T, N> &point, const Box<T, N> &bounds)
+{
+    constexpr uint32 BITS = N == 2 ? 16 : 10;
+    return static_cast<uint32>(internal::encodeCurve(internal::GridQuantizer<T, N>::make(bounds, BITS), point, BITS,
+        SpaceFillingCurve::Hilbert));
+}
+
+template<typename T, size_t N>
+FMATH_INLINE uint64 encodeHilbert64(const Point<T, N> &point, const Box<T, N> &bounds)
+{
+    constexpr uint32 BITS = N == 2 ? 32 : 21;
+    return internal::encodeCurve(internal::GridQuantizer<T, N>::make(bounds, BITS), point, BITS,
+        SpaceFillingCurve::Hilbert);
+}
+
+template<typename T, size_t N>
+std::vector<uint32> spatialOrder(const Point<T, N> *points, size_t count, SpaceFillingCurve curve)
+{
+    static_assert(N == 2 || N == 3, "Space filling curves are defined for 2D and 3D points");
+
+    std::vector<uint32> order(count);
+    if (count == 0)
+        return order;
+
+    // About four cells per point along every axis
+    constexpr uint32 MAX_BITS = N == 2 ? 32 : 21;
+    uint32 log_count = 0;
+    while (log_count < 64 && (1ULL << log_count) < count)
+        ++log_count;
+    const uint32 bits = min(static_cast<uint32>((log_count + N - 1) / N + 2), MAX_BITS);
+
+    const auto quantizer = internal::GridQuantizer<T, N>::make(internal::computePointBounds(points, count), bits);
+    if (bits * N <= 32)
+        internal::sortAlongCurve<uint32>(points, count, quantizer, bits, curve, order.data());
+    else
+        internal::sortAlongCurve<uint64>(points, count, quantizer, bits, curve, order.data());
+    return order;
+}
+
+template<typename ElementT>
+void permute(ElementT *data, const uint32 *order, size_t count)
+{
+    std::vector<ElementT> sorted(count);
+    internal::parallelFor(0, count, internal::SPATIAL_SORT_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            sorted[i] = std::move(data[order[i]]);
+    });
+    internal::parallelFor(0, count, internal::SPATIAL_SORT_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            data[i] = std::move(sorted[i]);
+    });
+}
+
+template<typename T, size_t N, typename... AttributeTs>
+std::vector<uint32> spatialSort(Point<T, N> *points, size_t count, SpaceFillingCurve curve,
+    AttributeTs *...attributes)
+{
+    std::vector<uint32> order = spatialOrder(static_cast<const Point<T, N> *>(points), count, curve);
+    permute(points, order.data(), count);
+    (permute(attributes, order.data(), count), ...);
+    return order;
+}
+
+template<typename T, size_t N, typename... AttributeTs>
+std::vector<uint32> spatialSort(Point<T, N> *points, size_t count, AttributeTs *...attributes)
+{
+    return spatialSort(points, count, SpaceFillingCurve::Hilbert, attributes...);
+}
+
+}
+
+#endif
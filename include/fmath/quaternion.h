@@ -5,6 +5,7 @@
 #include <istream>
 #include <ostream>
 
+#include "internal/simd.h"
 #include "common.h"
 #include "matrix.h"
 #include "vector.h"
@@ -72,10 +73,18 @@ public:
 
     FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> toMatrix() const;
 
+    // Unlike toMatrix, expects a unit quaternion and does not normalize
+    FMATH_INLINE FMATH_CONSTEXPR Matrix3<T> toMatrix3() const;
+
+    // Rotation followed by translation, expects a unit quaternion
+    FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> toAffine(const Vector3<T> &translation) const;
+
     static FMATH_CONSTEXPR Quat identity();
 
     static FMATH_CONSTEXPR Quat makeRotation(const Vector3<T> &axis, const T &angle);
 
+    static FMATH_CONSTEXPR Quat makeRotation(const Matrix3<T> &rotation);
+
 public:
     union
     {
@@ -141,9 +150,9 @@ template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Quat<T> operator*(const Quat<T> &q1, const Quat<T> &q2)
 {
     return Quat<T>(q1[0] * q2[0] - q1[1] * q2[1] - q1[2] * q2[2] - q1[3] * q2[3],
-        q1[1] * q2[0] + q1[0] * q2[1] + q1[3] * q2[2] - q1[2] * q2[3],
-        q1[2] * q2[0] + q1[0] * q2[2] + q1[1] * q2[3] - q1[3] * q2[1],
-        q1[3] * q2[0] + q2[3] * q1[0] + q1[2] * q2[1] - q1[1] * q2[2]
+        q1[1] * q2[0] + q1[0] * q2[1] + q1[2] * q2[3] - q1[3] * q2[2],
+        q1[2] * q2[0] + q1[0] * q2[2] + q1[3] * q2[1] - q1[1] * q2[3],
+        q1[3] * q2[0] + q1[0] * q2[3] + q1[1] * q2[2] - q1[2] * q2[1]
     );
 }
 
@@ -217,18 +226,26 @@ FMATH_INLINE FMATH_CONSTEXPR Quat<T> opposite(const Quat<T> &q)
     return -q;
 }
 
+// (ln |q|, v / |v| * atan2(|v|, w)) for q = (w, v), the scalar part is zero for unit quaternions
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Quat<T> log(const Quat<T> &q)
 {
-    T alpha = q.angle() / static_cast<T>(2);
-    return Quat<T>(0, alpha * q.axis());
+    const T v_length2 = q.x * q.x + q.y * q.y + q.z * q.z;
+    const T v_length = sqrt(v_length2);
+    // atan2(|v|, w) / |v| tends to 1 / w as v vanishes
+    const T scale = v_length > constants::Epsilon<T>::value ? atan2(v_length, q.w) / v_length
+        : static_cast<T>(1) / q.w;
+    return Quat<T>(ln(sqrt(v_length2 + q.w * q.w)), q.x * scale, q.y * scale, q.z * scale);
 }
 
+// e^w * (cos |v|, v / |v| * sin |v|) for q = (w, v)
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Quat<T> exp(const Quat<T> &q)
 {
-    T alpha = q.angle() / static_cast<T>(2);
-    return Quat<T>(cos(alpha), sin(alpha) * q.axis());
+    const T angle = sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+    const T e = exp(q.w);
+    const T scale = angle > constants::Epsilon<T>::value ? e * sin(angle) / angle : e;
+    return Quat<T>(e * cos(angle), q.x * scale, q.y * scale, q.z * scale);
 }
 
 template<typename T>
@@ -237,8 +254,129 @@ FMATH_INLINE FMATH_CONSTEXPR Quat<T> pow(const Quat<T> &q, const T &t)
     return exp(t * log(q));
 }
 
+// Normalized linear interpolation along the shortest path, constant speed is not preserved
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Quat<T> nlerp(const Quat<T> &q1, const Quat<T> &q2, const T &t)
+{
+    const T t2 = dot(q1, q2) < static_cast<T>(0) ? -t : t;
+    return normalize(q1 * (static_cast<T>(1) - t) + q2 * t2);
+}
+
+// Spherical linear interpolation along the shortest path between unit quaternions
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Quat<T> slerp(const Quat<T> &q1, const Quat<T> &q2, const T &t)
+{
+    T cos_theta = dot(q1, q2);
+    const T sign = cos_theta < static_cast<T>(0) ? static_cast<T>(-1) : static_cast<T>(1);
+    cos_theta *= sign;
+
+    // sin(theta) vanishes for nearly equal rotations, where nlerp is accurate anyway
+    if (cos_theta > static_cast<T>(1) - constants::Epsilon<T>::value)
+        return normalize(q1 * (static_cast<T>(1) - t) + q2 * (sign * t));
+
+    const T theta = acos(cos_theta);
+    const T inv_sin_theta = static_cast<T>(1) / sin(theta);
+    const T c1 = sin((static_cast<T>(1) - t) * theta) * inv_sin_theta;
+    const T c2 = sin(t * theta) * inv_sin_theta * sign;
+    return q1 * c1 + q2 * c2;
+}
+
+namespace internal
+{
+
+// Coefficients of Eberly's polynomial approximation of slerp, see "A Fast and Accurate Algorithm for Computing SLERP",
+// Journal of Graphics, GPU, and Game Tools, 2011. The last term is scaled by 1 + mu to compensate for the truncation.
+template<typename T>
+struct SlerpCoefficients
+{
+    static constexpr T ONE_PLUS_MU = static_cast<T>(1.85298109240830);
+    static constexpr T U[8] = {
+        static_cast<T>(1.0 / (1 * 3)), static_cast<T>(1.0 / (2 * 5)), static_cast<T>(1.0 / (3 * 7)),
+        static_cast<T>(1.0 / (4 * 9)), static_cast<T>(1.0 / (5 * 11)), static_cast<T>(1.0 / (6 * 13)),
+        static_cast<T>(1.0 / (7 * 15)), ONE_PLUS_MU / static_cast<T>(8 * 17)
+    };
+    static constexpr T V[8] = {
+        static_cast<T>(1.0 / 3), static_cast<T>(2.0 / 5), static_cast<T>(3.0 / 7), static_cast<T>(4.0 / 9),
+        static_cast<T>(5.0 / 11), static_cast<T>(6.0 / 13), static_cast<T>(7.0 / 15), ONE_PLUS_MU * 8 / 17
+    };
+};
+
+// Evaluates sin(t * theta) / sin(theta) from xm1 = cos(theta) - 1
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR T slerpWeight(const T &xm1, const T &t)
+{
+    const T t2 = t * t;
+    T result = static_cast<T>(1);
+    for (index_t i = 8; i-- > 0;)
+        result = static_cast<T>(1) + (SlerpCoefficients<T>::U[i] * t2 - SlerpCoefficients<T>::V[i]) * xm1 * result;
+    return t * result;
+}
+
+template<typename SimdT>
+FMATH_INLINE SimdT slerpWeightSimd(const SimdT &xm1, const SimdT &t)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdT t2 = t * t;
+    SimdT result = one;
+    for (index_t i = 8; i-- > 0;)
+    {
+        const SimdT b = (SimdT::broadcast(SlerpCoefficients<T>::U[i]) * t2 - SimdT::broadcast(SlerpCoefficients<T>::V[i])) * xm1;
+        result = fmadd(b, result, one);
+    }
+    return t * result;
+}
+
+}
+
+// Polynomial slerp without trigonometric calls, each weight stays within 2e-5 of the exact one for unit quaternions
 template<typename T>
-FMATH_INLINE FMATH_CONSTEXPR Quat<T> slerp(const Quat<T> &q1, const Quat<T> &q2);
+FMATH_INLINE FMATH_CONSTEXPR Quat<T> slerpFast(const Quat<T> &q1, const Quat<T> &q2, const T &t)
+{
+    const T one = static_cast<T>(1);
+    T x = dot(q1, q2);
+    const T sign = x < static_cast<T>(0) ? -one : one;
+    const T xm1 = x * sign - one;
+    const T c1 = internal::slerpWeight(xm1, one - t);
+    const T c2 = internal::slerpWeight(xm1, t) * sign;
+    return q1 * c1 + q2 * c2;
+}
+
+// Intermediate squad control quaternion of the unit key q from its neighbours, q * exp(-(log(q^-1 * prev) +
+// log(q^-1 * next)) / 4). Neighbours are taken in the hemisphere of q, the tangents assume evenly spaced keys.
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Quat<T> squadControl(const Quat<T> &prev, const Quat<T> &q, const Quat<T> &next)
+{
+    const Quat<T> q_inverse = conjugate(q);
+    const Quat<T> to_prev = q_inverse * (dot(q, prev) < static_cast<T>(0) ? -prev : prev);
+    const Quat<T> to_next = q_inverse * (dot(q, next) < static_cast<T>(0) ? -next : next);
+    return q * exp((log(to_prev) + log(to_next)) * static_cast<T>(-0.25));
+}
+
+// Shoemake's spherical quadrangle interpolation from q1 to q2, s1 and s2 are their squadControl quaternions
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Quat<T> squad(const Quat<T> &q1, const Quat<T> &q2, const Quat<T> &s1, const Quat<T> &s2,
+    const T &t)
+{
+    return slerp(slerp(q1, q2, t), slerp(s1, s2, t), static_cast<T>(2) * t * (static_cast<T>(1) - t));
+}
+
+// Rotates v by the unit quaternion q as v + w * t + u x t with t = 2 * u x v, where q = (w, u)
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Vector3<T> rotate(const Quat<T> &q, const Vector3<T> &v)
+{
+    const T two = static_cast<T>(2);
+    const Vector3<T> t(
+        two * (q.y * v[2] - q.z * v[1]),
+        two * (q.z * v[0] - q.x * v[2]),
+        two * (q.x * v[1] - q.y * v[0])
+    );
+    return Vector3<T>(
+        v[0] + q.w * t[0] + (q.y * t[2] - q.z * t[1]),
+        v[1] + q.w * t[1] + (q.z * t[0] - q.x * t[2]),
+        v[2] + q.w * t[2] + (q.x * t[1] - q.y * t[0])
+    );
+}
 
 template<typename T>
 FMATH_INLINE std::ostream &operator<<(std::ostream &output, const Quat<T> &q)
@@ -351,13 +489,14 @@ FMATH_INLINE FMATH_CONSTEXPR typename Quat<T>::ValueType Quat<T>::angle() const
     return static_cast<T>(2) * acos(values[0]);
 }
 
-template<typename T>   
+// Unit rotation axis, the x axis when the rotation is the identity
+template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Vector3<T> Quat<T>::axis() const
 {
-    return Vector3<T>(static_cast<T>(2) * asin(values[1]),
-        static_cast<T>(2) * asin(values[2]),
-        static_cast<T>(2) * asin(values[3])
-    );
+    const T v_length = sqrt(values[1] * values[1] + values[2] * values[2] + values[3] * values[3]);
+    if (v_length <= constants::Epsilon<T>::value)
+        return Vector3<T>(1, 0, 0);
+    return Vector3<T>(values[1] / v_length, values[2] / v_length, values[3] / v_length);
 }
 
 template<typename T>
@@ -382,7 +521,7 @@ FMATH_INLINE Quat<T> &Quat<T>::operator+=(const Quat &other)
 template<typename T>
 FMATH_INLINE Quat<T> &Quat<T>::operator-=(const Quat &other)
 {
-    *this = (*this) + other;
+    *this = (*this) - other;
     return *this;
 }
 
@@ -397,14 +536,14 @@ template<typename T>
 FMATH_INLINE Quat<T> &Quat<T>::operator*=(const ValueType &value)
 {
     *this = (*this) * value;
-    return this;
+    return *this;
 }
 
 template<typename T>
 FMATH_INLINE Quat<T> &Quat<T>::operator/=(const ValueType &value)
 {
     *this = (*this) / value;
-    return this;
+    return *this;
 }
 
 template<typename T>
@@ -437,7 +576,7 @@ FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> Quat<T>::toMatrix() const
     r[1][1] = one - two * (xx + zz);
     r[1][2] = two * (yz + wx);
 
-    r[2][0] = two * (xz - wy);
+    r[2][0] = two * (xz + wy);
     r[2][1] = two * (yz - wx);
     r[2][2] = one - two * (xx + yy);
 
@@ -446,6 +585,37 @@ FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> Quat<T>::toMatrix() const
     return r;
 }
 
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix3<T> Quat<T>::toMatrix3() const
+{
+    const T one = static_cast<T>(1);
+    const T two = static_cast<T>(2);
+    const T tx = two * x, ty = two * y, tz = two * z;
+    const T wx = w * tx, wy = w * ty, wz = w * tz;
+    const T xx = x * tx, xy = x * ty, xz = x * tz;
+    const T yy = y * ty, yz = y * tz, zz = z * tz;
+
+    return Matrix3<T>(
+        one - yy - zz, xy + wz, xz - wy,
+        xy - wz, one - xx - zz, yz + wx,
+        xz + wy, yz - wx, one - xx - yy
+    );
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> Quat<T>::toAffine(const Vector3<T> &translation) const
+{
+    const T zero = static_cast<T>(0);
+    const Matrix3<T> r = toMatrix3();
+
+    return Matrix4<T>(
+        r[0][0], r[0][1], r[0][2], zero,
+        r[1][0], r[1][1], r[1][2], zero,
+        r[2][0], r[2][1], r[2][2], zero,
+        translation[0], translation[1], translation[2], static_cast<T>(1)
+    );
+}
+
 template<typename T>
 FMATH_CONSTEXPR Quat<T> Quat<T>::identity()
 {
@@ -458,6 +628,353 @@ FMATH_CONSTEXPR Quat<T> Quat<T>::makeRotation(const Vector3<T> &axis, const T &a
     return Quat<T>(cos(angle / static_cast<T>(2)), axis * sin(angle / static_cast<T>(2)));
 }
 
+// See https://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+template<typename T>
+FMATH_CONSTEXPR Quat<T> Quat<T>::makeRotation(const Matrix3<T> &m)
+{
+    const T one = static_cast<T>(1);
+    const T quarter = static_cast<T>(0.25);
+    const T trace = m[0][0] + m[1][1] + m[2][2];
+
+    if (trace > static_cast<T>(0))
+    {
+        T s = sqrt(trace + one) * static_cast<T>(2);
+        return Quat<T>(quarter * s, (m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s);
+    }
+    else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+    {
+        T s = sqrt(one + m[0][0] - m[1][1] - m[2][2]) * static_cast<T>(2);
+        return Quat<T>((m[1][2] - m[2][1]) / s, quarter * s, (m[1][0] + m[0][1]) / s, (m[2][0] + m[0][2]) / s);
+    }
+    else if (m[1][1] > m[2][2])
+    {
+        T s = sqrt(one + m[1][1] - m[0][0] - m[2][2]) * static_cast<T>(2);
+        return Quat<T>((m[2][0] - m[0][2]) / s, (m[1][0] + m[0][1]) / s, quarter * s, (m[2][1] + m[1][2]) / s);
+    }
+    else
+    {
+        T s = sqrt(one + m[2][2] - m[0][0] - m[1][1]) * static_cast<T>(2);
+        return Quat<T>((m[0][1] - m[1][0]) / s, (m[2][0] + m[0][2]) / s, (m[2][1] + m[1][2]) / s, quarter * s);
+    }
+}
+
+namespace internal
+{
+
+template<typename SimdT, bool FAST_SLERP>
+FMATH_INLINE void interpolateQuatBlock(const typename SimdT::ValueType *q1, const typename SimdT::ValueType *q2,
+    const typename SimdT::ValueType *t, typename SimdT::ValueType *result)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+
+    SimdT a[4], b[4];
+    for (index_t c = 0; c < 4; ++c)
+    {
+        a[c] = SimdT::loadStrided(q1 + c, 4);
+        b[c] = SimdT::loadStrided(q2 + c, 4);
+    }
+
+    const SimdT x = fmadd(a[0], b[0], fmadd(a[1], b[1], fmadd(a[2], b[2], a[3] * b[3])));
+    const SimdT tt = SimdT::load(t);
+    const typename SimdT::MaskType flip = x < zero;
+
+    SimdT c1, c2;
+    if constexpr (FAST_SLERP)
+    {
+        const SimdT xm1 = abs(x) - one;
+        c1 = slerpWeightSimd(xm1, one - tt);
+        c2 = slerpWeightSimd(xm1, tt);
+    }
+    else
+    {
+        c1 = one - tt;
+        c2 = tt;
+    }
+    c2 = select(flip, -c2, c2);
+
+    SimdT r[4];
+    for (index_t c = 0; c < 4; ++c)
+        r[c] = fmadd(a[c], c1, b[c] * c2);
+
+    if constexpr (!FAST_SLERP)
+    {
+        const SimdT inv_length = one / sqrt(fmadd(r[0], r[0], fmadd(r[1], r[1], fmadd(r[2], r[2], r[3] * r[3]))));
+        for (index_t c = 0; c < 4; ++c)
+            r[c] = r[c] * inv_length;
+    }
+
+    for (index_t c = 0; c < 4; ++c)
+        r[c].storeStrided(result + c, 4);
+}
+
+template<bool FAST_SLERP, typename T>
+FMATH_INLINE void interpolateQuats(const Quat<T> *q1, const Quat<T> *q2, const T *t, Quat<T> *result, size_t count)
+{
+    using SimdT = simd::NativeSimd<T>;
+    constexpr size_t W = SimdT::WIDTH;
+
+    index_t i = 0;
+    for (; i + W <= count; i += W)
+        interpolateQuatBlock<SimdT, FAST_SLERP>(q1[i].data(), q2[i].data(), t + i, result[i].data());
+    for (; i < count; ++i)
+        interpolateQuatBlock<simd::Simd<T, 1>, FAST_SLERP>(q1[i].data(), q2[i].data(), t + i, result[i].data());
+}
+
+}
+
+// Interpolates count pairs, each with its own parameter. result may alias q1 or q2.
+template<typename T>
+FMATH_INLINE void nlerp(const Quat<T> *q1, const Quat<T> *q2, const T *t, Quat<T> *result, size_t count)
+{
+    internal::interpolateQuats<false>(q1, q2, t, result, count);
+}
+
+template<typename T>
+FMATH_INLINE void slerpFast(const Quat<T> *q1, const Quat<T> *q2, const T *t, Quat<T> *result, size_t count)
+{
+    internal::interpolateQuats<true>(q1, q2, t, result, count);
+}
+
+namespace internal
+{
+
+template<typename SimdT>
+struct SimdQuat
+{
+    SimdT w, x, y, z;
+};
+
+template<typename SimdT>
+FMATH_INLINE SimdQuat<SimdT> loadQuats(const typename SimdT::ValueType *q)
+{
+    return SimdQuat<SimdT> { SimdT::loadStrided(q, 4), SimdT::loadStrided(q + 1, 4), SimdT::loadStrided(q + 2, 4),
+        SimdT::loadStrided(q + 3, 4) };
+}
+
+template<typename SimdT>
+FMATH_INLINE void storeQuats(const SimdQuat<SimdT> &q, typename SimdT::ValueType *result)
+{
+    q.w.storeStrided(result, 4);
+    q.x.storeStrided(result + 1, 4);
+    q.y.storeStrided(result + 2, 4);
+    q.z.storeStrided(result + 3, 4);
+}
+
+template<typename SimdT>
+FMATH_INLINE SimdQuat<SimdT> multiply(const SimdQuat<SimdT> &a, const SimdQuat<SimdT> &b)
+{
+    return SimdQuat<SimdT> {
+        fnmadd(a.z, b.z, fnmadd(a.y, b.y, fnmadd(a.x, b.x, a.w * b.w))),
+        fnmadd(a.z, b.y, fmadd(a.y, b.z, fmadd(a.w, b.x, a.x * b.w))),
+        fnmadd(a.x, b.z, fmadd(a.z, b.x, fmadd(a.w, b.y, a.y * b.w))),
+        fnmadd(a.y, b.x, fmadd(a.x, b.y, fmadd(a.w, b.z, a.z * b.w)))
+    };
+}
+
+// Logarithm of unit quaternions, the scalar part of the result is zero
+template<typename SimdT>
+FMATH_INLINE SimdQuat<SimdT> logUnit(const SimdQuat<SimdT> &q)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT v_length = sqrt(fmadd(q.x, q.x, fmadd(q.y, q.y, q.z * q.z)));
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdT scale = select(v_length > SimdT::broadcast(constants::Epsilon<T>::value),
+        simd::atan2(v_length, q.w) / v_length, one / q.w);
+    return SimdQuat<SimdT> { SimdT::broadcast(static_cast<T>(0)), q.x * scale, q.y * scale, q.z * scale };
+}
+
+// Exponential of pure quaternions, the scalar part of the input is ignored
+template<typename SimdT>
+FMATH_INLINE SimdQuat<SimdT> expPure(const SimdQuat<SimdT> &q)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT angle = sqrt(fmadd(q.x, q.x, fmadd(q.y, q.y, q.z * q.z)));
+    SimdT sin_angle, cos_angle;
+    simd::sincos(angle, sin_angle, cos_angle);
+    const SimdT scale = select(angle > SimdT::broadcast(constants::Epsilon<T>::value), sin_angle / angle,
+        SimdT::broadcast(static_cast<T>(1)));
+    return SimdQuat<SimdT> { cos_angle, q.x * scale, q.y * scale, q.z * scale };
+}
+
+template<typename SimdT>
+FMATH_INLINE SimdQuat<SimdT> squadControl(const SimdQuat<SimdT> &prev, const SimdQuat<SimdT> &q,
+    const SimdQuat<SimdT> &next)
+{
+    using T = typename SimdT::ValueType;
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    const SimdQuat<SimdT> q_inverse { q.w, -q.x, -q.y, -q.z };
+
+    // Negating the product is the same as negating the neighbour, its scalar part is dot(q, neighbour)
+    const auto hemisphere = [&zero](const SimdQuat<SimdT> &p)
+    {
+        const typename SimdT::MaskType flip = p.w < zero;
+        return SimdQuat<SimdT> { select(flip, -p.w, p.w), select(flip, -p.x, p.x), select(flip, -p.y, p.y),
+            select(flip, -p.z, p.z) };
+    };
+
+    const SimdQuat<SimdT> log_prev = logUnit(hemisphere(multiply(q_inverse, prev)));
+    const SimdQuat<SimdT> log_next = logUnit(hemisphere(multiply(q_inverse, next)));
+    const SimdT quarter = SimdT::broadcast(static_cast<T>(-0.25));
+    const SimdQuat<SimdT> tangent { zero, (log_prev.x + log_next.x) * quarter, (log_prev.y + log_next.y) * quarter,
+        (log_prev.z + log_next.z) * quarter };
+    return multiply(q, expPure(tangent));
+}
+
+// Applies func to blocks of quaternions. The polynomial approximations behind the SIMD functions are accurate to
+// float precision, so double keeps the scalar path through scalar_func.
+template<typename T, typename SimdFuncT, typename ScalarFuncT>
+FMATH_INLINE void mapQuats(const Quat<T> *q, Quat<T> *result, size_t count, SimdFuncT func, ScalarFuncT scalar_func)
+{
+    if constexpr (std::is_same_v<T, float>)
+    {
+        using SimdT = simd::NativeSimd<T>;
+        constexpr size_t W = SimdT::WIDTH;
+
+        index_t i = 0;
+        for (; i + W <= count; i += W)
+            storeQuats(func(loadQuats<SimdT>(q[i].data())), result[i].data());
+        for (; i < count; ++i)
+            storeQuats(func(loadQuats<simd::Simd<T, 1>>(q[i].data())), result[i].data());
+    }
+    else
+    {
+        for (index_t i = 0; i < count; ++i)
+            result[i] = scalar_func(q[i]);
+    }
+}
+
+}
+
+// Batch forms restricted to rotations, result may alias q. log expects unit quaternions and exp expects the pure
+// quaternions log produces.
+template<typename T>
+FMATH_INLINE void log(const Quat<T> *q, Quat<T> *result, size_t count)
+{
+    internal::mapQuats(q, result, count,
+        [](const auto &block) { return internal::logUnit(block); },
+        [](const Quat<T> &value) { return log(value); });
+}
+
+template<typename T>
+FMATH_INLINE void exp(const Quat<T> *q, Quat<T> *result, size_t count)
+{
+    internal::mapQuats(q, result, count,
+        [](const auto &block) { return internal::expPure(block); },
+        [](const Quat<T> &value) { return exp(Quat<T>(0, value.x, value.y, value.z)); });
+}
+
+template<typename T>
+FMATH_INLINE void pow(const Quat<T> *q, const T &t, Quat<T> *result, size_t count)
+{
+    internal::mapQuats(q, result, count,
+        [&t](const auto &block)
+        {
+            using SimdT = std::decay_t<decltype(block.w)>;
+            const SimdT tt = SimdT::broadcast(t);
+            const auto l = internal::logUnit(block);
+            return internal::expPure(std::decay_t<decltype(l)> { l.w, l.x * tt, l.y * tt, l.z * tt });
+        },
+        [&t](const Quat<T> &value) { return pow(value, t); });
+}
+
+// Squad control quaternions of a whole sequence of unit keys, computed once so that sampling only costs the three
+// slerps of squad. The end keys are their own controls. controls must not alias keys.
+template<typename T>
+FMATH_INLINE void squadControls(const Quat<T> *keys, Quat<T> *controls, size_t count)
+{
+    FMATH_ASSERT(keys != controls || count == 0);
+    if (count < 3)
+    {
+        for (index_t i = 0; i < count; ++i)
+            controls[i] = keys[i];
+        return;
+    }
+
+    controls[0] = keys[0];
+    controls[count - 1] = keys[count - 1];
+    const size_t inner_count = count - 2;
+
+    if constexpr (std::is_same_v<T, float>)
+    {
+        using SimdT = internal::simd::NativeSimd<T>;
+        using SimdT1 = internal::simd::Simd<T, 1>;
+        constexpr size_t W = SimdT::WIDTH;
+
+        index_t i = 0;
+        for (; i + W <= inner_count; i += W)
+        {
+            internal::storeQuats(internal::squadControl(internal::loadQuats<SimdT>(keys[i].data()),
+                internal::loadQuats<SimdT>(keys[i + 1].data()), internal::loadQuats<SimdT>(keys[i + 2].data())),
+                controls[i + 1].data());
+        }
+        for (; i < inner_count; ++i)
+        {
+            internal::storeQuats(internal::squadControl(internal::loadQuats<SimdT1>(keys[i].data()),
+                internal::loadQuats<SimdT1>(keys[i + 1].data()), internal::loadQuats<SimdT1>(keys[i + 2].data())),
+                controls[i + 1].data());
+        }
+    }
+    else
+    {
+        for (index_t i = 1; i + 1 < count; ++i)
+            controls[i] = squadControl(keys[i - 1], keys[i], keys[i + 1]);
+    }
+}
+
+namespace internal
+{
+
+// Rotates a block of vectors, q_stride is 0 to use the same quaternion for every vector
+template<typename SimdT>
+FMATH_INLINE void rotateBlock(const typename SimdT::ValueType *q, size_t q_stride, const typename SimdT::ValueType *v,
+    typename SimdT::ValueType *result)
+{
+    const SimdT w = SimdT::loadStrided(q, q_stride);
+    const simd::SimdVector3<SimdT> u { SimdT::loadStrided(q + 1, q_stride), SimdT::loadStrided(q + 2, q_stride),
+        SimdT::loadStrided(q + 3, q_stride) };
+    const simd::SimdVector3<SimdT> in { SimdT::loadStrided(v, 3), SimdT::loadStrided(v + 1, 3),
+        SimdT::loadStrided(v + 2, 3) };
+
+    const simd::SimdVector3<SimdT> out = simd::rotate(w, u, in);
+    out.x.storeStrided(result, 3);
+    out.y.storeStrided(result + 1, 3);
+    out.z.storeStrided(result + 2, 3);
+}
+
+template<typename T>
+FMATH_INLINE void rotateVectors(const Quat<T> *q, size_t q_stride, const Vector3<T> *v, Vector3<T> *result, size_t count)
+{
+    static_assert(sizeof(Vector3<T>) == sizeof(T) * 3, "Vector3 must be tightly packed");
+    using SimdT = simd::NativeSimd<T>;
+    constexpr size_t W = SimdT::WIDTH;
+    const T *qdata = q->data();
+    const size_t q_step = q_stride * 4;
+
+    index_t i = 0;
+    for (; i + W <= count; i += W)
+        rotateBlock<SimdT>(qdata + i * q_step, q_step, v[i].data(), result[i].data());
+    for (; i < count; ++i)
+        rotateBlock<simd::Simd<T, 1>>(qdata + i * q_step, q_step, v[i].data(), result[i].data());
+}
+
+}
+
+// Rotates count vectors by the same unit quaternion, result may alias v
+template<typename T>
+FMATH_INLINE void rotate(const Quat<T> &q, const Vector3<T> *v, Vector3<T> *result, size_t count)
+{
+    internal::rotateVectors(&q, 0, v, result, count);
+}
+
+// Rotates every vector by its own unit quaternion, result may alias v
+template<typename T>
+FMATH_INLINE void rotate(const Quat<T> *q, const Vector3<T> *v, Vector3<T> *result, size_t count)
+{
+    internal::rotateVectors(q, 1, v, result, count);
+}
+
 using Quatf = Quat<float>;
 using Quatlf = Quat<double>;
 
@@ -1,7 +1,14 @@
 #ifndef _FMATH_RAY_H_
 #define _FMATH_RAY_H_
 
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include "internal/simd.h"
+#include "box.h"
 #include "point.h"
+#include "triangle.h"
 #include "vector.h"
 #include "line.h"
 
@@ -237,6 +244,433 @@ using Ray2lf = Ray2<double>;
 using Ray3f = Ray3<float>;
 using Ray3lf = Ray3<double>;
 
+// Ray data shared by every slab test of a traversal. Only intersections within [t_min, t_max] count, a closest-hit
+// traversal shrinks t_max to the nearest hit found so far.
+template<typename T>
+struct RayPrecomputed
+{
+    using ValueType = T;
+
+    Point3<T> origin;
+    Vector3<T> direction;
+    Vector3<T> inv_direction;
+    // 1 where the direction component is negative, so that the slab of that axis is entered through the maximum
+    std::array<uint32, 3> sign;
+    // Watertight triangle test: the axes permuted so that z is the dominant direction, and the shear that maps the
+    // direction onto the permuted z axis
+    std::array<uint32, 3> shear_axes;
+    Vector3<T> shear;
+    T t_min;
+    T t_max;
+
+    explicit FMATH_CONSTEXPR RayPrecomputed(const Ray3<T> &ray, const T &t_min = 0,
+        const T &t_max = constants::Inf<T>::value);
+
+    // The direction is not normalized, distances are measured in multiples of it
+    explicit FMATH_CONSTEXPR RayPrecomputed(const Point3<T> &origin, const Vector3<T> &direction, const T &t_min = 0,
+        const T &t_max = constants::Inf<T>::value);
+};
+
+// W boxes stored as component arrays, the layout of the child bounds of a wide BVH node
+template<typename T, size_t W>
+struct Box3Block
+{
+    using ValueType = T;
+    static constexpr size_t WIDTH = W;
+
+    alignas(sizeof(T) * W) T min_x[W];
+    T min_y[W];
+    T min_z[W];
+    T max_x[W];
+    T max_y[W];
+    T max_z[W];
+
+    FMATH_INLINE Box3<T> get(index_t lane) const;
+
+    FMATH_INLINE void set(index_t lane, const Box3<T> &box);
+
+    // Empty lanes are inverted boxes that no ray hits
+    FMATH_INLINE void setEmpty(index_t lane);
+
+    static FMATH_INLINE Box3Block makeEmpty();
+};
+
+template<typename T>
+using Box3Block4 = Box3Block<T, 4>;
+
+template<typename T>
+using Box3Block8 = Box3Block<T, 8>;
+
+// Branchless slab test. On a hit [t_near, t_far] is the part of the ray inside the box, clipped to [t_min, t_max].
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool intersect(const RayPrecomputed<T> &ray, const Box3<T> &box, T &t_near, T &t_far)
+{
+    const Point3<T> *bounds[2] = { &box.min(), &box.max() };
+    T t0 = ray.t_min;
+    T t1 = ray.t_max;
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const T near_i = ((*bounds[ray.sign[i]])[i] - ray.origin[i]) * ray.inv_direction[i];
+        const T far_i = ((*bounds[1 - ray.sign[i]])[i] - ray.origin[i]) * ray.inv_direction[i];
+        // A ray lying in a slab plane gives NaN, which the comparisons skip
+        t0 = near_i > t0 ? near_i : t0;
+        t1 = far_i < t1 ? far_i : t1;
+    }
+    t_near = t0;
+    t_far = t1;
+    return t0 <= t1;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool intersect(const Ray3<T> &ray, const Box3<T> &box, T &t_near, T &t_far)
+{
+    return intersect(RayPrecomputed<T>(ray), box, t_near, t_far);
+}
+
+// Slab test of one ray against W boxes at once. Returns the bitmask of the lanes hit and writes the entry distance of
+// every lane to t_near, which is meaningful only for the lanes hit.
+template<typename T, size_t W>
+FMATH_INLINE uint32 intersect(const RayPrecomputed<T> &ray, const Box3Block<T, W> &boxes, T *t_near)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    const T *near_planes[3] = {
+        ray.sign[0] ? boxes.max_x : boxes.min_x,
+        ray.sign[1] ? boxes.max_y : boxes.min_y,
+        ray.sign[2] ? boxes.max_z : boxes.min_z
+    };
+    const T *far_planes[3] = {
+        ray.sign[0] ? boxes.min_x : boxes.max_x,
+        ray.sign[1] ? boxes.min_y : boxes.max_y,
+        ray.sign[2] ? boxes.min_z : boxes.max_z
+    };
+
+    SimdT t0 = SimdT::broadcast(ray.t_min);
+    SimdT t1 = SimdT::broadcast(ray.t_max);
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const SimdT origin = SimdT::broadcast(ray.origin[i]);
+        const SimdT inv_direction = SimdT::broadcast(ray.inv_direction[i]);
+        // NaN candidates come first so that min and max keep the running bound
+        t0 = max((SimdT::load(near_planes[i]) - origin) * inv_direction, t0);
+        t1 = min((SimdT::load(far_planes[i]) - origin) * inv_direction, t1);
+    }
+    t0.store(t_near);
+    return internal::simd::bitmask(t0 <= t1);
+}
+
+// W triangles stored as component arrays of the first vertex and the two edges leaving it, as the Moller-Trumbore
+// test consumes them
+template<typename T, size_t W>
+struct Triangle3Block
+{
+    using ValueType = T;
+    static constexpr size_t WIDTH = W;
+
+    alignas(sizeof(T) * W) T v0_x[W];
+    T v0_y[W];
+    T v0_z[W];
+    T e1_x[W];
+    T e1_y[W];
+    T e1_z[W];
+    T e2_x[W];
+    T e2_y[W];
+    T e2_z[W];
+
+    FMATH_INLINE Triangle3<T> get(index_t lane) const;
+
+    FMATH_INLINE void set(index_t lane, const Triangle3<T> &triangle);
+
+    // Empty lanes are triangles collapsed to a point at infinity, which no ray hits and no point is near
+    FMATH_INLINE void setEmpty(index_t lane);
+
+    static FMATH_INLINE Triangle3Block makeEmpty();
+};
+
+template<typename T>
+using Triangle3Block4 = Triangle3Block<T, 4>;
+
+template<typename T>
+using Triangle3Block8 = Triangle3Block<T, 8>;
+
+// Moller-Trumbore test, see "Fast, Minimum Storage Ray/Triangle Intersection", 1997. Both sides of the triangle are
+// hit. On a hit within [t_min, t_max] the point is origin + t * direction = (1 - u - v) * v0 + u * v1 + v * v2.
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool intersect(const RayPrecomputed<T> &ray, const Triangle3<T> &triangle, T &t, T &u,
+    T &v)
+{
+    const Vector3<T> e1 = triangle[1] - triangle[0];
+    const Vector3<T> e2 = triangle[2] - triangle[0];
+    const Vector3<T> p = cross(ray.direction, e2);
+    const T det = dot(e1, p);
+    // Rays parallel to the plane are rejected, nearly parallel ones fail the barycentric tests
+    if (det == static_cast<T>(0))
+        return false;
+
+    const T inv_det = static_cast<T>(1) / det;
+    const Vector3<T> s = ray.origin - triangle[0];
+    const T hit_u = dot(s, p) * inv_det;
+    if (hit_u < static_cast<T>(0) || hit_u > static_cast<T>(1))
+        return false;
+
+    const Vector3<T> q = cross(s, e1);
+    const T hit_v = dot(ray.direction, q) * inv_det;
+    if (hit_v < static_cast<T>(0) || hit_u + hit_v > static_cast<T>(1))
+        return false;
+
+    const T hit_t = dot(e2, q) * inv_det;
+    if (hit_t < ray.t_min || hit_t > ray.t_max)
+        return false;
+
+    t = hit_t;
+    u = hit_u;
+    v = hit_v;
+    return true;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool intersect(const Ray3<T> &ray, const Triangle3<T> &triangle, T &t, T &u, T &v)
+{
+    return intersect(RayPrecomputed<T>(ray), triangle, t, u, v);
+}
+
+namespace internal
+{
+
+// a * b - c * d with the sign of the exact result. An edge shared by two triangles is seen by each with its ends
+// swapped, and the two edge functions must come out exactly opposite. A plain expression does not guarantee it once
+// the compiler contracts it into a fused multiply-add, which rounds only one of the products.
+template<typename T>
+FMATH_INLINE T differenceOfProducts(T a, T b, T c, T d)
+{
+#if defined(FP_FAST_FMA)
+    // Kahan's algorithm: the second fused multiply-add recovers the rounding error of c * d exactly
+    const T cd = c * d;
+    const T error = std::fma(-c, d, cd);
+    return std::fma(a, b, -cd) + error;
+#else
+    // Without fused multiply-adds both products are rounded alike and swapping them negates the result exactly
+    return a * b - c * d;
+#endif
+}
+
+// The products of two floats are exact in double, which rounds only the difference
+template<>
+FMATH_INLINE float differenceOfProducts(float a, float b, float c, float d)
+{
+    return static_cast<float>(static_cast<double>(a) * b - static_cast<double>(c) * d);
+}
+
+}
+
+// Watertight test of Woop, Benthin and Wald, "Watertight Ray/Triangle Intersection", JCGT 2013. A ray never slips
+// between triangles sharing an edge: a ray through the edge hits at least one of them, possibly both, as there is no
+// tie-breaking rule. The outputs match the Moller-Trumbore test.
+template<typename T>
+FMATH_INLINE bool intersectWatertight(const RayPrecomputed<T> &ray, const Triangle3<T> &triangle, T &t, T &u, T &v)
+{
+    const uint32 kx = ray.shear_axes[0];
+    const uint32 ky = ray.shear_axes[1];
+    const uint32 kz = ray.shear_axes[2];
+
+    const Vector3<T> a = triangle[0] - ray.origin;
+    const Vector3<T> b = triangle[1] - ray.origin;
+    const Vector3<T> c = triangle[2] - ray.origin;
+
+    // Vertices in the space where the ray runs along +z from the origin
+    const T ax = a[kx] - ray.shear[0] * a[kz];
+    const T ay = a[ky] - ray.shear[1] * a[kz];
+    const T bx = b[kx] - ray.shear[0] * b[kz];
+    const T by = b[ky] - ray.shear[1] * b[kz];
+    const T cx = c[kx] - ray.shear[0] * c[kz];
+    const T cy = c[ky] - ray.shear[1] * c[kz];
+
+    // Edge functions with exact signs, which the triangles sharing an edge agree on
+    const T edge_u = internal::differenceOfProducts(cx, by, cy, bx);
+    const T edge_v = internal::differenceOfProducts(ax, cy, ay, cx);
+    const T edge_w = internal::differenceOfProducts(bx, ay, by, ax);
+
+    const T zero = static_cast<T>(0);
+    if ((edge_u < zero || edge_v < zero || edge_w < zero) && (edge_u > zero || edge_v > zero || edge_w > zero))
+        return false;
+
+    const T det = edge_u + edge_v + edge_w;
+    if (det == zero)
+        return false;
+
+    const T az = ray.shear[2] * a[kz];
+    const T bz = ray.shear[2] * b[kz];
+    const T cz = ray.shear[2] * c[kz];
+    const T scaled_t = edge_u * az + edge_v * bz + edge_w * cz;
+
+    // Range check on the scaled distance, flipping both sides to a positive determinant first
+    const T sign = det < zero ? static_cast<T>(-1) : static_cast<T>(1);
+    const T abs_det = det * sign;
+    if (scaled_t * sign < ray.t_min * abs_det || scaled_t * sign > ray.t_max * abs_det)
+        return false;
+
+    const T inv_det = static_cast<T>(1) / det;
+    t = scaled_t * inv_det;
+    u = edge_v * inv_det;
+    v = edge_w * inv_det;
+    return true;
+}
+
+template<typename T>
+FMATH_INLINE bool intersectWatertight(const Ray3<T> &ray, const Triangle3<T> &triangle, T &t, T &u, T &v)
+{
+    return intersectWatertight(RayPrecomputed<T>(ray), triangle, t, u, v);
+}
+
+// Moller-Trumbore test of one ray against W triangles at once. Returns the bitmask of the lanes hit and writes t, u
+// and v of every lane, which are meaningful only for the lanes hit.
+template<typename T, size_t W>
+FMATH_INLINE uint32 intersect(const RayPrecomputed<T> &ray, const Triangle3Block<T, W> &triangles, T *t, T *u, T *v)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    using MaskT = typename SimdT::MaskType;
+    using internal::simd::SimdVector3;
+
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdVector3<SimdT> direction { SimdT::broadcast(ray.direction[0]), SimdT::broadcast(ray.direction[1]),
+        SimdT::broadcast(ray.direction[2]) };
+    const SimdVector3<SimdT> e1 { SimdT::load(triangles.e1_x), SimdT::load(triangles.e1_y),
+        SimdT::load(triangles.e1_z) };
+    const SimdVector3<SimdT> e2 { SimdT::load(triangles.e2_x), SimdT::load(triangles.e2_y),
+        SimdT::load(triangles.e2_z) };
+    const SimdVector3<SimdT> s {
+        SimdT::broadcast(ray.origin[0]) - SimdT::load(triangles.v0_x),
+        SimdT::broadcast(ray.origin[1]) - SimdT::load(triangles.v0_y),
+        SimdT::broadcast(ray.origin[2]) - SimdT::load(triangles.v0_z)
+    };
+
+    const SimdVector3<SimdT> p = cross(direction, e2);
+    const SimdVector3<SimdT> q = cross(s, e1);
+    const SimdT det = fmadd(e1.x, p.x, fmadd(e1.y, p.y, e1.z * p.z));
+    const SimdT inv_det = one / det;
+    const SimdT hit_u = fmadd(s.x, p.x, fmadd(s.y, p.y, s.z * p.z)) * inv_det;
+    const SimdT hit_v = fmadd(direction.x, q.x, fmadd(direction.y, q.y, direction.z * q.z)) * inv_det;
+    const SimdT hit_t = fmadd(e2.x, q.x, fmadd(e2.y, q.y, e2.z * q.z)) * inv_det;
+
+    // A zero determinant makes the barycentrics infinite or NaN, which fail the comparisons
+    const MaskT hit = (hit_u >= zero) & (hit_v >= zero) & (hit_u + hit_v <= one) &
+        (hit_t >= SimdT::broadcast(ray.t_min)) & (hit_t <= SimdT::broadcast(ray.t_max));
+    hit_t.store(t);
+    hit_u.store(u);
+    hit_v.store(v);
+    return internal::simd::bitmask(hit);
+}
+
+template<typename T>
+FMATH_CONSTEXPR RayPrecomputed<T>::RayPrecomputed(const Ray3<T> &ray, const T &t_min, const T &t_max)
+    :   RayPrecomputed(ray.origin(), ray.direction(), t_min, t_max)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR RayPrecomputed<T>::RayPrecomputed(const Point3<T> &origin, const Vector3<T> &direction, const T &t_min,
+    const T &t_max)
+    :   origin(origin),
+        direction(direction),
+        inv_direction(static_cast<T>(1) / direction[0], static_cast<T>(1) / direction[1],
+            static_cast<T>(1) / direction[2]),
+        sign { inv_direction[0] < 0 ? 1U : 0U, inv_direction[1] < 0 ? 1U : 0U, inv_direction[2] < 0 ? 1U : 0U },
+        shear_axes {},
+        shear(),
+        t_min(t_min),
+        t_max(t_max)
+{
+    const T ax = abs(direction[0]);
+    const T ay = abs(direction[1]);
+    const T az = abs(direction[2]);
+    const uint32 kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+    uint32 kx = kz == 2 ? 0 : kz + 1;
+    uint32 ky = kx == 2 ? 0 : kx + 1;
+    // Keeps the winding of the projected triangle
+    if (direction[kz] < 0)
+        std::swap(kx, ky);
+
+    shear_axes = { kx, ky, kz };
+    shear = Vector3<T>(direction[kx] / direction[kz], direction[ky] / direction[kz], static_cast<T>(1) / direction[kz]);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Box3<T> Box3Block<T, W>::get(index_t lane) const
+{
+    // Assigned directly, the two-point constructor would reorder the corners of an empty lane
+    Box3<T> box;
+    box.min() = Point3<T>(min_x[lane], min_y[lane], min_z[lane]);
+    box.max() = Point3<T>(max_x[lane], max_y[lane], max_z[lane]);
+    return box;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void Box3Block<T, W>::set(index_t lane, const Box3<T> &box)
+{
+    min_x[lane] = box.min()[0];
+    min_y[lane] = box.min()[1];
+    min_z[lane] = box.min()[2];
+    max_x[lane] = box.max()[0];
+    max_y[lane] = box.max()[1];
+    max_z[lane] = box.max()[2];
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void Box3Block<T, W>::setEmpty(index_t lane)
+{
+    min_x[lane] = min_y[lane] = min_z[lane] = constants::Inf<T>::value;
+    max_x[lane] = max_y[lane] = max_z[lane] = -constants::Inf<T>::value;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Box3Block<T, W> Box3Block<T, W>::makeEmpty()
+{
+    Box3Block block;
+    for (index_t i = 0; i < W; ++i)
+        block.setEmpty(i);
+    return block;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Triangle3<T> Triangle3Block<T, W>::get(index_t lane) const
+{
+    const Point3<T> v0(v0_x[lane], v0_y[lane], v0_z[lane]);
+    return Triangle3<T>(v0, v0 + Vector3<T>(e1_x[lane], e1_y[lane], e1_z[lane]),
+        v0 + Vector3<T>(e2_x[lane], e2_y[lane], e2_z[lane]));
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void Triangle3Block<T, W>::set(index_t lane, const Triangle3<T> &triangle)
+{
+    const Vector3<T> e1 = triangle[1] - triangle[0];
+    const Vector3<T> e2 = triangle[2] - triangle[0];
+    v0_x[lane] = triangle[0][0];
+    v0_y[lane] = triangle[0][1];
+    v0_z[lane] = triangle[0][2];
+    e1_x[lane] = e1[0];
+    e1_y[lane] = e1[1];
+    e1_z[lane] = e1[2];
+    e2_x[lane] = e2[0];
+    e2_y[lane] = e2[1];
+    e2_z[lane] = e2[2];
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void Triangle3Block<T, W>::setEmpty(index_t lane)
+{
+    v0_x[lane] = v0_y[lane] = v0_z[lane] = constants::Inf<T>::value;
+    e1_x[lane] = e1_y[lane] = e1_z[lane] = static_cast<T>(0);
+    e2_x[lane] = e2_y[lane] = e2_z[lane] = static_cast<T>(0);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Triangle3Block<T, W> Triangle3Block<T, W>::makeEmpty()
+{
+    Triangle3Block block;
+    for (index_t i = 0; i < W; ++i)
+        block.setEmpty(i);
+    return block;
+}
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,401 @@
+#ifndef _FMATH_RAY_PACKET_H_
+#define _FMATH_RAY_PACKET_H_
+
+#include <array>
+
+#include "internal/simd.h"
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "frustum.h"
+#include "plane.h"
+#include "point.h"
+#include "ray.h"
+#include "sphere.h"
+#include "transform.h"
+#include "triangle.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// W rays stored as component arrays for coherent primary and shadow rays. Directions are not normalized, distances
+// are measured in multiples of them. Only the lanes set in active take part in the tests, and every test returns
+// the bitmask of the active lanes hit. Per-lane outputs are written for all lanes but only meaningful where hit.
+template<typename T, size_t W>
+struct RayPacket
+{
+    using ValueType = T;
+    static constexpr size_t WIDTH = W;
+    static_assert(W <= 32, "The active mask holds at most 32 lanes");
+
+    alignas(sizeof(T) * W) T origin_x[W];
+    T origin_y[W];
+    T origin_z[W];
+    T direction_x[W];
+    T direction_y[W];
+    T direction_z[W];
+    // Kept in sync by set, call precompute after writing the direction arrays directly
+    T inv_direction_x[W];
+    T inv_direction_y[W];
+    T inv_direction_z[W];
+    T t_min[W];
+    T t_max[W];
+    uint32 active;
+
+    FMATH_INLINE Point3<T> origin(index_t lane) const;
+
+    FMATH_INLINE Vector3<T> direction(index_t lane) const;
+
+    FMATH_INLINE RayPrecomputed<T> get(index_t lane) const;
+
+    // Activates the lane, packets start from makeEmpty
+    FMATH_INLINE void set(index_t lane, const Point3<T> &origin, const Vector3<T> &direction, const T &t_min = 0,
+        const T &t_max = constants::Inf<T>::value);
+
+    FMATH_INLINE void set(index_t lane, const Ray3<T> &ray, const T &t_min = 0,
+        const T &t_max = constants::Inf<T>::value);
+
+    FMATH_INLINE void precompute();
+
+    // No active lanes
+    static FMATH_INLINE RayPacket makeEmpty();
+};
+
+template<typename T>
+using RayPacket4 = RayPacket<T, 4>;
+
+template<typename T>
+using RayPacket8 = RayPacket<T, 8>;
+
+template<typename T>
+using RayPacket16 = RayPacket<T, 16>;
+
+namespace internal
+{
+
+template<typename T, size_t W>
+struct SimdRays
+{
+    using SimdT = simd::Simd<T, W>;
+
+    simd::SimdVector3<SimdT> origin;
+    simd::SimdVector3<SimdT> direction;
+    SimdT t_min;
+    SimdT t_max;
+
+    explicit SimdRays(const RayPacket<T, W> &packet)
+        :   origin { SimdT::load(packet.origin_x), SimdT::load(packet.origin_y), SimdT::load(packet.origin_z) },
+            direction { SimdT::load(packet.direction_x), SimdT::load(packet.direction_y),
+                SimdT::load(packet.direction_z) },
+            t_min(SimdT::load(packet.t_min)),
+            t_max(SimdT::load(packet.t_max))
+    {}
+};
+
+template<typename SimdT>
+FMATH_INLINE SimdT dot(const simd::SimdVector3<SimdT> &a, const simd::SimdVector3<SimdT> &b)
+{
+    return fmadd(a.x, b.x, fmadd(a.y, b.y, a.z * b.z));
+}
+
+template<typename SimdT>
+FMATH_INLINE simd::SimdVector3<SimdT> broadcast(const Vector3<typename SimdT::ValueType> &v)
+{
+    return simd::SimdVector3<SimdT> { SimdT::broadcast(v[0]), SimdT::broadcast(v[1]), SimdT::broadcast(v[2]) };
+}
+
+}
+
+// Slab test of every active ray against one box, giving up as soon as no active ray is left in all slabs seen so far
+template<typename T, size_t W>
+FMATH_INLINE uint32 intersect(const RayPacket<T, W> &packet, const Box3<T> &box, T *t_near)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    const T *origins[3] = { packet.origin_x, packet.origin_y, packet.origin_z };
+    const T *inv_directions[3] = { packet.inv_direction_x, packet.inv_direction_y, packet.inv_direction_z };
+
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    SimdT t0 = SimdT::load(packet.t_min);
+    SimdT t1 = SimdT::load(packet.t_max);
+    uint32 hit = packet.active;
+    for (index_t i = 0; i < 3 && hit != 0; ++i)
+    {
+        const SimdT origin = SimdT::load(origins[i]);
+        const SimdT inv_direction = SimdT::load(inv_directions[i]);
+        const SimdT ta = (SimdT::broadcast(box.min()[i]) - origin) * inv_direction;
+        const SimdT tb = (SimdT::broadcast(box.max()[i]) - origin) * inv_direction;
+        // The direction signs differ between lanes, so the near plane is picked per lane from the sign of the inverse
+        // direction, as the scalar test does. Ordering ta and tb with min and max instead would let the NaN of a ray
+        // lying in a slab plane replace the other candidate. The NaN candidates come first so that min and max keep
+        // the running bound.
+        const auto negative = inv_direction < zero;
+        t0 = max(select(negative, tb, ta), t0);
+        t1 = min(select(negative, ta, tb), t1);
+        hit &= internal::simd::bitmask(t0 <= t1);
+    }
+    t0.store(t_near);
+    return hit;
+}
+
+// Entry distance of every active ray into a solid sphere, rays starting inside report their exit
+template<typename T, size_t W>
+FMATH_INLINE uint32 intersect(const RayPacket<T, W> &packet, const Sphere3<T> &sphere, T *t)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    const internal::SimdRays<T, W> rays(packet);
+
+    const internal::simd::SimdVector3<SimdT> center = internal::broadcast<SimdT>(Vector3<T>(sphere.center()[0],
+        sphere.center()[1], sphere.center()[2]));
+    const internal::simd::SimdVector3<SimdT> offset { rays.origin.x - center.x, rays.origin.y - center.y,
+        rays.origin.z - center.z };
+
+    // a * t^2 + 2 * b * t + c = 0
+    const SimdT a = internal::dot(rays.direction, rays.direction);
+    const SimdT b = internal::dot(rays.direction, offset);
+    const SimdT radius = SimdT::broadcast(sphere.radius());
+    const SimdT c = fnmadd(radius, radius, internal::dot(offset, offset));
+    const SimdT discriminant = fnmadd(a, c, b * b);
+    const SimdT root = sqrt(max(discriminant, SimdT::broadcast(static_cast<T>(0))));
+
+    const SimdT inv_a = SimdT::broadcast(static_cast<T>(1)) / a;
+    const SimdT t_enter = (-b - root) * inv_a;
+    const SimdT t_exit = (root - b) * inv_a;
+    const SimdT result = select(t_enter >= rays.t_min, t_enter, t_exit);
+
+    result.store(t);
+    const uint32 hit = internal::simd::bitmask((discriminant >= SimdT::broadcast(static_cast<T>(0))) &
+        (result >= rays.t_min) & (result <= rays.t_max));
+    return hit & packet.active;
+}
+
+// Rays parallel to the plane never hit it
+template<typename T, size_t W>
+FMATH_INLINE uint32 intersect(const RayPacket<T, W> &packet, const Plane<T> &plane, T *t)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    const internal::SimdRays<T, W> rays(packet);
+    const internal::simd::SimdVector3<SimdT> normal = internal::broadcast<SimdT>(plane.normal());
+
+    const SimdT distance = SimdT::broadcast(plane.constant()) - internal::dot(normal, rays.origin);
+    const SimdT denominator = internal::dot(normal, rays.direction);
+    const SimdT result = distance / denominator;
+
+    // Parallel rays off the plane divide by zero into an infinity, which an unbounded t_max would accept
+    result.store(t);
+    return internal::simd::bitmask(~(denominator == SimdT::broadcast(static_cast<T>(0))) & (result >= rays.t_min) &
+        (result <= rays.t_max)) & packet.active;
+}
+
+// Moller-Trumbore test of every active ray against one triangle, outputs as in intersect(RayPrecomputed, Triangle3)
+template<typename T, size_t W>
+FMATH_INLINE uint32 intersect(const RayPacket<T, W> &packet, const Triangle3<T> &triangle, T *t, T *u, T *v)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    using SimdVector3 = internal::simd::SimdVector3<SimdT>;
+    const internal::SimdRays<T, W> rays(packet);
+
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    const SimdVector3 e1 = internal::broadcast<SimdT>(triangle[1] - triangle[0]);
+    const SimdVector3 e2 = internal::broadcast<SimdT>(triangle[2] - triangle[0]);
+    const SimdVector3 s { rays.origin.x - SimdT::broadcast(triangle[0][0]),
+        rays.origin.y - SimdT::broadcast(triangle[0][1]), rays.origin.z - SimdT::broadcast(triangle[0][2]) };
+
+    const SimdVector3 p = cross(rays.direction, e2);
+    const SimdVector3 q = cross(s, e1);
+    const SimdT inv_det = one / internal::dot(e1, p);
+    const SimdT hit_u = internal::dot(s, p) * inv_det;
+    const SimdT hit_v = internal::dot(rays.direction, q) * inv_det;
+    const SimdT hit_t = internal::dot(e2, q) * inv_det;
+
+    hit_t.store(t);
+    hit_u.store(u);
+    hit_v.store(v);
+    const uint32 hit = internal::simd::bitmask((hit_u >= zero) & (hit_v >= zero) & (hit_u + hit_v <= one) &
+        (hit_t >= rays.t_min) & (hit_t <= rays.t_max));
+    return hit & packet.active;
+}
+
+// Moves the packet into the space of an affine transform. Directions are not renormalized, so t_min, t_max and the
+// hit distances stay valid in both spaces, as needed to trace instances.
+template<typename T, size_t W>
+FMATH_INLINE RayPacket<T, W> transform(const Transform<T> &t, const RayPacket<T, W> &packet)
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    FMATH_ASSERT(t.isAffine());
+    const Matrix4<T> &m = t.toMatrix();
+    const internal::SimdRays<T, W> rays(packet);
+
+    const auto row = [&m](index_t r, const internal::simd::SimdVector3<SimdT> &v, const SimdT &w)
+    {
+        return fmadd(SimdT::broadcast(m[0][r]), v.x, fmadd(SimdT::broadcast(m[1][r]), v.y,
+            fmadd(SimdT::broadcast(m[2][r]), v.z, w)));
+    };
+
+    RayPacket<T, W> result = packet;
+    const SimdT zero = SimdT::broadcast(static_cast<T>(0));
+    row(0, rays.origin, SimdT::broadcast(m[3][0])).store(result.origin_x);
+    row(1, rays.origin, SimdT::broadcast(m[3][1])).store(result.origin_y);
+    row(2, rays.origin, SimdT::broadcast(m[3][2])).store(result.origin_z);
+    row(0, rays.direction, zero).store(result.direction_x);
+    row(1, rays.direction, zero).store(result.direction_y);
+    row(2, rays.direction, zero).store(result.direction_z);
+    result.precompute();
+    return result;
+}
+
+// Planes bounding every active ray of the packet between t_min and t_max, so that a box the frustum classifies as
+// Outside is missed by the whole packet and its per-ray tests can be skipped. Bounding planes exist only when every
+// active ray heads the same way along one axis, otherwise the frustum contains everything and culls nothing.
+template<typename T, size_t W>
+Frustum<T> makeFrustum(const RayPacket<T, W> &packet)
+{
+    const T zero = static_cast<T>(0);
+    const Plane<T> everything(Vector3<T>(zero, zero, static_cast<T>(1)), -constants::Inf<T>::value);
+    std::array<Plane<T>, Frustum<T>::PLANE_COUNT> planes = { everything, everything, everything, everything,
+        everything, everything };
+    if (packet.active == 0)
+        return Frustum<T>(planes);
+
+    const T *directions[3] = { packet.direction_x, packet.direction_y, packet.direction_z };
+
+    // The axis along which the rays agree the most
+    T sums[3] = { zero, zero, zero };
+    for (index_t lane = 0; lane < W; ++lane)
+    {
+        if ((packet.active >> lane) & 1U)
+        {
+            for (index_t i = 0; i < 3; ++i)
+                sums[i] += directions[i][lane];
+        }
+    }
+    const index_t k = abs(sums[0]) > abs(sums[1]) ? (abs(sums[0]) > abs(sums[2]) ? 0 : 2)
+        : (abs(sums[1]) > abs(sums[2]) ? 1 : 2);
+    const index_t axes[2] = { k == 0 ? 1U : 0U, k == 2 ? 1U : 2U };
+    const T sign = sums[k] < zero ? static_cast<T>(-1) : static_cast<T>(1);
+
+    // Slopes against the main axis, and the extreme values of the plane equations over the start and end points
+    T slope_min[2] = { constants::Inf<T>::value, constants::Inf<T>::value };
+    T slope_max[2] = { -constants::Inf<T>::value, -constants::Inf<T>::value };
+    for (index_t lane = 0; lane < W; ++lane)
+    {
+        if (((packet.active >> lane) & 1U) == 0)
+            continue;
+        const T forward = directions[k][lane] * sign;
+        if (!(forward > zero))
+            return Frustum<T>(planes);
+        for (index_t j = 0; j < 2; ++j)
+        {
+            const T slope = directions[axes[j]][lane] / forward;
+            slope_min[j] = min(slope_min[j], slope);
+            slope_max[j] = max(slope_max[j], slope);
+        }
+    }
+
+    T near_constant = constants::Inf<T>::value;
+    T far_constant = constants::Inf<T>::value;
+    T low_constant[2] = { constants::Inf<T>::value, constants::Inf<T>::value };
+    T high_constant[2] = { constants::Inf<T>::value, constants::Inf<T>::value };
+    for (index_t lane = 0; lane < W; ++lane)
+    {
+        if (((packet.active >> lane) & 1U) == 0)
+            continue;
+        const RayPrecomputed<T> ray = packet.get(lane);
+        // Every point of the ray past its start lies on the inner side of each side plane
+        const Point3<T> start = ray.origin + ray.direction * ray.t_min;
+        for (index_t j = 0; j < 2; ++j)
+        {
+            low_constant[j] = min(low_constant[j], start[axes[j]] - slope_min[j] * sign * start[k]);
+            high_constant[j] = min(high_constant[j], slope_max[j] * sign * start[k] - start[axes[j]]);
+        }
+        near_constant = min(near_constant, sign * start[k]);
+        far_constant = min(far_constant, -sign * (ray.origin[k] + ray.direction[k] * ray.t_max));
+    }
+
+    for (index_t j = 0; j < 2; ++j)
+    {
+        Vector3<T> low(zero, zero, zero);
+        low[axes[j]] = static_cast<T>(1);
+        low[k] = -slope_min[j] * sign;
+        Vector3<T> high(zero, zero, zero);
+        high[axes[j]] = static_cast<T>(-1);
+        high[k] = slope_max[j] * sign;
+        // The plane constructor normalizes the normal but not the constant
+        planes[j * 2] = Plane<T>(low, low_constant[j] / length(low));
+        planes[j * 2 + 1] = Plane<T>(high, high_constant[j] / length(high));
+    }
+    Vector3<T> forward(zero, zero, zero);
+    forward[k] = sign;
+    planes[Frustum<T>::NEAR_PLANE] = Plane<T>(forward, near_constant);
+    planes[Frustum<T>::FAR_PLANE] = Plane<T>(-forward, far_constant);
+
+    return Frustum<T>(planes);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Point3<T> RayPacket<T, W>::origin(index_t lane) const
+{
+    return Point3<T>(origin_x[lane], origin_y[lane], origin_z[lane]);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Vector3<T> RayPacket<T, W>::direction(index_t lane) const
+{
+    return Vector3<T>(direction_x[lane], direction_y[lane], direction_z[lane]);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE RayPrecomputed<T> RayPacket<T, W>::get(index_t lane) const
+{
+    return RayPrecomputed<T>(origin(lane), direction(lane), t_min[lane], t_max[lane]);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void RayPacket<T, W>::set(index_t lane, const Point3<T> &origin, const Vector3<T> &direction,
+    const T &t_min, const T &t_max)
+{
+    origin_x[lane] = origin[0];
+    origin_y[lane] = origin[1];
+    origin_z[lane] = origin[2];
+    direction_x[lane] = direction[0];
+    direction_y[lane] = direction[1];
+    direction_z[lane] = direction[2];
+    inv_direction_x[lane] = static_cast<T>(1) / direction[0];
+    inv_direction_y[lane] = static_cast<T>(1) / direction[1];
+    inv_direction_z[lane] = static_cast<T>(1) / direction[2];
+    this->t_min[lane] = t_min;
+    this->t_max[lane] = t_max;
+    active |= 1U << lane;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void RayPacket<T, W>::set(index_t lane, const Ray3<T> &ray, const T &t_min, const T &t_max)
+{
+    set(lane, ray.origin(), ray.direction(), t_min, t_max);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE void RayPacket<T, W>::precompute()
+{
+    using SimdT = internal::simd::Simd<T, W>;
+    const SimdT one = SimdT::broadcast(static_cast<T>(1));
+    (one / SimdT::load(direction_x)).store(inv_direction_x);
+    (one / SimdT::load(direction_y)).store(inv_direction_y);
+    (one / SimdT::load(direction_z)).store(inv_direction_z);
+}
+
+template<typename T, size_t W>
+FMATH_INLINE RayPacket<T, W> RayPacket<T, W>::makeEmpty()
+{
+    RayPacket packet;
+    packet.active = 0;
+    for (index_t i = 0; i < W; ++i)
+        packet.set(i, Point3<T>(0, 0, 0), Vector3<T>(0, 0, 1), static_cast<T>(0), static_cast<T>(0));
+    packet.active = 0;
+    return packet;
+}
+
+}
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef _FMATH_SKINNING_H_
+#define _FMATH_SKINNING_H_
+
+#include "internal/parallel.h"
+#include "internal/simd.h"
+#include "common.h"
+#include "dual_quaternion.h"
+#include "matrix.h"
+#include "quaternion.h"
+
+namespace fmath
+{
+
+// Three component arrays, either separate (stride 1) or interleaved with a common stride in elements
+template<typename T>
+struct Vector3Stream
+{
+    T *x = nullptr;
+    T *y = nullptr;
+    T *z = nullptr;
+    size_t stride = 1;
+
+    FMATH_INLINE bool empty() const;
+
+    static FMATH_INLINE Vector3Stream makeSoa(T *x, T *y, T *z);
+
+    static FMATH_INLINE Vector3Stream makeInterleaved(T *data, size_t stride = 3);
+};
+
+// bone_indices and bone_weights hold K entries per vertex, where K is the influence count of the kernel.
+// The weights of a vertex are expected to sum to one. Normals are optional.
+template<typename T>
+struct SkinningStreams
+{
+    Vector3Stream<const T> positions;
+    Vector3Stream<const T> normals;
+    Vector3Stream<T> skinned_positions;
+    Vector3Stream<T> skinned_normals;
+    const uint16 *bone_indices = nullptr;
+    const T *bone_weights = nullptr;
+    size_t count = 0;
+};
+
+template<typename T>
+FMATH_INLINE bool Vector3Stream<T>::empty() const
+{
+    return x == nullptr;
+}
+
+template<typename T>
+FMATH_INLINE Vector3Stream<T> Vector3Stream<T>::makeSoa(T *x, T *y, T *z)
+{
+    return Vector3Stream<T> { x, y, z, 1 };
+}
+
+template<typename T>
+FMATH_INLINE Vector3Stream<T> Vector3Stream<T>::makeInterleaved(T *data, size_t stride)
+{
+    return Vector3Stream<T> { data, data + 1, data + 2, stride };
+}
+
+namespace internal
+{
+
+constexpr size_t SKINNING_GRAIN_SIZE = 4096;
+
+template<typename SimdT, typename T>
+FMATH_INLINE SimdT loadStream(const T *data, size_t stride, index_t index)
+{
+    if (stride == 1)
+        return SimdT::load(data + index);
+    return SimdT::loadStrided(data + index * stride, stride);
+}
+
+template<typename SimdT, typename T>
+FMATH_INLINE void storeStream(const SimdT &value, T *data, size_t stride, index_t index)
+{
+    if (stride == 1)
+        value.store(data + index);
+    else
+        value.storeStrided(data + index * stride, stride);
+}
+
+namespace simd
+{
+
+template<typename SimdT, typename T>
+FMATH_INLINE SimdVector3<SimdT> loadVector3(const Vector3Stream<T> &stream, index_t index)
+{
+    return SimdVector3<SimdT> {
+        loadStream<SimdT>(stream.x, stream.stride, index),
+        loadStream<SimdT>(stream.y, stream.stride, index),
+        loadStream<SimdT>(stream.z, stream.stride, index)
+    };
+}
+
+template<typename SimdT, typename T>
+FMATH_INLINE void storeVector3(const SimdVector3<SimdT> &v, const Vector3Stream<T> &stream, index_t index)
+{
+    storeStream(v.x, stream.x, stream.stride, index);
+    storeStream(v.y, stream.y, stream.stride, index);
+    storeStream(v.z, stream.z, stream.stride, index);
+}
+
+}
+
+template<size_t K, typename SimdT, typename T>
+FMATH_INLINE void skinDualQuatBlock(const DualQuat<T> *palette, const SkinningStreams<T> &streams, index_t first)
+{
+    constexpr size_t W = SimdT::WIDTH;
+    const T *base = palette->data();
+    const uint16 *indices = streams.bone_indices + first * K;
+    const T *weights = streams.bone_weights + first * K;
+
+    SimdT acc[8];
+    SimdT first_real[4];
+
+    for (index_t k = 0; k < K; ++k)
+    {
+        uint32 lanes[W];
+        for (index_t l = 0; l < W; ++l)
+            lanes[l] = indices[l * K + k];
+
+        SimdT q[8];
+        for (index_t c = 0; c < 8; ++c)
+            q[c] = SimdT::gather(base + c, lanes, 8);
+
+        SimdT weight = SimdT::loadStrided(weights + k, K);
+        if (k == 0)
+        {
+            for (index_t c = 0; c < 4; ++c)
+                first_real[c] = q[c];
+            for (index_t c = 0; c < 8; ++c)
+                acc[c] = q[c] * weight;
+        }
+        else
+        {
+            // Blend along the shortest path, q and -q encode the same transform
+            SimdT d = q[0] * first_real[0];
+            d = fmadd(q[1], first_real[1], d);
+            d = fmadd(q[2], first_real[2], d);
+            d = fmadd(q[3], first_real[3], d);
+            weight = select(d < SimdT::broadcast(0), -weight, weight);
+
+            for (index_t c = 0; c < 8; ++c)
+                acc[c] = fmadd(q[c], weight, acc[c]);
+        }
+    }
+
+    SimdT length2 = acc[0] * acc[0];
+    length2 = fmadd(acc[1], acc[1], length2);
+    length2 = fmadd(acc[2], acc[2], length2);
+    length2 = fmadd(acc[3], acc[3], length2);
+    const SimdT inv_length = SimdT::broadcast(1) / sqrt(length2);
+    for (index_t c = 0; c < 8; ++c)
+        acc[c] = acc[c] * inv_length;
+
+    const SimdT &rw = acc[0];
+    const SimdT &dw = acc[4];
+    simd::SimdVector3<SimdT> ru { acc[1], acc[2], acc[3] };
+    simd::SimdVector3<SimdT> du { acc[5], acc[6], acc[7] };
+
+    if (!streams.positions.empty())
+    {
+        // translation = 2 * (rw * du - dw * ru + ru x du)
+        const SimdT two = SimdT::broadcast(2);
+        simd::SimdVector3<SimdT> rd = simd::cross(ru, du);
+        simd::SimdVector3<SimdT> p = simd::rotate(rw, ru, simd::loadVector3<SimdT>(streams.positions, first));
+        p.x = fmadd(two, fnmadd(dw, ru.x, fmadd(rw, du.x, rd.x)), p.x);
+        p.y = fmadd(two, fnmadd(dw, ru.y, fmadd(rw, du.y, rd.y)), p.y);
+        p.z = fmadd(two, fnmadd(dw, ru.z, fmadd(rw, du.z, rd.z)), p.z);
+        simd::storeVector3(p, streams.skinned_positions, first);
+    }
+
+    if (!streams.normals.empty())
+    {
+        simd::SimdVector3<SimdT> n = simd::rotate(rw, ru, simd::loadVector3<SimdT>(streams.normals, first));
+        simd::storeVector3(n, streams.skinned_normals, first);
+    }
+}
+
+// Element offsets of the upper 3x4 part of a palette entry
+struct Matrix4PaletteLayout
+{
+    static constexpr size_t STRIDE = 16;
+
+    static constexpr size_t offset(size_t row, size_t column)
+    {
+        return column * 4 + row;
+    }
+};
+
+struct Matrix3x4PaletteLayout
+{
+    static constexpr size_t STRIDE = 12;
+
+    static constexpr size_t offset(size_t row, size_t column)
+    {
+        return row * 4 + column;
+    }
+};
+
+template<size_t K, typename Layout, typename SimdT, typename T>
+FMATH_INLINE void skinLinearBlock(const T *palette, const SkinningStreams<T> &streams, index_t first)
+{
+    constexpr size_t W = SimdT::WIDTH;
+    const uint16 *indices = streams.bone_indices + first * K;
+    const T *weights = streams.bone_weights + first * K;
+
+    // Rows 0..2 of the blended matrix, the last row of an affine bone is always (0, 0, 0, 1)
+    SimdT m[3][4];
+
+    for (index_t k = 0; k < K; ++k)
+    {
+        uint32 lanes[W];
+        for (index_t l = 0; l < W; ++l)
+            lanes[l] = indices[l * K + k];
+
+        const SimdT weight = SimdT::loadStrided(weights + k, K);
+        for (index_t r = 0; r < 3; ++r)
+        {
+            for (index_t c = 0; c < 4; ++c)
+            {
+                SimdT e = SimdT::gather(palette + Layout::offset(r, c), lanes, Layout::STRIDE);
+                m[r][c] = k == 0 ? e * weight : fmadd(e, weight, m[r][c]);
+            }
+        }
+    }
+
+    if (!streams.positions.empty())
+    {
+        simd::SimdVector3<SimdT> p = simd::loadVector3<SimdT>(streams.positions, first);
+        simd::SimdVector3<SimdT> result {
+            fmadd(m[0][0], p.x, fmadd(m[0][1], p.y, fmadd(m[0][2], p.z, m[0][3]))),
+            fmadd(m[1][0], p.x, fmadd(m[1][1], p.y, fmadd(m[1][2], p.z, m[1][3]))),
+            fmadd(m[2][0], p.x, fmadd(m[2][1], p.y, fmadd(m[2][2], p.z, m[2][3])))
+        };
+        simd::storeVector3(result, streams.skinned_positions, first);
+    }
+
+    if (!streams.normals.empty())
+    {
+        simd::SimdVector3<SimdT> n = simd::loadVector3<SimdT>(streams.normals, first);
+        simd::SimdVector3<SimdT> result {
+            fmadd(m[0][0], n.x, fmadd(m[0][1], n.y, m[0][2] * n.z)),
+            fmadd(m[1][0], n.x, fmadd(m[1][1], n.y, m[1][2] * n.z)),
+            fmadd(m[2][0], n.x, fmadd(m[2][1], n.y, m[2][2] * n.z))
+        };
+        simd::storeVector3(result, streams.skinned_normals, first);
+    }
+}
+
+}
+
+// Dual quaternion linear blending (Kavan et al. 2007) with K influences per vertex
+template<size_t K, typename T>
+void skinDualQuat(const DualQuat<T> *palette, const SkinningStreams<T> &streams)
+{
+    static_assert(K >= 1 && K <= 4, "Dual quaternion skinning supports up to 4 influences");
+    FMATH_ASSERT(palette != nullptr && streams.bone_indices != nullptr && streams.bone_weights != nullptr);
+
+    internal::parallelForSimd<internal::simd::NativeSimd<T>>(streams.count, internal::SKINNING_GRAIN_SIZE, [&](auto tag, index_t i)
+    {
+        using SimdT = decltype(tag);
+        internal::skinDualQuatBlock<K, SimdT>(palette, streams, i);
+    });
+}
+
+// Linear blend skinning with K influences per vertex. Bones are expected to be affine, normals are
+// transformed by the blended upper 3x3 and are not renormalized.
+template<size_t K, typename T>
+void skinLinear(const Matrix4<T> *palette, const SkinningStreams<T> &streams)
+{
+    static_assert(K == 1 || K == 2 || K == 4 || K == 8, "Linear blend skinning supports 1, 2, 4 or 8 influences");
+    static_assert(sizeof(Matrix4<T>) == sizeof(T) * 16, "Matrix4 palette must be tightly packed");
+    FMATH_ASSERT(palette != nullptr && streams.bone_indices != nullptr && streams.bone_weights != nullptr);
+
+    const T *data = palette->data();
+    internal::parallelForSimd<internal::simd::NativeSimd<T>>(streams.count, internal::SKINNING_GRAIN_SIZE, [&](auto tag, index_t i)
+    {
+        using SimdT = decltype(tag);
+        internal::skinLinearBlock<K, internal::Matrix4PaletteLayout, SimdT>(data, streams, i);
+    });
+}
+
+// Same as above for a palette of row-major 3x4 matrices (12 elements each), the usual GPU upload format
+template<size_t K, typename T>
+void skinLinear(const T *palette, const SkinningStreams<T> &streams)
+{
+    static_assert(K == 1 || K == 2 || K == 4 || K == 8, "Linear blend skinning supports 1, 2, 4 or 8 influences");
+    FMATH_ASSERT(palette != nullptr && streams.bone_indices != nullptr && streams.bone_weights != nullptr);
+
+    internal::parallelForSimd<internal::simd::NativeSimd<T>>(streams.count, internal::SKINNING_GRAIN_SIZE, [&](auto tag, index_t i)
+    {
+        using SimdT = decltype(tag);
+        internal::skinLinearBlock<K, internal::Matrix3x4PaletteLayout, SimdT>(palette, streams, i);
+    });
+}
+
+// Blends the K influences of a single vertex, mostly useful for attachments and debugging
+template<size_t K, typename T>
+FMATH_INLINE DualQuat<T> blendDualQuat(const DualQuat<T> *palette, const uint16 *bone_indices, const T *bone_weights)
+{
+    const Quat<T> &pivot = palette[bone_indices[0]].real;
+    DualQuat<T> result = palette[bone_indices[0]] * bone_weights[0];
+    for (index_t k = 1; k < K; ++k)
+    {
+        const DualQuat<T> &q = palette[bone_indices[k]];
+        T weight = dot(q.real, pivot) < static_cast<T>(0) ? -bone_weights[k] : bone_weights[k];
+        result += q * weight;
+    }
+    return normalize(result);
+}
+
+}
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef _FMATH_SPATIAL_HASH_H_
+#define _FMATH_SPATIAL_HASH_H_
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "common.h"
+#include "morton.h"
+#include "point.h"
+#include "sphere.h"
+
+namespace fmath
+{
+
+// Uniform grid of cubic cells over points or spheres, hashed into a table with about one bucket per item, so that the
+// world needs no bounds. Rebuilt from scratch every time by a counting sort of the items by bucket. Blocks of 4x4x4
+// cells hash to runs of consecutive buckets in Morton order, which keeps neighboring cells in the same cache lines.
+// Items sharing a bucket but not a cell are told apart by their cell coordinates. Queries visit every cell they
+// cover, a cell size near the query radius, or the largest sphere diameter, works best.
+template<typename T>
+class SpatialHashGrid
+{
+public:
+    using ValueType = T;
+    using PairType = std::pair<uint32, uint32>;
+
+public:
+    SpatialHashGrid() = default;
+
+    explicit SpatialHashGrid(ValueType cell_size);
+
+    // Replaces the content with points, or with spheres whose radii the queries account for
+    void build(const Point3<ValueType> *points, size_t count);
+
+    void build(const Sphere3<ValueType> *spheres, size_t count);
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE size_t size() const;
+
+    FMATH_INLINE ValueType cellSize() const;
+
+    // Calls func(index) for every point inside the sphere or every sphere overlapping it, touching included
+    template<typename FunctionT>
+    void query(const Sphere3<ValueType> &sphere, FunctionT &&func) const;
+
+    // Appends the indices found to indices
+    void query(const Sphere3<ValueType> &sphere, std::vector<uint32> &indices) const;
+
+    // Every pair of items with at most distance between them once, the smaller index first. The order only depends
+    // on the content, not on the number of threads.
+    void findPairs(ValueType distance, std::vector<PairType> &pairs) const;
+
+    // Every pair of overlapping spheres, findPairs with a distance of 0
+    void findOverlaps(std::vector<PairType> &pairs) const;
+
+private:
+    template<typename PositionT>
+    void buildCells(size_t count, PositionT &&position);
+
+    FMATH_INLINE Point3i cellOf(const Point3<ValueType> &point) const;
+
+    FMATH_INLINE uint32 bucketOf(const Point3i &cell) const;
+
+    FMATH_INLINE ValueType radius(index_t slot) const;
+
+private:
+    ValueType cell_size_ = static_cast<ValueType>(1);
+    ValueType inv_cell_size_ = static_cast<ValueType>(1);
+    ValueType max_radius_ = static_cast<ValueType>(0);
+    uint32 shift_ = 31;
+    uint32 block_bits_ = 0;
+    // Items in bucket order, bucket b holds the slots [starts_[b], starts_[b + 1])
+    std::vector<uint32> starts_;
+    std::vector<uint32> indices_;
+    std::vector<Point3<ValueType>> positions_;
+    std::vector<Point3i> cells_;
+    std::vector<ValueType> radii_;
+};
+
+using SpatialHashGridf = SpatialHashGrid<float>;
+using SpatialHashGridlf = SpatialHashGrid<double>;
+
+namespace internal
+{
+
+constexpr size_t SPATIAL_HASH_GRAIN_SIZE = 16384;
+
+// Cells further away than this from the origin are clamped, which only costs extra candidates
+constexpr int32 MAX_GRID_CELL = 1 << 30;
+
+}
+
+template<typename T>
+SpatialHashGrid<T>::SpatialHashGrid(ValueType cell_size)
+    :   cell_size_(cell_size),
+        inv_cell_size_(static_cast<ValueType>(1) / cell_size)
+{
+    FMATH_ASSERT(cell_size > static_cast<ValueType>(0));
+}
+
+template<typename T>
+void SpatialHashGrid<T>::build(const Point3<ValueType> *points, size_t count)
+{
+    buildCells(count, [points](index_t i) -> const Point3<ValueType> & { return points[i]; });
+    radii_.clear();
+    max_radius_ = static_cast<ValueType>(0);
+}
+
+template<typename T>
+void SpatialHashGrid<T>::build(const Sphere3<ValueType> *spheres, size_t count)
+{
+    buildCells(count, [spheres](index_t i) -> const Point3<ValueType> & { return spheres[i].center(); });
+    radii_.resize(count);
+    const size_t chunk_count = (count + internal::SPATIAL_HASH_GRAIN_SIZE - 1) / internal::SPATIAL_HASH_GRAIN_SIZE;
+    std::vector<ValueType> chunk_radii(chunk_count, static_cast<ValueType>(0));
+    internal::parallelForChunks(count, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            radii_[i] = spheres[indices_[i]].radius();
+            chunk_radii[chunk] = max(chunk_radii[chunk], radii_[i]);
+        }
+    });
+
+    max_radius_ = static_cast<ValueType>(0);
+    for (ValueType r : chunk_radii)
+        max_radius_ = max(max_radius_, r);
+}
+
+template<typename T>
+FMATH_INLINE bool SpatialHashGrid<T>::empty() const
+{
+    return indices_.empty();
+}
+
+template<typename T>
+FMATH_INLINE size_t SpatialHashGrid<T>::size() const
+{
+    return indices_.size();
+}
+
+template<typename T>
+FMATH_INLINE T SpatialHashGrid<T>::cellSize() const
+{
+    return cell_size_;
+}
+
+template<typename T>
+    template<typename FunctionT>
+void SpatialHashGrid<T>::query(const Sphere3<ValueType> &sphere, FunctionT &&func) const
+{
+    if (empty())
+        return;
+
+    const Point3<ValueType> &center = sphere.center();
+    const ValueType reach = sphere.radius() + max_radius_;
+    const Point3i lower = cellOf(center - reach);
+    const Point3i upper = cellOf(center + reach);
+    const auto test = [&](index_t slot)
+    {
+        const ValueType limit = sphere.radius() + radius(slot);
+        if (distance2(positions_[slot], center) <= limit * limit)
+            func(indices_[slot]);
+    };
+
+    // Past one cell per item scanning everything is cheaper
+    const uint64 cell_count = static_cast<uint64>(upper[0] - lower[0] + 1) *
+        static_cast<uint64>(upper[1] - lower[1] + 1) * static_cast<uint64>(upper[2] - lower[2] + 1);
+    if (cell_count > size())
+    {
+        for (index_t slot = 0; slot < size(); ++slot)
+            test(slot);
+        return;
+    }
+
+    for (int32 z = lower[2]; z <= upper[2]; ++z)
+    {
+        for (int32 y = lower[1]; y <= upper[1]; ++y)
+        {
+            for (int32 x = lower[0]; x <= upper[0]; ++x)
+            {
+                const Point3i cell(x, y, z);
+                const uint32 bucket = bucketOf(cell);
+                for (index_t slot = starts_[bucket]; slot < starts_[bucket + 1]; ++slot)
+                {
+                    if (cells_[slot] == cell)
+                        test(slot);
+                }
+            }
+        }
+    }
+}
+
+template<typename T>
+void SpatialHashGrid<T>::query(const Sphere3<ValueType> &sphere, std::vector<uint32> &indices) const
+{
+    query(sphere, [&indices](uint32 index) { indices.push_back(index); });
+}
+
+// Slots with the same cell next to each other form a run sharing the neighbor lookups. Pairs inside a cell are
+// found from the earlier slot, pairs across cells from the cell whose neighbor lies in the upper half of the
+// neighborhood, so every pair is seen once. Runs are split between chunks by their first slot.
+template<typename T>
+void SpatialHashGrid<T>::findPairs(ValueType distance, std::vector<PairType> &pairs) const
+{
+    pairs.clear();
+    const size_t count = size();
+    if (count < 2)
+        return;
+
+    const ValueType reach = distance + static_cast<ValueType>(2) * max_radius_;
+    const size_t chunk_count = (count + internal::SPATIAL_HASH_GRAIN_SIZE - 1) / internal::SPATIAL_HASH_GRAIN_SIZE;
+    std::vector<std::vector<PairType>> chunk_pairs(chunk_count);
+    internal::parallelForChunks(count, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+    {
+        std::vector<PairType> &found = chunk_pairs[chunk];
+        const auto test = [&](index_t a, index_t b)
+        {
+            const ValueType limit = distance + radius(a) + radius(b);
+            if (distance2(positions_[a], positions_[b]) <= limit * limit)
+            {
+                const uint32 i = indices_[a];
+                const uint32 j = indices_[b];
+                found.emplace_back(min(i, j), max(i, j));
+            }
+        };
+
+        index_t run_begin = begin;
+        while (run_begin != 0 && run_begin < end && cells_[run_begin] == cells_[run_begin - 1])
+            ++run_begin;
+        while (run_begin < end)
+        {
+            const Point3i cell = cells_[run_begin];
+            index_t run_end = run_begin + 1;
+            while (run_end < count && cells_[run_end] == cell)
+                ++run_end;
+
+            const uint32 bucket = bucketOf(cell);
+            Point3<ValueType> lower = positions_[run_begin];
+            Point3<ValueType> upper = positions_[run_begin];
+            for (index_t a = run_begin; a < run_end; ++a)
+            {
+                lower = componentWiseMin(lower, positions_[a]);
+                upper = componentWiseMax(upper, positions_[a]);
+                for (index_t b = a + 1; b < starts_[bucket + 1]; ++b)
+                {
+                    if (cells_[b] == cell)
+                        test(a, b);
+                }
+            }
+
+            // Only the upper half of the cells within reach of the items in the run
+            const Point3i lower_cell = cellOf(lower - reach);
+            const Point3i upper_cell = cellOf(upper + reach);
+            for (int32 z = cell[2]; z <= upper_cell[2]; ++z)
+            {
+                for (int32 y = z == cell[2] ? cell[1] : lower_cell[1]; y <= upper_cell[1]; ++y)
+                {
+                    for (int32 x = z == cell[2] && y == cell[1] ? cell[0] + 1 : lower_cell[0]; x <= upper_cell[0]; ++x)
+                    {
+                        const Point3i neighbor(x, y, z);
+                        const uint32 neighbor_bucket = bucketOf(neighbor);
+                        for (index_t b = starts_[neighbor_bucket]; b < starts_[neighbor_bucket + 1]; ++b)
+                        {
+                            if (cells_[b] != neighbor)
+                                continue;
+                            for (index_t a = run_begin; a < run_end; ++a)
+                                test(a, b);
+                        }
+                    }
+                }
+            }
+            run_begin = run_end;
+        }
+    });
+
+    size_t total = 0;
+    for (const auto &found : chunk_pairs)
+        total += found.size();
+    pairs.reserve(total);
+    for (const auto &found : chunk_pairs)
+        pairs.insert(pairs.end(), found.begin(), found.end());
+}
+
+template<typename T>
+void SpatialHashGrid<T>::findOverlaps(std::vector<PairType> &pairs) const
+{
+    findPairs(static_cast<ValueType>(0), pairs);
+}
+
+template<typename T>
+    template<typename PositionT>
+void SpatialHashGrid<T>::buildCells(size_t count, PositionT &&position)
+{
+    starts_.clear();
+    indices_.clear();
+    positions_.clear();
+    cells_.clear();
+    if (count == 0)
+        return;
+
+    FMATH_ASSERT(count <= static_cast<size_t>(~0U));
+    uint32 table_bits = 1;
+    while ((static_cast<size_t>(1) << table_bits) < count && table_bits < 31)
+        ++table_bits;
+    block_bits_ = min((table_bits - 1) / 3, 2U);
+    shift_ = 32 - (table_bits - 3 * block_bits_);
+    const size_t table_size = static_cast<size_t>(1) << table_bits;
+
+    std::vector<uint32> buckets(count);
+    std::vector<Point3i> cells(count);
+    indices_.resize(count);
+    internal::parallelFor(0, count, internal::SPATIAL_HASH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            cells[i] = cellOf(position(i));
+            buckets[i] = bucketOf(cells[i]);
+            indices_[i] = static_cast<uint32>(i);
+        }
+    });
+    internal::parallelRadixSort(buckets.data(), indices_.data(), count, table_bits);
+
+    // Every slot opens the empty buckets between its predecessor's bucket and its own
+    positions_.resize(count);
+    cells_.resize(count);
+    starts_.resize(table_size + 1);
+    internal::parallelFor(0, count, internal::SPATIAL_HASH_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t slot = begin; slot < end; ++slot)
+        {
+            positions_[slot] = position(indices_[slot]);
+            cells_[slot] = cells[indices_[slot]];
+            const size_t first = slot == 0 ? 0 : static_cast<size_t>(buckets[slot - 1]) + 1;
+            for (size_t bucket = first; bucket <= buckets[slot]; ++bucket)
+                starts_[bucket] = static_cast<uint32>(slot);
+        }
+    });
+    for (size_t bucket = static_cast<size_t>(buckets[count - 1]) + 1; bucket <= table_size; ++bucket)
+        starts_[bucket] = static_cast<uint32>(count);
+}
+
+template<typename T>
+FMATH_INLINE Point3i SpatialHashGrid<T>::cellOf(const Point3<ValueType> &point) const
+{
+    constexpr ValueType LIMIT = static_cast<ValueType>(internal::MAX_GRID_CELL);
+    Point3i cell;
+    for (index_t k = 0; k < 3; ++k)
+    {
+        // NaN coordinates end up in the lowest cell
+        const ValueType value = std::floor(point[k] * inv_cell_size_);
+        cell[k] = static_cast<int32>(value > -LIMIT ? (value < LIMIT ? value : LIMIT) : -LIMIT);
+    }
+    return cell;
+}
+
+// The block is hashed as in Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable
+// Objects", with a Fibonacci multiply so that the top bits mix all three coordinates
+template<typename T>
+FMATH_INLINE uint32 SpatialHashGrid<T>::bucketOf(const Point3i &cell) const
+{
+    const uint32 mask = (1U << block_bits_) - 1;
+    const uint32 x = static_cast<uint32>(cell[0]);
+    const uint32 y = static_cast<uint32>(cell[1]);
+    const uint32 z = static_cast<uint32>(cell[2]);
+    const uint32 hash = ((x >> block_bits_) * 73856093U) ^ ((y >> block_bits_) * 19349663U) ^
+        ((z >> block_bits_) * 83492791U);
+    return ((hash * 0x9E3779B1U) >> shift_ << (3 * block_bits_)) | encodeMorton32(x & mask, y & mask, z & mask);
+}
+
+template<typename T>
+FMATH_INLINE T SpatialHashGrid<T>::radius(index_t slot) const
+{
+    return radii_.empty() ? static_cast<ValueType>(0) : radii_[slot];
+}
+
+}
+
+#endif
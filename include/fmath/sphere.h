@@ -40,6 +40,8 @@ public:
 
     FMATH_INLINE FMATH_CONSTEXPR bool overlaps(const Sphere &other) const;
 
+    FMATH_INLINE FMATH_CONSTEXPR bool overlaps(const Box<ValueType, N> &box) const;
+
     FMATH_INLINE void setCenter(const Point<ValueType, N> &center);
 
     FMATH_INLINE void setRadius(const ValueType &radius);
@@ -192,6 +194,20 @@ FMATH_INLINE FMATH_CONSTEXPR bool Sphere<T, N>::overlaps(const Sphere &other) co
     return distance2(*this, other) <= (radius_ + other.radius_) * (radius_ + other.radius_);
 }
 
+template<typename T, size_t N>
+FMATH_INLINE FMATH_CONSTEXPR bool Sphere<T, N>::overlaps(const Box<ValueType, N> &box) const
+{
+    // Squared distance from the center to the closest point of the box
+    T d2 = static_cast<T>(0);
+    for (index_t i = 0; i < N; ++i)
+    {
+        const T d = center_[i] < box.min()[i] ? box.min()[i] - center_[i] :
+            (center_[i] > box.max()[i] ? center_[i] - box.max()[i] : static_cast<T>(0));
+        d2 += d * d;
+    }
+    return d2 <= radius_ * radius_;
+}
+
 template<typename T, size_t N>
 FMATH_INLINE void Sphere<T, N>::setCenter(const Point<T, N> &center)
 {
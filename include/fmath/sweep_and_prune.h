@@ -0,0 +1,277 @@
+#ifndef _FMATH_SWEEP_AND_PRUNE_H_
+#define _FMATH_SWEEP_AND_PRUNE_H_
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "internal/simd.h"
+#include "box.h"
+#include "common.h"
+
+namespace fmath
+{
+
+// Sweep-and-prune broadphase over boxes. The boxes are kept sorted by their lower bound on the axis their centers
+// spread most along, with each of the six bounds in its own array in that order, so that the sweep tests a SIMD block
+// of candidates at a time. Moving boxes leave the order nearly sorted between frames and update restores it by
+// insertion sort in close to linear time. Pairs come from a parallel sweep appending to one shared buffer.
+template<typename T>
+class SweepAndPrune
+{
+public:
+    using ValueType = T;
+    using PairType = std::pair<uint32, uint32>;
+
+public:
+    SweepAndPrune() = default;
+
+    // Replaces the boxes, picks the sweep axis and sorts from scratch
+    void build(const Box3<ValueType> *boxes, size_t count);
+
+    // New bounds of the boxes of the last build, in the same order. The sweep axis stays, boxes that moved too far
+    // for the insertion sort to pay off get a full sort.
+    void update(const Box3<ValueType> *boxes, size_t count);
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE size_t size() const;
+
+    FMATH_INLINE index_t axis() const;
+
+    // Every pair of overlapping boxes once, touching included, the smaller index first. The pairs come in the order
+    // the threads find them. They are gathered in a buffer of the calling thread that only grows, so that frames
+    // after the first neither allocate nor clear it, and only the pairs found are copied out.
+    void findPairs(std::vector<PairType> &pairs) const;
+
+private:
+    using SimdT = internal::simd::NativeSimd<ValueType>;
+
+    void sort(const Box3<ValueType> *boxes);
+
+    // Gathers the bounds in sorted order
+    void gather(const Box3<ValueType> *boxes);
+
+private:
+    index_t axis_ = 0;
+    std::vector<uint32> order_;
+    // Padded by a SIMD block of NaNs, which fail every comparison and so end every sweep, even of unbounded boxes
+    std::vector<ValueType> min_[3];
+    std::vector<ValueType> max_[3];
+};
+
+using SweepAndPrunef = SweepAndPrune<float>;
+using SweepAndPrunelf = SweepAndPrune<double>;
+
+namespace internal
+{
+
+constexpr size_t SWEEP_AND_PRUNE_GRAIN_SIZE = 1024;
+constexpr size_t SWEEP_AND_PRUNE_BLOCK_SIZE = 256;
+// Average number of places a box may move per update before the insertion sort gives way to a full sort
+constexpr size_t SWEEP_AND_PRUNE_MAX_MOVES = 16;
+
+}
+
+template<typename T>
+void SweepAndPrune<T>::build(const Box3<ValueType> *boxes, size_t count)
+{
+    // Sweeping along the axis of the largest spread leaves the fewest candidates per box
+    ValueType sum[3] = {};
+    ValueType sum2[3] = {};
+    for (index_t i = 0; i < count; ++i)
+    {
+        for (index_t k = 0; k < 3; ++k)
+        {
+            const ValueType center = boxes[i].min()[k] + boxes[i].max()[k];
+            sum[k] += center;
+            sum2[k] += center * center;
+        }
+    }
+
+    axis_ = 0;
+    const ValueType n = static_cast<ValueType>(max(count, static_cast<size_t>(1)));
+    ValueType best = sum2[0] - sum[0] * sum[0] / n;
+    for (index_t k = 1; k < 3; ++k)
+    {
+        const ValueType variance = sum2[k] - sum[k] * sum[k] / n;
+        if (variance > best)
+        {
+            best = variance;
+            axis_ = k;
+        }
+    }
+
+    order_.resize(count);
+    for (index_t k = 0; k < 3; ++k)
+    {
+        min_[k].resize(count + SimdT::WIDTH);
+        max_[k].resize(count + SimdT::WIDTH);
+    }
+
+    for (index_t i = 0; i < count; ++i)
+        order_[i] = static_cast<uint32>(i);
+    sort(boxes);
+    gather(boxes);
+}
+
+template<typename T>
+void SweepAndPrune<T>::update(const Box3<ValueType> *boxes, size_t count)
+{
+    FMATH_ASSERT(count == size());
+    std::vector<ValueType> &keys = min_[axis_];
+    internal::parallelFor(0, count, internal::SWEEP_AND_PRUNE_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            keys[i] = boxes[order_[i]].min()[axis_];
+    });
+
+    const size_t max_moves = count * internal::SWEEP_AND_PRUNE_MAX_MOVES;
+    size_t moves = 0;
+    for (index_t i = 1; i < count && moves <= max_moves; ++i)
+    {
+        const ValueType key = keys[i];
+        const uint32 index = order_[i];
+        index_t j = i;
+        for (; j > 0 && keys[j - 1] > key; --j)
+        {
+            keys[j] = keys[j - 1];
+            order_[j] = order_[j - 1];
+        }
+        keys[j] = key;
+        order_[j] = index;
+        moves += i - j;
+    }
+
+    if (moves > max_moves)
+        sort(boxes);
+    gather(boxes);
+}
+
+template<typename T>
+FMATH_INLINE bool SweepAndPrune<T>::empty() const
+{
+    return order_.empty();
+}
+
+template<typename T>
+FMATH_INLINE size_t SweepAndPrune<T>::size() const
+{
+    return order_.size();
+}
+
+template<typename T>
+FMATH_INLINE index_t SweepAndPrune<T>::axis() const
+{
+    return axis_;
+}
+
+template<typename T>
+void SweepAndPrune<T>::findPairs(std::vector<PairType> &pairs) const
+{
+    constexpr size_t W = SimdT::WIDTH;
+    constexpr uint32 FULL = W == 32 ? ~0U : (1U << W) - 1U;
+    const size_t count = size();
+    pairs.clear();
+    if (count < 2)
+        return;
+
+    const index_t s = axis_;
+    const index_t a = (axis_ + 1) % 3;
+    const index_t b = (axis_ + 2) % 3;
+    thread_local std::vector<PairType> storage;
+    size_t capacity = max(storage.size(), count);
+    for (;;)
+    {
+        if (storage.size() < capacity)
+            storage.resize(capacity);
+        internal::AppendBuffer<PairType> buffer(storage.data(), capacity);
+        internal::parallelFor(0, count, internal::SWEEP_AND_PRUNE_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            PairType block[internal::SWEEP_AND_PRUNE_BLOCK_SIZE];
+            size_t block_size = 0;
+            for (index_t i = begin; i < end; ++i)
+            {
+                const SimdT max_s = SimdT::broadcast(max_[s][i]);
+                const SimdT min_a = SimdT::broadcast(min_[a][i]);
+                const SimdT max_a = SimdT::broadcast(max_[a][i]);
+                const SimdT min_b = SimdT::broadcast(min_[b][i]);
+                const SimdT max_b = SimdT::broadcast(max_[b][i]);
+                for (index_t j = i + 1;; j += W)
+                {
+                    // Sorted lower bounds, the candidates are a prefix of the lanes
+                    const uint32 candidates = internal::simd::bitmask(SimdT::load(&min_[s][j]) <= max_s);
+                    const uint32 hits = candidates & internal::simd::bitmask(
+                        (SimdT::load(&min_[a][j]) <= max_a) & (SimdT::load(&max_[a][j]) >= min_a) &
+                        (SimdT::load(&min_[b][j]) <= max_b) & (SimdT::load(&max_[b][j]) >= min_b));
+                    for (index_t l = 0; hits != 0 && l < W; ++l)
+                    {
+                        if ((hits >> l & 1U) == 0)
+                            continue;
+
+                        const uint32 first = order_[i];
+                        const uint32 second = order_[j + l];
+                        block[block_size++] = first < second ? PairType(first, second) : PairType(second, first);
+                        if (block_size == internal::SWEEP_AND_PRUNE_BLOCK_SIZE)
+                        {
+                            buffer.append(block, block_size);
+                            block_size = 0;
+                        }
+                    }
+
+                    if (candidates != FULL)
+                        break;
+                }
+            }
+            buffer.append(block, block_size);
+        });
+
+        if (!buffer.overflowed())
+        {
+            pairs.assign(storage.begin(), storage.begin() + buffer.size());
+            return;
+        }
+        capacity = buffer.size();
+    }
+}
+
+template<typename T>
+void SweepAndPrune<T>::sort(const Box3<ValueType> *boxes)
+{
+    const index_t axis = axis_;
+    std::sort(order_.begin(), order_.end(), [boxes, axis](uint32 i, uint32 j)
+    {
+        return boxes[i].min()[axis] < boxes[j].min()[axis];
+    });
+}
+
+template<typename T>
+void SweepAndPrune<T>::gather(const Box3<ValueType> *boxes)
+{
+    const size_t count = size();
+    internal::parallelFor(0, count, internal::SWEEP_AND_PRUNE_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+        {
+            const Box3<ValueType> &box = boxes[order_[i]];
+            for (index_t k = 0; k < 3; ++k)
+            {
+                min_[k][i] = box.min()[k];
+                max_[k][i] = box.max()[k];
+            }
+        }
+    });
+
+    const ValueType padding = std::numeric_limits<ValueType>::quiet_NaN();
+    for (index_t k = 0; k < 3; ++k)
+    {
+        std::fill(min_[k].begin() + count, min_[k].end(), padding);
+        std::fill(max_[k].begin() + count, max_[k].end(), padding);
+    }
+}
+
+}
+
+#endif
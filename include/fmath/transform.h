@@ -279,6 +279,187 @@ FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> lookAt(const Point3<T> &eye, const Point
     );
 }
 
+// Builds the view matrix and its inverse (the camera to world matrix) together
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR void lookAt(const Point3<T> &eye, const Point3<T> &target, const Vector3<T> &up,
+    Matrix4<T> &view, Matrix4<T> &inverse_view)
+{
+    Vector3<T> w = normalize(target - eye);
+    Vector3<T> u = normalize(cross(w, up));
+    Vector3<T> v = cross(u, w);
+
+    const Vector3<T> &e = reinterpret_cast<const Vector3<T> &>(eye);
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+
+    view = Matrix4<T>(
+        u[0], v[0], -w[0], zero,
+        u[1], v[1], -w[1], zero,
+        u[2], v[2], -w[2], zero,
+        -dot(u, e), -dot(v, e), dot(w, e), one
+    );
+
+    inverse_view = Matrix4<T>(
+        u[0], u[1], u[2], zero,
+        v[0], v[1], v[2], zero,
+        -w[0], -w[1], -w[2], zero,
+        e[0], e[1], e[2], one
+    );
+}
+
+// Inverse of a matrix whose upper 3x3 is a rotation and whose last row is (0, 0, 0, 1)
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> inverseRigid(const Matrix4<T> &m)
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    const T tx = m[3][0], ty = m[3][1], tz = m[3][2];
+
+    return Matrix4<T>(
+        m[0][0], m[1][0], m[2][0], zero,
+        m[0][1], m[1][1], m[2][1], zero,
+        m[0][2], m[1][2], m[2][2], zero,
+        -(m[0][0] * tx + m[0][1] * ty + m[0][2] * tz),
+        -(m[1][0] * tx + m[1][1] * ty + m[1][2] * tz),
+        -(m[2][0] * tx + m[2][1] * ty + m[2][2] * tz),
+        one
+    );
+}
+
+// Same as inverseRigid for a rotation combined with a uniform scale, (s * R)^-1 = (s * R)^T / s^2
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> inverseRigidScale(const Matrix4<T> &m)
+{
+    const T inv_scale2 = static_cast<T>(1) / (m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2]);
+    Matrix4<T> r = inverseRigid(m);
+    r[0] *= inv_scale2;
+    r[1] *= inv_scale2;
+    r[2] *= inv_scale2;
+    r[3][0] *= inv_scale2;
+    r[3][1] *= inv_scale2;
+    r[3][2] *= inv_scale2;
+    return r;
+}
+
+// Inverse of a matrix whose last row is (0, 0, 0, 1), only the 3x3 part needs a general inverse
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> inverseAffine(const Matrix4<T> &m)
+{
+    const Matrix3<T> linv = inverse(Matrix3<T>(
+        m[0][0], m[0][1], m[0][2],
+        m[1][0], m[1][1], m[1][2],
+        m[2][0], m[2][1], m[2][2]
+    ));
+    const Vector3<T> t = -(linv * Vector3<T>(m[3][0], m[3][1], m[3][2]));
+    const T zero = static_cast<T>(0);
+
+    return Matrix4<T>(
+        linv[0][0], linv[0][1], linv[0][2], zero,
+        linv[1][0], linv[1][1], linv[1][2], zero,
+        linv[2][0], linv[2][1], linv[2][2], zero,
+        t[0], t[1], t[2], static_cast<T>(1)
+    );
+}
+
+// Gram-Schmidt on the columns, the first column keeps its direction and the handedness is preserved
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix3<T> orthonormalize(const Matrix3<T> &m)
+{
+    Vector3<T> c0 = normalize(Vector3<T>(m[0][0], m[0][1], m[0][2]));
+    Vector3<T> c1 = Vector3<T>(m[1][0], m[1][1], m[1][2]);
+    Vector3<T> c2 = Vector3<T>(m[2][0], m[2][1], m[2][2]);
+
+    c1 = normalize(c1 - c0 * dot(c0, c1));
+    c2 = normalize(c2 - c0 * dot(c0, c2) - c1 * dot(c1, c2));
+
+    return Matrix3<T>(
+        c0[0], c0[1], c0[2],
+        c1[0], c1[1], c1[2],
+        c2[0], c2[1], c2[2]
+    );
+}
+
+// Conservative description of what a Transform may contain. The kind of a product is the union of the
+// kinds of its factors, so a flag being set does not guarantee the matrix actually has that component.
+enum class TransformKind : uint8
+{
+    Identity = 0x00,
+    Translation = 0x01,
+    UniformScale = 0x02,
+    Rotation = 0x04,
+    Affine = 0x08,
+    Projective = 0x10,
+
+    Rigid = Translation | Rotation,
+    Similarity = Translation | Rotation | UniformScale
+};
+
+FMATH_INLINE FMATH_CONSTEXPR TransformKind operator|(TransformKind k1, TransformKind k2)
+{
+    return static_cast<TransformKind>(static_cast<uint8>(k1) | static_cast<uint8>(k2));
+}
+
+FMATH_INLINE FMATH_CONSTEXPR TransformKind operator&(TransformKind k1, TransformKind k2)
+{
+    return static_cast<TransformKind>(static_cast<uint8>(k1) & static_cast<uint8>(k2));
+}
+
+FMATH_INLINE FMATH_CONSTEXPR TransformKind &operator|=(TransformKind &k1, TransformKind k2)
+{
+    k1 = k1 | k2;
+    return k1;
+}
+
+// Whether every flag of kind is also in mask
+FMATH_INLINE FMATH_CONSTEXPR bool isKindOf(TransformKind kind, TransformKind mask)
+{
+    return (static_cast<uint8>(kind) & ~static_cast<uint8>(mask)) == 0;
+}
+
+// Whether kind has any of the flags
+FMATH_INLINE FMATH_CONSTEXPR bool hasKind(TransformKind kind, TransformKind flags)
+{
+    return (kind & flags) != TransformKind::Identity;
+}
+
+template<typename T>
+FMATH_INLINE TransformKind classifyTransform(const Matrix4<T> &m)
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+
+    if (m[0][3] != zero || m[1][3] != zero || m[2][3] != zero || m[3][3] != one)
+        return TransformKind::Projective;
+
+    TransformKind kind = TransformKind::Identity;
+    if (m[3][0] != zero || m[3][1] != zero || m[3][2] != zero)
+        kind |= TransformKind::Translation;
+
+    const Vector3<T> c0(m[0][0], m[0][1], m[0][2]);
+    const Vector3<T> c1(m[1][0], m[1][1], m[1][2]);
+    const Vector3<T> c2(m[2][0], m[2][1], m[2][2]);
+
+    const bool diagonal = c0[1] == zero && c0[2] == zero && c1[0] == zero && c1[2] == zero && c2[0] == zero && c2[1] == zero;
+    if (diagonal && c0[0] == one && c1[1] == one && c2[2] == one)
+        return kind;
+
+    const T l0 = dot(c0, c0);
+    const T epsilon = constants::Epsilon<T>::value * max(l0, one);
+    const bool orthogonal = abs(dot(c0, c1)) <= epsilon && abs(dot(c0, c2)) <= epsilon && abs(dot(c1, c2)) <= epsilon;
+    if (!orthogonal || abs(dot(c1, c1) - l0) > epsilon || abs(dot(c2, c2) - l0) > epsilon)
+        return kind | TransformKind::Affine;
+
+    // Reflections are not rotations, they keep the general affine path. A diagonal with a negative entry that is not
+    // a reflection is a half turn and needs the rotation flag as much as any other orthogonal matrix.
+    if (dot(cross(c0, c1), c2) < zero)
+        return kind | TransformKind::Affine;
+    if (!diagonal || c0[0] < zero || c1[1] < zero || c2[2] < zero)
+        kind |= TransformKind::Rotation;
+    if (abs(l0 - one) > constants::Epsilon<T>::value)
+        kind |= TransformKind::UniformScale;
+    return kind;
+}
+
 template<typename T>
 class Transform
 {
@@ -290,14 +471,26 @@ public:
 
     FMATH_CONSTEXPR Transform();
 
+    // Classifies the matrix, use the two argument constructor when the kind is already known
     FMATH_CONSTEXPR Transform(const Matrix4<ValueType> &mat);
 
+    FMATH_CONSTEXPR Transform(const Matrix4<ValueType> &mat, TransformKind kind);
+
     FMATH_CONSTEXPR Transform &operator=(const Transform &other);
 
     FMATH_INLINE FMATH_CONSTEXPR const T *data() const;
 
+    // Writing through the returned pointer is allowed, the kind falls back to projective
     FMATH_INLINE FMATH_CONSTEXPR T *data();
 
+    FMATH_INLINE FMATH_CONSTEXPR TransformKind kind() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR bool isIdentity() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR bool isRigid() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR bool isAffine() const;
+
     FMATH_INLINE FMATH_CONSTEXPR Matrix3<T> linear() const;
 
     FMATH_INLINE FMATH_CONSTEXPR Vector3<T> translation() const;
@@ -384,18 +577,69 @@ public:
 
     FMATH_INLINE FMATH_CONSTEXPR Triangle3<T> operator()(const Triangle3<ValueType> &t) const;
 
+    // Picks the cheapest inverse the kind allows
     FMATH_INLINE FMATH_CONSTEXPR Transform inverse() const;
 
+    // The caller guarantees the transform is rigid, no checks are made
+    FMATH_INLINE FMATH_CONSTEXPR Transform inverseRigid() const;
+
+    // The caller guarantees the transform is a rotation with uniform scale and translation
+    FMATH_INLINE FMATH_CONSTEXPR Transform inverseRigidScale() const;
+
+    // Removes scale and shear that accumulated in the linear part, the transform becomes rigid
+    FMATH_INLINE Transform &orthonormalize();
+
     FMATH_INLINE FMATH_CONSTEXPR const Matrix4<T> &toMatrix() const;
 
+private:
+    static FMATH_INLINE TransformKind scaleKind(const Vector3<ValueType> &factors);
+
+    static FMATH_INLINE TransformKind scaleKind(const ValueType &uniform_factor);
+
+    FMATH_INLINE FMATH_CONSTEXPR Vector3<T> applyLinear(const ValueType &x, const ValueType &y, const ValueType &z) const;
+
 private:
     Matrix4<ValueType> mat_;
+    TransformKind kind_;
 };
 
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Transform<T> operator*(const Transform<T> &t1, const Transform<T> &t2)
 {
-    return Transform<T>(t1.toMatrix() * t2.toMatrix());
+    const TransformKind kind = t1.kind() | t2.kind();
+    if (t1.isIdentity())
+        return t2;
+    if (t2.isIdentity())
+        return t1;
+
+    const Matrix4<T> &m1 = t1.toMatrix();
+    const Matrix4<T> &m2 = t2.toMatrix();
+
+    if (isKindOf(kind, TransformKind::Translation))
+    {
+        Matrix4<T> r = m1;
+        r[3][0] += m2[3][0];
+        r[3][1] += m2[3][1];
+        r[3][2] += m2[3][2];
+        return Transform<T>(r, kind);
+    }
+
+    if (hasKind(kind, TransformKind::Projective))
+        return Transform<T>(m1 * m2, kind);
+
+    // Both bottom rows are (0, 0, 0, 1), only the upper 3x4 block needs computing
+    Matrix4<T> r;
+    for (index_t c = 0; c < 4; ++c)
+    {
+        for (index_t i = 0; i < 3; ++i)
+            r[c][i] = m1[0][i] * m2[c][0] + m1[1][i] * m2[c][1] + m1[2][i] * m2[c][2];
+        r[c][3] = static_cast<T>(0);
+    }
+    r[3][0] += m1[3][0];
+    r[3][1] += m1[3][1];
+    r[3][2] += m1[3][2];
+    r[3][3] = static_cast<T>(1);
+    return Transform<T>(r, kind);
 }
 
 template<typename T>
@@ -413,23 +657,33 @@ FMATH_INLINE std::ostream &operator<<(std::ostream &output, const Transform<T> &
 
 template<typename T>
 FMATH_CONSTEXPR Transform<T>::Transform(const Transform &other)
-    :   mat_(other.mat_)
+    :   mat_(other.mat_),
+        kind_(other.kind_)
 {}
 
 template<typename T>
 FMATH_CONSTEXPR Transform<T>::Transform()
-    :   mat_(Matrix4<ValueType>::identity())
+    :   mat_(Matrix4<ValueType>::identity()),
+        kind_(TransformKind::Identity)
 {}
 
 template<typename T>
 FMATH_CONSTEXPR Transform<T>::Transform(const Matrix4<ValueType> &mat)
-    :   mat_(mat)
+    :   mat_(mat),
+        kind_(classifyTransform(mat))
+{}
+
+template<typename T>
+FMATH_CONSTEXPR Transform<T>::Transform(const Matrix4<ValueType> &mat, TransformKind kind)
+    :   mat_(mat),
+        kind_(kind)
 {}
 
 template<typename T>
 FMATH_CONSTEXPR Transform<T> &Transform<T>::operator=(const Transform &other)
 {
     mat_ = other.mat_;
+    kind_ = other.kind_;
     return *this;
 }
 
@@ -442,9 +696,34 @@ FMATH_INLINE FMATH_CONSTEXPR const T *Transform<T>::data() const
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR T *Transform<T>::data()
 {
+    kind_ = TransformKind::Projective;
     return mat_.data();
 }
 
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR TransformKind Transform<T>::kind() const
+{
+    return kind_;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool Transform<T>::isIdentity() const
+{
+    return kind_ == TransformKind::Identity;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool Transform<T>::isRigid() const
+{
+    return isKindOf(kind_, TransformKind::Rigid);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool Transform<T>::isAffine() const
+{
+    return !hasKind(kind_, TransformKind::Projective);
+}
+
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Matrix3<T> Transform<T>::linear() const
 {
@@ -492,6 +771,7 @@ FMATH_INLINE Transform<T> &Transform<T>::preRotate(const ValueType &angle)
         m[0] = v0;
         m[1] = v1;
     }
+    kind_ |= TransformKind::Rotation;
     return *this;
 }
 
@@ -529,6 +809,7 @@ FMATH_INLINE Transform<T> &Transform<T>::preRotate(const Vector3<ValueType> &axi
     m[1] = v1;
     m[2] = v2;
 
+    kind_ |= TransformKind::Rotation;
     return *this;
 }
 
@@ -536,6 +817,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::preRotate(const Quat<ValueType> &q)
 {
     mat_ *= q.toMatrix();
+    kind_ |= TransformKind::Rotation;
     return *this;
 }
 
@@ -546,6 +828,7 @@ FMATH_INLINE Transform<T> &Transform<T>::preScale(const Vector3<ValueType> &fact
     mat_[1] *= factors[1];
     mat_[2] *= factors[2];
 
+    kind_ |= scaleKind(factors);
     return *this;
 }
 
@@ -556,6 +839,7 @@ FMATH_INLINE Transform<T> &Transform<T>::preScale(const ValueType &uniform_facto
     mat_[1] *= uniform_factor;
     mat_[2] *= uniform_factor;
 
+    kind_ |= scaleKind(uniform_factor);
     return *this;
 }
 
@@ -563,7 +847,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::preScale(const Vector3<ValueType> &axis, const ValueType &factor)
 {
     Matrix4<ValueType> &m = mat_;
-    Vector3<ValueType> &n = normalize(axis);
+    Vector3<ValueType> n = normalize(axis);
     const ValueType factor_x = n[0] * (factor - static_cast<ValueType>(1));
     const ValueType factor_y = n[1] * (factor - static_cast<ValueType>(1));
     const ValueType factor_z = n[2] * (factor - static_cast<ValueType>(1));
@@ -590,6 +874,7 @@ FMATH_INLINE Transform<T> &Transform<T>::preScale(const Vector3<ValueType> &axis
     m[1] = v1;
     m[2] = v2;
 
+    kind_ |= TransformKind::Affine;
     return *this;
 }
 
@@ -600,6 +885,7 @@ FMATH_INLINE Transform<T> &Transform<T>::preTranslate(const Vector3<ValueType> &
 
     Vector4<ValueType> v = m[0] * translation[0] + m[1] * translation[1] + m[2] * translation[2] + m[3];
     m[3] = v;
+    kind_ |= TransformKind::Translation;
     return *this;
 }
 
@@ -608,6 +894,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::rotate(const ValueType &angle)
 {
     mat_ = fmath::rotate<A>(angle) * mat_;
+    kind_ |= TransformKind::Rotation;
     return *this;
 }
 
@@ -615,6 +902,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::rotate(const Vector3<ValueType> &axis, const ValueType &angle)
 {
     mat_ = fmath::rotate(axis, angle) * mat_;
+    kind_ |= TransformKind::Rotation;
     return *this;
 }
 
@@ -622,6 +910,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::rotate(const Quat<ValueType> &q)
 {
     mat_ = q.toMatrix() * mat_;
+    kind_ |= TransformKind::Rotation;
     return *this;
 }
 
@@ -629,6 +918,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::scale(const Vector3<ValueType> &factors)
 {
     mat_ = fmath::scale(factors) * mat_;
+    kind_ |= scaleKind(factors);
     return *this;
 }
 
@@ -636,6 +926,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::scale(const ValueType &uniform_factor)
 {
     mat_ = fmath::scale(uniform_factor) * mat_;
+    kind_ |= scaleKind(uniform_factor);
     return *this;
 }
 
@@ -643,13 +934,24 @@ template<typename T>
 Transform<T> &Transform<T>::scale(const Vector3<T> &axis, const ValueType &factor)
 {
     mat_ = fmath::scale(axis, factor) * mat_;
+    kind_ |= TransformKind::Affine;
     return *this;
 }
 
 template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::translate(const Vector3<ValueType> &translation)
 {
-    mat_[3] += translation;
+    if (hasKind(kind_, TransformKind::Projective))
+    {
+        mat_ = fmath::translate(translation) * mat_;
+    }
+    else
+    {
+        mat_[3][0] += translation[0];
+        mat_[3][1] += translation[1];
+        mat_[3][2] += translation[2];
+    }
+    kind_ |= TransformKind::Translation;
     return *this;
 }
 
@@ -658,6 +960,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::shear(const ValueType &factor_s, const ValueType &factor_t)
 {
     mat_ = fmath::shear<A>(factor_s, factor_t) * mat_;
+    kind_ |= TransformKind::Affine;
     return *this;
 }
 
@@ -679,6 +982,7 @@ FMATH_INLINE Transform<T> &Transform<T>::orthographic(const ValueType &left, con
     const ValueType &bottom, const ValueType &top, const ValueType &near, const ValueType &far)
 {
     mat_ = fmath::orthographic(left, right, bottom, top, near, far) * mat_;
+    kind_ |= TransformKind::Affine | TransformKind::Translation;
     return *this;
 }
 
@@ -687,6 +991,7 @@ FMATH_INLINE Transform<T> &Transform<T>::perspective(const ValueType &left, cons
     const ValueType &bottom, const ValueType &top, const ValueType &near, const ValueType &far)
 {
     mat_ = fmath::perspective(left, right, bottom, top, near, far) * mat_;
+    kind_ |= TransformKind::Projective;
     return *this;
 }
 
@@ -695,6 +1000,7 @@ FMATH_INLINE Transform<T> &Transform<T>::perspective(const ValueType &fovy, cons
         const ValueType &near, const ValueType &far)
 {
     mat_ = fmath::perspective(fovy, aspect, near, far) * mat_;
+    kind_ |= TransformKind::Projective;
     return *this;
 }
 
@@ -702,6 +1008,7 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::lookAt(const Point3<ValueType> &eye, const Point3<ValueType> &target, const Vector3<ValueType> &up)
 {
     mat_ = fmath::lookAt(eye, target, up) * mat_;
+    kind_ |= TransformKind::Rigid;
     return *this;
 }
 
@@ -709,12 +1016,44 @@ template<typename T>
 FMATH_INLINE Transform<T> &Transform<T>::clear()
 {
     mat_ = Matrix4<ValueType>::identity();
+    kind_ = TransformKind::Identity;
     return *this;
 }
 
+template<typename T>
+FMATH_INLINE TransformKind Transform<T>::scaleKind(const Vector3<ValueType> &factors)
+{
+    if (factors[0] != factors[1] || factors[0] != factors[2])
+        return TransformKind::Affine;
+    return scaleKind(factors[0]);
+}
+
+template<typename T>
+FMATH_INLINE TransformKind Transform<T>::scaleKind(const ValueType &uniform_factor)
+{
+    return uniform_factor == static_cast<ValueType>(1) ? TransformKind::Identity : TransformKind::UniformScale;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Vector3<T> Transform<T>::applyLinear(const ValueType &x, const ValueType &y, const ValueType &z) const
+{
+    const Matrix4<ValueType> &m = mat_;
+    return Vector3<ValueType>(
+        m[0][0] * x + m[1][0] * y + m[2][0] * z,
+        m[0][1] * x + m[1][1] * y + m[2][1] * z,
+        m[0][2] * x + m[1][2] * y + m[2][2] * z
+    );
+}
+
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Vector3<T> Transform<T>::apply(const Vector3<ValueType> &vector) const
 {
+    if (isKindOf(kind_, TransformKind::Translation))
+        return vector;
+
+    if (!hasKind(kind_, TransformKind::Projective))
+        return applyLinear(vector[0], vector[1], vector[2]);
+
     Vector4<ValueType> result = mat_ * Vector4<ValueType>(vector[0], vector[1], vector[2], static_cast<ValueType>(0));
     return Vector3<ValueType>(result[0], result[1], result[2]);
 }
@@ -722,6 +1061,18 @@ FMATH_INLINE FMATH_CONSTEXPR Vector3<T> Transform<T>::apply(const Vector3<ValueT
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Point3<T> Transform<T>::apply(const Point3<ValueType> &point) const
 {
+    if (kind_ == TransformKind::Identity)
+        return point;
+
+    if (kind_ == TransformKind::Translation)
+        return Point3<ValueType>(point[0] + mat_[3][0], point[1] + mat_[3][1], point[2] + mat_[3][2]);
+
+    if (!hasKind(kind_, TransformKind::Projective))
+    {
+        Vector3<ValueType> r = applyLinear(point[0], point[1], point[2]);
+        return Point3<ValueType>(r[0] + mat_[3][0], r[1] + mat_[3][1], r[2] + mat_[3][2]);
+    }
+
     Vector4<ValueType> result = mat_ * Vector4<ValueType>(point[0], point[1], point[2], static_cast<ValueType>(1));
     ValueType w = result[3];
     if (w != static_cast<ValueType>(1))
@@ -732,6 +1083,18 @@ FMATH_INLINE FMATH_CONSTEXPR Point3<T> Transform<T>::apply(const Point3<ValueTyp
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Normal3<T> Transform<T>::apply(const Normal3<ValueType> &normal) const
 {
+    if (isKindOf(kind_, TransformKind::Translation))
+        return normal;
+
+    // The inverse transpose of s * R is R / s, which is (s * R) / s^2
+    if (isKindOf(kind_, TransformKind::Similarity))
+    {
+        Vector3<ValueType> r = applyLinear(normal[0], normal[1], normal[2]);
+        if (hasKind(kind_, TransformKind::UniformScale))
+            r /= mat_[0][0] * mat_[0][0] + mat_[0][1] * mat_[0][1] + mat_[0][2] * mat_[0][2];
+        return Normal3<ValueType>(r[0], r[1], r[2]);
+    }
+
     Matrix4<ValueType> inv = fmath::inverse(mat_);
     Vector4<ValueType> r = Vector4<ValueType>(normal[0], normal[1], normal[2], static_cast<ValueType>(0)) * inv;
     return Normal3<ValueType>(r[0], r[1], r[2]);
@@ -755,6 +1118,24 @@ FMATH_INLINE FMATH_CONSTEXPR Box3<T> Transform<T>::apply(const Box3<ValueType> &
     const Point3<ValueType> &pmin = b.min();
     const Point3<ValueType> &pmax = b.max();
 
+    if (!hasKind(kind_, TransformKind::Projective))
+    {
+        // Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990
+        Point3<ValueType> rmin(mat_[3][0], mat_[3][1], mat_[3][2]);
+        Point3<ValueType> rmax = rmin;
+        for (index_t c = 0; c < 3; ++c)
+        {
+            for (index_t r = 0; r < 3; ++r)
+            {
+                const ValueType e0 = mat_[c][r] * pmin[c];
+                const ValueType e1 = mat_[c][r] * pmax[c];
+                rmin[r] += fmath::min(e0, e1);
+                rmax[r] += fmath::max(e0, e1);
+            }
+        }
+        return Box3<ValueType>(rmin, rmax);
+    }
+
     Box3<ValueType> result(apply(pmin));
     result += apply(Point3<ValueType>(pmax[0], pmin[1], pmin[2]));
     result += apply(Point3<ValueType>(pmin[0], pmax[1], pmin[2]));
@@ -818,7 +1199,60 @@ FMATH_INLINE FMATH_CONSTEXPR Triangle3<T> Transform<T>::operator()(const Triangl
 template<typename T>
 FMATH_INLINE FMATH_CONSTEXPR Transform<T> Transform<T>::inverse() const
 {
-    return Transform<T>(fmath::inverse(mat_));
+    if (kind_ == TransformKind::Identity)
+        return *this;
+
+    const Matrix4<ValueType> &m = mat_;
+    const ValueType one = static_cast<ValueType>(1);
+
+    if (kind_ == TransformKind::Translation)
+    {
+        Matrix4<ValueType> r = Matrix4<ValueType>::identity();
+        r[3] = Vector4<ValueType>(-m[3][0], -m[3][1], -m[3][2], one);
+        return Transform<T>(r, kind_);
+    }
+
+    if (isKindOf(kind_, TransformKind::Rigid))
+        return inverseRigid();
+
+    if (isKindOf(kind_, TransformKind::Similarity))
+        return inverseRigidScale();
+
+    if (hasKind(kind_, TransformKind::Projective))
+        return Transform<T>(fmath::inverse(mat_), kind_);
+
+    return Transform<T>(fmath::inverseAffine(mat_), kind_);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Transform<T> Transform<T>::inverseRigid() const
+{
+    return Transform<T>(fmath::inverseRigid(mat_), kind_);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Transform<T> Transform<T>::inverseRigidScale() const
+{
+    return Transform<T>(fmath::inverseRigidScale(mat_), kind_);
+}
+
+template<typename T>
+FMATH_INLINE Transform<T> &Transform<T>::orthonormalize()
+{
+    FMATH_ASSERT(!hasKind(kind_, TransformKind::Projective));
+
+    if (isKindOf(kind_, TransformKind::Translation))
+        return *this;
+
+    const Matrix3<ValueType> r = fmath::orthonormalize(linear());
+    for (index_t c = 0; c < 3; ++c)
+    {
+        mat_[c][0] = r[c][0];
+        mat_[c][1] = r[c][1];
+        mat_[c][2] = r[c][2];
+    }
+    kind_ = (kind_ & TransformKind::Translation) | TransformKind::Rotation;
+    return *this;
 }
 
 template<typename T>
@@ -827,9 +1261,173 @@ FMATH_INLINE FMATH_CONSTEXPR const Matrix4<T> &Transform<T>::toMatrix() const
     return mat_;
 }
 
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR void lookAt(const Point3<T> &eye, const Point3<T> &target, const Vector3<T> &up,
+    Transform<T> &view, Transform<T> &inverse_view)
+{
+    Matrix4<T> m, inv;
+    lookAt(eye, target, up, m, inv);
+    view = Transform<T>(m, TransformKind::Rigid);
+    inverse_view = Transform<T>(inv, TransformKind::Rigid);
+}
+
+// Translation, rotation and scale stored separately, composed as T * R * S
+template<typename T>
+class TRS
+{
+public:
+    using ValueType = T;
+
+public:
+    FMATH_CONSTEXPR TRS(const TRS &other);
+
+    FMATH_CONSTEXPR TRS();
+
+    explicit FMATH_CONSTEXPR TRS(const Vector3<ValueType> &translation, const Quat<ValueType> &rotation,
+        const Vector3<ValueType> &scale = Vector3<ValueType>(1, 1, 1));
+
+    FMATH_CONSTEXPR TRS &operator=(const TRS &other);
+
+    FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> toMatrix() const;
+
+    FMATH_INLINE FMATH_CONSTEXPR Transform<T> toTransform() const;
+
+    static FMATH_CONSTEXPR TRS identity();
+
+    // Assumes the matrix has no shear or projection
+    static FMATH_CONSTEXPR TRS makeFromMatrix(const Matrix4<ValueType> &mat);
+
+    static FMATH_CONSTEXPR TRS makeFromTransform(const Transform<ValueType> &t);
+
+public:
+    Vector3<ValueType> translation;
+    Quat<ValueType> rotation;
+    Vector3<ValueType> scale;
+};
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool operator==(const TRS<T> &t1, const TRS<T> &t2)
+{
+    return t1.translation == t2.translation && t1.rotation == t2.rotation && t1.scale == t2.scale;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool operator!=(const TRS<T> &t1, const TRS<T> &t2)
+{
+    return !(t1 == t2);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool equalEpsilon(const TRS<T> &t1, const TRS<T> &t2, const T &epsilon = constants::Epsilon<T>::value)
+{
+    return equalEpsilon(t1.translation, t2.translation, epsilon) &&
+        equalEpsilon(t1.rotation, t2.rotation, epsilon) &&
+        equalEpsilon(t1.scale, t2.scale, epsilon);
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool notEqualEpsilon(const TRS<T> &t1, const TRS<T> &t2, const T &epsilon = constants::Epsilon<T>::value)
+{
+    return !equalEpsilon(t1, t2, epsilon);
+}
+
+template<typename T>
+FMATH_INLINE std::ostream &operator<<(std::ostream &output, const TRS<T> &t)
+{
+    output << '(' << t.translation << ',' << t.rotation << ',' << t.scale << ')';
+    return output;
+}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T>::TRS(const TRS &other)
+    :   translation(other.translation),
+        rotation(other.rotation),
+        scale(other.scale)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T>::TRS()
+    :   translation(Vector3<ValueType>::zero()),
+        rotation(Quat<ValueType>::identity()),
+        scale(Vector3<ValueType>(1, 1, 1))
+{}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T>::TRS(const Vector3<ValueType> &translation, const Quat<ValueType> &rotation,
+    const Vector3<ValueType> &scale)
+    :   translation(translation),
+        rotation(rotation),
+        scale(scale)
+{}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T> &TRS<T>::operator=(const TRS &other)
+{
+    translation = other.translation;
+    rotation = other.rotation;
+    scale = other.scale;
+    return *this;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Matrix4<T> TRS<T>::toMatrix() const
+{
+    Matrix4<ValueType> r = rotation.toMatrix();
+    r[0] *= scale[0];
+    r[1] *= scale[1];
+    r[2] *= scale[2];
+    r[3] = Vector4<ValueType>(translation[0], translation[1], translation[2], static_cast<ValueType>(1));
+    return r;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR Transform<T> TRS<T>::toTransform() const
+{
+    TransformKind kind = TransformKind::Rigid;
+    if (scale[0] != scale[1] || scale[0] != scale[2])
+        kind |= TransformKind::Affine;
+    else if (scale[0] != static_cast<ValueType>(1))
+        kind |= TransformKind::UniformScale;
+    return Transform<ValueType>(toMatrix(), kind);
+}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T> TRS<T>::identity()
+{
+    return TRS<T>();
+}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T> TRS<T>::makeFromMatrix(const Matrix4<ValueType> &m)
+{
+    Vector3<ValueType> c0(m[0][0], m[0][1], m[0][2]);
+    Vector3<ValueType> c1(m[1][0], m[1][1], m[1][2]);
+    Vector3<ValueType> c2(m[2][0], m[2][1], m[2][2]);
+
+    Vector3<ValueType> s(length(c0), length(c1), length(c2));
+    if (dot(cross(c0, c1), c2) < static_cast<ValueType>(0))
+        s[0] = -s[0];
+
+    c0 /= s[0];
+    c1 /= s[1];
+    c2 /= s[2];
+
+    Matrix3<ValueType> r(c0, c1, c2);
+    return TRS<T>(Vector3<ValueType>(m[3][0], m[3][1], m[3][2]), Quat<ValueType>::makeRotation(r), s);
+}
+
+template<typename T>
+FMATH_CONSTEXPR TRS<T> TRS<T>::makeFromTransform(const Transform<ValueType> &t)
+{
+    return makeFromMatrix(t.toMatrix());
+}
+
 using Transform4f = Transform<float>;
 using Transform4lf = Transform<double>;
 
+using TRSf = TRS<float>;
+using TRSlf = TRS<double>;
+
 }
 
 #endif
\ No newline at end of file
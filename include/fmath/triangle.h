@@ -3,6 +3,7 @@
 
 #include <array>
 
+#include "box.h"
 #include "common.h"
 #include "constants.h"
 #include "plane.h"
@@ -221,6 +222,64 @@ FMATH_INLINE FMATH_CONSTEXPR Plane<T> Triangle<T, N>::toPlane() const
     return Plane<T>(vertices_[0], vertices_[1], vertices_[2]);
 }
 
+// Akenine-Moller, "Fast 3D Triangle-Box Overlap Testing". Separating axis test on the box face normals, the nine
+// cross products of the box axes with the triangle edges and the triangle normal, touching counts as overlapping.
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool overlaps(const Triangle<T, 3> &triangle, const Box<T, 3> &box)
+{
+    const T half = static_cast<T>(0.5);
+    T extent[3] = {};
+    Vector<T, 3> v[3];
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const T center = (box.min()[i] + box.max()[i]) * half;
+        extent[i] = (box.max()[i] - box.min()[i]) * half;
+        for (index_t k = 0; k < 3; ++k)
+            v[k][i] = triangle[k][i] - center;
+    }
+
+    for (index_t i = 0; i < 3; ++i)
+    {
+        if (min(v[0][i], v[1][i], v[2][i]) > extent[i] || max(v[0][i], v[1][i], v[2][i]) < -extent[i])
+            return false;
+    }
+
+    // Axis i cross edge k, on which both ends of the edge project to the same value
+    const Vector<T, 3> edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+    for (index_t k = 0; k < 3; ++k)
+    {
+        const Vector<T, 3> &e = edges[k];
+        const Vector<T, 3> &p = v[k];
+        const Vector<T, 3> &q = v[(k + 2) % 3];
+        for (index_t i = 0; i < 3; ++i)
+        {
+            const index_t a = (i + 1) % 3;
+            const index_t b = (i + 2) % 3;
+            const T p0 = e[a] * p[b] - e[b] * p[a];
+            const T p1 = e[a] * q[b] - e[b] * q[a];
+            const T radius = extent[a] * abs(e[b]) + extent[b] * abs(e[a]);
+            if (min(p0, p1) > radius || max(p0, p1) < -radius)
+                return false;
+        }
+    }
+
+    // The normal of a collinear triangle is rounding, which would separate it from boxes it touches. The axes above
+    // are all the separating axes of a segment.
+    const Vector<T, 3> normal = cross(edges[0], edges[1]);
+    const T flat_tolerance = static_cast<T>(16) * constants::Epsilon<T>::value;
+    if (dot(normal, normal) <= flat_tolerance * flat_tolerance * dot(edges[0], edges[0]) * dot(edges[1], edges[1]))
+        return true;
+
+    const T radius = extent[0] * abs(normal[0]) + extent[1] * abs(normal[1]) + extent[2] * abs(normal[2]);
+    return abs(dot(normal, v[0])) <= radius;
+}
+
+template<typename T>
+FMATH_INLINE FMATH_CONSTEXPR bool overlaps(const Box<T, 3> &box, const Triangle<T, 3> &triangle)
+{
+    return overlaps(triangle, box);
+}
+
 template<typename T>
 using Triangle2 = Triangle<T, 2>;
 
@@ -0,0 +1,915 @@
+#ifndef _FMATH_VOXELIZER_H_
+#define _FMATH_VOXELIZER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "internal/parallel.h"
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "morton.h"
+#include "point.h"
+#include "triangle.h"
+#include "vector.h"
+
+namespace fmath
+{
+
+// How voxelize splits the work between threads
+enum class VoxelizePartition : uint8
+{
+    // Every thread rasterizes its own range of triangles and merges the voxels with atomic ors. Suits meshes of many
+    // small, evenly spread triangles.
+    Triangles,
+    // The triangles are first binned to the bricks of 8x8x8 voxels they overlap, then every brick is filled by a
+    // single thread without atomics. Suits large triangles and uneven tessellation, as in CAD meshes.
+    Bricks
+};
+
+// Dense grid of one bit per voxel over bounds. The bits are kept in words of 4x4x4 voxels, voxel (x, y, z) of a word
+// in bit x + 4 * y + 16 * z, and the words in x, y, z order.
+template<typename T>
+class VoxelGrid
+{
+public:
+    using ValueType = T;
+    static constexpr uint32 WORD_SIZE = 4;
+
+public:
+    VoxelGrid() = default;
+
+    explicit VoxelGrid(const Box3<ValueType> &bounds, const Point3u &resolution);
+
+    // Sets every voxel the triangles touch, keeping the voxels already set. Conservative: a voxel is set as soon as
+    // its closed box overlaps a triangle, on the separating axes of overlaps(Triangle3, Box3).
+    void voxelize(const Triangle3<ValueType> *triangles, size_t count,
+        VoxelizePartition partition = VoxelizePartition::Bricks);
+
+    FMATH_INLINE const Box3<ValueType> &bounds() const;
+
+    FMATH_INLINE const Point3u &resolution() const;
+
+    FMATH_INLINE Vector3<ValueType> voxelSize() const;
+
+    FMATH_INLINE Box3<ValueType> voxelBounds(uint32 x, uint32 y, uint32 z) const;
+
+    FMATH_INLINE bool get(uint32 x, uint32 y, uint32 z) const;
+
+    FMATH_INLINE void set(uint32 x, uint32 y, uint32 z, bool value = true);
+
+    // Number of words along each axis, and the word at word coordinates (x, y, z)
+    FMATH_INLINE const Point3u &wordResolution() const;
+
+    FMATH_INLINE uint64 word(uint32 x, uint32 y, uint32 z) const;
+
+    FMATH_INLINE uint64 &word(uint32 x, uint32 y, uint32 z);
+
+    FMATH_INLINE const std::vector<uint64> &words() const;
+
+    // Number of voxels set
+    size_t count() const;
+
+    void clear();
+
+private:
+    FMATH_INLINE size_t wordIndex(uint32 x, uint32 y, uint32 z) const;
+
+private:
+    Box3<ValueType> bounds_;
+    Point3u resolution_;
+    Point3u word_resolution_;
+    std::vector<uint64> words_;
+};
+
+// The voxels of a VoxelGrid, stored only for the bricks of 8x8x8 voxels holding any. A brick is 8 words of 4x4x4
+// voxels in Morton order, the bricks are sorted by the Morton code of their coordinates and looked up by binary
+// search. Up to 2^24 voxels per axis.
+template<typename T>
+class SparseVoxelGrid
+{
+public:
+    using ValueType = T;
+    static constexpr uint32 BRICK_SIZE = 8;
+    static constexpr uint32 BRICK_WORDS = 8;
+    static constexpr size_t NONE = ~static_cast<size_t>(0);
+
+public:
+    SparseVoxelGrid() = default;
+
+    explicit SparseVoxelGrid(const Box3<ValueType> &bounds, const Point3u &resolution);
+
+    // Replaces the content by the voxels the triangles touch, with the same rule as VoxelGrid::voxelize
+    void voxelize(const Triangle3<ValueType> *triangles, size_t count,
+        VoxelizePartition partition = VoxelizePartition::Bricks);
+
+    FMATH_INLINE const Box3<ValueType> &bounds() const;
+
+    FMATH_INLINE const Point3u &resolution() const;
+
+    FMATH_INLINE Vector3<ValueType> voxelSize() const;
+
+    FMATH_INLINE Box3<ValueType> voxelBounds(uint32 x, uint32 y, uint32 z) const;
+
+    FMATH_INLINE bool get(uint32 x, uint32 y, uint32 z) const;
+
+    FMATH_INLINE size_t brickCount() const;
+
+    // Brick holding the voxels from 8 * brick coordinates on, or NONE if all of them are clear
+    FMATH_INLINE size_t findBrick(uint32 x, uint32 y, uint32 z) const;
+
+    FMATH_INLINE Point3u brickCoordinates(index_t brick) const;
+
+    FMATH_INLINE const uint64 *brickWords(index_t brick) const;
+
+    // Number of voxels set
+    size_t count() const;
+
+    VoxelGrid<ValueType> toDense() const;
+
+    void clear();
+
+private:
+    Box3<ValueType> bounds_;
+    Point3u resolution_;
+    std::vector<uint64> keys_;
+    std::vector<uint64> words_;
+};
+
+using VoxelGridf = VoxelGrid<float>;
+using VoxelGridlf = VoxelGrid<double>;
+
+using SparseVoxelGridf = SparseVoxelGrid<float>;
+using SparseVoxelGridlf = SparseVoxelGrid<double>;
+
+namespace internal
+{
+
+constexpr size_t VOXELIZE_GRAIN_SIZE = 256;
+constexpr size_t VOXELIZE_BRICK_GRAIN_SIZE = 16;
+constexpr size_t VOXELIZE_WORD_GRAIN_SIZE = 16384;
+constexpr uint32 VOXEL_BRICK_SIZE = 8;
+constexpr uint32 MAX_SPARSE_VOXEL_RESOLUTION = 1U << 24;
+
+FMATH_INLINE uint32 countBits(uint64 value)
+{
+#if defined(FMATH_COMPILER_GCC) || defined(FMATH_COMPILER_CLANG)
+    return static_cast<uint32>(__builtin_popcountll(value));
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<uint32>((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Bit of voxel (x, y, z) in its word of 4x4x4 voxels
+FMATH_INLINE uint64 voxelBit(uint32 x, uint32 y, uint32 z)
+{
+    return 1ULL << ((x & 3U) | (y & 3U) << 2 | (z & 3U) << 4);
+}
+
+// Word of voxel (x, y, z) in its brick of 2x2x2 words
+FMATH_INLINE uint32 brickWordIndex(uint32 x, uint32 y, uint32 z)
+{
+    return (x >> 2 & 1U) | (y >> 2 & 1U) << 1 | (z >> 2 & 1U) << 2;
+}
+
+// A triangle in voxel units, where voxel (x, y, z) spans [x, x + 1] and so on, set up for the form of the separating
+// axis test from Schwarz and Seidel, "Fast Parallel Surface and Solid Voxelization on GPUs". With boxes of one size
+// the nine edge axes turn into three 2D edge functions per projection and the normal axis into a plane offset pair,
+// all precomputed per triangle. Columns along the dominant normal axis only visit the voxels around the plane, so
+// the cost follows the area of the triangle instead of the volume of its bounds.
+template<typename T>
+class TriangleRasterizer
+{
+public:
+    // The triangle in voxel units, as toVoxelUnits makes it. Voxels are grown by margin on every side.
+    explicit TriangleRasterizer(const Triangle3<T> &triangle, T margin = static_cast<T>(0));
+
+    // Calls func(x, y, z) for every voxel in [first, last] the triangle overlaps
+    template<typename FunctionT>
+    void rasterize(const Point3u &first, const Point3u &last, FunctionT &&func) const;
+
+private:
+    // 2D test in the projection along axis, a and b are the coordinates on the next two axes
+    FMATH_INLINE bool edgeTest(index_t axis, T a, T b) const;
+
+    FMATH_INLINE bool planeTest(const T *p) const;
+
+private:
+    T normal_[3];
+    T plane_offset_;
+    T plane_min_;
+    T plane_max_;
+    T edge_normals_[3][3][2];
+    T edge_offsets_[3][3];
+    T margin_;
+    index_t dominant_;
+    // Normal within rounding of zero, collinear triangles in the input end up with one of rounding size
+    bool flat_;
+};
+
+template<typename T>
+FMATH_INLINE Triangle3<T> toVoxelUnits(const Triangle3<T> &triangle, const Point3<T> &origin, const Vector3<T> &scale)
+{
+    Triangle3<T> result;
+    for (index_t k = 0; k < 3; ++k)
+    {
+        for (index_t i = 0; i < 3; ++i)
+            result[k][i] = (triangle[k][i] - origin[i]) * scale[i];
+    }
+    return result;
+}
+
+// Inclusive range of the voxels below resolution the bounds of a triangle in voxel units touch, false when there are
+// none
+template<typename T>
+FMATH_INLINE bool voxelRange(const Triangle3<T> &triangle, const Point3u &resolution, Point3u &first, Point3u &last,
+    T margin = static_cast<T>(0))
+{
+    const T one = static_cast<T>(1);
+    for (index_t i = 0; i < 3; ++i)
+    {
+        const T low = min(triangle[0][i], triangle[1][i], triangle[2][i]) - margin;
+        const T high = max(triangle[0][i], triangle[1][i], triangle[2][i]) + margin;
+        const T limit = static_cast<T>(resolution[i]);
+        if (!(high >= static_cast<T>(0) && low <= limit) || resolution[i] == 0)
+            return false;
+
+        first[i] = static_cast<uint32>(max(ceil(low) - one, static_cast<T>(0)));
+        last[i] = static_cast<uint32>(min(floor(high), limit - one));
+    }
+    return true;
+}
+
+template<typename T>
+TriangleRasterizer<T>::TriangleRasterizer(const Triangle3<T> &triangle, T margin)
+    : margin_(margin)
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    const Triangle3<T> &v = triangle;
+    T e[3][3];
+    for (index_t i = 0; i < 3; ++i)
+    {
+        for (index_t k = 0; k < 3; ++k)
+            e[k][i] = v[(k + 1) % 3][i] - v[k][i];
+    }
+
+    normal_[0] = e[0][1] * e[1][2] - e[0][2] * e[1][1];
+    normal_[1] = e[0][2] * e[1][0] - e[0][0] * e[1][2];
+    normal_[2] = e[0][0] * e[1][1] - e[0][1] * e[1][0];
+
+    // Plane distances of the corners of a voxel at the origin farthest along and against the normal
+    plane_offset_ = normal_[0] * v[0][0] + normal_[1] * v[0][1] + normal_[2] * v[0][2];
+    plane_max_ = -plane_offset_;
+    plane_min_ = -plane_offset_;
+    dominant_ = 0;
+    for (index_t i = 0; i < 3; ++i)
+    {
+        (normal_[i] > zero ? plane_max_ : plane_min_) += normal_[i];
+        plane_max_ += abs(normal_[i]) * margin;
+        plane_min_ -= abs(normal_[i]) * margin;
+        if (abs(normal_[i]) > abs(normal_[dominant_]))
+            dominant_ = i;
+    }
+    // Same tolerance as overlaps(Triangle3, Box3)
+    const T length2_0 = e[0][0] * e[0][0] + e[0][1] * e[0][1] + e[0][2] * e[0][2];
+    const T length2_1 = e[1][0] * e[1][0] + e[1][1] * e[1][1] + e[1][2] * e[1][2];
+    const T normal_length2 = normal_[0] * normal_[0] + normal_[1] * normal_[1] + normal_[2] * normal_[2];
+    const T flat_tolerance = static_cast<T>(16) * constants::Epsilon<T>::value;
+    flat_ = !(normal_length2 > flat_tolerance * flat_tolerance * length2_0 * length2_1);
+
+    // Edge normals pointing inside in the projection along axis, offset so the voxel corner farthest along them is
+    // the one tested
+    for (index_t axis = 0; axis < 3; ++axis)
+    {
+        const index_t a = (axis + 1) % 3;
+        const index_t b = (axis + 2) % 3;
+        const T side = normal_[axis] >= zero ? one : -one;
+        for (index_t k = 0; k < 3; ++k)
+        {
+            const T na = -e[k][b] * side;
+            const T nb = e[k][a] * side;
+            edge_normals_[axis][k][0] = na;
+            edge_normals_[axis][k][1] = nb;
+            edge_offsets_[axis][k] = -(na * v[k][a] + nb * v[k][b]) + max(zero, na) + max(zero, nb) +
+                (abs(na) + abs(nb)) * margin;
+        }
+    }
+}
+
+template<typename T>
+FMATH_INLINE bool TriangleRasterizer<T>::edgeTest(index_t axis, T a, T b) const
+{
+    const T zero = static_cast<T>(0);
+    const T (&n)[3][2] = edge_normals_[axis];
+    const T (&d)[3] = edge_offsets_[axis];
+    return n[0][0] * a + n[0][1] * b + d[0] >= zero &&
+        n[1][0] * a + n[1][1] * b + d[1] >= zero &&
+        n[2][0] * a + n[2][1] * b + d[2] >= zero;
+}
+
+template<typename T>
+FMATH_INLINE bool TriangleRasterizer<T>::planeTest(const T *p) const
+{
+    const T zero = static_cast<T>(0);
+    const T distance = normal_[0] * p[0] + normal_[1] * p[1] + normal_[2] * p[2];
+    return distance + plane_max_ >= zero && distance + plane_min_ <= zero;
+}
+
+template<typename T>
+template<typename FunctionT>
+void TriangleRasterizer<T>::rasterize(const Point3u &first, const Point3u &last, FunctionT &&func) const
+{
+    const T zero = static_cast<T>(0);
+    const T one = static_cast<T>(1);
+    const index_t d = dominant_;
+    const index_t a = (d + 1) % 3;
+    const index_t b = (d + 2) % 3;
+    uint32 c[3];
+    T p[3];
+
+    // Degenerate triangles have no plane to walk, every voxel of the range is tested. The edge tests alone are the
+    // separating axes of a segment.
+    if (flat_)
+    {
+        for (c[2] = first[2]; c[2] <= last[2]; ++c[2])
+        {
+            for (c[1] = first[1]; c[1] <= last[1]; ++c[1])
+            {
+                for (c[0] = first[0]; c[0] <= last[0]; ++c[0])
+                {
+                    p[0] = static_cast<T>(c[0]);
+                    p[1] = static_cast<T>(c[1]);
+                    p[2] = static_cast<T>(c[2]);
+                    if (edgeTest(0, p[1], p[2]) && edgeTest(1, p[2], p[0]) && edgeTest(2, p[0], p[1]))
+                        func(c[0], c[1], c[2]);
+                }
+            }
+        }
+        return;
+    }
+
+    const T low_a = min(normal_[a], zero) - abs(normal_[a]) * margin_;
+    const T high_a = max(normal_[a], zero) + abs(normal_[a]) * margin_;
+    const T low_b = min(normal_[b], zero) - abs(normal_[b]) * margin_;
+    const T high_b = max(normal_[b], zero) + abs(normal_[b]) * margin_;
+    const T first_d = static_cast<T>(first[d]);
+    const T last_d = static_cast<T>(last[d]);
+    for (c[b] = first[b]; c[b] <= last[b]; ++c[b])
+    {
+        p[b] = static_cast<T>(c[b]);
+        for (c[a] = first[a]; c[a] <= last[a]; ++c[a])
+        {
+            p[a] = static_cast<T>(c[a]);
+            if (!edgeTest(d, p[a], p[b]))
+                continue;
+
+            // Span of the plane along d over the column, widened by a voxel on both sides against rounding. The plane
+            // test below is the exact one.
+            const T t = plane_offset_ - normal_[a] * p[a] - normal_[b] * p[b];
+            T low = (t - high_a - high_b) / normal_[d];
+            T high = (t - low_a - low_b) / normal_[d];
+            if (normal_[d] < zero)
+                std::swap(low, high);
+
+            low = max(floor(low - margin_) - one - one, first_d);
+            high = min(floor(high + margin_) + one, last_d);
+            if (!(low <= high))
+                continue;
+
+            const uint32 end = static_cast<uint32>(high);
+            for (c[d] = static_cast<uint32>(low); c[d] <= end; ++c[d])
+            {
+                p[d] = static_cast<T>(c[d]);
+                if (planeTest(p) && edgeTest(a, p[b], p[d]) && edgeTest(b, p[d], p[a]))
+                    func(c[0], c[1], c[2]);
+            }
+        }
+    }
+}
+
+template<typename T>
+FMATH_INLINE Vector3<T> voxelScale(const Box3<T> &bounds, const Point3u &resolution)
+{
+    const Vector3<T> size = bounds.diagonal();
+    return Vector3<T>(static_cast<T>(resolution[0]) / size[0], static_cast<T>(resolution[1]) / size[1],
+        static_cast<T>(resolution[2]) / size[2]);
+}
+
+// Pairs of brick Morton code and triangle index for every brick of 8x8x8 voxels a triangle may overlap, sorted by
+// brick. Triangles spanning several bricks are rasterized at brick size, with bricks grown by a small margin so that
+// rounding can only add bricks the voxel pass then leaves empty.
+template<typename T>
+void binTrianglesToBricks(const Triangle3<T> *triangles, size_t count, const Box3<T> &bounds,
+    const Point3u &resolution, std::vector<uint64> &keys, std::vector<uint32> &indices)
+{
+    const Vector3<T> scale = voxelScale(bounds, resolution);
+    const T brick_scale = static_cast<T>(1) / static_cast<T>(VOXEL_BRICK_SIZE);
+    const T margin = static_cast<T>(1) / static_cast<T>(64 * VOXEL_BRICK_SIZE);
+    Point3u brick_resolution;
+    for (index_t k = 0; k < 3; ++k)
+        brick_resolution[k] = (resolution[k] + VOXEL_BRICK_SIZE - 1) / VOXEL_BRICK_SIZE;
+    const size_t chunk_count = min(workerCount() * 4, max(count / VOXELIZE_GRAIN_SIZE, static_cast<size_t>(1)));
+    std::vector<std::vector<uint64>> chunk_keys(chunk_count);
+    std::vector<std::vector<uint32>> chunk_indices(chunk_count);
+
+    parallelForChunks(count, chunk_count, [&](size_t chunk, size_t begin, size_t end)
+    {
+        std::vector<uint64> &local_keys = chunk_keys[chunk];
+        std::vector<uint32> &local_indices = chunk_indices[chunk];
+        for (index_t i = begin; i < end; ++i)
+        {
+            // Scaling by a power of two is exact, the bricks see the same triangle as the voxels
+            const Triangle3<T> local = toVoxelUnits(triangles[i], bounds.min(), scale * brick_scale);
+            Point3u first, last;
+            if (!voxelRange(local, brick_resolution, first, last, margin))
+                continue;
+
+            const auto emit = [&](uint32 x, uint32 y, uint32 z)
+            {
+                local_keys.push_back(encodeMorton64(x, y, z));
+                local_indices.push_back(static_cast<uint32>(i));
+            };
+
+            if (first == last)
+                emit(first[0], first[1], first[2]);
+            else
+                TriangleRasterizer<T>(local, margin).rasterize(first, last, emit);
+        }
+    });
+
+    std::vector<size_t> offsets(chunk_count + 1, 0);
+    for (index_t chunk = 0; chunk < chunk_count; ++chunk)
+        offsets[chunk + 1] = offsets[chunk] + chunk_keys[chunk].size();
+
+    keys.resize(offsets[chunk_count]);
+    indices.resize(offsets[chunk_count]);
+    parallelFor(0, chunk_count, 1, [&](size_t begin, size_t end)
+    {
+        for (index_t chunk = begin; chunk < end; ++chunk)
+        {
+            std::copy(chunk_keys[chunk].begin(), chunk_keys[chunk].end(), keys.begin() + offsets[chunk]);
+            std::copy(chunk_indices[chunk].begin(), chunk_indices[chunk].end(), indices.begin() + offsets[chunk]);
+        }
+    });
+
+    uint32 brick_bits = 1;
+    const uint32 max_bricks = max(resolution[0], resolution[1], resolution[2]) / VOXEL_BRICK_SIZE + 1;
+    while ((1U << brick_bits) < max_bricks)
+        ++brick_bits;
+    parallelRadixSort(keys.data(), indices.data(), keys.size(), 3 * brick_bits);
+}
+
+// Start of every run of equal keys, followed by the key count
+FMATH_INLINE std::vector<size_t> keyRuns(const std::vector<uint64> &keys)
+{
+    std::vector<size_t> runs;
+    for (index_t i = 0; i < keys.size(); ++i)
+    {
+        if (i == 0 || keys[i] != keys[i - 1])
+            runs.push_back(i);
+    }
+    runs.push_back(keys.size());
+    return runs;
+}
+
+// Rasterizes the triangles of a run into the 8 words of its brick
+template<typename T>
+FMATH_INLINE void fillBrick(const Triangle3<T> *triangles, const uint32 *indices, size_t count, uint64 key,
+    const Box3<T> &bounds, const Point3u &resolution, const Vector3<T> &scale, uint64 *words)
+{
+    Point3u brick_first, brick_last;
+    decodeMorton64(key, brick_first[0], brick_first[1], brick_first[2]);
+    for (index_t k = 0; k < 3; ++k)
+    {
+        brick_first[k] *= VOXEL_BRICK_SIZE;
+        brick_last[k] = min(brick_first[k] + VOXEL_BRICK_SIZE - 1, resolution[k] - 1);
+    }
+
+    for (index_t i = 0; i < count; ++i)
+    {
+        const Triangle3<T> local = toVoxelUnits(triangles[indices[i]], bounds.min(), scale);
+        Point3u first, last;
+        if (!voxelRange(local, resolution, first, last))
+            continue;
+
+        for (index_t k = 0; k < 3; ++k)
+        {
+            first[k] = max(first[k], brick_first[k]);
+            last[k] = min(last[k], brick_last[k]);
+        }
+
+        if (first[0] > last[0] || first[1] > last[1] || first[2] > last[2])
+            continue;
+
+        TriangleRasterizer<T>(local).rasterize(first, last, [words](uint32 x, uint32 y, uint32 z)
+        {
+            words[brickWordIndex(x, y, z)] |= voxelBit(x, y, z);
+        });
+    }
+}
+
+}
+
+template<typename T>
+VoxelGrid<T>::VoxelGrid(const Box3<ValueType> &bounds, const Point3u &resolution)
+    : bounds_(bounds), resolution_(resolution)
+{
+    for (index_t i = 0; i < 3; ++i)
+        word_resolution_[i] = (resolution[i] + WORD_SIZE - 1) / WORD_SIZE;
+    words_.assign(static_cast<size_t>(word_resolution_[0]) * word_resolution_[1] * word_resolution_[2], 0);
+}
+
+template<typename T>
+void VoxelGrid<T>::voxelize(const Triangle3<ValueType> *triangles, size_t count, VoxelizePartition partition)
+{
+    const Vector3<ValueType> scale = internal::voxelScale(bounds_, resolution_);
+    if (partition == VoxelizePartition::Bricks)
+    {
+        std::vector<uint64> keys;
+        std::vector<uint32> indices;
+        internal::binTrianglesToBricks(triangles, count, bounds_, resolution_, keys, indices);
+        const std::vector<size_t> runs = internal::keyRuns(keys);
+
+        // Bricks cover whole words, so every word is written by the one thread filling its brick
+        internal::parallelFor(0, runs.size() - 1, internal::VOXELIZE_BRICK_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t run = begin; run < end; ++run)
+            {
+                uint64 brick[SparseVoxelGrid<ValueType>::BRICK_WORDS] = {};
+                internal::fillBrick(triangles, indices.data() + runs[run], runs[run + 1] - runs[run], keys[runs[run]],
+                    bounds_, resolution_, scale, brick);
+
+                uint32 x, y, z;
+                decodeMorton64(keys[runs[run]], x, y, z);
+                for (uint32 i = 0; i < SparseVoxelGrid<ValueType>::BRICK_WORDS; ++i)
+                {
+                    const uint32 wx = 2 * x + (i & 1U);
+                    const uint32 wy = 2 * y + (i >> 1 & 1U);
+                    const uint32 wz = 2 * z + (i >> 2);
+                    if (brick[i] != 0)
+                        word(wx, wy, wz) |= brick[i];
+                }
+            }
+        });
+        return;
+    }
+
+    const size_t word_count = words_.size();
+    std::unique_ptr<std::atomic<uint64>[]> shared(new std::atomic<uint64>[word_count]);
+    internal::parallelFor(0, word_count, internal::VOXELIZE_WORD_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            shared[i].store(words_[i], std::memory_order_relaxed);
+    });
+
+    internal::parallelFor(0, count, internal::VOXELIZE_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        // Voxels come in columns, so bits are gathered per word and merged once the word changes
+        size_t pending_word = word_count;
+        uint64 pending = 0;
+        for (index_t i = begin; i < end; ++i)
+        {
+            const Triangle3<ValueType> local = internal::toVoxelUnits(triangles[i], bounds_.min(), scale);
+            Point3u first, last;
+            if (!internal::voxelRange(local, resolution_, first, last))
+                continue;
+
+            internal::TriangleRasterizer<ValueType>(local).rasterize(first, last, [&](uint32 x, uint32 y, uint32 z)
+            {
+                const size_t index = wordIndex(x / WORD_SIZE, y / WORD_SIZE, z / WORD_SIZE);
+                if (index != pending_word)
+                {
+                    if (pending_word != word_count)
+                        shared[pending_word].fetch_or(pending, std::memory_order_relaxed);
+                    pending_word = index;
+                    pending = 0;
+                }
+                pending |= internal::voxelBit(x, y, z);
+            });
+        }
+        if (pending_word != word_count)
+            shared[pending_word].fetch_or(pending, std::memory_order_relaxed);
+    });
+
+    internal::parallelFor(0, word_count, internal::VOXELIZE_WORD_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t i = begin; i < end; ++i)
+            words_[i] = shared[i].load(std::memory_order_relaxed);
+    });
+}
+
+template<typename T>
+FMATH_INLINE const Box3<T> &VoxelGrid<T>::bounds() const
+{
+    return bounds_;
+}
+
+template<typename T>
+FMATH_INLINE const Point3u &VoxelGrid<T>::resolution() const
+{
+    return resolution_;
+}
+
+template<typename T>
+FMATH_INLINE Vector3<T> VoxelGrid<T>::voxelSize() const
+{
+    const Vector3<ValueType> size = bounds_.diagonal();
+    return Vector3<ValueType>(size[0] / static_cast<ValueType>(resolution_[0]),
+        size[1] / static_cast<ValueType>(resolution_[1]), size[2] / static_cast<ValueType>(resolution_[2]));
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> VoxelGrid<T>::voxelBounds(uint32 x, uint32 y, uint32 z) const
+{
+    const Vector3<ValueType> size = voxelSize();
+    const Point3<ValueType> low = bounds_.min() + Vector3<ValueType>(static_cast<ValueType>(x) * size[0],
+        static_cast<ValueType>(y) * size[1], static_cast<ValueType>(z) * size[2]);
+    return Box3<ValueType>(low, low + size);
+}
+
+template<typename T>
+FMATH_INLINE bool VoxelGrid<T>::get(uint32 x, uint32 y, uint32 z) const
+{
+    FMATH_ASSERT(x < resolution_[0] && y < resolution_[1] && z < resolution_[2]);
+    return (words_[wordIndex(x / WORD_SIZE, y / WORD_SIZE, z / WORD_SIZE)] & internal::voxelBit(x, y, z)) != 0;
+}
+
+template<typename T>
+FMATH_INLINE void VoxelGrid<T>::set(uint32 x, uint32 y, uint32 z, bool value)
+{
+    FMATH_ASSERT(x < resolution_[0] && y < resolution_[1] && z < resolution_[2]);
+    uint64 &bits = words_[wordIndex(x / WORD_SIZE, y / WORD_SIZE, z / WORD_SIZE)];
+    bits = value ? bits | internal::voxelBit(x, y, z) : bits & ~internal::voxelBit(x, y, z);
+}
+
+template<typename T>
+FMATH_INLINE const Point3u &VoxelGrid<T>::wordResolution() const
+{
+    return word_resolution_;
+}
+
+template<typename T>
+FMATH_INLINE uint64 VoxelGrid<T>::word(uint32 x, uint32 y, uint32 z) const
+{
+    return words_[wordIndex(x, y, z)];
+}
+
+template<typename T>
+FMATH_INLINE uint64 &VoxelGrid<T>::word(uint32 x, uint32 y, uint32 z)
+{
+    return words_[wordIndex(x, y, z)];
+}
+
+template<typename T>
+FMATH_INLINE const std::vector<uint64> &VoxelGrid<T>::words() const
+{
+    return words_;
+}
+
+template<typename T>
+size_t VoxelGrid<T>::count() const
+{
+    size_t result = 0;
+    for (uint64 bits : words_)
+        result += internal::countBits(bits);
+    return result;
+}
+
+template<typename T>
+void VoxelGrid<T>::clear()
+{
+    std::fill(words_.begin(), words_.end(), 0);
+}
+
+template<typename T>
+FMATH_INLINE size_t VoxelGrid<T>::wordIndex(uint32 x, uint32 y, uint32 z) const
+{
+    FMATH_ASSERT(x < word_resolution_[0] && y < word_resolution_[1] && z < word_resolution_[2]);
+    return x + word_resolution_[0] * (y + static_cast<size_t>(word_resolution_[1]) * z);
+}
+
+template<typename T>
+SparseVoxelGrid<T>::SparseVoxelGrid(const Box3<ValueType> &bounds, const Point3u &resolution)
+    : bounds_(bounds), resolution_(resolution)
+{
+    FMATH_ASSERT(resolution[0] <= internal::MAX_SPARSE_VOXEL_RESOLUTION &&
+        resolution[1] <= internal::MAX_SPARSE_VOXEL_RESOLUTION &&
+        resolution[2] <= internal::MAX_SPARSE_VOXEL_RESOLUTION);
+}
+
+template<typename T>
+void SparseVoxelGrid<T>::voxelize(const Triangle3<ValueType> *triangles, size_t count, VoxelizePartition partition)
+{
+    const Vector3<ValueType> scale = internal::voxelScale(bounds_, resolution_);
+    std::vector<uint64> keys;
+    std::vector<uint32> indices;
+    internal::binTrianglesToBricks(triangles, count, bounds_, resolution_, keys, indices);
+    const std::vector<size_t> runs = internal::keyRuns(keys);
+    const size_t brick_count = runs.size() - 1;
+
+    keys_.resize(brick_count);
+    words_.assign(brick_count * BRICK_WORDS, 0);
+    if (partition == VoxelizePartition::Bricks)
+    {
+        internal::parallelFor(0, brick_count, internal::VOXELIZE_BRICK_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t run = begin; run < end; ++run)
+            {
+                keys_[run] = keys[runs[run]];
+                internal::fillBrick(triangles, indices.data() + runs[run], runs[run + 1] - runs[run], keys_[run],
+                    bounds_, resolution_, scale, words_.data() + run * BRICK_WORDS);
+            }
+        });
+    }
+    else
+    {
+        // The binning only fixes the set of bricks here, the triangles are then rasterized in input order
+        for (index_t run = 0; run < brick_count; ++run)
+            keys_[run] = keys[runs[run]];
+
+        const size_t word_count = words_.size();
+        std::unique_ptr<std::atomic<uint64>[]> shared(new std::atomic<uint64>[word_count]);
+        internal::parallelFor(0, word_count, internal::VOXELIZE_WORD_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                shared[i].store(0, std::memory_order_relaxed);
+        });
+
+        internal::parallelFor(0, count, internal::VOXELIZE_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            size_t pending_word = word_count;
+            uint64 pending = 0;
+            uint64 last_key = ~0ULL;
+            size_t last_brick = NONE;
+            for (index_t i = begin; i < end; ++i)
+            {
+                const Triangle3<ValueType> local = internal::toVoxelUnits(triangles[i], bounds_.min(), scale);
+                Point3u first, last;
+                if (!internal::voxelRange(local, resolution_, first, last))
+                    continue;
+
+                internal::TriangleRasterizer<ValueType>(local).rasterize(first, last, [&](uint32 x, uint32 y, uint32 z)
+                {
+                    const uint64 key = encodeMorton64(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE);
+                    if (key != last_key)
+                    {
+                        last_key = key;
+                        last_brick = findBrick(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE);
+                    }
+                    FMATH_ASSERT(last_brick != NONE);
+
+                    const size_t index = last_brick * BRICK_WORDS + internal::brickWordIndex(x, y, z);
+                    if (index != pending_word)
+                    {
+                        if (pending_word != word_count)
+                            shared[pending_word].fetch_or(pending, std::memory_order_relaxed);
+                        pending_word = index;
+                        pending = 0;
+                    }
+                    pending |= internal::voxelBit(x, y, z);
+                });
+            }
+            if (pending_word != word_count)
+                shared[pending_word].fetch_or(pending, std::memory_order_relaxed);
+        });
+
+        internal::parallelFor(0, word_count, internal::VOXELIZE_WORD_GRAIN_SIZE, [&](size_t begin, size_t end)
+        {
+            for (index_t i = begin; i < end; ++i)
+                words_[i] = shared[i].load(std::memory_order_relaxed);
+        });
+    }
+
+    // Bricks the widened binning test let through without any voxel
+    size_t kept = 0;
+    for (index_t brick = 0; brick < brick_count; ++brick)
+    {
+        const uint64 *bits = words_.data() + brick * BRICK_WORDS;
+        if (std::all_of(bits, bits + BRICK_WORDS, [](uint64 word) { return word == 0; }))
+            continue;
+
+        if (kept != brick)
+        {
+            keys_[kept] = keys_[brick];
+            std::copy(bits, bits + BRICK_WORDS, words_.data() + kept * BRICK_WORDS);
+        }
+        ++kept;
+    }
+    keys_.resize(kept);
+    words_.resize(kept * BRICK_WORDS);
+}
+
+template<typename T>
+FMATH_INLINE const Box3<T> &SparseVoxelGrid<T>::bounds() const
+{
+    return bounds_;
+}
+
+template<typename T>
+FMATH_INLINE const Point3u &SparseVoxelGrid<T>::resolution() const
+{
+    return resolution_;
+}
+
+template<typename T>
+FMATH_INLINE Vector3<T> SparseVoxelGrid<T>::voxelSize() const
+{
+    const Vector3<ValueType> size = bounds_.diagonal();
+    return Vector3<ValueType>(size[0] / static_cast<ValueType>(resolution_[0]),
+        size[1] / static_cast<ValueType>(resolution_[1]), size[2] / static_cast<ValueType>(resolution_[2]));
+}
+
+template<typename T>
+FMATH_INLINE Box3<T> SparseVoxelGrid<T>::voxelBounds(uint32 x, uint32 y, uint32 z) const
+{
+    const Vector3<ValueType> size = voxelSize();
+    const Point3<ValueType> low = bounds_.min() + Vector3<ValueType>(static_cast<ValueType>(x) * size[0],
+        static_cast<ValueType>(y) * size[1], static_cast<ValueType>(z) * size[2]);
+    return Box3<ValueType>(low, low + size);
+}
+
+template<typename T>
+FMATH_INLINE bool SparseVoxelGrid<T>::get(uint32 x, uint32 y, uint32 z) const
+{
+    FMATH_ASSERT(x < resolution_[0] && y < resolution_[1] && z < resolution_[2]);
+    const size_t brick = findBrick(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE);
+    return brick != NONE &&
+        (words_[brick * BRICK_WORDS + internal::brickWordIndex(x, y, z)] & internal::voxelBit(x, y, z)) != 0;
+}
+
+template<typename T>
+FMATH_INLINE size_t SparseVoxelGrid<T>::brickCount() const
+{
+    return keys_.size();
+}
+
+template<typename T>
+FMATH_INLINE size_t SparseVoxelGrid<T>::findBrick(uint32 x, uint32 y, uint32 z) const
+{
+    const uint64 key = encodeMorton64(x, y, z);
+    const auto found = std::lower_bound(keys_.begin(), keys_.end(), key);
+    return found != keys_.end() && *found == key ? static_cast<size_t>(found - keys_.begin()) : NONE;
+}
+
+template<typename T>
+FMATH_INLINE Point3u SparseVoxelGrid<T>::brickCoordinates(index_t brick) const
+{
+    Point3u result;
+    decodeMorton64(keys_[brick], result[0], result[1], result[2]);
+    return result;
+}
+
+template<typename T>
+FMATH_INLINE const uint64 *SparseVoxelGrid<T>::brickWords(index_t brick) const
+{
+    return words_.data() + brick * BRICK_WORDS;
+}
+
+template<typename T>
+size_t SparseVoxelGrid<T>::count() const
+{
+    size_t result = 0;
+    for (uint64 bits : words_)
+        result += internal::countBits(bits);
+    return result;
+}
+
+template<typename T>
+VoxelGrid<T> SparseVoxelGrid<T>::toDense() const
+{
+    VoxelGrid<ValueType> result(bounds_, resolution_);
+    const Point3u &word_resolution = result.wordResolution();
+    internal::parallelFor(0, keys_.size(), internal::VOXELIZE_BRICK_GRAIN_SIZE, [&](size_t begin, size_t end)
+    {
+        for (index_t brick = begin; brick < end; ++brick)
+        {
+            const Point3u coordinates = brickCoordinates(brick);
+            for (uint32 i = 0; i < BRICK_WORDS; ++i)
+            {
+                const uint32 wx = 2 * coordinates[0] + (i & 1U);
+                const uint32 wy = 2 * coordinates[1] + (i >> 1 & 1U);
+                const uint32 wz = 2 * coordinates[2] + (i >> 2);
+                if (wx < word_resolution[0] && wy < word_resolution[1] && wz < word_resolution[2])
+                    result.word(wx, wy, wz) = words_[brick * BRICK_WORDS + i];
+            }
+        }
+    });
+    return result;
+}
+
+template<typename T>
+void SparseVoxelGrid<T>::clear()
+{
+    keys_.clear();
+    words_.clear();
+}
+
+}
+
+#endif
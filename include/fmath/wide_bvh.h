@@ -0,0 +1,385 @@
+#ifndef _FMATH_WIDE_BVH_H_
+#define _FMATH_WIDE_BVH_H_
+
+#include <array>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bvh.h"
+#include "box.h"
+#include "common.h"
+#include "constants.h"
+#include "ray.h"
+#include "triangle.h"
+
+namespace fmath
+{
+
+// W children with their bounds stored as a Box3Block, 128 bytes for float and W = 4, 256 bytes for W = 8. A child
+// with a count of 0 is the inner node at children[i], otherwise a leaf referencing count entries of the primitive
+// index array starting at children[i]. Unused slots have empty bounds and EMPTY_CHILD as reference.
+template<typename T, size_t W>
+struct WideBvhNode
+{
+    static constexpr uint32 EMPTY_CHILD = ~0U;
+
+    Box3Block<T, W> bounds;
+    uint32 children[W];
+    uint32 counts[W];
+
+    FMATH_INLINE bool isLeaf(index_t slot) const;
+
+    FMATH_INLINE bool isEmpty(index_t slot) const;
+};
+
+static_assert(sizeof(WideBvhNode<float, 4>) == 128, "WideBvhNode<float, 4> must fill two cache lines");
+
+// Bvh collapsed into W-wide nodes, so that a single SIMD slab test covers all children of a node. Built from a binary
+// Bvh by repeatedly opening the inner child with the largest surface area until W slots are filled, the primitive
+// order and indices are kept. Traversal visits the children it hits front to back.
+template<typename T, size_t W>
+class WideBvh
+{
+public:
+    using ValueType = T;
+    using NodeType = WideBvhNode<T, W>;
+    static constexpr size_t WIDTH = W;
+
+    // Every node pushes at most W - 1 entries more than it pops
+    static constexpr size_t STACK_SIZE = Bvh<T>::STACK_SIZE * (W - 1) + 1;
+
+    static_assert(W >= 2 && W <= 32, "Width of WideBvh must be between 2 and 32");
+
+public:
+    WideBvh() = default;
+
+    explicit WideBvh(const Bvh<ValueType> &bvh);
+
+    FMATH_INLINE bool empty() const;
+
+    FMATH_INLINE size_t nodeCount() const;
+
+    FMATH_INLINE const NodeType *nodes() const;
+
+    FMATH_INLINE size_t primitiveCount() const;
+
+    // Input index of every primitive in leaf order
+    FMATH_INLINE const uint32 *primitiveIndices() const;
+
+    FMATH_INLINE Box3<ValueType> bounds() const;
+
+    // Same contracts as the traversals of Bvh
+    template<typename IntersectorT>
+    bool intersect(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector, ValueType &t) const;
+
+    bool intersect(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles,
+        RayHit<ValueType> &hit) const;
+
+    template<typename IntersectorT,
+        typename = std::enable_if_t<!std::is_pointer_v<std::remove_reference_t<IntersectorT>>>>
+    bool occluded(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector) const;
+
+    bool occluded(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles) const;
+
+private:
+    std::vector<NodeType> nodes_;
+    std::vector<uint32> indices_;
+};
+
+template<typename T>
+using Bvh4 = WideBvh<T, 4>;
+
+template<typename T>
+using Bvh8 = WideBvh<T, 8>;
+
+using Bvh4f = Bvh4<float>;
+using Bvh4lf = Bvh4<double>;
+using Bvh8f = Bvh8<float>;
+using Bvh8lf = Bvh8<double>;
+
+template<typename T, size_t W>
+FMATH_INLINE bool WideBvhNode<T, W>::isLeaf(index_t slot) const
+{
+    return counts[slot] != 0;
+}
+
+template<typename T, size_t W>
+FMATH_INLINE bool WideBvhNode<T, W>::isEmpty(index_t slot) const
+{
+    return children[slot] == EMPTY_CHILD;
+}
+
+template<typename T, size_t W>
+WideBvh<T, W>::WideBvh(const Bvh<ValueType> &bvh)
+    :   indices_(bvh.primitiveIndices(), bvh.primitiveIndices() + bvh.primitiveCount())
+{
+    if (bvh.empty())
+        return;
+
+    const BvhNode<ValueType> *source = bvh.nodes();
+    const auto half_area = [](const BvhNode<ValueType> &node)
+    {
+        return internal::halfArea(node.lower, node.upper);
+    };
+
+    // A leaf root still gets an inner node above it, traversal always starts with a node test
+    nodes_.emplace_back();
+    std::vector<std::pair<uint32, uint32>> stack { { 0U, 0U } };
+    while (!stack.empty())
+    {
+        const auto [from, to] = stack.back();
+        stack.pop_back();
+
+        std::array<uint32, W> slots;
+        size_t slot_count = 0;
+        if (source[from].count != 0)
+        {
+            slots[slot_count++] = from;
+        }
+        else
+        {
+            slots[slot_count++] = source[from].first;
+            slots[slot_count++] = source[from].first + 1;
+        }
+        while (slot_count < W)
+        {
+            index_t largest = W;
+            for (index_t i = 0; i < slot_count; ++i)
+            {
+                if (source[slots[i]].count == 0 && (largest == W || half_area(source[slots[i]]) >
+                    half_area(source[slots[largest]])))
+                    largest = i;
+            }
+            if (largest == W)
+                break;
+
+            const uint32 opened = slots[largest];
+            slots[largest] = source[opened].first;
+            slots[slot_count++] = source[opened].first + 1;
+        }
+
+        NodeType node;
+        node.bounds = Box3Block<ValueType, W>::makeEmpty();
+        for (index_t i = 0; i < W; ++i)
+        {
+            if (i >= slot_count)
+            {
+                node.children[i] = NodeType::EMPTY_CHILD;
+                node.counts[i] = 0;
+                continue;
+            }
+
+            const BvhNode<ValueType> &child = source[slots[i]];
+            node.bounds.set(i, child.bounds());
+            node.counts[i] = child.count;
+            if (child.count != 0)
+            {
+                node.children[i] = child.first;
+                continue;
+            }
+            node.children[i] = static_cast<uint32>(nodes_.size());
+            nodes_.emplace_back();
+            stack.emplace_back(slots[i], node.children[i]);
+        }
+        nodes_[to] = node;
+    }
+}
+
+template<typename T, size_t W>
+FMATH_INLINE bool WideBvh<T, W>::empty() const
+{
+    return nodes_.empty();
+}
+
+template<typename T, size_t W>
+FMATH_INLINE size_t WideBvh<T, W>::nodeCount() const
+{
+    return nodes_.size();
+}
+
+template<typename T, size_t W>
+FMATH_INLINE const WideBvhNode<T, W> *WideBvh<T, W>::nodes() const
+{
+    return nodes_.data();
+}
+
+template<typename T, size_t W>
+FMATH_INLINE size_t WideBvh<T, W>::primitiveCount() const
+{
+    return indices_.size();
+}
+
+template<typename T, size_t W>
+FMATH_INLINE const uint32 *WideBvh<T, W>::primitiveIndices() const
+{
+    return indices_.data();
+}
+
+template<typename T, size_t W>
+FMATH_INLINE Box3<T> WideBvh<T, W>::bounds() const
+{
+    Box3<ValueType> result = Box3<ValueType>::makeEmpty();
+    if (empty())
+        return result;
+
+    for (index_t i = 0; i < W; ++i)
+    {
+        if (!nodes_[0].isEmpty(i))
+        {
+            const Box3<ValueType> box = nodes_[0].bounds.get(i);
+            result = Box3<ValueType>(componentWiseMin(result.min(), box.min()),
+                componentWiseMax(result.max(), box.max()));
+        }
+    }
+    return result;
+}
+
+template<typename T, size_t W>
+    template<typename IntersectorT>
+bool WideBvh<T, W>::intersect(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector, ValueType &t) const
+{
+    struct Entry
+    {
+        uint32 child;
+        uint32 count;
+        ValueType t_near;
+    };
+
+    if (empty())
+        return false;
+
+    RayPrecomputed<ValueType> current = ray;
+    bool hit = false;
+    Entry stack[STACK_SIZE];
+    size_t top = 0;
+    Entry entry { 0U, 0U, ray.t_min };
+    while (true)
+    {
+        if (entry.count != 0)
+        {
+            for (index_t i = entry.child; i < entry.child + entry.count; ++i)
+            {
+                ValueType t_hit;
+                if (intersector(indices_[i], static_cast<const RayPrecomputed<ValueType> &>(current), t_hit))
+                {
+                    current.t_max = t_hit;
+                    hit = true;
+                }
+            }
+        }
+        else
+        {
+            // Hit children are sorted by distance, the nearest one is visited next and the others pushed far to near
+            const NodeType &node = nodes_[entry.child];
+            ValueType t_near[W];
+            const uint32 mask = fmath::intersect(current, node.bounds, t_near);
+            Entry hits[W];
+            size_t hit_count = 0;
+            for (index_t slot = 0; slot < W; ++slot)
+            {
+                if ((mask & (1U << slot)) == 0 || node.isEmpty(slot))
+                    continue;
+
+                const Entry child { node.children[slot], node.counts[slot], t_near[slot] };
+                size_t j = hit_count++;
+                for (; j > 0 && hits[j - 1].t_near < child.t_near; --j)
+                    hits[j] = hits[j - 1];
+                hits[j] = child;
+            }
+            if (hit_count != 0)
+            {
+                for (index_t i = 0; i + 1 < hit_count; ++i)
+                    stack[top++] = hits[i];
+                entry = hits[hit_count - 1];
+                continue;
+            }
+        }
+
+        // Entries pushed before t_max shrank may lie behind the closest hit by now
+        do
+        {
+            if (top == 0)
+            {
+                if (hit)
+                    t = current.t_max;
+                return hit;
+            }
+            entry = stack[--top];
+        } while (entry.t_near > current.t_max);
+    }
+}
+
+template<typename T, size_t W>
+bool WideBvh<T, W>::intersect(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles,
+    RayHit<ValueType> &hit) const
+{
+    ValueType u = 0, v = 0;
+    uint32 primitive = 0;
+    ValueType t;
+    const bool found = intersect(ray, [&](uint32 index, const RayPrecomputed<ValueType> &r, ValueType &t_hit)
+    {
+        ValueType u_hit, v_hit;
+        if (!fmath::intersect(r, triangles[index], t_hit, u_hit, v_hit))
+            return false;
+        u = u_hit;
+        v = v_hit;
+        primitive = index;
+        return true;
+    }, t);
+
+    if (found)
+        hit = RayHit<ValueType> { t, u, v, primitive };
+    return found;
+}
+
+template<typename T, size_t W>
+    template<typename IntersectorT, typename>
+bool WideBvh<T, W>::occluded(const RayPrecomputed<ValueType> &ray, IntersectorT &&intersector) const
+{
+    if (empty())
+        return false;
+
+    // No ordering, any hit ends the traversal
+    uint32 stack[STACK_SIZE];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        const NodeType &node = nodes_[stack[--top]];
+        ValueType t_near[W];
+        const uint32 mask = fmath::intersect(ray, node.bounds, t_near);
+        for (index_t slot = 0; slot < W; ++slot)
+        {
+            if ((mask & (1U << slot)) == 0 || node.isEmpty(slot))
+                continue;
+
+            if (!node.isLeaf(slot))
+            {
+                stack[top++] = node.children[slot];
+                continue;
+            }
+            for (index_t i = node.children[slot]; i < node.children[slot] + node.counts[slot]; ++i)
+            {
+                ValueType t_hit;
+                if (intersector(indices_[i], ray, t_hit))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+template<typename T, size_t W>
+bool WideBvh<T, W>::occluded(const RayPrecomputed<ValueType> &ray, const Triangle3<ValueType> *triangles) const
+{
+    return occluded(ray, [triangles](uint32 index, const RayPrecomputed<ValueType> &r, ValueType &t_hit)
+    {
+        ValueType u, v;
+        return fmath::intersect(r, triangles[index], t_hit, u, v);
+    });
+}
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace fmath;
+
+namespace
+{
+
+double segmentDistance2(const Point3lf &point, const Point3lf &start, const Point3lf &end)
+{
+    return distance2(Line3<double>(start, end), Line3<double>(point, point));
+}
+
+double edgeDistance2(const Point3lf &point, const Triangle3lf &triangle)
+{
+    return std::min({ segmentDistance2(point, triangle[0], triangle[1]),
+        segmentDistance2(point, triangle[1], triangle[2]), segmentDistance2(point, triangle[2], triangle[0]) });
+}
+
+// Collinear triangles, triangles with a repeated vertex and triangles collapsed to a point
+std::vector<Triangle3lf> makeFlatTriangles(size_t count)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> coordinate(-3, 3);
+    std::uniform_real_distribution<double> along(-0.5, 1.5);
+    std::vector<Triangle3lf> result;
+    for (index_t i = 0; i < count; ++i)
+    {
+        const Point3lf a(coordinate(rng), coordinate(rng), coordinate(rng));
+        const Point3lf b(coordinate(rng), coordinate(rng), coordinate(rng));
+        if (i % 3 == 0)
+            result.emplace_back(a, b, a + (b - a) * along(rng));
+        else if (i % 3 == 1)
+            result.emplace_back(a, a, b);
+        else
+            result.emplace_back(a, a, a);
+    }
+    return result;
+}
+
+}
+
+TEST(DistanceTest, ClosestPointOnCollinearTriangle)
+{
+    // The closest point of (3, 1, 0) is the end (2, 0, 0) of the segment the triangle collapses to, the face branch
+    // used to divide by the zero area and land outside of the triangle
+    const Triangle3lf triangle(Point3lf(0, 0, 0), Point3lf(2, 0, 0), Point3lf(1, 0, 0));
+    const TriangleClosestPoint<double> result = closestPoint(Point3lf(3, 1, 0), triangle);
+    EXPECT_NEAR(result.distance2, 2.0, 1e-12);
+    EXPECT_GE(result.u, 0.0);
+    EXPECT_GE(result.v, 0.0);
+    EXPECT_LE(result.u + result.v, 1.0);
+    EXPECT_NEAR(result.point[0], 2.0, 1e-12);
+}
+
+TEST(DistanceTest, ClosestPointOnFlatTriangles)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> coordinate(-3, 3);
+    for (const Triangle3lf &triangle : makeFlatTriangles(3000))
+    {
+        const Point3lf point(coordinate(rng), coordinate(rng), coordinate(rng));
+        const TriangleClosestPoint<double> result = closestPoint(point, triangle);
+        const double expected = edgeDistance2(point, triangle);
+        ASSERT_NEAR(result.distance2, expected, 1e-9 * max(expected, 1.0));
+
+        // The barycentrics describe the closest point
+        EXPECT_GE(result.u, 0.0);
+        EXPECT_GE(result.v, 0.0);
+        EXPECT_LE(result.u + result.v, 1.0 + 1e-12);
+        const Point3lf on = triangle[0] + (triangle[1] - triangle[0]) * result.u + (triangle[2] - triangle[0]) * result.v;
+        EXPECT_NEAR(distance2(point, on), result.distance2, 1e-9 * max(expected, 1.0));
+    }
+}
+
+TEST(DistanceTest, BlockMatchesScalarOnFlatTriangles)
+{
+    constexpr size_t W = 4;
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<double> coordinate(-3, 3);
+    const std::vector<Triangle3lf> triangles = makeFlatTriangles(3000);
+    for (index_t i = 0; i + W <= triangles.size(); i += W)
+    {
+        Triangle3Block<double, W> block;
+        for (index_t l = 0; l < W; ++l)
+            block.set(l, triangles[i + l]);
+
+        const Point3lf point(coordinate(rng), coordinate(rng), coordinate(rng));
+        alignas(32) double distance2[W];
+        alignas(32) double u[W];
+        alignas(32) double v[W];
+        closestPoint(point, block, distance2, u, v);
+        for (index_t l = 0; l < W; ++l)
+        {
+            const double expected = closestPoint(point, triangles[i + l]).distance2;
+            ASSERT_NEAR(distance2[l], expected, 1e-9 * max(expected, 1.0));
+        }
+    }
+}
+
+TEST(DistanceTest, BlockEmptyLanesAreInfinitelyFar)
+{
+    constexpr size_t W = 4;
+    Triangle3Block<double, W> block = Triangle3Block<double, W>::makeEmpty();
+    block.set(1, Triangle3lf(Point3lf(5, 0, 0), Point3lf(6, 0, 0), Point3lf(5, 1, 0)));
+
+    alignas(32) double distance2[W];
+    alignas(32) double u[W];
+    alignas(32) double v[W];
+    closestPoint(Point3lf(0.1, 0, 0), block, distance2, u, v);
+    EXPECT_EQ(distance2[0], constants::Inf<double>::value);
+    EXPECT_NEAR(distance2[1], 4.9 * 4.9, 1e-12);
+    EXPECT_EQ(distance2[2], constants::Inf<double>::value);
+    EXPECT_EQ(distance2[3], constants::Inf<double>::value);
+}
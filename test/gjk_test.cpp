@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+#include <cmath>
+#include <random>
+
+using namespace fmath;
+
+namespace
+{
+
+Box3<double> makeBox(const Point3lf &center, const Vector3lf &half_size)
+{
+    return Box3<double>(center - half_size, center + half_size);
+}
+
+// Gap between the boxes on every axis, zero where their extents overlap
+Vector3lf boxGap(const Box3<double> &box1, const Box3<double> &box2)
+{
+    Vector3lf gap;
+    for (index_t i = 0; i < 3; ++i)
+        gap[i] = max(max(box1.min()[i] - box2.max()[i], box2.min()[i] - box1.max()[i]), 0.0);
+    return gap;
+}
+
+// Smallest translation of the second box along an axis that separates overlapping boxes
+double boxPenetration(const Box3<double> &box1, const Box3<double> &box2)
+{
+    double depth = constants::Inf<double>::value;
+    for (index_t i = 0; i < 3; ++i)
+        depth = min(depth, min(box1.max()[i] - box2.min()[i], box2.max()[i] - box1.min()[i]));
+    return depth;
+}
+
+void expectInside(const Point3lf &point, const Box3<double> &box, double epsilon)
+{
+    for (index_t i = 0; i < 3; ++i)
+    {
+        EXPECT_GE(point[i], box.min()[i] - epsilon) << "component " << i;
+        EXPECT_LE(point[i], box.max()[i] + epsilon) << "component " << i;
+    }
+}
+
+}
+
+TEST(GjkTest, SeparatedBoxes)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> position(-4, 4);
+    std::uniform_real_distribution<double> size(0.1, 1.5);
+    size_t separated = 0;
+    for (index_t i = 0; i < 500; ++i)
+    {
+        const Box3<double> box1 = makeBox(Point3lf(position(rng), position(rng), position(rng)),
+            Vector3lf(size(rng), size(rng), size(rng)));
+        const Box3<double> box2 = makeBox(Point3lf(position(rng), position(rng), position(rng)),
+            Vector3lf(size(rng), size(rng), size(rng)));
+        const double expected = length(boxGap(box1, box2));
+        const GjkResult<double> result = gjkDistance(box1, box2);
+        EXPECT_EQ(result.intersecting, expected == 0.0);
+        EXPECT_EQ(gjkIntersect(box1, box2), expected == 0.0);
+        if (expected == 0.0)
+            continue;
+
+        ++separated;
+        EXPECT_NEAR(result.distance, expected, 1e-9);
+        EXPECT_NEAR(distance(result.point1, result.point2), expected, 1e-9);
+        expectInside(result.point1, box1, 1e-9);
+        expectInside(result.point2, box2, 1e-9);
+    }
+    EXPECT_GT(separated, 100u);
+}
+
+TEST(GjkTest, OverlappingBoxes)
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> position(-1, 1);
+    std::uniform_real_distribution<double> size(0.5, 1.5);
+    size_t overlapping = 0;
+    for (index_t i = 0; i < 300; ++i)
+    {
+        const Box3<double> box1 = makeBox(Point3lf(position(rng), position(rng), position(rng)),
+            Vector3lf(size(rng), size(rng), size(rng)));
+        const Box3<double> box2 = makeBox(Point3lf(position(rng), position(rng), position(rng)),
+            Vector3lf(size(rng), size(rng), size(rng)));
+        if (length2(boxGap(box1, box2)) > 0.0 || boxPenetration(box1, box2) < 1e-3)
+            continue;
+
+        ++overlapping;
+        Penetration<double> penetration;
+        ASSERT_TRUE(epaPenetration(box1, box2, penetration));
+        EXPECT_NEAR(penetration.depth, boxPenetration(box1, box2), 1e-9);
+        EXPECT_NEAR(length(penetration.normal), 1.0, 1e-9);
+
+        // Moving the second box out along the normal leaves the boxes touching
+        const Vector3lf offset = penetration.normal * penetration.depth;
+        const Box3<double> moved(box2.min() + offset, box2.max() + offset);
+        EXPECT_NEAR(gjkDistance(box1, moved).distance, 0.0, 1e-9);
+        const Vector3lf further = penetration.normal * (penetration.depth + 1e-6);
+        EXPECT_FALSE(gjkIntersect(box1, Box3<double>(box2.min() + further, box2.max() + further)));
+    }
+    EXPECT_GT(overlapping, 100u);
+}
+
+TEST(GjkTest, Spheres)
+{
+    const Sphere3lf sphere1(Point3lf(1, 2, 3), 1.5);
+    const Sphere3lf separated(Point3lf(1, 2, 3) + normalize(Vector3lf(1, -2, 2)) * 5.0, 0.5);
+    const GjkResult<double> result = gjkDistance(sphere1, separated);
+    EXPECT_FALSE(result.intersecting);
+    EXPECT_NEAR(result.distance, 3.0, 1e-12);
+    EXPECT_NEAR(distance(result.point1, sphere1.center()), 1.5, 1e-12);
+    EXPECT_NEAR(distance(result.point2, separated.center()), 0.5, 1e-12);
+
+    const Sphere3lf overlapping(Point3lf(1, 2, 3) + normalize(Vector3lf(-3, 0, 4)) * 1.25, 0.75);
+    EXPECT_TRUE(gjkIntersect(sphere1, overlapping));
+    Penetration<double> penetration;
+    ASSERT_TRUE(epaPenetration(sphere1, overlapping, penetration));
+    EXPECT_NEAR(penetration.depth, 1.0, 1e-9);
+    EXPECT_NEAR(penetration.normal[0], -0.6, 1e-9);
+    EXPECT_NEAR(penetration.normal[1], 0.0, 1e-9);
+    EXPECT_NEAR(penetration.normal[2], 0.8, 1e-9);
+    EXPECT_FALSE(epaPenetration(sphere1, separated, penetration));
+}
+
+TEST(GjkTest, SphereAndBox)
+{
+    // The closest point of the box is its corner (1, 1, 1)
+    const Box3<double> box(Point3lf(-1, -1, -1), Point3lf(1, 1, 1));
+    const Sphere3lf sphere(Point3lf(3, 3, 3), 1.0);
+    const GjkResult<double> result = gjkDistance(box, sphere);
+    EXPECT_NEAR(result.distance, 2.0 * std::sqrt(3.0) - 1.0, 1e-9);
+    EXPECT_NEAR(distance(result.point1, Point3lf(1, 1, 1)), 0.0, 1e-9);
+
+    // Sunk 0.25 into the face x = 1
+    Penetration<double> penetration;
+    ASSERT_TRUE(epaPenetration(box, Sphere3lf(Point3lf(1.75, 0.2, -0.3), 1.0), penetration));
+    EXPECT_NEAR(penetration.depth, 0.25, 1e-9);
+    EXPECT_NEAR(penetration.normal[0], 1.0, 1e-9);
+}
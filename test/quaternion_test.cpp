@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+using namespace fmath;
+
+namespace
+{
+
+void expectNear(const Vector3lf &v1, const Vector3lf &v2, double epsilon = 1e-12)
+{
+    for (index_t i = 0; i < 3; ++i)
+        EXPECT_NEAR(v1[i], v2[i], epsilon) << "component " << i;
+}
+
+}
+
+TEST(QuatTest, MultiplicationOfUnitQuaternions)
+{
+    const Quatlf i(0, 1, 0, 0);
+    const Quatlf j(0, 0, 1, 0);
+    const Quatlf k(0, 0, 0, 1);
+
+    EXPECT_EQ(i * j, k);
+    EXPECT_EQ(j * k, i);
+    EXPECT_EQ(k * i, j);
+    EXPECT_EQ(j * i, -k);
+    EXPECT_EQ(i * i, Quatlf(-1, 0, 0, 0));
+}
+
+TEST(QuatTest, MultiplicationComposesRotations)
+{
+    const Quatlf q1 = Quatlf::makeRotation(normalize(Vector3lf(1, 2, 3)), 0.7);
+    const Quatlf q2 = Quatlf::makeRotation(normalize(Vector3lf(-2, 0, 1)), 1.9);
+    const Vector3lf v(0.5, -1.0, 2.0);
+
+    // q1 * q2 rotates by q2 first, then by q1
+    expectNear(rotate(q1 * q2, v), rotate(q1, rotate(q2, v)));
+
+    Quatlf q = q1;
+    q *= q2;
+    expectNear(rotate(q, v), rotate(q1, rotate(q2, v)));
+}
+
+TEST(QuatTest, MatrixMatchesRotation)
+{
+    const Quatlf q = Quatlf::makeRotation(normalize(Vector3lf(0.3, -1, 0.6)), 2.3);
+    const Matrix3lf m = q.toMatrix3();
+    const Matrix4lf m4 = q.toMatrix();
+    const Vector3lf v(1.5, 0.25, -2.0);
+
+    expectNear(m * v, rotate(q, v));
+    const Vector4lf r = m4 * Vector4lf(v[0], v[1], v[2], 0);
+    expectNear(Vector3lf(r[0], r[1], r[2]), rotate(q, v));
+}
+
+TEST(QuatTest, CompoundAssignment)
+{
+    Quatlf q(1, 2, 3, 4);
+    q -= Quatlf(0.5, 1, 1.5, 2);
+    EXPECT_EQ(q, Quatlf(0.5, 1, 1.5, 2));
+
+    q += Quatlf(0.5, 1, 1.5, 2);
+    EXPECT_EQ(q, Quatlf(1, 2, 3, 4));
+
+    Quatlf &scaled = (q *= 2.0);
+    EXPECT_EQ(&scaled, &q);
+    EXPECT_EQ(q, Quatlf(2, 4, 6, 8));
+
+    Quatlf &divided = (q /= 4.0);
+    EXPECT_EQ(&divided, &q);
+    EXPECT_EQ(q, Quatlf(0.5, 1, 1.5, 2));
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+#include <random>
+
+using namespace fmath;
+
+namespace
+{
+
+// Origins snapped to the planes of the box faces and directions with signed zero components, the rays lying in a
+// slab plane whose candidate distances are NaN
+template<typename T, size_t W>
+void expectPacketMatchesScalar(size_t count)
+{
+    std::mt19937 rng(23);
+    std::uniform_real_distribution<T> coordinate(static_cast<T>(-2), static_cast<T>(3));
+    std::uniform_int_distribution<int> choice(0, 5);
+    const Box3<T> box(Point3<T>(0, 0, 0), Point3<T>(1, 1, 1));
+    size_t hits = 0;
+    for (index_t i = 0; i < count; ++i)
+    {
+        RayPacket<T, W> packet = RayPacket<T, W>::makeEmpty();
+        for (index_t l = 0; l < W; ++l)
+        {
+            Point3<T> origin(coordinate(rng), coordinate(rng), coordinate(rng));
+            Vector3<T> direction(coordinate(rng), coordinate(rng), coordinate(rng));
+            for (index_t k = 0; k < 3; ++k)
+            {
+                const int c = choice(rng);
+                if (c == 0)
+                    origin[k] = box.min()[k];
+                else if (c == 1)
+                    origin[k] = box.max()[k];
+
+                const int d = choice(rng);
+                if (d == 0)
+                    direction[k] = static_cast<T>(0);
+                else if (d == 1)
+                    direction[k] = -static_cast<T>(0);
+            }
+            packet.set(l, origin, direction);
+        }
+
+        alignas(64) T t_near[W];
+        const uint32 hit = intersect(packet, box, t_near);
+        for (index_t l = 0; l < W; ++l)
+        {
+            T expected_near;
+            T expected_far;
+            const bool expected = intersect(packet.get(l), box, expected_near, expected_far);
+            ASSERT_EQ((hit >> l & 1U) != 0, expected) << "origin " << packet.origin(l) << " direction "
+                << packet.direction(l);
+            if (expected)
+            {
+                ++hits;
+                EXPECT_EQ(t_near[l], expected_near);
+            }
+        }
+    }
+    EXPECT_GT(hits, count / 4);
+}
+
+}
+
+TEST(RayPacketTest, BoxOriginOnFace)
+{
+    // Every ray lies in the plane of a face, with a zero direction component across it, and enters through another
+    RayPacket4<float> packet = RayPacket4<float>::makeEmpty();
+    packet.set(0, Point3f(-1, 0.5F, 0), Vector3f(1, 0, 0));
+    packet.set(1, Point3f(-1, 0.5F, 0), Vector3f(1, -0.0F, 0));
+    packet.set(2, Point3f(-1, 0, 1), Vector3f(1, 0, -0.0F));
+    packet.set(3, Point3f(2, 1, 0.5F), Vector3f(-1, 0, 0));
+
+    alignas(16) float t_near[4];
+    EXPECT_EQ(intersect(packet, Box3<float>(Point3f(0, 0, 0), Point3f(1, 1, 1)), t_near), 0xFU);
+    EXPECT_EQ(t_near[0], 1.0F);
+    EXPECT_EQ(t_near[3], 1.0F);
+}
+
+TEST(RayPacketTest, BoxMatchesScalarFloat4)
+{
+    expectPacketMatchesScalar<float, 4>(5000);
+}
+
+TEST(RayPacketTest, BoxMatchesScalarFloat8)
+{
+    expectPacketMatchesScalar<float, 8>(5000);
+}
+
+TEST(RayPacketTest, BoxMatchesScalarDouble4)
+{
+    expectPacketMatchesScalar<double, 4>(5000);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+#include <random>
+
+using namespace fmath;
+
+namespace
+{
+
+// Rays aimed at the diagonal shared by the two triangles of a convex quad, each of which must hit at least one of
+// them. Returns the number of rays slipping through the diagonal.
+template<typename T>
+size_t countSharedEdgeLeaks(size_t count)
+{
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<T> coordinate(static_cast<T>(-10), static_cast<T>(10));
+    std::uniform_real_distribution<T> offset(static_cast<T>(0.5), static_cast<T>(2));
+    std::uniform_real_distribution<T> along(static_cast<T>(0.05), static_cast<T>(0.95));
+    size_t leaks = 0;
+    for (index_t i = 0; i < count; ++i)
+    {
+        // p and q are the shared diagonal, r and s lie on either side of it, in a plane through p and q
+        const Point3<T> p(coordinate(rng), coordinate(rng), coordinate(rng));
+        const Point3<T> q(coordinate(rng), coordinate(rng), coordinate(rng));
+        const Vector3<T> side = normalize(cross(q - p, Vector3<T>(coordinate(rng), coordinate(rng), coordinate(rng))));
+        const Point3<T> middle = p + (q - p) * static_cast<T>(0.5);
+        const Point3<T> r = middle + side * offset(rng);
+        const Point3<T> s = middle - side * offset(rng);
+        const Triangle3<T> triangle1(p, q, r);
+        const Triangle3<T> triangle2(q, p, s);
+
+        const Point3<T> target = p + (q - p) * along(rng);
+        const Point3<T> origin(coordinate(rng), coordinate(rng), coordinate(rng));
+        const RayPrecomputed<T> ray(origin, target - origin);
+
+        T t;
+        T u;
+        T v;
+        const bool hit1 = intersectWatertight(ray, triangle1, t, u, v);
+        const bool hit2 = intersectWatertight(ray, triangle2, t, u, v);
+        leaks += hit1 || hit2 ? 0 : 1;
+    }
+    return leaks;
+}
+
+}
+
+TEST(RayTest, WatertightSharedEdgeFloat)
+{
+    EXPECT_EQ(countSharedEdgeLeaks<float>(200000), 0u);
+}
+
+TEST(RayTest, WatertightSharedEdgeDouble)
+{
+    EXPECT_EQ(countSharedEdgeLeaks<double>(200000), 0u);
+}
+
+TEST(RayTest, WatertightMatchesMollerTrumbore)
+{
+    std::mt19937 rng(19);
+    std::uniform_real_distribution<double> coordinate(-5, 5);
+    size_t hits = 0;
+    for (index_t i = 0; i < 10000; ++i)
+    {
+        const Triangle3lf triangle(Point3lf(coordinate(rng), coordinate(rng), coordinate(rng)),
+            Point3lf(coordinate(rng), coordinate(rng), coordinate(rng)),
+            Point3lf(coordinate(rng), coordinate(rng), coordinate(rng)));
+        const Point3lf origin(coordinate(rng), coordinate(rng), coordinate(rng));
+        const Point3lf target(coordinate(rng) * 0.3, coordinate(rng) * 0.3, coordinate(rng) * 0.3);
+        const Ray3<double> ray(origin, target - origin);
+
+        double t1;
+        double u1;
+        double v1;
+        double t2;
+        double u2;
+        double v2;
+        const bool hit1 = intersect(ray, triangle, t1, u1, v1);
+        const bool hit2 = intersectWatertight(ray, triangle, t2, u2, v2);
+        // Only rays grazing an edge may disagree
+        if (hit1 != hit2)
+        {
+            EXPECT_TRUE(min(min(u1, v1), 1.0 - u1 - v1) < 1e-9 || min(min(u2, v2), 1.0 - u2 - v2) < 1e-9);
+            continue;
+        }
+        if (!hit1)
+            continue;
+
+        ++hits;
+        EXPECT_NEAR(t1, t2, 1e-9 * max(t1, 1.0));
+        EXPECT_NEAR(u1, u2, 1e-9);
+        EXPECT_NEAR(v1, v2, 1e-9);
+    }
+    EXPECT_GT(hits, 100u);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+using namespace fmath;
+
+namespace
+{
+
+Matrix4lf makeDiagonal(double x, double y, double z, const Vector3lf &translation = Vector3lf(0, 0, 0))
+{
+    Matrix4lf m = Matrix4lf::identity();
+    m[0][0] = x;
+    m[1][1] = y;
+    m[2][2] = z;
+    m[3][0] = translation[0];
+    m[3][1] = translation[1];
+    m[3][2] = translation[2];
+    return m;
+}
+
+// The transform applies and inverts as its matrix does, whatever kind it was given
+void expectConsistent(const Matrix4lf &m)
+{
+    const Transform<double> transform(m);
+    const Point3lf point(1, 2, 3);
+    const Vector4lf expected = m * Vector4lf(point[0], point[1], point[2], 1);
+    const Point3lf result = transform.apply(point);
+    for (index_t i = 0; i < 3; ++i)
+        EXPECT_NEAR(result[i], expected[i], 1e-12) << "component " << i;
+
+    const Point3lf back = transform.inverse().apply(result);
+    for (index_t i = 0; i < 3; ++i)
+        EXPECT_NEAR(back[i], point[i], 1e-12) << "component " << i;
+}
+
+}
+
+TEST(TransformTest, ClassifyIdentityAndTranslation)
+{
+    EXPECT_EQ(classifyTransform(Matrix4lf::identity()), TransformKind::Identity);
+    EXPECT_EQ(classifyTransform(makeDiagonal(1, 1, 1, Vector3lf(1, 2, 3))), TransformKind::Translation);
+}
+
+TEST(TransformTest, ClassifyPositiveDiagonal)
+{
+    EXPECT_EQ(classifyTransform(makeDiagonal(2, 2, 2)), TransformKind::UniformScale);
+    EXPECT_EQ(classifyTransform(makeDiagonal(1, 2, 3)), TransformKind::Affine);
+}
+
+TEST(TransformTest, ClassifyHalfTurns)
+{
+    // diag(-1, -1, 1) is a half turn about z, not the identity
+    EXPECT_EQ(classifyTransform(makeDiagonal(-1, -1, 1)), TransformKind::Rotation);
+    EXPECT_EQ(classifyTransform(makeDiagonal(-1, 1, -1, Vector3lf(0, 0, 5))), TransformKind::Rigid);
+    EXPECT_EQ(classifyTransform(makeDiagonal(-2, -2, 2)), TransformKind::Rotation | TransformKind::UniformScale);
+
+    const Transform<double> half_turn(makeDiagonal(-1, -1, 1));
+    EXPECT_TRUE(half_turn.isRigid());
+    EXPECT_FALSE(half_turn.isIdentity());
+}
+
+TEST(TransformTest, ClassifyReflections)
+{
+    EXPECT_EQ(classifyTransform(makeDiagonal(-1, 1, 1)), TransformKind::Affine);
+    EXPECT_EQ(classifyTransform(makeDiagonal(-1, -1, -1)), TransformKind::Affine);
+    EXPECT_EQ(classifyTransform(makeDiagonal(-2, -2, -2)), TransformKind::Affine);
+    EXPECT_FALSE(Transform<double>(makeDiagonal(-1, 1, 1)).isRigid());
+}
+
+TEST(TransformTest, ApplyAndInverseMatchMatrix)
+{
+    expectConsistent(makeDiagonal(-1, -1, 1));
+    expectConsistent(makeDiagonal(-1, 1, 1));
+    expectConsistent(makeDiagonal(-1, -1, 1, Vector3lf(5, 0, 0)));
+    expectConsistent(makeDiagonal(-2, -2, -2));
+    expectConsistent(makeDiagonal(-2, -2, 2, Vector3lf(1, 0, 0)));
+    expectConsistent(makeDiagonal(2, 2, 2));
+    expectConsistent(makeDiagonal(1, 1, 1, Vector3lf(0, 3, 0)));
+}
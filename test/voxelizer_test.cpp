@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <fmath/fmath.h>
+
+#include <random>
+
+using namespace fmath;
+
+namespace
+{
+
+// Over the bounds of expectBruteForce the voxels are 1/8 on every axis, so that their faces are exact
+const Point3u resolution(37, 20, 17);
+
+// Collinear triangles, triangles with a repeated vertex and segments lying on voxel faces
+template<typename T>
+std::vector<Triangle3<T>> makeCollinearTriangles(size_t count)
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<T> x(static_cast<T>(-0.5), static_cast<T>(5));
+    std::uniform_real_distribution<T> y(static_cast<T>(-0.5), static_cast<T>(3));
+    std::uniform_real_distribution<T> z(static_cast<T>(-0.5), static_cast<T>(2.5));
+    std::uniform_real_distribution<T> along(static_cast<T>(-0.5), static_cast<T>(1.5));
+    std::vector<Triangle3<T>> result;
+    for (index_t i = 0; i < count; ++i)
+    {
+        const Point3<T> a(x(rng), y(rng), z(rng));
+        const Point3<T> b(x(rng), y(rng), z(rng));
+        if (i % 3 == 2)
+        {
+            // Along x, on the boundary between two voxel layers of y and of z
+            const T edge_y = static_cast<T>(0.5);
+            const T edge_z = static_cast<T>(1.25);
+            result.emplace_back(Point3<T>(a[0], edge_y, edge_z), Point3<T>(b[0], edge_y, edge_z),
+                Point3<T>(a[0] + (b[0] - a[0]) * along(rng), edge_y, edge_z));
+        }
+        else if (i % 3 == 1)
+        {
+            result.emplace_back(a, b, b);
+        }
+        else
+        {
+            result.emplace_back(a, b, a + (b - a) * along(rng));
+        }
+    }
+    return result;
+}
+
+template<typename T>
+void expectBruteForce(const std::vector<Triangle3<T>> &triangles)
+{
+    const Box3<T> bounds(Point3<T>(0, 0, 0), Point3<T>(4.625, 2.5, 2.125));
+    const VoxelizePartition partitions[2] = { VoxelizePartition::Triangles, VoxelizePartition::Bricks };
+    for (const VoxelizePartition partition : partitions)
+    {
+        VoxelGrid<T> dense(bounds, resolution);
+        SparseVoxelGrid<T> sparse(bounds, resolution);
+        dense.voxelize(triangles.data(), triangles.size(), partition);
+        sparse.voxelize(triangles.data(), triangles.size(), partition);
+
+        size_t expected_count = 0;
+        for (uint32 z = 0; z < resolution[2]; ++z)
+        {
+            for (uint32 y = 0; y < resolution[1]; ++y)
+            {
+                for (uint32 x = 0; x < resolution[0]; ++x)
+                {
+                    const Box3<T> voxel = dense.voxelBounds(x, y, z);
+                    bool expected = false;
+                    for (const Triangle3<T> &triangle : triangles)
+                        expected = expected || overlaps(triangle, voxel);
+                    expected_count += expected ? 1 : 0;
+                    ASSERT_EQ(dense.get(x, y, z), expected) << "voxel " << x << " " << y << " " << z;
+                    ASSERT_EQ(sparse.get(x, y, z), expected) << "voxel " << x << " " << y << " " << z;
+                }
+            }
+        }
+        EXPECT_GT(expected_count, 0u);
+        EXPECT_EQ(dense.count(), expected_count);
+        EXPECT_EQ(sparse.count(), expected_count);
+        EXPECT_EQ(sparse.toDense().words(), dense.words());
+    }
+}
+
+}
+
+TEST(VoxelizerTest, CollinearTrianglesFloat)
+{
+    expectBruteForce(makeCollinearTriangles<float>(60));
+}
+
+TEST(VoxelizerTest, CollinearTrianglesDouble)
+{
+    expectBruteForce(makeCollinearTriangles<double>(60));
+}
+
+TEST(VoxelizerTest, SegmentAlongVoxelEdge)
+{
+    // Lies on the edge shared by four voxels of every x, which all touch it
+    const Triangle3lf triangle(Point3lf(0.1, 0.5, 0.5), Point3lf(0.9, 0.5, 0.5), Point3lf(0.5, 0.5, 0.5));
+    VoxelGrid<double> grid(Box3<double>(Point3lf(0, 0, 0), Point3lf(1, 1, 1)), Point3u(8, 8, 8));
+    grid.voxelize(&triangle, 1);
+    EXPECT_EQ(grid.count(), 8u * 4u);
+    for (uint32 x = 0; x < 8; ++x)
+    {
+        EXPECT_TRUE(grid.get(x, 3, 3));
+        EXPECT_TRUE(grid.get(x, 4, 4));
+        EXPECT_FALSE(grid.get(x, 2, 3));
+    }
+}